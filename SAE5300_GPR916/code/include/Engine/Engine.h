@@ -1,6 +1,7 @@
 #ifndef __SAE5300_GPR916_ENGINE_H__
 #define __SAE5300_GPR916_ENGINE_H__
 
+#include <atomic>
 #include <memory>
 
 #include "Platform/Input.h"
@@ -12,13 +13,24 @@
 #include "Platform/DirectX11/DirectX11Mesh.h"
 #include "Platform/DirectX11/DirectX11Light.h"
 
-#include "Renderer/RendererDTO.h"
+#include "Engine/EntityRegistry.h"
+#include "Engine/FrameArena.h"
+#include "Engine/LightSystem.h"
+#include "Engine/SceneComponents.h"
+#include "Engine/SIMDMath.h"
+#include "Engine/TextureDecodeService.h"
+#include "Engine/WorkerPool.h"
+
+#include "Platform/DirectX11/DirectX11RenderGraphAllocator.h"
 
-struct Node {
-  uint64_t objectId;
+#include "Renderer/LightClusters.h"
+#include "Renderer/MaskedOcclusionCulling.h"
+#include "Renderer/RenderGraph.h"
+#include "Renderer/SceneBVH.h"
+#include "Renderer/ShadowAtlas.h"
+#include "Renderer/StaticBatcher.h"
 
-  std::vector<struct Node> children;
-};
+#include "Renderer/RendererDTO.h"
 
 namespace SAE {
   namespace Engine {
@@ -27,36 +39,156 @@ namespace SAE {
     using namespace SAE::Resources;
     using namespace SAE::DirectX11;
     using namespace SAE::DTO;
+    using SAE::Texture::TextureDecodeService;
 
     using Camera = SAE::DirectX11::Camera;
 
+    /**********************************************************************************************//**
+     * \class Engine
+     *
+     * \brief Simulates and renders the scene, whose objects and lights are entities of m_registry.
+     *
+     * Entities and components are only created and removed by initialize(). From then on the
+     * update side writes component values and the render side reads the mesh, material and
+     * bounds components and the sparse indices of the pools, which stay as they are.
+     **************************************************************************************************/
     class Engine {
     public:
+      using RenderPassFn = std::function<void(RenderScene const&, PassType const&)>;
+
+      // Unshadowed point light circling a fixed centre; lit through the light clusters only.
+      struct DynamicLight {
+        XMFLOAT3 center;
+        XMFLOAT3 position;
+        XMFLOAT3 color;
+        float    orbitRadius;
+        float    orbitSpeed;   // radians per second
+        float    phase;
+        float    range;
+        float    intensity;
+      };
+
+      /**********************************************************************************************//**
+       * \struct FramePacket
+       *
+       * \brief Everything renderFrame() needs of one simulated frame, copied out by capture().
+       *
+       * Once captured, a packet belongs to the render side: it may cache into its camera and
+       * fit the cascades of its lights, but update() never touches it, so update() can simulate
+       * the next frame while this one is submitted.
+       **************************************************************************************************/
+      struct FramePacket {
+        uint64_t                  frameIndex;
+        Timer::State              time;
+        Camera                    camera;
+        LightSystem               lights;         // Light pool in dense order; light id k + 1 is light k
+        std::vector<XMMATRIX>     worldMatrices;  // WorldMatrix pool in dense order
+        std::vector<XMMATRIX>     normalMatrices; // their WorldMatrix::normalMatrix
+        std::vector<DynamicLight> dynamicLights;
+        uint32_t                  displayMode;
+        bool                      pickRequested;  // P pressed: renderFrame() logs the object in the view's centre
+      };
+
+      struct RaycastHit {
+        SAE::ECS::Entity entity;
+        uint32_t         triangle;  // in the index buffer of the entity's mesh
+        float            distance;  // along the ray, in units of its direction
+      };
+
       bool initialize(std::shared_ptr<DirectX11ResourceManager> &resourceManager);
       bool update(
         const Timer::State &time,
         const InputState   &inputState);
+      // Copies the state update() produced into outPacket; call between update() and the next.
+      void capture(
+        const Timer::State &time,
+        FramePacket        &outPacket);
       bool render(
         PassType    const&passType,
         RenderScene      &sceneHolder,
         uint64_t    const&cubeIndex      = 0,
         uint64_t    const&shadowMapIndex = 0);
+      bool renderFrame(
+        FramePacket       &packet,
+        uint32_t     const&width,
+        uint32_t     const&height,
+        RenderPassFn const&renderPass);
       bool deinitialize();
 
+      // Closest triangle of the meshes with a TriangleBVH hit by origin + t * direction, t in
+      // [0, maxDistance], at the world matrices of frame. Render side: reads the scene BVH as
+      // renderFrame() last updated it.
+      bool raycast(
+        FramePacket const&frame,
+        XMVECTOR    const&origin,
+        XMVECTOR    const&direction,
+        float             maxDistance,
+        RaycastHit       &outHit);
+
+      inline SAE::Rendering::RenderGraph const& frameGraph() const { return m_frameGraph; }
+
     private:
+      // Simplified CPU-side geometry rasterized into the occlusion buffer in place of objectId.
+      struct OccluderMesh {
+        uint64_t              objectId;
+        std::vector<float>    positions;
+        std::vector<uint32_t> indices;
+      };
+
+      // Capacity of the cluster light buffer; the shadowed lights come first.
+      static const uint32_t MaxClusterLights = 1024;
+
+      uint32_t         addMesh(SAE::DirectX11::DirectX11MeshPtr const&mesh);
+      SAE::ECS::Entity createObject(uint32_t mesh, DX11Transform const&transform, SAE::ECS::Entity parent = SAE::ECS::NullEntity);
+      void             flattenHierarchy();
+
+      // World matrix of an entity in the frame being rendered; nullptr without a transform.
+      XMMATRIX const* frameWorldMatrix(FramePacket const&frame, uint64_t const&objectId);
+      XMMATRIX const* frameNormalMatrix(FramePacket const&frame, uint64_t const&objectId);
+
+      void buildStaticBatches(std::shared_ptr<DirectX11ResourceManager> &resourceManager);
+
+      void updateSceneBVH();
+      void queryFrustum(XMMATRIX const&viewProjection, bool clipNear, SAE::Memory::FrameVector<uint8_t> &outVisible) const;
+      void queryFrustum(LightSystem::Plane const *planes, uint32_t planeCount, SAE::Memory::FrameVector<uint8_t> &outVisible) const;
+
+      static bool loadOccluderMesh(std::string const&filename, uint64_t objectId, OccluderMesh &outOccluder);
+      void cullOccludedObjects(RenderScene &sceneHolder);
+
+      // Atlas key of one shadow view (cube face) of a light.
+      static inline uint64_t shadowViewKey(uint64_t lightId, uint64_t face) { return (lightId << 3) | face; }
+      float shadowImportance(LightSystem const&lights, uint32_t light, Camera &camera);
+      void cullShadowCasters(RenderScene &sceneHolder, uint32_t light, uint64_t const&view);
+
+      void buildLightClusters(uint32_t const&width, uint32_t const&height);
+
+      // Logs heap allocations the calling thread made since mark, once past the warm-up frames;
+      // see SAE::Memory::ThreadHeapAllocations().
+      void checkFrameAllocations(char const *stage, uint64_t frameIndex, uint64_t mark);
+
       uint64_t
         m_cameraBuffer,
         m_objectBuffer,
         m_lightBuffer,
         m_otherBuffer,
+        m_ambientBuffer,
+        m_clusterBuffer,
         m_shadowMapLightBufferId;
 
       Camera m_defaultCamera;
 
-      Node   m_hierarchyRoot;
-      std::map<uint64_t, SAE::DirectX11::DirectX11MeshPtr> m_meshes;
-      std::map<uint64_t, SAE::DirectX11::DX11TransformPtr> m_transforms;
-      std::map<uint64_t, Light> m_lights;
+      SAE::ECS::Registry                            m_registry;
+      std::vector<SAE::DirectX11::DirectX11MeshPtr> m_meshAssets;             // indexed by MeshRef::mesh
+      std::vector<uint32_t>                         m_transformParents;       // per transform: the parent's, or InvalidIndex
+      std::vector<size_t>                           m_hierarchyLevelOffsets;  // transform pool range of every level, then the end
+      std::vector<DynamicLight>                     m_dynamicLights;
+      LightSystem                                   m_lights;                 // the Light pool as of the last capture()
+      std::vector<SAE::ECS::Entity>                 m_staticBatches;
+
+      SAE::ECS::Entity
+        m_controlledLight,  // moved by WASD/QE
+        m_lightMarker,      // sphere following m_controlledLight
+        m_floor;
 
       uint64_t
         m_diffuseTextureId,
@@ -67,11 +199,44 @@ namespace SAE {
         m_glossTextureSRVId,
         m_normalTextureId,
         m_normalTextureSRVId,
-        m_shadowMapTextureId,
-        m_shadowMapSRVId,
-        m_shadowMapDSVId[24];
+        m_environmentMapTextureId,
+        m_environmentMapSRVId;
+
+      std::shared_ptr<TextureDecodeService> m_textureDecodeService;
+
+      SAE::Threading::WorkerPool               m_workerPool;
+      SAE::Rendering::MaskedOcclusionCulling   m_occlusionCulling;
+      std::vector<OccluderMesh>                m_occluders;
+
+      // World space bounds of the MeshRef pool, item k for entity k of the pool; render side.
+      SAE::Rendering::SceneBVH                 m_sceneBVH;
+      std::vector<XMMATRIX>                    m_sceneBVHWorlds;  // per item, as last put into m_sceneBVH
+
+      std::shared_ptr<DirectX11RenderGraphAllocator> m_frameGraphAllocator;
+      SAE::Rendering::RenderGraph                    m_frameGraph;
+      uint32_t                                       m_frameGraphPassCount;
+      SAE::Rendering::ShadowAtlas                    m_shadowAtlas;
+
+      SAE::Rendering::LightClusters                          m_lightClusters;
+      std::vector<SAE::Rendering::LightClusters::LightSphere> m_clusterSpheres;
+      std::vector<ClusterLight_t>                            m_clusterLights;
+      ClusterBuffer_t                                        m_clusterConstants;
+      uint64_t
+        m_clusterLightBuffer,
+        m_clusterLightsSRVId,
+        m_clusterCellBuffer,
+        m_clusterCellsSRVId,
+        m_clusterIndexBuffer,
+        m_clusterIndicesSRVId;
 
       uint32_t m_displayMode;
+      bool     m_pickKeyDown;
+      bool     m_pickRequested;
+      uint64_t m_frameIndex;
+      uint64_t m_updateAllocationMark;
+      std::atomic<uint32_t> m_allocationReports;
+
+      FramePacket *m_renderPacket;  // during renderFrame() only
     };
 
   }
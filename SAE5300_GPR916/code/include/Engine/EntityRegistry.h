@@ -0,0 +1,279 @@
+#ifndef __SAE5300_GPR916_ENTITYREGISTRY_H__
+#define __SAE5300_GPR916_ENTITYREGISTRY_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace SAE {
+  namespace ECS {
+
+    // Index in the low 24 bits, generation in the high 8; 0 is never a valid entity.
+    typedef uint32_t Entity;
+
+    static const Entity   NullEntity   = 0;
+    static const uint32_t EntityBits   = 24;
+    static const uint32_t EntityMask   = (1u << EntityBits) - 1;
+    static const uint32_t InvalidIndex = 0xFFFFFFFF;
+
+    inline uint32_t EntityIndex(Entity entity)      { return entity & EntityMask; }
+    inline uint32_t EntityGeneration(Entity entity) { return entity >> EntityBits; }
+
+    // Sequential id per component type, see ComponentPool<T>::Type().
+    uint32_t NextComponentType();
+
+    class ComponentPoolBase {
+    public:
+      virtual ~ComponentPoolBase() {}
+
+      virtual bool remove(Entity entity) = 0;
+    };
+
+    /**********************************************************************************************//**
+     * \class ComponentPool
+     *
+     * \brief Sparse set of the components of one type: dense arrays plus an index per entity.
+     *
+     * Components and their entities are packed into two parallel vectors, so a system iterating
+     * the pool reads them linearly; the sparse array maps an entity index to the dense position
+     * in O(1). Removing swaps the last component into the gap, so dense positions are only
+     * stable while nothing is removed or reordered.
+     *
+     * Not synchronized: adding, removing and reordering must not overlap other accesses.
+     * Components may be read and written from several threads as long as every one is
+     * touched by a single thread.
+     **************************************************************************************************/
+    template <typename T>
+    class ComponentPool
+      : public ComponentPoolBase
+    {
+    public:
+      static uint32_t Type()
+      {
+        static uint32_t const type = NextComponentType();
+        return type;
+      }
+
+      // Overwrites the component if the entity already has one.
+      T& add(Entity entity, T const&component)
+      {
+        uint32_t const index = EntityIndex(entity);
+        if(index >= m_sparse.size())
+          m_sparse.resize(index + 1, InvalidIndex);
+
+        uint32_t &slot = m_sparse[index];
+        if(slot != InvalidIndex && m_entities[slot] == entity) {
+          m_components[slot] = component;
+          return m_components[slot];
+        }
+
+        slot = static_cast<uint32_t>(m_entities.size());
+        m_entities.push_back(entity);
+        m_components.push_back(component);
+        return m_components.back();
+      }
+
+      bool remove(Entity entity)
+      {
+        uint32_t const slot = indexOf(entity);
+        if(slot == InvalidIndex)
+          return false;
+
+        uint32_t const last = static_cast<uint32_t>(m_entities.size() - 1);
+        if(slot != last) {
+          m_entities[slot]   = m_entities[last];
+          m_components[slot] = std::move(m_components[last]);
+          m_sparse[EntityIndex(m_entities[slot])] = slot;
+        }
+
+        m_entities.pop_back();
+        m_components.pop_back();
+        m_sparse[EntityIndex(entity)] = InvalidIndex;
+        return true;
+      }
+
+      // Dense position of the entity's component; InvalidIndex without one.
+      inline uint32_t indexOf(Entity entity) const
+      {
+        uint32_t const index = EntityIndex(entity);
+        if(index >= m_sparse.size())
+          return InvalidIndex;
+
+        uint32_t const slot = m_sparse[index];
+        return (slot != InvalidIndex && m_entities[slot] == entity) ? slot : InvalidIndex;
+      }
+
+      inline bool has(Entity entity) const { return (indexOf(entity) != InvalidIndex); }
+
+      inline T* find(Entity entity)
+      {
+        uint32_t const slot = indexOf(entity);
+        return (slot != InvalidIndex) ? &m_components[slot] : nullptr;
+      }
+
+      inline T const* find(Entity entity) const
+      {
+        uint32_t const slot = indexOf(entity);
+        return (slot != InvalidIndex) ? &m_components[slot] : nullptr;
+      }
+
+      // The listed entities with a component move to the front, in the given order; the others
+      // follow in their previous order.
+      void reorder(Entity const*order, size_t count)
+      {
+        std::vector<uint8_t> placed(m_entities.size(), 0);
+        std::vector<Entity>  entities;
+        std::vector<T>       components;
+        entities.reserve(m_entities.size());
+        components.reserve(m_components.size());
+
+        for(size_t k=0; k < count; ++k) {
+          uint32_t const slot = indexOf(order[k]);
+          if(slot == InvalidIndex || placed[slot])
+            continue;
+
+          placed[slot] = 1;
+          entities.push_back(m_entities[slot]);
+          components.push_back(std::move(m_components[slot]));
+        }
+
+        for(size_t slot=0; slot < m_entities.size(); ++slot)
+          if(!placed[slot]) {
+            entities.push_back(m_entities[slot]);
+            components.push_back(std::move(m_components[slot]));
+          }
+
+        m_entities.swap(entities);
+        m_components.swap(components);
+        for(size_t slot=0; slot < m_entities.size(); ++slot)
+          m_sparse[EntityIndex(m_entities[slot])] = static_cast<uint32_t>(slot);
+      }
+
+      void clear()
+      {
+        m_sparse.clear();
+        m_entities.clear();
+        m_components.clear();
+      }
+
+      inline size_t size() const { return m_entities.size(); }
+
+      inline Entity const* entities() const { return m_entities.data(); }
+      inline T*            data()           { return m_components.data(); }
+      inline T const*      data()     const { return m_components.data(); }
+
+      inline T&       operator[](size_t index)       { return m_components[index]; }
+      inline T const& operator[](size_t index) const { return m_components[index]; }
+
+    private:
+      std::vector<uint32_t> m_sparse;      // per entity index: dense position or InvalidIndex
+      std::vector<Entity>   m_entities;    // dense
+      std::vector<T>        m_components;  // dense, parallel to m_entities
+    };
+
+    /**********************************************************************************************//**
+     * \class Registry
+     *
+     * \brief Creates entities and owns one ComponentPool per component type.
+     *
+     * An entity is only an id; everything about it lives in components. Systems ask for the
+     * pool of the component they process and iterate it linearly, looking up the other
+     * components they need through the sparse index; each() does so for the common case.
+     * Destroyed entity indices are reused with the next generation, so stale ids of destroyed
+     * entities find no components.
+     **************************************************************************************************/
+    class Registry {
+    public:
+      Registry();
+
+      Entity create();
+      bool   destroy(Entity entity);
+      bool   alive(Entity entity) const;
+      void   clear();
+
+      // Live entities.
+      inline size_t size() const { return m_generations.size() - 1 - m_free.size(); }
+
+      template <typename T>
+      ComponentPool<T>& pool()
+      {
+        uint32_t const type = ComponentPool<T>::Type();
+        if(type >= m_pools.size())
+          m_pools.resize(type + 1);
+        if(!m_pools[type])
+          m_pools[type].reset(new ComponentPool<T>());
+
+        return *static_cast<ComponentPool<T>*>(m_pools[type].get());
+      }
+
+      template <typename T>
+      ComponentPool<T> const* findPool() const
+      {
+        uint32_t const type = ComponentPool<T>::Type();
+        return (type < m_pools.size()) ? static_cast<ComponentPool<T> const*>(m_pools[type].get()) : nullptr;
+      }
+
+      template <typename T>
+      T& add(Entity entity, T const&component = T()) { return pool<T>().add(entity, component); }
+
+      template <typename T>
+      bool remove(Entity entity) { return pool<T>().remove(entity); }
+
+      template <typename T>
+      T* find(Entity entity) { return pool<T>().find(entity); }
+
+      template <typename T>
+      T const* find(Entity entity) const
+      {
+        ComponentPool<T> const*components = findPool<T>();
+        return components ? components->find(entity) : nullptr;
+      }
+
+      template <typename T>
+      bool has(Entity entity) const
+      {
+        ComponentPool<T> const*components = findPool<T>();
+        return components && components->has(entity);
+      }
+
+      // fn(entity, a, b) for every entity with both components, in the dense order of TA.
+      template <typename TA, typename TB, typename TFn>
+      void each(TFn const&fn)
+      {
+        ComponentPool<TA> &a = pool<TA>();
+        ComponentPool<TB> &b = pool<TB>();
+        for(size_t k=0; k < a.size(); ++k) {
+          Entity   const entity = a.entities()[k];
+          uint32_t const slot   = b.indexOf(entity);
+          if(slot != InvalidIndex)
+            fn(entity, a[k], b[slot]);
+        }
+      }
+
+    private:
+      Registry(Registry const&)            = delete;
+      Registry& operator=(Registry const&) = delete;
+
+      std::vector<uint8_t>                            m_generations;  // per entity index; index 0 unused
+      std::vector<uint32_t>                           m_free;         // indices of destroyed entities
+      std::vector<std::unique_ptr<ComponentPoolBase>> m_pools;        // per component type
+    };
+
+    struct EntityBenchmarkResult {
+      size_t entityCount;
+      double mapMs;       // std::map<uint64_t, shared_ptr> per component, as Engine had
+      double registryMs;  // the same pass iterating component pools
+      double speedup;
+      bool   valid;       // both computed the same result
+    };
+
+    // Integrates positions of entityCount entities, of which every second one has a velocity,
+    // once through maps of shared pointers and once through a Registry.
+    EntityBenchmarkResult BenchmarkEntityIteration(size_t entityCount = 250000, uint32_t iterations = 20);
+
+  }
+}
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef __SAE5300_GPR916_ENVIRONMENTMAP_H__
+#define __SAE5300_GPR916_ENVIRONMENTMAP_H__
+
+#include <string>
+#include <vector>
+
+#include "Engine/Texture.h"
+
+namespace SAE {
+  namespace Texture {
+
+    // D3D11 cube face order, matching the array slice index of a TEXTURECUBE.
+    enum CubeFace {
+      CubeFacePositiveX = 0,
+      CubeFaceNegativeX,
+      CubeFacePositiveY,
+      CubeFaceNegativeY,
+      CubeFacePositiveZ,
+      CubeFaceNegativeZ,
+      CubeFaceCount
+    };
+
+    // Skybox sets name their faces rt/lf/up/dn/ft/bk; returns them in CubeFace order,
+    // e.g. ("resources/textures/envmap_miramar/", "miramar", ".tga").
+    std::vector<std::string> CubeMapFaceFilenames(
+      std::string const&directory,
+      std::string const&prefix,
+      std::string const&extension);
+
+    /**********************************************************************************************//**
+     * \struct SHIrradiance
+     *
+     * \brief Cosine-convolved L2 spherical harmonics of an environment, RGB.
+     *
+     * Basis constants and the 1/pi of the Lambert BRDF are folded in, so the diffuse ambient
+     * term for a unit normal n is simply albedo * sum(coefficients[i] * p_i(n)) with
+     *   p = { 1, y, z, x, xy, yz, 3z^2 - 1, xz, x^2 - y^2 }.
+     * Laid out as float4s so it uploads straight into a constant buffer.
+     **************************************************************************************************/
+    struct SHIrradiance {
+      float coefficients[9][4];
+    };
+
+    struct EnvironmentPreprocessOptions {
+      unsigned int specularSize;   // edge length of the prefiltered cube's top mip (capped to the source)
+      unsigned int sampleCount;    // GGX samples per texel and mip
+      unsigned int threadCount;    // 0: hardware concurrency
+
+      EnvironmentPreprocessOptions()
+        : specularSize(128)
+        , sampleCount(64)
+        , threadCount(0)
+      {}
+    };
+
+    struct EnvironmentLighting {
+      SHIrradiance        irradiance;
+      // 6 slices of RGBA8 (sRGB-encoded like the source) with full mip chains;
+      // mip m is prefiltered for GGX roughness m / (mipLevels - 1).
+      Texture2DDescriptor specular;
+    };
+
+    // cube: six square RGBA8 sRGB slices in CubeFace order. Only level 0 of each slice is read.
+    bool ProjectCubeMapToSH(
+      Texture2DDescriptor const&cube,
+      SHIrradiance             &outIrradiance,
+      unsigned int              threadCount = 0);
+
+    bool PrefilterSpecularCubeMap(
+      Texture2DDescriptor          const&cube,
+      EnvironmentPreprocessOptions const&options,
+      Texture2DDescriptor               &outSpecular);
+
+    bool PreprocessEnvironmentMap(
+      Texture2DDescriptor          const&cube,
+      EnvironmentPreprocessOptions const&options,
+      EnvironmentLighting               &outLighting);
+
+    // The cache sits next to the first face ("<face 0>.envcache") and is only accepted
+    // while the face files keep their size and modification time and the options match.
+    std::string EnvironmentCachePath(std::vector<std::string> const&faceFilenames);
+
+    bool LoadEnvironmentCache(
+      std::vector<std::string>     const&faceFilenames,
+      EnvironmentPreprocessOptions const&options,
+      EnvironmentLighting               &outLighting);
+
+    bool SaveEnvironmentCache(
+      std::vector<std::string>     const&faceFilenames,
+      EnvironmentPreprocessOptions const&options,
+      EnvironmentLighting          const&lighting);
+
+  }
+}
+
+#endif
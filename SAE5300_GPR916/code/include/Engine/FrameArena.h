@@ -0,0 +1,133 @@
+#ifndef __SAE5300_GPR916_FRAMEARENA_H__
+#define __SAE5300_GPR916_FRAMEARENA_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace SAE {
+  namespace Memory {
+
+    /**********************************************************************************************//**
+     * \class FrameArena
+     *
+     * \brief Bump allocator for memory that lives until the end of its thread's frame.
+     *
+     * Every thread has its own arena, see local(); allocations only move an offset and are all
+     * released at once by reset(), which the thread calls when its frame is done. An arena that
+     * ran out of its chunk continues in a larger one; the next reset() replaces all chunks by
+     * one as large as all of them together, so once a frame fitted, later frames of the same
+     * size allocate nothing from the heap.
+     *
+     * An arena is not synchronized: only its own thread allocates from it. Memory handed out
+     * may be read and written by other threads until reset().
+     **************************************************************************************************/
+    class FrameArena {
+    public:
+      struct Stats {
+        uint64_t used;      // bytes handed out since reset(), alignment included
+        uint64_t peak;      // largest used at a reset()
+        uint64_t capacity;  // bytes of all chunks
+        uint32_t chunks;
+        uint32_t grows;     // chunks added since the arena was created
+      };
+
+      static const size_t InitialChunkSize = 64 * 1024;
+
+      FrameArena();
+
+      // The calling thread's arena.
+      static FrameArena& local();
+
+      // size bytes aligned to alignment (a power of two); never nullptr.
+      void* allocate(size_t size, size_t alignment);
+
+      // Memory is only reclaimed by reset().
+      inline void deallocate(void *, size_t) {}
+
+      // Invalidates everything allocated so far. Containers using the arena must be gone.
+      void reset();
+
+      Stats stats() const;
+
+    private:
+      struct Chunk {
+        std::unique_ptr<uint8_t[]> memory;
+        size_t                     size;
+      };
+
+      FrameArena(FrameArena const&)            = delete;
+      FrameArena& operator=(FrameArena const&) = delete;
+
+      void addChunk(size_t size);
+
+      std::vector<Chunk> m_chunks;     // allocations come from the last one
+      size_t             m_offset;     // into the last chunk
+      uint64_t           m_retired;    // bytes used in the chunks before the last one
+      uint64_t           m_peak;
+      uint32_t           m_grows;
+    };
+
+    /**********************************************************************************************//**
+     * \class FrameAllocator
+     *
+     * \brief STL allocator on a FrameArena, by default the one of the constructing thread.
+     *
+     * Containers using it are frame locals: they must be destroyed before their arena is reset
+     * and may only grow on the arena's thread. Copies share the arena.
+     **************************************************************************************************/
+    template <typename T>
+    class FrameAllocator {
+    public:
+      typedef T value_type;
+
+      FrameAllocator()
+        : m_arena(&FrameArena::local())
+      {}
+
+      explicit FrameAllocator(FrameArena &arena)
+        : m_arena(&arena)
+      {}
+
+      template <typename U>
+      FrameAllocator(FrameAllocator<U> const&other)
+        : m_arena(other.arena())
+      {}
+
+      T* allocate(size_t count)
+      {
+        return static_cast<T*>(m_arena->allocate(count * sizeof(T), alignof(T)));
+      }
+
+      void deallocate(T *pointer, size_t count)
+      {
+        m_arena->deallocate(pointer, count * sizeof(T));
+      }
+
+      inline FrameArena* arena() const { return m_arena; }
+
+    private:
+      FrameArena *m_arena;
+    };
+
+    template <typename T, typename U>
+    inline bool operator==(FrameAllocator<T> const&lhs, FrameAllocator<U> const&rhs) { return lhs.arena() == rhs.arena(); }
+
+    template <typename T, typename U>
+    inline bool operator!=(FrameAllocator<T> const&lhs, FrameAllocator<U> const&rhs) { return lhs.arena() != rhs.arena(); }
+
+    template <typename T>
+    using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+    // Heap allocations (operator new) made by the calling thread so far. Counted only in builds
+    // defining SAE_CHECK_FRAME_ALLOCATIONS, 0 otherwise.
+    uint64_t ThreadHeapAllocations();
+
+    // Heap allocations made by all threads so far, counted like ThreadHeapAllocations().
+    uint64_t HeapAllocations();
+
+  }
+}
+
+#endif
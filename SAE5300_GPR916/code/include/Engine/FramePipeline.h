@@ -0,0 +1,193 @@
+#ifndef __SAE5300_GPR916_FRAMEPIPELINE_H__
+#define __SAE5300_GPR916_FRAMEPIPELINE_H__
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace SAE {
+  namespace Threading {
+
+    /**********************************************************************************************//**
+     * \class FramePipeline
+     *
+     * \brief Hands frame packets from one producing to one consuming thread through a ring of slots.
+     *
+     * The producer (update) thread fills a free slot between beginWrite() and endWrite(); the
+     * consumer (render) thread takes published slots in order between beginRead() and endRead().
+     * A slot belongs to exactly one side at a time, so a packet is never written while it is read
+     * and needs no locking of its own. Slots and their contents are reused, so packets keep the
+     * capacity of their containers from frame to frame.
+     *
+     * framesInFlight bounds how far the producer may run ahead: 1 serializes both sides, 2 lets
+     * update work on frame N + 1 while frame N is submitted, 3 buffers one more frame. Every
+     * further slot adds a frame of latency between input and its picture.
+     **************************************************************************************************/
+    template <typename TPacket>
+    class FramePipeline {
+    public:
+      struct Options {
+        uint32_t framesInFlight;
+
+        Options()
+          : framesInFlight(2)
+        {}
+      };
+
+      struct Stats {
+        uint64_t produced;
+        uint64_t consumed;
+        double   producerWaitMs;  // beginWrite() blocked on a free slot
+        double   consumerWaitMs;  // beginRead() blocked on a published slot
+      };
+
+      FramePipeline()
+        : m_slots()
+        , m_state()
+        , m_writeIndex(0)
+        , m_readIndex(0)
+        , m_stopped(true)
+        , m_stats()
+      {}
+
+      ~FramePipeline()
+      {
+        deinitialize();
+      }
+
+      bool initialize(Options const&options = Options())
+      {
+        deinitialize();
+
+        if(!options.framesInFlight)
+          return false;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_slots.resize(options.framesInFlight);
+        m_state.assign(options.framesInFlight, SlotState::Free);
+        m_writeIndex = 0;
+        m_readIndex  = 0;
+        m_stopped    = false;
+        m_stats      = Stats();
+        return true;
+      }
+
+      // Wakes both sides; beginWrite() and beginRead() return nullptr from then on. Slots still
+      // held must not be used after the call returned.
+      void deinitialize()
+      {
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          m_stopped = true;
+        }
+        m_slotFree.notify_all();
+        m_slotPublished.notify_all();
+      }
+
+      // Producer: the next slot in order, once the consumer released it; nullptr once stopped.
+      TPacket* beginWrite()
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        waitFor(lock, m_slotFree, m_writeIndex, SlotState::Free, m_stats.producerWaitMs);
+        if(m_stopped)
+          return nullptr;
+
+        m_state[m_writeIndex] = SlotState::Writing;
+        return &m_slots[m_writeIndex];
+      }
+
+      // Producer: publishes the packet of the last beginWrite().
+      void endWrite(TPacket *packet)
+      {
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          if(!packet || packet != &m_slots[m_writeIndex] || m_state[m_writeIndex] != SlotState::Writing)
+            return;
+
+          m_state[m_writeIndex] = SlotState::Published;
+          m_writeIndex          = (m_writeIndex + 1) % m_slots.size();
+          ++m_stats.produced;
+        }
+        m_slotPublished.notify_one();
+      }
+
+      // Consumer: the oldest published packet; nullptr once stopped.
+      TPacket* beginRead()
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        waitFor(lock, m_slotPublished, m_readIndex, SlotState::Published, m_stats.consumerWaitMs);
+        if(m_stopped)
+          return nullptr;
+
+        m_state[m_readIndex] = SlotState::Reading;
+        return &m_slots[m_readIndex];
+      }
+
+      // Consumer: returns the packet of the last beginRead() to the producer.
+      void endRead(TPacket *packet)
+      {
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          if(!packet || packet != &m_slots[m_readIndex] || m_state[m_readIndex] != SlotState::Reading)
+            return;
+
+          m_state[m_readIndex] = SlotState::Free;
+          m_readIndex          = (m_readIndex + 1) % m_slots.size();
+          ++m_stats.consumed;
+        }
+        m_slotFree.notify_one();
+      }
+
+      inline uint32_t framesInFlight() const { return static_cast<uint32_t>(m_slots.size()); }
+
+      Stats stats() const
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_stats;
+      }
+
+    private:
+      enum class SlotState {
+        Free,
+        Writing,
+        Published,
+        Reading
+      };
+
+      typedef std::chrono::high_resolution_clock Clock;
+
+      void waitFor(
+        std::unique_lock<std::mutex> &lock,
+        std::condition_variable      &condition,
+        size_t                 const&index,
+        SlotState              const&state,
+        double                       &waitMs)
+      {
+        if(m_stopped || m_state[index] == state)
+          return;
+
+        Clock::time_point const start = Clock::now();
+        condition.wait(lock, [&] () -> bool { return m_stopped || m_state[index] == state; });
+        waitMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+      }
+
+      FramePipeline(FramePipeline const&)            = delete;
+      FramePipeline& operator=(FramePipeline const&) = delete;
+
+      mutable std::mutex      m_mutex;
+      std::condition_variable m_slotFree;
+      std::condition_variable m_slotPublished;
+      std::vector<TPacket>    m_slots;
+      std::vector<SlotState>  m_state;
+      size_t                  m_writeIndex;
+      size_t                  m_readIndex;
+      bool                    m_stopped;
+      Stats                   m_stats;
+    };
+
+  }
+}
+
+#endif
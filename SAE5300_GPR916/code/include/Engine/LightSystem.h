@@ -0,0 +1,102 @@
+#ifndef __SAE5300_GPR916_LIGHTSYSTEM_H__
+#define __SAE5300_GPR916_LIGHTSYSTEM_H__
+
+#include <cstdint>
+#include <vector>
+
+#include "Platform/DirectX11/DirectX11Light.h"
+
+#include "Renderer/SceneBVH.h"
+
+namespace SAE {
+  namespace Engine {
+    using DirectX::XMMATRIX;
+    using DirectX::XMVECTOR;
+    using SAE::DirectX11::Light;
+
+    /**********************************************************************************************//**
+     * \class LightSystem
+     *
+     * \brief The lights of a frame as structure of arrays, with their shadow views.
+     *
+     * sync() copies position, direction and range of every light of the Light pool into flat
+     * arrays and recomputes the view-projections of those point and spot lights whose shadow
+     * views changed with them: the position or range of a point light, also the direction and
+     * cone of a spot light. All changed lights are combined in one batch through
+     * SAE::Math::MultiplyMatrices. The frustum planes of every view are extracted along with
+     * it, so shadow caster culling does not derive them per pass. Directional cascades follow
+     * the camera and are fitted by fitCascades() on the render side instead.
+     *
+     * Lights are indexed like the Light pool: light id k + 1 is light k. Views past
+     * shadowViewCount() repeat the last one.
+     **************************************************************************************************/
+    class LightSystem {
+    public:
+      using Plane = SAE::Rendering::SceneBVH::Plane;
+
+      static const uint32_t MaxShadowViews = Light::MaxShadowViews;
+      static const uint32_t PlanesPerView  = 6;
+
+      // Brings the arrays up to lights[0, count); returns the number of lights whose shadow
+      // views were recomputed.
+      uint32_t sync(Light const *lights, size_t count);
+
+      // Fits the cascades of directional light k to slices of the camera frustum up to
+      // shadowDistance. tileSizes: atlas tile size per cascade, its texel grid is snapped to
+      // (0: no snapping). Does nothing for the other types.
+      void fitCascades(
+        uint32_t       light,
+        XMMATRIX const&cameraView,
+        XMMATRIX const&cameraProjection,
+        float          shadowDistance,
+        uint32_t const tileSizes[Light::CascadeCount]);
+
+      inline size_t size() const { return m_types.size(); }
+
+      inline Light::Type              type(uint32_t light)       const { return m_types[light];      }
+      inline Light::Properties const& properties(uint32_t light) const { return m_properties[light]; }
+      inline float                    range(uint32_t light)      const { return m_ranges[light];     }
+      inline uint32_t shadowViewCount(uint32_t light) const { return Light::ShadowViewCount(m_types[light]); }
+
+      inline XMVECTOR position(uint32_t light)  const { return DirectX::XMVectorSet(m_positionX[light],  m_positionY[light],  m_positionZ[light],  1.0f); }
+      inline XMVECTOR direction(uint32_t light) const { return DirectX::XMVectorSet(m_directionX[light], m_directionY[light], m_directionZ[light], 0.0f); }
+
+      // view * projection per shadow view, MaxShadowViews of them.
+      inline XMMATRIX const* viewProjectionMatrices(uint32_t light)              const { return &m_viewProjections[light * MaxShadowViews]; }
+      inline XMMATRIX const& viewProjectionMatrix(uint32_t light, uint64_t view) const { return m_viewProjections[(light * MaxShadowViews) + view]; }
+
+      // Frustum planes of one view, see SceneBVH::FrustumPlanes(). Directional cascades have
+      // no near plane: casters between the light and the cascade still cast.
+      inline Plane const* frustumPlanes(uint32_t light, uint64_t view) const { return &m_planes[((light * MaxShadowViews) + view) * PlanesPerView]; }
+      inline uint32_t     frustumPlaneCount(uint32_t light)           const { return (m_types[light] == Light::Type::Directional) ? 5 : 6; }
+
+    private:
+      void updateShadowViews();
+      void updateFrustumPlanes(uint32_t light);
+
+      std::vector<Light::Type>       m_types;
+      std::vector<Light::Properties> m_properties;
+      std::vector<float>
+        m_positionX,
+        m_positionY,
+        m_positionZ,
+        m_directionX,  // normalized
+        m_directionY,
+        m_directionZ,
+        m_ranges,
+        m_fieldOfViews;
+      std::vector<uint8_t>  m_valid;  // 0 until the first sync() of the light
+
+      std::vector<XMMATRIX> m_viewProjections;  // MaxShadowViews per light
+      std::vector<Plane>    m_planes;           // PlanesPerView per view
+
+      // Scratch of sync(), empty in between: kept for its capacity, copies carry none of it.
+      std::vector<uint32_t> m_changed;
+      std::vector<float>    m_views;
+      std::vector<float>    m_projections;
+    };
+
+  }
+}
+
+#endif
@@ -42,6 +42,10 @@ namespace SAE {
       VertexBuffer_t const& vertexBuffer() const { return m_vertexBuffer; }
       IndexBuffer_t  const& indexBuffer()  const { return m_indexBuffer;  }
 
+      // Object space bounding box of the vertex positions.
+      TVector const& boundsMin() const { return m_boundsMin; }
+      TVector const& boundsMax() const { return m_boundsMax; }
+
       static bool LoadMeshAssimp(
         const char     *filename,
         VertexBuffer_t &outVB,
@@ -52,10 +56,14 @@ namespace SAE {
     protected:
       VertexBuffer_t& vertexBuffer() { return m_vertexBuffer; }
       IndexBuffer_t&  indexBuffer()  { return m_indexBuffer;  }
+
+      void setBounds(TVector const&boundsMin, TVector const&boundsMax) { m_boundsMin = boundsMin; m_boundsMax = boundsMax; }
       
     private:
       VertexBuffer_t m_vertexBuffer;
       IndexBuffer_t  m_indexBuffer;
+      TVector        m_boundsMin;
+      TVector        m_boundsMax;
     };
 
     template <typename TVector>
@@ -0,0 +1,101 @@
+#ifndef __SAE5300_GPR916_PIXELCONVERSION_H__
+#define __SAE5300_GPR916_PIXELCONVERSION_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace SAE {
+  namespace Texture {
+
+    /**********************************************************************************************//**
+     * Pixel format conversion kernels used by texture import.
+     *
+     * Every kernel has a scalar reference path and SSE4.1 / AVX2 paths selected at runtime
+     * from cpuid, so one binary runs everywhere. Passing an explicit level forces a path
+     * (capped to what the CPU supports); the benchmark uses that to compare them.
+     *
+     * All counts are in pixels. 8-bit RGBA is the canonical layout; in-place operation
+     * (src == dst) is allowed wherever source and destination have the same pixel size.
+     * The integer kernels give bit-identical results on every path.
+     **************************************************************************************************/
+    enum class PixelKernelLevel {
+      Scalar = 0,
+      SSE41,
+      AVX2,
+      Best
+    };
+
+    PixelKernelLevel SupportedPixelKernelLevel();
+    const char*      PixelKernelLevelName(PixelKernelLevel level);
+
+    // 1, 2 or 3 channels -> RGBA8. Gray is replicated to RGB, missing alpha is 255.
+    // channels == 4 is a plain copy.
+    void ExpandToRGBA(
+      const uint8_t   *src,
+      unsigned int     channels,
+      uint8_t         *dst,
+      size_t           count,
+      PixelKernelLevel level = PixelKernelLevel::Best);
+
+    // dst[k] = src[order[k]] for each of the four channels, e.g. { 2, 1, 0, 3 } for RGBA <-> BGRA.
+    void SwizzleRGBA(
+      const uint8_t   *src,
+      uint8_t         *dst,
+      size_t           count,
+      const uint8_t    order[4],
+      PixelKernelLevel level = PixelKernelLevel::Best);
+
+    // rgb = round(rgb * a / 255), alpha untouched.
+    void PremultiplyAlpha(
+      const uint8_t   *src,
+      uint8_t         *dst,
+      size_t           count,
+      PixelKernelLevel level = PixelKernelLevel::Best);
+
+    // RGBA8 sRGB -> RGBA32F linear. Alpha is linear already and only scaled to [0, 1].
+    void SRGBToLinear(
+      const uint8_t   *src,
+      float           *dst,
+      size_t           count,
+      PixelKernelLevel level = PixelKernelLevel::Best);
+
+    // RGBA32F linear -> RGBA8 sRGB, clamped to [0, 1]. Colour is encoded with the
+    // table-driven approximation from stb_image_resize (error < 0.6 ulp).
+    void LinearToSRGB(
+      const float     *src,
+      uint8_t         *dst,
+      size_t           count,
+      PixelKernelLevel level = PixelKernelLevel::Best);
+
+    // RGBA8 normal map -> two-channel XY (RG8), as stored by BC5/RG textures.
+    void ExtractNormalXY(
+      const uint8_t   *src,
+      uint8_t         *dst,
+      size_t           count,
+      PixelKernelLevel level = PixelKernelLevel::Best);
+
+    // RG8 XY -> RGBA8 normal with z = sqrt(1 - x^2 - y^2) in blue, alpha 255.
+    void ReconstructNormalZ(
+      const uint8_t   *src,
+      uint8_t         *dst,
+      size_t           count,
+      PixelKernelLevel level = PixelKernelLevel::Best);
+
+    struct PixelKernelBenchmarkResult {
+      std::string      kernel;
+      PixelKernelLevel level;
+      double           megapixelsPerSecond;
+      double           speedupOverScalar;
+    };
+
+    // Times every kernel on every supported level over a pixelCount-sized image.
+    std::vector<PixelKernelBenchmarkResult> BenchmarkPixelConversion(
+      size_t       pixelCount = 4096 * 4096,
+      unsigned int iterations = 8);
+
+  }
+}
+
+#endif
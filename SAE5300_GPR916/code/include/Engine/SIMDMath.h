@@ -0,0 +1,584 @@
+#ifndef __SAE5300_GPR916_SIMDMATH_H__
+#define __SAE5300_GPR916_SIMDMATH_H__
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Register backend of the inline operations, fixed at compile time: SSE2 is part of the x64
+// baseline and the MSVC x86 default, NEON of AArch64. SAE_MATH_FORCE_SCALAR selects the
+// plain float backend anywhere.
+#if !defined(SAE_MATH_FORCE_SCALAR) && (defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__))
+  #define SAE_MATH_SSE  1
+  #define SAE_MATH_NEON 0
+  #include <emmintrin.h>
+  #if defined(__SSE4_1__) || defined(__AVX__)
+    #define SAE_MATH_SSE41 1
+    #include <smmintrin.h>
+  #else
+    #define SAE_MATH_SSE41 0
+  #endif
+  #if defined(__FMA__) || defined(__AVX2__)
+    #define SAE_MATH_FMA 1
+    #include <immintrin.h>
+  #else
+    #define SAE_MATH_FMA 0
+  #endif
+#elif !defined(SAE_MATH_FORCE_SCALAR) && (defined(__aarch64__) || defined(_M_ARM64))
+  #define SAE_MATH_SSE  0
+  #define SAE_MATH_NEON 1
+  #include <arm_neon.h>
+#else
+  #define SAE_MATH_SSE  0
+  #define SAE_MATH_NEON 0
+#endif
+
+namespace SAE {
+  namespace Math {
+
+    /**********************************************************************************************//**
+     * Vector, matrix and quaternion math on SIMD registers, independent of DirectXMath.
+     *
+     * Conventions are DirectXMath's: row vectors transformed as v' = v * M, matrices stored as
+     * 16 floats row after row, left-handed views, clip space z in [0, 1], quaternions as
+     * (x, y, z, w). A matrix loaded with LoadMat4() from an XMFLOAT4X4 or XMMATRIX and stored
+     * back is the same matrix.
+     *
+     * Vec4 is the register type of the backend; Mat4 holds four of them and, like any type
+     * containing SIMD registers, is meant for locals: arrays on the heap are passed to the
+     * batched kernels below as floats, which need no alignment.
+     *
+     * Everything is built on a handful of per-backend primitives (arithmetic, Shuffle(),
+     * Dot3() / Dot4()), so all backends run the same algorithms.
+     **************************************************************************************************/
+#if SAE_MATH_SSE
+    typedef __m128 Vec4;
+#elif SAE_MATH_NEON
+    typedef float32x4_t Vec4;
+#else
+    struct Vec4 {
+      float f[4];
+    };
+#endif
+
+    struct Mat4 {
+      Vec4 r[4];
+    };
+
+    //
+    // Primitives
+    //
+#if SAE_MATH_SSE
+    inline Vec4  Set(float x, float y, float z, float w) { return _mm_setr_ps(x, y, z, w); }
+    inline Vec4  Splat(float s)                           { return _mm_set1_ps(s); }
+    inline Vec4  Zero()                                   { return _mm_setzero_ps(); }
+    inline Vec4  Load4(float const *p)                    { return _mm_loadu_ps(p); }
+    inline void  Store4(float *p, Vec4 v)                 { _mm_storeu_ps(p, v); }
+
+    inline float GetX(Vec4 v) { return _mm_cvtss_f32(v); }
+    inline float GetY(Vec4 v) { return _mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1))); }
+    inline float GetZ(Vec4 v) { return _mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2))); }
+    inline float GetW(Vec4 v) { return _mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3))); }
+
+    // { v1[A], v1[B], v2[C], v2[D] }
+    template <int A, int B, int C, int D>
+    inline Vec4 Shuffle(Vec4 v1, Vec4 v2) { return _mm_shuffle_ps(v1, v2, _MM_SHUFFLE(D, C, B, A)); }
+
+    inline Vec4 Add(Vec4 a, Vec4 b)      { return _mm_add_ps(a, b); }
+    inline Vec4 Subtract(Vec4 a, Vec4 b) { return _mm_sub_ps(a, b); }
+    inline Vec4 Multiply(Vec4 a, Vec4 b) { return _mm_mul_ps(a, b); }
+    inline Vec4 Divide(Vec4 a, Vec4 b)   { return _mm_div_ps(a, b); }
+    inline Vec4 Min(Vec4 a, Vec4 b)      { return _mm_min_ps(a, b); }
+    inline Vec4 Max(Vec4 a, Vec4 b)      { return _mm_max_ps(a, b); }
+    inline Vec4 Sqrt(Vec4 v)             { return _mm_sqrt_ps(v); }
+    inline Vec4 Abs(Vec4 v)              { return _mm_andnot_ps(_mm_set1_ps(-0.0f), v); }
+
+    // a * b + c
+    inline Vec4 MultiplyAdd(Vec4 a, Vec4 b, Vec4 c)
+    {
+  #if SAE_MATH_FMA
+      return _mm_fmadd_ps(a, b, c);
+  #else
+      return _mm_add_ps(_mm_mul_ps(a, b), c);
+  #endif
+    }
+
+    // The dot products in all four lanes.
+    inline Vec4 Dot4(Vec4 a, Vec4 b)
+    {
+  #if SAE_MATH_SSE41
+      return _mm_dp_ps(a, b, 0xFF);
+  #else
+      Vec4 const m = _mm_mul_ps(a, b);
+      Vec4 const s = _mm_add_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+      return _mm_add_ps(s, _mm_shuffle_ps(s, s, _MM_SHUFFLE(1, 0, 3, 2)));
+  #endif
+    }
+
+    inline Vec4 Dot3(Vec4 a, Vec4 b)
+    {
+  #if SAE_MATH_SSE41
+      return _mm_dp_ps(a, b, 0x7F);
+  #else
+      Vec4 const m = _mm_mul_ps(a, b);
+      Vec4 const x = _mm_shuffle_ps(m, m, _MM_SHUFFLE(0, 0, 0, 0));
+      Vec4 const y = _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 1, 1, 1));
+      Vec4 const z = _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 2, 2, 2));
+      return _mm_add_ps(_mm_add_ps(x, y), z);
+  #endif
+    }
+#elif SAE_MATH_NEON
+    inline Vec4  Set(float x, float y, float z, float w) { float const v[4] ={ x, y, z, w }; return vld1q_f32(v); }
+    inline Vec4  Splat(float s)                           { return vdupq_n_f32(s); }
+    inline Vec4  Zero()                                   { return vdupq_n_f32(0.0f); }
+    inline Vec4  Load4(float const *p)                    { return vld1q_f32(p); }
+    inline void  Store4(float *p, Vec4 v)                 { vst1q_f32(p, v); }
+
+    inline float GetX(Vec4 v) { return vgetq_lane_f32(v, 0); }
+    inline float GetY(Vec4 v) { return vgetq_lane_f32(v, 1); }
+    inline float GetZ(Vec4 v) { return vgetq_lane_f32(v, 2); }
+    inline float GetW(Vec4 v) { return vgetq_lane_f32(v, 3); }
+
+    // { v1[A], v1[B], v2[C], v2[D] }
+    template <int A, int B, int C, int D>
+    inline Vec4 Shuffle(Vec4 v1, Vec4 v2)
+    {
+      Vec4 result = vdupq_n_f32(vgetq_lane_f32(v1, A));
+      result = vsetq_lane_f32(vgetq_lane_f32(v1, B), result, 1);
+      result = vsetq_lane_f32(vgetq_lane_f32(v2, C), result, 2);
+      return vsetq_lane_f32(vgetq_lane_f32(v2, D), result, 3);
+    }
+
+    inline Vec4 Add(Vec4 a, Vec4 b)      { return vaddq_f32(a, b); }
+    inline Vec4 Subtract(Vec4 a, Vec4 b) { return vsubq_f32(a, b); }
+    inline Vec4 Multiply(Vec4 a, Vec4 b) { return vmulq_f32(a, b); }
+    inline Vec4 Divide(Vec4 a, Vec4 b)   { return vdivq_f32(a, b); }
+    inline Vec4 Min(Vec4 a, Vec4 b)      { return vminq_f32(a, b); }
+    inline Vec4 Max(Vec4 a, Vec4 b)      { return vmaxq_f32(a, b); }
+    inline Vec4 Sqrt(Vec4 v)             { return vsqrtq_f32(v); }
+    inline Vec4 Abs(Vec4 v)              { return vabsq_f32(v); }
+
+    // a * b + c
+    inline Vec4 MultiplyAdd(Vec4 a, Vec4 b, Vec4 c) { return vfmaq_f32(c, a, b); }
+
+    // The dot products in all four lanes.
+    inline Vec4 Dot4(Vec4 a, Vec4 b) { return vdupq_n_f32(vaddvq_f32(vmulq_f32(a, b))); }
+    inline Vec4 Dot3(Vec4 a, Vec4 b) { return vdupq_n_f32(vaddvq_f32(vsetq_lane_f32(0.0f, vmulq_f32(a, b), 3))); }
+#else
+    inline Vec4  Set(float x, float y, float z, float w) { Vec4 v ={ { x, y, z, w } }; return v; }
+    inline Vec4  Splat(float s)                           { return Set(s, s, s, s); }
+    inline Vec4  Zero()                                   { return Set(0.0f, 0.0f, 0.0f, 0.0f); }
+    inline Vec4  Load4(float const *p)                    { return Set(p[0], p[1], p[2], p[3]); }
+    inline void  Store4(float *p, Vec4 v)                 { p[0] = v.f[0]; p[1] = v.f[1]; p[2] = v.f[2]; p[3] = v.f[3]; }
+
+    inline float GetX(Vec4 v) { return v.f[0]; }
+    inline float GetY(Vec4 v) { return v.f[1]; }
+    inline float GetZ(Vec4 v) { return v.f[2]; }
+    inline float GetW(Vec4 v) { return v.f[3]; }
+
+    // { v1[A], v1[B], v2[C], v2[D] }
+    template <int A, int B, int C, int D>
+    inline Vec4 Shuffle(Vec4 v1, Vec4 v2) { return Set(v1.f[A], v1.f[B], v2.f[C], v2.f[D]); }
+
+    inline Vec4 Add(Vec4 a, Vec4 b)      { return Set(a.f[0] + b.f[0], a.f[1] + b.f[1], a.f[2] + b.f[2], a.f[3] + b.f[3]); }
+    inline Vec4 Subtract(Vec4 a, Vec4 b) { return Set(a.f[0] - b.f[0], a.f[1] - b.f[1], a.f[2] - b.f[2], a.f[3] - b.f[3]); }
+    inline Vec4 Multiply(Vec4 a, Vec4 b) { return Set(a.f[0] * b.f[0], a.f[1] * b.f[1], a.f[2] * b.f[2], a.f[3] * b.f[3]); }
+    inline Vec4 Divide(Vec4 a, Vec4 b)   { return Set(a.f[0] / b.f[0], a.f[1] / b.f[1], a.f[2] / b.f[2], a.f[3] / b.f[3]); }
+    inline Vec4 Min(Vec4 a, Vec4 b)      { return Set(std::fmin(a.f[0], b.f[0]), std::fmin(a.f[1], b.f[1]), std::fmin(a.f[2], b.f[2]), std::fmin(a.f[3], b.f[3])); }
+    inline Vec4 Max(Vec4 a, Vec4 b)      { return Set(std::fmax(a.f[0], b.f[0]), std::fmax(a.f[1], b.f[1]), std::fmax(a.f[2], b.f[2]), std::fmax(a.f[3], b.f[3])); }
+    inline Vec4 Sqrt(Vec4 v)             { return Set(std::sqrt(v.f[0]), std::sqrt(v.f[1]), std::sqrt(v.f[2]), std::sqrt(v.f[3])); }
+    inline Vec4 Abs(Vec4 v)              { return Set(std::fabs(v.f[0]), std::fabs(v.f[1]), std::fabs(v.f[2]), std::fabs(v.f[3])); }
+
+    // a * b + c
+    inline Vec4 MultiplyAdd(Vec4 a, Vec4 b, Vec4 c) { return Add(Multiply(a, b), c); }
+
+    // The dot products in all four lanes.
+    inline Vec4 Dot4(Vec4 a, Vec4 b) { return Splat(a.f[0] * b.f[0] + a.f[1] * b.f[1] + a.f[2] * b.f[2] + a.f[3] * b.f[3]); }
+    inline Vec4 Dot3(Vec4 a, Vec4 b) { return Splat(a.f[0] * b.f[0] + a.f[1] * b.f[1] + a.f[2] * b.f[2]); }
+#endif
+
+    //
+    // Vectors
+    //
+    template <int A, int B, int C, int D>
+    inline Vec4 Swizzle(Vec4 v) { return Shuffle<A, B, C, D>(v, v); }
+
+    inline Vec4 SplatX(Vec4 v) { return Swizzle<0, 0, 0, 0>(v); }
+    inline Vec4 SplatY(Vec4 v) { return Swizzle<1, 1, 1, 1>(v); }
+    inline Vec4 SplatZ(Vec4 v) { return Swizzle<2, 2, 2, 2>(v); }
+    inline Vec4 SplatW(Vec4 v) { return Swizzle<3, 3, 3, 3>(v); }
+
+    // x, y, z of v and w of w.
+    inline Vec4 SetW(Vec4 v, Vec4 w) { return Shuffle<0, 1, 0, 2>(v, Shuffle<2, 2, 3, 3>(v, w)); }
+
+    inline Vec4 Load3(float const *p, float w)  { return Set(p[0], p[1], p[2], w); }
+    inline void Store3(float *p, Vec4 v)        { p[0] = GetX(v); p[1] = GetY(v); p[2] = GetZ(v); }
+
+    inline Vec4 Scale(Vec4 v, float s) { return Multiply(v, Splat(s)); }
+    inline Vec4 Negate(Vec4 v)         { return Subtract(Zero(), v); }
+
+    inline Vec4 Cross3(Vec4 a, Vec4 b)
+    {
+      return Subtract(
+        Multiply(Swizzle<1, 2, 0, 3>(a), Swizzle<2, 0, 1, 3>(b)),
+        Multiply(Swizzle<2, 0, 1, 3>(a), Swizzle<1, 2, 0, 3>(b)));
+    }
+
+    inline Vec4 Length3(Vec4 v)    { return Sqrt(Dot3(v, v)); }
+    // All four lanes divided by the length of x, y, z, as XMVector3Normalize does.
+    inline Vec4 Normalize3(Vec4 v) { return Divide(v, Length3(v)); }
+
+    //
+    // Matrices
+    //
+    inline Mat4 Identity()
+    {
+      Mat4 const m ={ { Set(1.0f, 0.0f, 0.0f, 0.0f), Set(0.0f, 1.0f, 0.0f, 0.0f), Set(0.0f, 0.0f, 1.0f, 0.0f), Set(0.0f, 0.0f, 0.0f, 1.0f) } };
+      return m;
+    }
+
+    inline Mat4 LoadMat4(float const *p)
+    {
+      Mat4 const m ={ { Load4(p), Load4(p + 4), Load4(p + 8), Load4(p + 12) } };
+      return m;
+    }
+
+    inline void StoreMat4(float *p, Mat4 const&m)
+    {
+      Store4(p,      m.r[0]);
+      Store4(p + 4,  m.r[1]);
+      Store4(p + 8,  m.r[2]);
+      Store4(p + 12, m.r[3]);
+    }
+
+    // v * M with w = 1 (XMVector3Transform, no divide by w).
+    inline Vec4 TransformPoint(Vec4 v, Mat4 const&m)
+    {
+      Vec4 result = MultiplyAdd(SplatZ(v), m.r[2], m.r[3]);
+      result = MultiplyAdd(SplatY(v), m.r[1], result);
+      return MultiplyAdd(SplatX(v), m.r[0], result);
+    }
+
+    // v * M with w = 0 (XMVector3TransformNormal).
+    inline Vec4 TransformVector(Vec4 v, Mat4 const&m)
+    {
+      Vec4 result = Multiply(SplatZ(v), m.r[2]);
+      result = MultiplyAdd(SplatY(v), m.r[1], result);
+      return MultiplyAdd(SplatX(v), m.r[0], result);
+    }
+
+    // v * M for all four components.
+    inline Vec4 Transform4(Vec4 v, Mat4 const&m)
+    {
+      Vec4 result = Multiply(SplatW(v), m.r[3]);
+      result = MultiplyAdd(SplatZ(v), m.r[2], result);
+      result = MultiplyAdd(SplatY(v), m.r[1], result);
+      return MultiplyAdd(SplatX(v), m.r[0], result);
+    }
+
+    // a * b: a's transform, then b's.
+    inline Mat4 Multiply(Mat4 const&a, Mat4 const&b)
+    {
+      Mat4 const m ={ { Transform4(a.r[0], b), Transform4(a.r[1], b), Transform4(a.r[2], b), Transform4(a.r[3], b) } };
+      return m;
+    }
+
+    inline Mat4 Transpose(Mat4 const&m)
+    {
+      Vec4 const t0 = Shuffle<0, 1, 0, 1>(m.r[0], m.r[1]);
+      Vec4 const t1 = Shuffle<0, 1, 0, 1>(m.r[2], m.r[3]);
+      Vec4 const t2 = Shuffle<2, 3, 2, 3>(m.r[0], m.r[1]);
+      Vec4 const t3 = Shuffle<2, 3, 2, 3>(m.r[2], m.r[3]);
+
+      Mat4 const result ={ { Shuffle<0, 2, 0, 2>(t0, t1), Shuffle<1, 3, 1, 3>(t0, t1), Shuffle<0, 2, 0, 2>(t2, t3), Shuffle<1, 3, 1, 3>(t2, t3) } };
+      return result;
+    }
+
+    namespace Detail {
+      // 2x2 matrices in one register, row after row.
+      inline Vec4 Mat2Multiply(Vec4 a, Vec4 b)
+      {
+        return Add(Multiply(a, Swizzle<0, 3, 0, 3>(b)), Multiply(Swizzle<1, 0, 3, 2>(a), Swizzle<2, 1, 2, 1>(b)));
+      }
+      // adjugate(a) * b
+      inline Vec4 Mat2AdjugateMultiply(Vec4 a, Vec4 b)
+      {
+        return Subtract(Multiply(Swizzle<3, 3, 0, 0>(a), b), Multiply(Swizzle<1, 1, 2, 2>(a), Swizzle<2, 3, 0, 1>(b)));
+      }
+      // a * adjugate(b)
+      inline Vec4 Mat2MultiplyAdjugate(Vec4 a, Vec4 b)
+      {
+        return Subtract(Multiply(a, Swizzle<3, 0, 3, 0>(b)), Multiply(Swizzle<1, 0, 3, 2>(a), Swizzle<2, 1, 2, 1>(b)));
+      }
+    }
+
+    // General inverse by blockwise inversion of the 2x2 sub-matrices. outDeterminant, if
+    // given, receives the determinant; a singular matrix yields infinities and NaNs, as
+    // XMMatrixInverse does.
+    inline Mat4 Inverse(Mat4 const&m, float *outDeterminant = nullptr)
+    {
+      using namespace Detail;
+
+      Vec4 const a = Shuffle<0, 1, 0, 1>(m.r[0], m.r[1]);
+      Vec4 const b = Shuffle<2, 3, 2, 3>(m.r[0], m.r[1]);
+      Vec4 const c = Shuffle<0, 1, 0, 1>(m.r[2], m.r[3]);
+      Vec4 const d = Shuffle<2, 3, 2, 3>(m.r[2], m.r[3]);
+
+      // Determinants of a, b, c and d.
+      Vec4 const determinants = Subtract(
+        Multiply(Shuffle<0, 2, 0, 2>(m.r[0], m.r[2]), Shuffle<1, 3, 1, 3>(m.r[1], m.r[3])),
+        Multiply(Shuffle<1, 3, 1, 3>(m.r[0], m.r[2]), Shuffle<0, 2, 0, 2>(m.r[1], m.r[3])));
+      Vec4 const detA = SplatX(determinants);
+      Vec4 const detB = SplatY(determinants);
+      Vec4 const detC = SplatZ(determinants);
+      Vec4 const detD = SplatW(determinants);
+
+      Vec4 const dc = Mat2AdjugateMultiply(d, c);
+      Vec4 const ab = Mat2AdjugateMultiply(a, b);
+
+      Vec4 x = Subtract(Multiply(detD, a), Mat2Multiply(b, dc));
+      Vec4 w = Subtract(Multiply(detA, d), Mat2Multiply(c, ab));
+      Vec4 y = Subtract(Multiply(detB, c), Mat2MultiplyAdjugate(d, ab));
+      Vec4 z = Subtract(Multiply(detC, b), Mat2MultiplyAdjugate(a, dc));
+
+      Vec4 const trace = Dot4(ab, Swizzle<0, 2, 1, 3>(dc));
+      Vec4 const det   = Subtract(Add(Multiply(detA, detD), Multiply(detB, detC)), trace);
+      if(outDeterminant)
+        *outDeterminant = GetX(det);
+
+      Vec4 const inverseDet = Divide(Set(1.0f, -1.0f, -1.0f, 1.0f), det);
+      x = Multiply(x, inverseDet);
+      y = Multiply(y, inverseDet);
+      z = Multiply(z, inverseDet);
+      w = Multiply(w, inverseDet);
+
+      Mat4 const result ={ { Shuffle<3, 1, 3, 1>(x, y), Shuffle<2, 0, 2, 0>(x, y), Shuffle<3, 1, 3, 1>(z, w), Shuffle<2, 0, 2, 0>(z, w) } };
+      return result;
+    }
+
+    inline Mat4 Translation(float x, float y, float z)
+    {
+      Mat4 const m ={ { Set(1.0f, 0.0f, 0.0f, 0.0f), Set(0.0f, 1.0f, 0.0f, 0.0f), Set(0.0f, 0.0f, 1.0f, 0.0f), Set(x, y, z, 1.0f) } };
+      return m;
+    }
+
+    inline Mat4 Scaling(float x, float y, float z)
+    {
+      Mat4 const m ={ { Set(x, 0.0f, 0.0f, 0.0f), Set(0.0f, y, 0.0f, 0.0f), Set(0.0f, 0.0f, z, 0.0f), Set(0.0f, 0.0f, 0.0f, 1.0f) } };
+      return m;
+    }
+
+    // XMMatrixLookToLH
+    inline Mat4 LookToLH(Vec4 eye, Vec4 direction, Vec4 up)
+    {
+      Vec4 const axisZ = Normalize3(direction);
+      Vec4 const axisX = Normalize3(Cross3(up, axisZ));
+      Vec4 const axisY = Cross3(axisZ, axisX);
+      Vec4 const back  = Negate(eye);
+
+      Mat4 const m ={ {
+        SetW(axisX, Dot3(axisX, back)),
+        SetW(axisY, Dot3(axisY, back)),
+        SetW(axisZ, Dot3(axisZ, back)),
+        Set(0.0f, 0.0f, 0.0f, 1.0f) } };
+      return Transpose(m);
+    }
+
+    // XMMatrixPerspectiveFovLH
+    inline Mat4 PerspectiveFovLH(float fieldOfViewY, float aspectRatio, float nearZ, float farZ)
+    {
+      float const height = std::cos(0.5f * fieldOfViewY) / std::sin(0.5f * fieldOfViewY);
+      float const width  = height / aspectRatio;
+      float const range  = farZ / (farZ - nearZ);
+
+      Mat4 const m ={ { Set(width, 0.0f, 0.0f, 0.0f), Set(0.0f, height, 0.0f, 0.0f), Set(0.0f, 0.0f, range, 1.0f), Set(0.0f, 0.0f, -range * nearZ, 0.0f) } };
+      return m;
+    }
+
+    //
+    // Quaternions
+    //
+    inline Vec4 QuatIdentity() { return Set(0.0f, 0.0f, 0.0f, 1.0f); }
+
+    // The rotation by a, then by b (XMQuaternionMultiply(a, b), the product b * a).
+    inline Vec4 QuatMultiply(Vec4 a, Vec4 b)
+    {
+      Vec4 result = Multiply(SplatW(b), a);
+      result = MultiplyAdd(Multiply(SplatX(b), Swizzle<3, 2, 1, 0>(a)), Set( 1.0f, -1.0f,  1.0f, -1.0f), result);
+      result = MultiplyAdd(Multiply(SplatY(b), Swizzle<2, 3, 0, 1>(a)), Set( 1.0f,  1.0f, -1.0f, -1.0f), result);
+      return   MultiplyAdd(Multiply(SplatZ(b), Swizzle<1, 0, 3, 2>(a)), Set(-1.0f,  1.0f,  1.0f, -1.0f), result);
+    }
+
+    inline Vec4 QuatConjugate(Vec4 q) { return Multiply(q, Set(-1.0f, -1.0f, -1.0f, 1.0f)); }
+    inline Vec4 QuatNormalize(Vec4 q) { return Divide(q, Sqrt(Dot4(q, q))); }
+
+    // Rotation by angle radians around a unit axis.
+    inline Vec4 QuatRotationAxis(Vec4 axis, float angle)
+    {
+      return SetW(Scale(axis, std::sin(0.5f * angle)), Splat(std::cos(0.5f * angle)));
+    }
+
+    // Roll around z, then pitch around x, then yaw around y (XMQuaternionRotationRollPitchYaw).
+    inline Vec4 QuatRotationRollPitchYaw(float pitch, float yaw, float roll)
+    {
+      float const sp = std::sin(0.5f * pitch), cp = std::cos(0.5f * pitch);
+      float const sy = std::sin(0.5f * yaw),   cy = std::cos(0.5f * yaw);
+      float const sr = std::sin(0.5f * roll),  cr = std::cos(0.5f * roll);
+
+      return Set(
+        sp * cy * cr + cp * sy * sr,
+        cp * sy * cr - sp * cy * sr,
+        cp * cy * sr - sp * sy * cr,
+        cp * cy * cr + sp * sy * sr);
+    }
+
+    // v rotated by the unit quaternion q; w of the result is 0.
+    inline Vec4 QuatRotate(Vec4 v, Vec4 q)
+    {
+      Vec4 const pure = SetW(v, Zero());
+      return QuatMultiply(QuatMultiply(QuatConjugate(q), pure), q);
+    }
+
+    // Rotation matrix of a unit quaternion (XMMatrixRotationQuaternion).
+    inline Mat4 RotationQuaternion(Vec4 q)
+    {
+      Vec4 const q2 = Add(q, q);
+      Vec4 const xx = Multiply(SplatX(q), q2);  // 2xx 2xy 2xz 2xw
+      Vec4 const yy = Multiply(SplatY(q), q2);  // 2yx 2yy 2yz 2yw
+      Vec4 const zz = Multiply(SplatZ(q), q2);  // 2zx 2zy 2zz 2zw
+
+      float const x2x = GetX(xx), x2y = GetY(xx), x2z = GetZ(xx), x2w = GetW(xx);
+      float const y2y = GetY(yy), y2z = GetZ(yy), y2w = GetW(yy);
+      float const z2z = GetZ(zz), z2w = GetW(zz);
+
+      Mat4 const m ={ {
+        Set(1.0f - y2y - z2z, x2y + z2w,        x2z - y2w,        0.0f),
+        Set(x2y - z2w,        1.0f - x2x - z2z, y2z + x2w,        0.0f),
+        Set(x2z + y2w,        y2z - x2w,        1.0f - x2x - y2y, 0.0f),
+        Set(0.0f,             0.0f,             0.0f,             1.0f) } };
+      return m;
+    }
+
+    // Scaling, then rotation, then translation.
+    inline Mat4 ScalingRotationTranslation(Vec4 scale, Vec4 rotation, Vec4 translation)
+    {
+      Mat4 m = RotationQuaternion(rotation);
+      m.r[0] = Multiply(m.r[0], SplatX(scale));
+      m.r[1] = Multiply(m.r[1], SplatY(scale));
+      m.r[2] = Multiply(m.r[2], SplatZ(scale));
+      m.r[3] = SetW(translation, Splat(1.0f));
+      return m;
+    }
+
+    // Inverse transpose of ScalingRotationTranslation(scale, rotation, ...) without the
+    // translation, for normals: the rotation's rows divided by the scale instead of multiplied.
+    // Scales must not be zero.
+    inline Mat4 NormalMatrix(Vec4 scale, Vec4 rotation)
+    {
+      Mat4 m = RotationQuaternion(rotation);
+      m.r[0] = Divide(m.r[0], SplatX(scale));
+      m.r[1] = Divide(m.r[1], SplatY(scale));
+      m.r[2] = Divide(m.r[2], SplatZ(scale));
+      return m;
+    }
+
+    /**********************************************************************************************//**
+     * Batched kernels over arrays, dispatched at runtime like the pixel kernels: a scalar
+     * reference path, which is what DirectXMath compiles to with _XM_NO_INTRINSICS_, and
+     * SSE4.1 / AVX2 paths selected from cpuid, or NEON on AArch64. Passing an explicit level
+     * forces a path (capped to what the CPU supports); the benchmark uses that to compare.
+     *
+     * Matrices are 16 floats each, packed, in any alignment: arrays of XMFLOAT4X4 or XMMATRIX
+     * can be passed as they are. Points and boxes are structure of arrays.
+     **************************************************************************************************/
+    enum class MathKernelLevel {
+      Scalar = 0,
+      SSE41,
+      AVX2,
+      NEON,
+      Best
+    };
+
+    MathKernelLevel SupportedMathKernelLevel();
+    const char*     MathKernelLevelName(MathKernelLevel level);
+
+    // Axis aligned boxes as structure of arrays; in- and outputs may be the same arrays.
+    struct BoxesSoA {
+      float *minX, *minY, *minZ;
+      float *maxX, *maxY, *maxZ;
+    };
+
+    // out[k] = lhs[k] * rhs[k]; out may alias either input.
+    void MultiplyMatrices(
+      float const    *lhs,
+      float const    *rhs,
+      float          *out,
+      size_t          count,
+      MathKernelLevel level = MathKernelLevel::Best);
+
+    // out[k] = inverse of in[k]; out may alias in.
+    void InvertMatrices(
+      float const    *in,
+      float          *out,
+      size_t          count,
+      MathKernelLevel level = MathKernelLevel::Best);
+
+    // Points (x[k], y[k], z[k], 1) * matrix; outputs may alias inputs.
+    void TransformPoints(
+      float const    *matrix,
+      float const    *x,
+      float const    *y,
+      float const    *z,
+      float          *outX,
+      float          *outY,
+      float          *outZ,
+      size_t          count,
+      MathKernelLevel level = MathKernelLevel::Best);
+
+    // Box k through matrices[k]: the box around the transformed box, from the transformed
+    // centre and the extents through the absolute matrix. Empty boxes (minimum above maximum)
+    // come out empty or inverted, and should be filtered by the caller.
+    void TransformBoxes(
+      float const    *matrices,
+      BoxesSoA const &boxes,
+      BoxesSoA const &outBoxes,
+      size_t          count,
+      MathKernelLevel level = MathKernelLevel::Best);
+
+    struct MathKernelBenchmarkResult {
+      std::string     kernel;
+      MathKernelLevel level;
+      double          millionsPerSecond;  // matrices, points, boxes or transforms
+      double          speedupOverScalar;
+      double          maxError;           // largest absolute difference from the scalar path
+    };
+
+    // Translation, rotation (unit quaternion) and scale of transforms as structure of arrays.
+    struct TransformsSoA {
+      float const *translationX, *translationY, *translationZ;
+      float const *rotationX, *rotationY, *rotationZ, *rotationW;
+      float const *scaleX, *scaleY, *scaleZ;
+    };
+
+    // outMatrices[k] = ScalingRotationTranslation() of transform k and, unless
+    // outNormalMatrices is nullptr, outNormalMatrices[k] = its NormalMatrix(). Both are
+    // written in closed form, four or eight transforms per iteration. Normal matrices have a
+    // zero translation, so a hierarchy multiplies them down like world matrices.
+    void ComposeTransforms(
+      TransformsSoA const &transforms,
+      float               *outMatrices,
+      float               *outNormalMatrices,
+      size_t               count,
+      MathKernelLevel      level = MathKernelLevel::Best);
+
+    // Times every kernel on every supported level over count elements.
+    std::vector<MathKernelBenchmarkResult> BenchmarkMathKernels(
+      size_t       count      = 1 << 16,
+      unsigned int iterations = 64);
+
+  }
+}
+
+#endif
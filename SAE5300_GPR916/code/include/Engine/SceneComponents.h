@@ -0,0 +1,51 @@
+#ifndef __SAE5300_GPR916_SCENECOMPONENTS_H__
+#define __SAE5300_GPR916_SCENECOMPONENTS_H__
+
+#include <cstdint>
+
+#include "Platform/DirectX11/DirectX11Common.h"
+
+#include "Engine/EntityRegistry.h"
+
+namespace SAE {
+  namespace Engine {
+    using DirectX::XMFLOAT3;
+    using DirectX::XMMATRIX;
+
+    // Components of the engine's scene objects, stored in an SAE::ECS::Registry. The local
+    // transform is an SAE::DirectX11::DX11Transform and a light an SAE::DirectX11::Light.
+
+    // Composed world matrix of the entity's DX11Transform, written by Engine::update(), and
+    // the inverse transpose of its upper 3x3 for normals, with a zero translation.
+    struct WorldMatrix {
+      XMMATRIX matrix;
+      XMMATRIX normalMatrix;
+    };
+
+    // Transform hierarchy: the local transform is relative to the parent's world matrix.
+    struct Parent {
+      SAE::ECS::Entity entity;
+    };
+
+    // Index into the engine's mesh table.
+    struct MeshRef {
+      uint32_t mesh;
+    };
+
+    struct Material {
+      uint64_t diffuseTextureSRVId;
+      uint64_t specularTextureSRVId;
+      uint64_t glossTextureSRVId;
+      uint64_t normalTextureSRVId;
+    };
+
+    // Model space bounding box of the entity's mesh.
+    struct Bounds {
+      XMFLOAT3 minimum;
+      XMFLOAT3 maximum;
+    };
+
+  }
+}
+
+#endif
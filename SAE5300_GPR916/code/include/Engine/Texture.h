@@ -9,6 +9,8 @@ namespace SAE {
 
     typedef char Byte;
 
+    // inData holds one entry per array slice. With mipLevels > 1 each entry is the
+    // whole RGBA8 mip chain of its slice, largest level first and tightly packed.
     struct Texture2DDescriptor
     {
       std::vector<std::vector<Byte>> inData;
@@ -24,13 +26,42 @@ namespace SAE {
       }
     };
 
+    // Levels of a full mip chain down to 1 x 1.
+    inline unsigned int MipLevelCount(unsigned int width, unsigned int height)
+    {
+      unsigned int levels = 1;
+      while(width > 1 || height > 1) {
+        width  = (width  > 1) ? (width  >> 1) : 1;
+        height = (height > 1) ? (height >> 1) : 1;
+        ++levels;
+      }
+      return levels;
+    }
+
+    // Bytes of the first levels mips of an RGBA8 chain.
+    inline size_t MipChainByteSize(unsigned int width, unsigned int height, unsigned int levels)
+    {
+      size_t size = 0;
+      for(unsigned int k=0; k < levels; ++k) {
+        size  += (size_t)width * height * 4 * sizeof(Byte);
+        width  = (width  > 1) ? (width  >> 1) : 1;
+        height = (height > 1) ? (height >> 1) : 1;
+      }
+      return size;
+    }
+
+    // scaleDenominator 1, 2, 4 or 8 loads the images at that fraction of their size
+    // (rounded up). JPEGs are decoded straight at the reduced size, which is much
+    // cheaper than a full decode plus resize; use it for previews and low mips.
     bool SAELoadTextureArrayFromFiles(
       const std::vector<std::string> &filenames, 
-      Texture2DDescriptor            &outImage);
+      Texture2DDescriptor            &outImage,
+      unsigned int                    scaleDenominator = 1);
 
     bool SAELoadTextureFromFile(
       const char          *filename,
-      Texture2DDescriptor &outImage);
+      Texture2DDescriptor &outImage,
+      unsigned int         scaleDenominator = 1);
 
   }
 }
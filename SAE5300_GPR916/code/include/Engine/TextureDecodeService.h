@@ -0,0 +1,178 @@
+#ifndef __SAE5300_GPR916_TEXTUREDECODESERVICE_H__
+#define __SAE5300_GPR916_TEXTUREDECODESERVICE_H__
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Engine/Texture.h"
+
+namespace SAE {
+  namespace Texture {
+
+    /**********************************************************************************************//**
+     * \class TextureDecodeService
+     *
+     * \brief Decodes textures on a bounded pool of worker threads.
+     *
+     * Every image runs through four stages: file read, decode, conversion to RGBA8 and mip
+     * generation. Each stage is queued as its own task, so while one image is being decoded
+     * the next one can already be read from disk and a third one mipped; all cores stay busy
+     * during bulk loads like the texture packs or cubemap sets.
+     *
+     * Reads are dispatched by request priority (higher first, FIFO among equals). Tasks of
+     * images already in flight always go before new reads, and at most maxInFlight images
+     * are between read and completion at a time, which bounds the memory held by the pipeline.
+     *
+     * Results are delivered through a future and, optionally, a callback that is invoked on
+     * the worker thread finishing the request. Array requests complete once all their slices
+     * are done; slices must share dimensions, like SAELoadTextureArrayFromFiles requires.
+     **************************************************************************************************/
+    class TextureDecodeService {
+    public:
+      enum Stage {
+        StageRead = 0,
+        StageDecode,
+        StageConvert,
+        StageMips,
+        StageCount
+      };
+
+      struct Options {
+        unsigned int workerCount;      // 0: hardware concurrency - 1, at least 1
+        unsigned int maxInFlight;      // 0: two images per worker
+        unsigned int scaleDenominator; // 1, 2, 4 or 8, see SAELoadTextureArrayFromFiles
+        bool         generateMips;
+
+        Options()
+          : workerCount(0)
+          , maxInFlight(0)
+          , scaleDenominator(1)
+          , generateMips(true)
+        {}
+      };
+
+      enum RequestFlags {
+        FlagNone             = 0,
+        FlagPremultiplyAlpha = 1 << 0, // for images that carry alpha
+        FlagNormalMap        = 1 << 1, // renormalize: rebuild z from xy on every mip
+      };
+
+      struct Result {
+        bool                success;
+        std::string         error;
+        Texture2DDescriptor image;   // inData[k] holds the mip chain of slice k, largest first
+      };
+
+      typedef std::function<void(Result const&)> Callback;
+
+      struct StageStats {
+        uint64_t count;
+        double   totalMs;
+        double   maxMs;
+
+        inline double averageMs() const { return count ? (totalMs / count) : 0.0; }
+      };
+
+      struct Stats {
+        uint64_t   requestsSubmitted;
+        uint64_t   requestsCompleted;
+        uint64_t   requestsFailed;
+        uint64_t   imagesDecoded;
+        uint64_t   bytesRead;
+        uint64_t   bytesProduced;
+        double     busySeconds;        // wall time spent with work in the pipeline
+        double     imagesPerSecond;
+        double     megabytesReadPerSecond;
+        size_t     queueDepth;
+        size_t     peakQueueDepth;
+        size_t     inFlight;
+        StageStats queueWait;          // submit until the read starts
+        StageStats stages[StageCount];
+      };
+
+      TextureDecodeService();
+      ~TextureDecodeService();
+
+      bool initialize(Options const&options = Options());
+      bool deinitialize();
+
+      std::future<Result> submit(
+        std::string const&filename,
+        int               priority = 0,
+        Callback          callback = nullptr,
+        unsigned int      flags    = FlagNone);
+
+      std::future<Result> submitArray(
+        std::vector<std::string> const&filenames,
+        int                            priority = 0,
+        Callback                       callback = nullptr,
+        unsigned int                   flags    = FlagNone);
+
+      // Blocks until every submitted request has completed.
+      void waitIdle();
+
+      Stats stats() const;
+      void  resetStats();
+
+      static const char* stageName(Stage stage);
+
+    private:
+      typedef std::chrono::high_resolution_clock Clock;
+
+      struct Request;
+      struct Job;
+
+      struct Task {
+        std::shared_ptr<Job> job;
+        int                  priority;
+        uint64_t             sequence;
+      };
+
+      struct TaskOrder {
+        bool operator()(Task const&l, Task const&r) const;
+      };
+
+      typedef std::priority_queue<Task, std::vector<Task>, TaskOrder> TaskQueue;
+
+      std::future<Result> enqueue(
+        std::vector<std::string> const&filenames,
+        int                            priority,
+        Callback                       callback,
+        unsigned int                   flags);
+
+      void workerMain();
+      bool runStage(Job &job);
+      void finishJob(std::shared_ptr<Job> const&job, bool success);
+      void record(StageStats &stats, double ms);
+
+      Options                  m_options;
+      std::vector<std::thread> m_workers;
+
+      mutable std::mutex       m_mutex;
+      std::condition_variable  m_workAvailable;
+      std::condition_variable  m_idle;
+      TaskQueue                m_pendingReads;
+      TaskQueue                m_ready;
+      uint64_t                 m_sequence;
+      size_t                   m_inFlight;
+      size_t                   m_outstandingRequests;
+      bool                     m_running;
+
+      Clock::time_point        m_busySince;
+      Stats                    m_stats;
+    };
+
+  }
+}
+
+#endif
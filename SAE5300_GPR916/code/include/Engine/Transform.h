@@ -12,9 +12,9 @@ namespace SAE {
     class ITransform
     {
     public:
-      virtual const TFloatN& getDirection() const = 0;
-      virtual const TFloatN& getUp()        const = 0;
-      virtual const TFloatN& getRight()     const = 0;
+      virtual const TFloatN getDirection() const = 0;
+      virtual const TFloatN getUp()        const = 0;
+      virtual const TFloatN getRight()     const = 0;
 
       virtual void setScaleX(const float& factor) = 0;
       virtual void setScaleY(const float& factor) = 0;
@@ -63,8 +63,6 @@ namespace SAE {
 
       virtual void worldMatrix(const TFloat4x4& parent, TFloat4x4 *pCombined) = 0;
 
-      virtual TFloat4x4 composedWorldMatrix() const = 0;
-
     private:
       virtual void invalidate() = 0;
     };
@@ -0,0 +1,271 @@
+#ifndef __SAE5300_GPR916_VIRTUALTEXTURE_H__
+#define __SAE5300_GPR916_VIRTUALTEXTURE_H__
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Engine/Texture.h"
+
+namespace SAE {
+  namespace Texture {
+
+    /**********************************************************************************************//**
+     * \struct VirtualTextureLayout
+     *
+     * \brief Page grid of a virtual texture.
+     *
+     * Every mip level is cut into pageSize x pageSize pages. Each stored tile carries a border of
+     * neighbouring texels on all sides so bilinear/anisotropic taps near a page edge stay inside
+     * the tile; a tile is therefore tileSize() texels wide. The chain stops at the first level that
+     * fits into a single page, which is always kept resident as the final fallback.
+     **************************************************************************************************/
+    struct VirtualTextureLayout {
+      uint32_t width;
+      uint32_t height;
+      uint32_t pageSize;
+      uint32_t border;
+      uint32_t mipLevels;
+
+      inline uint32_t tileSize()  const { return pageSize + 2 * border; }
+      inline size_t   tileBytes() const { return (size_t)tileSize() * tileSize() * 4; }
+
+      inline uint32_t mipWidth(uint32_t mip)  const { uint32_t w = width  >> mip; return w ? w : 1; }
+      inline uint32_t mipHeight(uint32_t mip) const { uint32_t h = height >> mip; return h ? h : 1; }
+      inline uint32_t pagesX(uint32_t mip)    const { return (mipWidth(mip)  + pageSize - 1) / pageSize; }
+      inline uint32_t pagesY(uint32_t mip)    const { return (mipHeight(mip) + pageSize - 1) / pageSize; }
+
+      // Index of a page in mip-major, row-major order; this is also its slot in the page file.
+      uint64_t pageIndex(uint32_t mip, uint32_t x, uint32_t y) const;
+      uint64_t pageCount() const;
+
+      static VirtualTextureLayout Create(uint32_t width, uint32_t height, uint32_t pageSize, uint32_t border);
+    };
+
+    struct VirtualPage {
+      uint32_t mip;
+      uint32_t x;
+      uint32_t y;
+
+      // 8 bit mip, 12 bit x/y: up to 4096 pages per axis, i.e. 512k texels at 128 texel pages.
+      inline uint32_t key() const { return (mip << 24) | (y << 12) | x; }
+      static inline VirtualPage FromKey(uint32_t key) { return { key >> 24, key & 0xFFF, (key >> 12) & 0xFFF }; }
+    };
+
+    /**********************************************************************************************//**
+     * \class VirtualTexturePageSource
+     *
+     * \brief Supplies RGBA8 tiles (tileSize() x tileSize(), tightly packed) of a virtual texture.
+     *
+     * readPage is called from the cache's loader threads and must be thread safe.
+     **************************************************************************************************/
+    class VirtualTexturePageSource {
+    public:
+      virtual ~VirtualTexturePageSource() = default;
+
+      virtual VirtualTextureLayout const& layout() const = 0;
+      virtual bool readPage(VirtualPage const&page, Byte *outTile) = 0;
+    };
+
+    struct VirtualTextureCookOptions {
+      uint32_t pageSize;
+      uint32_t border;
+      bool     wrap;     // borders of edge pages come from the opposite edge (seamless textures)
+
+      VirtualTextureCookOptions()
+        : pageSize(128)
+        , border(4)
+        , wrap(true)
+      {}
+    };
+
+    // Builds the mip chain of a decoded RGBA8 image (slice 0, level 0) and writes all tiles to
+    // a page file. Cooking happens once per texture; at runtime only tiles are read.
+    bool CookVirtualTexture(
+      Texture2DDescriptor       const&image,
+      VirtualTextureCookOptions const&options,
+      std::string               const&pageFilename);
+
+    /**********************************************************************************************//**
+     * \class VirtualTexturePageFile
+     *
+     * \brief Page source backed by a cooked page file. Tiles have a fixed size, so a page is
+     *        located by its index alone and read with a single seek.
+     **************************************************************************************************/
+    class VirtualTexturePageFile
+      : public VirtualTexturePageSource
+    {
+    public:
+      bool open(std::string const&pageFilename);
+      void close();
+
+      VirtualTextureLayout const& layout() const override { return m_layout; }
+      bool readPage(VirtualPage const&page, Byte *outTile) override;
+
+    private:
+      std::mutex           m_mutex;
+      std::ifstream        m_file;
+      VirtualTextureLayout m_layout;
+      uint64_t             m_dataOffset;
+    };
+
+    /**********************************************************************************************//**
+     * \class VirtualTextureCache
+     *
+     * \brief Fixed-size physical page cache with LRU replacement and a page table.
+     *
+     * Per frame:
+     *   beginFrame();
+     *   request(...) / requestRegion(...) for everything visible, from CPU-side visibility;
+     *   update(uploadFn);   // issues loads, maps finished tiles into physical slots
+     *   if(pageTableDirty()) upload pageTable(mip) for every mip;
+     *
+     * Missing pages are loaded asynchronously by loaderThreads workers (0 loads synchronously
+     * inside update, which makes the cache deterministic for tests and tools). Until a page
+     * arrives its page table entry points at the nearest resident coarser page; the coarsest
+     * level is pinned, so every lookup resolves to something. Coarser pages are requested and
+     * uploaded before finer ones so the fallback improves level by level. Loads are issued only
+     * for slots that can be evicted this frame, so a visible set larger than the cache does not
+     * read the same pages again every frame.
+     *
+     * The cache itself never touches a graphics API: tiles are handed to uploadFn together
+     * with their physical slot, and the page table is plain CPU memory.
+     **************************************************************************************************/
+    class VirtualTextureCache {
+    public:
+      struct Options {
+        uint32_t physicalPagesX;      // physical texture is physicalPagesX * tileSize texels wide
+        uint32_t physicalPagesY;
+        uint32_t loaderThreads;       // 0: synchronous loads in update()
+        uint32_t maxUploadsPerFrame;  // bounds upload bandwidth per frame
+        uint32_t maxPendingLoads;     // bounds loader queue and memory held by finished tiles
+
+        Options()
+          : physicalPagesX(16)
+          , physicalPagesY(16)
+          , loaderThreads(1)
+          , maxUploadsPerFrame(16)
+          , maxPendingLoads(64)
+        {}
+      };
+
+      // One RGBA8_UINT texel per virtual page and mip: physical slot, resident mip, valid.
+      struct PageTableEntry {
+        uint8_t slotX;
+        uint8_t slotY;
+        uint8_t mip;
+        uint8_t valid;
+      };
+
+      struct Upload {
+        VirtualPage page;
+        uint32_t    slotX;
+        uint32_t    slotY;
+        const Byte *tile;   // tileSize() x tileSize() RGBA8, valid during the callback
+      };
+
+      typedef std::function<void(Upload const&)> UploadFn;
+
+      struct Stats {
+        uint64_t requests;
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t loadsIssued;
+        uint64_t loadsCompleted;
+        uint64_t loadsFailed;
+        uint64_t uploads;
+        uint64_t evictions;
+        size_t   pendingLoads;
+        size_t   residentPages;
+      };
+
+      VirtualTextureCache();
+      ~VirtualTextureCache();
+
+      bool initialize(std::shared_ptr<VirtualTexturePageSource> const&source, Options const&options = Options());
+      bool deinitialize();
+
+      void   beginFrame();
+      void   request(VirtualPage const&page);
+      // All pages of mip covering the uv rectangle [u0, u1] x [v0, v1] (clamped to [0, 1]).
+      void   requestRegion(float u0, float v0, float u1, float v1, uint32_t mip);
+      size_t update(UploadFn const&uploadFn);
+
+      bool isResident(VirtualPage const&page) const;
+      // Page table entry for page, i.e. the finest resident page covering it.
+      PageTableEntry lookup(VirtualPage const&page) const;
+
+      inline bool pageTableDirty() const { return m_pageTableDirty; }
+      inline void clearPageTableDirty()  { m_pageTableDirty = false; }
+      inline std::vector<PageTableEntry> const& pageTable(uint32_t mip) const { return m_pageTable[mip]; }
+
+      inline VirtualTextureLayout const& layout()  const { return m_layout; }
+      inline Options              const& options() const { return m_options; }
+
+      Stats stats() const;
+      void  resetStats();
+
+      // Mip whose texel density matches the given screen-space footprint in level-0 texels per
+      // pixel, clamped to the chain; the CPU-side equivalent of the hardware mip selection.
+      uint32_t mipForFootprint(float texelsPerPixel) const;
+
+    private:
+      struct Slot {
+        uint32_t                      key;
+        bool                          used;
+        bool                          pinned;
+        uint64_t                      lastFrame;
+        std::list<uint32_t>::iterator lru;
+      };
+
+      struct LoadedPage {
+        uint32_t          key;
+        bool              success;
+        std::vector<Byte> tile;
+      };
+
+      void   loaderMain();
+      void   load(uint32_t key, LoadedPage &outPage);
+      bool   mapPage(LoadedPage const&page, uint32_t slotIndex, UploadFn const&uploadFn);
+      void   touch(uint32_t slot);
+      bool   allocateSlot(uint32_t &outSlot);
+      void   rebuildPageTable();
+
+      std::shared_ptr<VirtualTexturePageSource> m_source;
+      VirtualTextureLayout                      m_layout;
+      Options                                   m_options;
+
+      // Main thread only
+      std::vector<Slot>                      m_slots;
+      std::list<uint32_t>                    m_lru;        // most recently used first
+      std::unordered_map<uint32_t, uint32_t> m_resident;   // page key -> slot
+      std::unordered_set<uint32_t>           m_pending;    // requested, not yet mapped
+      std::unordered_set<uint32_t>           m_requested;  // this frame, not yet issued
+      std::vector<std::vector<PageTableEntry>> m_pageTable;
+      bool                                   m_pageTableDirty;
+      uint64_t                               m_frame;
+      Stats                                  m_stats;
+
+      // Shared with the loaders
+      std::mutex                             m_mutex;
+      std::condition_variable                m_loadAvailable;
+      std::deque<uint32_t>                   m_loadQueue;
+      std::deque<LoadedPage>                 m_completed;
+      std::vector<std::thread>               m_loaders;
+      bool                                   m_running;
+    };
+
+  }
+}
+
+#endif
@@ -0,0 +1,156 @@
+#ifndef __SAE5300_GPR916_WORKERPOOL_H__
+#define __SAE5300_GPR916_WORKERPOOL_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace SAE {
+  namespace Threading {
+
+    class JobCounter;
+
+    struct Job {
+      std::function<void()> fn;
+      JobCounter           *counter;  // decremented once fn returned, may be null
+    };
+
+    /**********************************************************************************************//**
+     * \class JobCounter
+     *
+     * \brief Number of outstanding jobs of a group.
+     *
+     * WorkerPool::run() increments it, the pool decrements it when the job returned. Jobs run with
+     * a counter as their dependency are held back until it drops to zero. A counter must outlive
+     * the jobs counted by it and the jobs depending on it; WorkerPool::wait() guarantees the former.
+     **************************************************************************************************/
+    class JobCounter {
+    public:
+      JobCounter()
+        : m_value(0)
+      {}
+
+      inline bool done() const { return m_value.load(std::memory_order_acquire) == 0; }
+
+    private:
+      friend class WorkerPool;
+
+      JobCounter(JobCounter const&)            = delete;
+      JobCounter& operator=(JobCounter const&) = delete;
+
+      std::atomic<uint32_t> m_value;
+      std::mutex            m_mutex;          // decrements and m_continuations
+      std::vector<Job>      m_continuations;  // queued once m_value drops to zero
+    };
+
+    /**********************************************************************************************//**
+     * \class WorkerPool
+     *
+     * \brief Fixed set of threads executing jobs from per-thread deques, stealing when idle.
+     *
+     * A pool of N threads spawns N - 1 workers; threads outside the pool share one more deque.
+     * A thread pushes and pops its own jobs at the back, so nested work stays hot in its caches,
+     * and steals the oldest job from the front of another deque when it runs out. Threads
+     * waiting for a counter keep executing jobs instead of blocking, so jobs may run and wait for
+     * further jobs, and parallelFor() may be nested or called from several threads at once.
+     *
+     * Workers reset their FrameArena before the first job they take after beginFrame(), outside
+     * of any job. Frame arena memory of a worker therefore lives as long as the job allocating
+     * it, and must not be handed out of it.
+     **************************************************************************************************/
+    class WorkerPool {
+    public:
+      struct Stats {
+        uint64_t jobs;
+        uint64_t steals;
+      };
+
+      WorkerPool();
+      ~WorkerPool();
+
+      // threadCount 0: hardware concurrency.
+      bool initialize(unsigned int threadCount = 0);
+      bool deinitialize();
+
+      // Queues fn, counted by counter if given. With a dependency, fn is queued only once that
+      // counter drops to zero. Without workers, fn runs right away.
+      void run(std::function<void()> const&fn, JobCounter *counter = nullptr, JobCounter *dependency = nullptr);
+
+      // Executes queued jobs until counter drops to zero.
+      void wait(JobCounter &counter);
+
+      // Runs fn(begin, end) over [0, count) in chunks of grain; blocks until done.
+      void parallelFor(size_t count, size_t grain, std::function<void(size_t, size_t)> const&fn);
+
+      // Lets the workers release their frame arenas, see above.
+      inline void beginFrame() { m_frame.fetch_add(1, std::memory_order_relaxed); }
+
+      inline unsigned int threadCount() const { return static_cast<unsigned int>(m_workers.size()) + 1; }
+
+      Stats stats() const;
+
+    private:
+      // Ring of jobs that keeps its capacity, so queueing allocates nothing once it fitted a frame.
+      struct Queue {
+        std::mutex       mutex;
+        std::vector<Job> jobs;
+        size_t           head;   // oldest job
+        size_t           count;
+
+        Queue()
+          : jobs(64)
+          , head(0)
+          , count(0)
+        {}
+
+        void pushBack(Job &&job);
+        void popBack(Job &outJob);
+        void popFront(Job &outJob);
+      };
+
+      unsigned int currentQueue() const;
+      void push(Job &&job);
+      bool pop(unsigned int queue, Job &outJob);
+      bool steal(unsigned int thief, Job &outJob);
+      void execute(Job &job);
+      void workerMain(unsigned int queue);
+
+      std::vector<std::unique_ptr<Queue>> m_queues;  // 0: threads outside the pool, k: worker k
+      std::vector<std::thread>            m_workers;
+      std::mutex                          m_sleepMutex;
+      std::condition_variable             m_workAvailable;
+      std::atomic<size_t>                 m_queued;
+      std::atomic<uint64_t>               m_jobs;
+      std::atomic<uint64_t>               m_steals;
+      std::atomic<uint64_t>               m_frame;
+      std::atomic<bool>                   m_running;
+    };
+
+    struct JobSystemBenchmarkResult {
+      unsigned int threadCount;
+      double       transformMs;   // hierarchy levels, one parallelFor each
+      double       cullMs;        // one job per view, each a nested parallelFor
+      double       drawListMs;    // count, prefix sum, write
+      double       frameMs;
+      double       speedup;       // frameMs of one thread over this frameMs
+      uint64_t     steals;
+      bool         valid;         // same visible sets and draw list as with one thread
+    };
+
+    // Updates, culls and builds the draw list of a synthetic scene of objectCount objects in a
+    // hierarchy, seen from viewCount views, with 1, 2, 4, ... maxThreads threads (0: hardware
+    // concurrency).
+    std::vector<JobSystemBenchmarkResult> BenchmarkJobSystem(
+      size_t       objectCount = 100000,
+      unsigned int viewCount   = 6,
+      unsigned int maxThreads  = 0);
+
+  }
+}
+
+#endif
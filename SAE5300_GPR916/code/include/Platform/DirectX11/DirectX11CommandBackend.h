@@ -0,0 +1,91 @@
+#ifndef __SAE5300_GPR916_DX11COMMANDBACKEND_H__
+#define __SAE5300_GPR916_DX11COMMANDBACKEND_H__
+
+#include <d3d11_1.h>
+
+#include "Platform/DirectX11/DirectX11Common.h"
+#include "Renderer/CommandBuffer.h"
+#include "Renderer/ConstantUploadRing.h"
+
+namespace SAE {
+  namespace DirectX11 {
+    using namespace SAE::Rendering;
+
+    /**********************************************************************************************//**
+     * \class DirectX11ConstantUploadDevice
+     *
+     * \brief Dynamic constant buffer backing a ConstantUploadRing.
+     *
+     * Binding ranges of it and mapping it with WRITE_NO_OVERWRITE need the D3D11.1 runtime;
+     * check IsSupported() first.
+     **************************************************************************************************/
+    class DirectX11ConstantUploadDevice
+      : public ConstantUploadDevice
+    {
+    public:
+      DirectX11ConstantUploadDevice(
+        ID3D11DevicePtr        const&device,
+        ID3D11DeviceContextPtr const&context);
+
+      static bool IsSupported(ID3D11DevicePtr const&device);
+
+      bool  createBuffer(uint32_t byteSize) override;
+      void* map(bool discard) override;
+      void  unmap() override;
+
+      inline ID3D11Buffer* buffer() const { return m_buffer.get(); }
+
+    private:
+      ID3D11DevicePtr               m_device;
+      ID3D11DeviceContextPtr        m_context;
+      std::shared_ptr<ID3D11Buffer> m_buffer;
+    };
+
+    /**********************************************************************************************//**
+     * \class DirectX11CommandBackend
+     *
+     * \brief Replays command packets on a D3D11 device context.
+     *
+     * Ids are the raw D3D11 object pointers the resource manager hands out. Draws without an
+     * explicit index count use the size of the bound index buffer, queried once per index
+     * buffer change.
+     *
+     * With a constant upload ring, uploadConstants() writes all constants of a command buffer
+     * with one Map before submit, and the replay binds ranges of the ring buffer. Without one
+     * (or for blocks that did not fit), each update maps its own buffer with WRITE_DISCARD.
+     * Shader resource buffer updates always do. A backend is meant to be kept and reused for
+     * every pass, so its allocation list keeps its storage.
+     **************************************************************************************************/
+    class DirectX11CommandBackend
+      : public CommandBackend
+    {
+    public:
+      DirectX11CommandBackend(
+        ID3D11DeviceContextPtr        const&context,
+        ConstantUploadRing                 *constantRing       = nullptr,
+        DirectX11ConstantUploadDevice      *constantRingDevice = nullptr);
+
+      bool uploadConstants(CommandBuffer const&buffer);
+
+      void bindPipeline(BindPipelineCommand const&command) override;
+      void bindResources(BindResourcesCommand const&command) override;
+      void updateConstants(UpdateConstantsCommand const&command, const void *data) override;
+      void drawIndexed(DrawIndexedCommand const&command) override;
+      void updateBuffer(UpdateBufferCommand const&command, const void *data) override;
+
+    private:
+      ID3D11DeviceContextPtr m_context;
+      uint64_t               m_indexBufferId;
+      uint32_t               m_indexCount;
+
+      ConstantUploadRing                         *m_constantRing;
+      DirectX11ConstantUploadDevice              *m_constantRingDevice;
+      std::shared_ptr<ID3D11DeviceContext1>       m_context1;
+      std::vector<ConstantUploadRing::Allocation> m_constantAllocations;
+      size_t                                      m_nextConstants;
+    };
+
+  }
+}
+
+#endif
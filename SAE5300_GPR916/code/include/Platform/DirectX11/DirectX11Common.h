@@ -7,13 +7,13 @@
 #include <cmath>
 #include <math.h>
 
-#define _XM_NO_INTRINSICS_
-#include <DirectXMath.h>
+#include "Platform/DirectXMathConfig.h"
 
-#define VEC_X(v) v.vector4_f32[0]
-#define VEC_Y(v) v.vector4_f32[1]
-#define VEC_Z(v) v.vector4_f32[2]
-#define VEC_W(v) v.vector4_f32[3]
+// Read-only component access, for every DirectXMath backend.
+#define VEC_X(v) DirectX::XMVectorGetX(v)
+#define VEC_Y(v) DirectX::XMVectorGetY(v)
+#define VEC_Z(v) DirectX::XMVectorGetZ(v)
+#define VEC_W(v) DirectX::XMVectorGetW(v)
 
 
 #include <dxgi.h>
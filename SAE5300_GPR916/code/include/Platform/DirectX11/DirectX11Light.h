@@ -24,7 +24,7 @@ namespace SAE {
           } point;
           struct Spot {
             float    distance;
-            float    hotSpotAngle;
+            float    hotSpotAngle;  // half angles of the fully lit and the outer cone, radians
             float    falloffAngle;
           } Spot;
 
@@ -38,28 +38,26 @@ namespace SAE {
         Properties();
       };
 
+      static const uint32_t CascadeCount   = 4;
+      static const uint32_t MaxShadowViews = 6;
+
       Light() = default;
       Light(Properties const&);
 
-      XMMATRIX const& viewMatrix(uint64_t faceIndex);
-      XMMATRIX const& projectionMatrix(uint64_t faceIndex);
-
-      XMMATRIX* viewMatrices();
-      XMMATRIX* projectionMatrices();
+      // Shadow views: the 6 cube faces of a point light, one frustum fitted to the outer cone of
+      // a spot light, CascadeCount orthographic cascades of a directional light. Their matrices
+      // are kept by SAE::Engine::LightSystem.
+      static uint32_t ShadowViewCount(Type type);
+      inline uint32_t shadowViewCount() const { return ShadowViewCount(m_properties.type); }
 
-      inline DX11Transform & transform() { return m_transform; }
+      inline DX11Transform      & transform()       { return m_transform; }
+      inline DX11Transform const& transform() const { return m_transform; }
 
       inline Properties const& properties() const { return m_properties; }
 
     private:
-      void createViewMatrices();
-      void createProjectionMatrices();
-
       DX11Transform
         m_transform;
-      XMMATRIX
-        m_viewMatrix[6],
-        m_projectionMatrix[6];
       Properties
         m_properties;
     };
@@ -8,6 +8,8 @@
 
 #include "Platform/DirectX11/DirectX11ResourceManager.h"
 
+#include "Renderer/TriangleBVH.h"
+
 namespace SAE {
   namespace DirectX11 {
     using namespace DirectX;
@@ -25,7 +27,17 @@ namespace SAE {
         std::shared_ptr<DirectX11Mesh> 
         loadFromFile(
           std::shared_ptr<DirectX11ResourceManager>      &resourceManager,
-          std::string                               const&filename);
+          std::string                               const&filename,
+          bool                                           buildTriangleBVH = false);
+      // Uploads vertices and indices as they are, e.g. geometry merged by StaticBatcher.
+      // With buildTriangleBVH, the triangles are also kept in a TriangleBVH for ray casts.
+      static
+        std::shared_ptr<DirectX11Mesh> 
+        createFromData(
+          std::shared_ptr<DirectX11ResourceManager>      &resourceManager,
+          VertexBuffer_t                            const&vertices,
+          IndexBuffer_t                             const&indices,
+          bool                                           buildTriangleBVH = false);
     
       uint64_t const& vertexBufferHandle() const { return m_vertexBufferHandle; }
       uint64_t const& indexBufferHandle()  const { return m_indexBufferHandle;  }
@@ -36,9 +48,14 @@ namespace SAE {
       uint64_t const& shadowMapVertexShaderHandle() const { return m_shadowMapVertexShaderHandle; }
       uint64_t const& shadowMapPixelShaderHandle()  const { return m_shadowMapPixelShaderHandle; }
 
+      // Null unless requested on creation; shared by all instances of the mesh.
+      std::shared_ptr<SAE::Rendering::TriangleBVH> const& triangleBVH() const { return m_triangleBVH; }
+
     private:
       DirectX11Mesh() = default;
 
+      void computeBounds();
+
       inline void setVertexBuffer(uint64_t const&handle) { m_vertexBufferHandle = handle; }
       inline void setIndexBuffer(uint64_t const&handle)  { m_indexBufferHandle  = handle; }
       inline void setVertexShader(uint64_t const&handle) { m_vertexShaderHandle = handle; }
@@ -58,6 +75,7 @@ namespace SAE {
         m_shadowMapPixelShaderHandle,
         m_shadowMapInputLayoutHandle;
 
+      std::shared_ptr<SAE::Rendering::TriangleBVH> m_triangleBVH;
     };
     using DirectX11MeshPtr = std::shared_ptr<DirectX11Mesh>;
   }
@@ -0,0 +1,39 @@
+#ifndef __SAE5300_GPR916_DX11RENDERGRAPHALLOCATOR_H__
+#define __SAE5300_GPR916_DX11RENDERGRAPHALLOCATOR_H__
+
+#include <memory>
+
+#include "Platform/DirectX11/DirectX11ResourceManager.h"
+#include "Renderer/RenderGraph.h"
+
+namespace SAE {
+  namespace DirectX11 {
+    using SAE::Rendering::RenderGraphAllocator;
+    using SAE::Rendering::RenderGraphTexture;
+    using SAE::Rendering::RenderGraphTextureDesc;
+
+    /**********************************************************************************************//**
+     * \class DirectX11RenderGraphAllocator
+     *
+     * \brief Creates render graph textures through the resource manager.
+     *
+     * Depth formats are created typeless so they can be sampled. Cube textures get a cube
+     * (array) SRV; depth stencil and render target views are created per array slice.
+     **************************************************************************************************/
+    class DirectX11RenderGraphAllocator
+      : public RenderGraphAllocator
+    {
+    public:
+      explicit DirectX11RenderGraphAllocator(std::shared_ptr<DirectX11ResourceManager> const&resourceManager);
+
+      bool create(RenderGraphTextureDesc const&desc, uint32_t usage, RenderGraphTexture &outTexture) override;
+      void release(RenderGraphTexture &texture) override;
+
+    private:
+      std::shared_ptr<DirectX11ResourceManager> m_resourceManager;
+    };
+
+  }
+}
+
+#endif
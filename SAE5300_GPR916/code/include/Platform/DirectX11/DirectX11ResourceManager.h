@@ -136,6 +136,15 @@ namespace SAE {
       (D3D11_SHADER_RESOURCE_VIEW_DESC  const&desc, 
        ID3D11Texture2D                 *const&texture);
 
+    template <>
+    uint64_t
+      DirectX11ResourceManager
+      ::create<ID3D11ShaderResourceView,
+                D3D11_SHADER_RESOURCE_VIEW_DESC,
+                ID3D11Buffer*>
+      (D3D11_SHADER_RESOURCE_VIEW_DESC  const&desc, 
+       ID3D11Buffer                    *const&buffer);
+
     template <>
     uint64_t
       DirectX11ResourceManager
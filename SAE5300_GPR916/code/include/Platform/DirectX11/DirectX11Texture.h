@@ -13,49 +13,69 @@ namespace SAE {
     using namespace SAE::Texture;
     using namespace SAE::Resources;
 
-    bool LoadTextureArrayFromFiles(
+    /**********************************************************************************************//**
+     * \fn bool CreateTextureFromDescriptor(std::shared_ptr<DirectX11ResourceManager> &resourceManager, Texture2DDescriptor const&image, uint64_t &outTextureHandle, uint64_t &outTexSRVHandle)
+     *
+     * \brief Uploads decoded RGBA8 slices (and their mip chains, if any) into a texture + SRV.
+     **************************************************************************************************/
+    bool CreateTextureFromDescriptor(
       std::shared_ptr<DirectX11ResourceManager> &resourceManager,
-      std::vector<std::string>             const&filenames,
+      Texture2DDescriptor                  const&image,
       uint64_t                                  &outTextureHandle,
       uint64_t                                  &outTexSRVHandle)
     {
       try {
-        Texture2DDescriptor outImage={};
-        SAELoadTextureArrayFromFiles(filenames, outImage);
-        outImage.mipLevels = 1;
-
         D3D11_TEXTURE2D_DESC desc ={};
-        desc.Width              = outImage.width;
-        desc.Height             = outImage.height;
+        desc.Width              = image.width;
+        desc.Height             = image.height;
         desc.Format             = DXGI_FORMAT_R8G8B8A8_UNORM;
-        desc.MipLevels          = outImage.mipLevels;
+        desc.MipLevels          = image.mipLevels ? image.mipLevels : 1;
         desc.BindFlags          = D3D11_BIND_SHADER_RESOURCE;
         desc.Usage              = D3D11_USAGE_DEFAULT;
         desc.CPUAccessFlags     = 0;
         desc.MiscFlags          = 0;
         desc.SampleDesc.Quality = 0;
         desc.SampleDesc.Count   = 1;
-        desc.ArraySize          = outImage.depth;
+        desc.ArraySize          = image.depth;
 
         if(desc.ArraySize > 1)
         {
           desc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE;
         }
 
+        // Subresource order is mip-major within each slice: D3D11CalcSubresource(mip, slice, MipLevels).
         std::vector<D3D11_SUBRESOURCE_DATA> pData={};
-        pData.resize(desc.ArraySize);
+        pData.resize(desc.ArraySize * desc.MipLevels);
         for(unsigned int k=0; k < desc.ArraySize; ++k)
         {
-          pData[k].pSysMem          = &outImage.inData[k][0];
-          pData[k].SysMemPitch      = 4 * outImage.width * sizeof(Byte);
-          pData[k].SysMemSlicePitch = 0;
+          const Byte   *level  = &image.inData[k][0];
+          unsigned int  width  = image.width;
+          unsigned int  height = image.height;
+          for(unsigned int m=0; m < desc.MipLevels; ++m)
+          {
+            D3D11_SUBRESOURCE_DATA &data = pData[(k * desc.MipLevels) + m];
+            data.pSysMem          = level;
+            data.SysMemPitch      = 4 * width * sizeof(Byte);
+            data.SysMemSlicePitch = 0;
+
+            level  += 4 * width * height * sizeof(Byte);
+            width   = (width  > 1) ? (width  >> 1) : 1;
+            height  = (height > 1) ? (height >> 1) : 1;
+          }
         }
 
         outTextureHandle = resourceManager->create<ID3D11Texture2D>(desc, pData);
         ID3D11Texture2D *pTexture =  reinterpret_cast<ID3D11Texture2D*>(outTextureHandle);
 
         D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc={};
-        if(desc.ArraySize > 1) {
+        if(desc.ArraySize == 6) {
+          // Environment maps: six faces in D3D11 cube order, see Engine/EnvironmentMap.h.
+          srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+          srvDesc.Format        = desc.Format;
+          srvDesc.TextureCube.MipLevels       = desc.MipLevels;
+          srvDesc.TextureCube.MostDetailedMip = 0;
+        }
+        else if(desc.ArraySize > 1) {
           srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
           srvDesc.Format        = desc.Format;
           srvDesc.Texture2DArray.ArraySize       = desc.ArraySize;
@@ -71,20 +91,38 @@ namespace SAE {
         }
         outTexSRVHandle  = resourceManager->create<ID3D11ShaderResourceView>(srvDesc, pTexture);
 
-        outImage.freeData();
         return true;
       } catch(...) {
         return false;
       }
     }
 
+    bool LoadTextureArrayFromFiles(
+      std::shared_ptr<DirectX11ResourceManager> &resourceManager,
+      std::vector<std::string>             const&filenames,
+      uint64_t                                  &outTextureHandle,
+      uint64_t                                  &outTexSRVHandle,
+      unsigned int                               scaleDenominator = 1)
+    {
+      Texture2DDescriptor outImage={};
+      if(!SAELoadTextureArrayFromFiles(filenames, outImage, scaleDenominator))
+        return false;
+      outImage.mipLevels = 1;
+
+      bool created = CreateTextureFromDescriptor(resourceManager, outImage, outTextureHandle, outTexSRVHandle);
+
+      outImage.freeData();
+      return created;
+    }
+
     bool LoadTextureFromFile(
       std::shared_ptr<DirectX11ResourceManager> &resourceManager,
       std::string                          const&filename,
       uint64_t                                  &outTextureHandle,
-      uint64_t                                  &outTexSRVHandle)
+      uint64_t                                  &outTexSRVHandle,
+      unsigned int                               scaleDenominator = 1)
     {
-      return LoadTextureArrayFromFiles(resourceManager, { filename }, outTextureHandle, outTexSRVHandle);
+      return LoadTextureArrayFromFiles(resourceManager, { filename }, outTextureHandle, outTexSRVHandle, scaleDenominator);
     }
 
   }
@@ -14,38 +14,48 @@ namespace SAE {
   namespace DirectX11 {
     using namespace DirectX;
 
+    /**********************************************************************************************//**
+     * \class DX11Transform
+     *
+     * \brief Scale, rotation and translation of an object, 48 bytes of state.
+     *
+     * The rotation is a unit quaternion: incremental rotations multiply quaternions and take
+     * one Newton step back to unit length, so no drift builds up in a matrix. Euler angles are
+     * kept as set and only derived from the quaternion after incremental rotations. The local
+     * matrix and its normal matrix are composed when first needed after a change, or handed
+     * in by a batch, see SAE::Math::ComposeTransforms().
+     **************************************************************************************************/
     class DX11Transform
       : public Engine::ITransform<XMVECTOR, XMMATRIX>
     {
     public:
       inline DX11Transform()
-        : m_scale({ 1.0f, 1.0f, 1.0f })
-        , m_rotation(XMMatrixIdentity())
-        , m_translation({ 0.0f, 0.0f, 0.0f })
-        , m_direction({ 0.0f, 0.0f, 1.0f })
-        , m_right({ 1.0f, 0.0f, 0.0f })
-        , m_up({ 0.0f, 1.0f, 0.0f })
+        : m_scale({ 1.0f, 1.0f, 1.0f, 0.0f })
+        , m_rotation(XMQuaternionIdentity())
+        , m_translation({ 0.0f, 0.0f, 0.0f, 0.0f })
+        , m_euler(0.0f, 0.0f, 0.0f)
+        , m_eulerValid(true)
+        , m_localDirty(false)
         , m_local(XMMatrixIdentity())
-        , m_composed(XMMatrixIdentity())
+        , m_localNormal(XMMatrixIdentity())
       {
 
       }
 
-      inline const XMVECTOR& getDirection() const { return m_direction; };
-      inline const XMVECTOR& getUp()        const { return m_up; };
-      inline const XMVECTOR& getRight()     const { return m_right; };
+      // Rows of the rotation: local x, y and z axis.
+      inline const XMVECTOR getDirection() const { return XMVector3Rotate(g_XMIdentityR2, m_rotation); };
+      inline const XMVECTOR getUp()        const { return XMVector3Rotate(g_XMIdentityR1, m_rotation); };
+      inline const XMVECTOR getRight()     const { return XMVector3Rotate(g_XMIdentityR0, m_rotation); };
 
-      inline void setScaleX(const float& factor) { VEC_X(m_scale) = factor; invalidate(); }
-      inline void setScaleY(const float& factor) { VEC_Y(m_scale) = factor; invalidate(); }
-      inline void setScaleZ(const float& factor) { VEC_Z(m_scale) = factor; invalidate(); }
+      inline void setScaleX(const float& factor) { m_scale = XMVectorSetX(m_scale, factor); invalidate(); }
+      inline void setScaleY(const float& factor) { m_scale = XMVectorSetY(m_scale, factor); invalidate(); }
+      inline void setScaleZ(const float& factor) { m_scale = XMVectorSetZ(m_scale, factor); invalidate(); }
       inline void setScale(
         const float& x,
         const float& y,
         const float& z)
       {
-        setScaleX(x);
-        setScaleY(y);
-        setScaleZ(z);
+        m_scale = XMVectorSet(x, y, z, 0.0f);
         invalidate();
       }
       inline void setScale(const XMVECTOR& vec) { m_scale = vec; invalidate(); }
@@ -54,18 +64,22 @@ namespace SAE {
 
       inline void rotateAroundAxisBy(const XMVECTOR& axis, float angle)
       {
-        XMMATRIX rot = XMMatrixRotationAxis(axis, angle);
-        m_rotation *= rot;
-        invalidate(); invalidate();
+        XMVECTOR const rotation = XMQuaternionMultiply(m_rotation, XMQuaternionRotationAxis(axis, angle));
+
+        // One Newton step towards unit length: the error a multiply leaves is tiny.
+        XMVECTOR const lengthSq = XMVector4Dot(rotation, rotation);
+        m_rotation   = XMVectorMultiply(rotation, XMVectorScale(XMVectorSubtract(XMVectorReplicate(3.0f), lengthSq), 0.5f));
+        m_eulerValid = false;
+        invalidate();
       }
 
-      inline void rotateXBy(const float& angle) { rotateAroundAxisBy({ 1.0f, 0.0f, 0.0f, 0.0f }, RAD(angle)); }
-      inline void rotateYBy(const float& angle) { rotateAroundAxisBy({ 0.0f, 1.0f, 0.0f, 0.0f }, RAD(angle)); }
-      inline void rotateZBy(const float& angle) { rotateAroundAxisBy({ 0.0f, 0.0f, 1.0f, 0.0f }, RAD(angle)); }
+      inline void rotateXBy(const float& angle) { rotateAroundAxisBy(g_XMIdentityR0, RAD(angle)); }
+      inline void rotateYBy(const float& angle) { rotateAroundAxisBy(g_XMIdentityR1, RAD(angle)); }
+      inline void rotateZBy(const float& angle) { rotateAroundAxisBy(g_XMIdentityR2, RAD(angle)); }
 
-      inline void rollBy(const float& angle) { rotateAroundAxisBy(m_direction, RAD(angle)); }
-      inline void pitchBy(const float& angle) { rotateAroundAxisBy(m_right, RAD(angle)); }
-      inline void yawBy(const float& angle) { rotateAroundAxisBy(m_up, RAD(angle)); }
+      inline void rollBy(const float& angle) { rotateAroundAxisBy(getDirection(), RAD(angle)); }
+      inline void pitchBy(const float& angle) { rotateAroundAxisBy(getRight(), RAD(angle)); }
+      inline void yawBy(const float& angle) { rotateAroundAxisBy(getUp(), RAD(angle)); }
 
       inline void setRotationX(const float& angle) { setRotation(angle, 0, 0); }
       inline void setRotationY(const float& angle) { setRotation(0, angle, 0); }
@@ -77,93 +91,142 @@ namespace SAE {
       {
         setRotation({ x, y, z, 0.0f });
       }
+      // Degrees around y, then x, then z.
       inline void setRotation(const XMVECTOR& vec) {
-        m_rotation  = XMMatrixIdentity();
-        m_rotation *= XMMatrixRotationY(RAD(VEC_Y(vec)));
-        m_rotation *= XMMatrixRotationX(RAD(VEC_X(vec)));
-        m_rotation *= XMMatrixRotationZ(RAD(VEC_Z(vec)));
+        XMStoreFloat3(&m_euler, vec);
+
+        m_rotation = XMQuaternionRotationNormal(g_XMIdentityR1, RAD(m_euler.y));
+        m_rotation = XMQuaternionMultiply(m_rotation, XMQuaternionRotationNormal(g_XMIdentityR0, RAD(m_euler.x)));
+        m_rotation = XMQuaternionMultiply(m_rotation, XMQuaternionRotationNormal(g_XMIdentityR2, RAD(m_euler.z)));
+        m_eulerValid = true;
 
         invalidate();
       }
+      // Any unit quaternion, e.g. one interpolated with XMQuaternionSlerp.
+      inline void setRotationQuaternion(const XMVECTOR& rotation)
+      {
+        m_rotation   = XMQuaternionNormalize(rotation);
+        m_eulerValid = false;
+        invalidate();
+      }
 
+      // Degrees as setRotation() takes them; as set, or derived once after incremental rotations.
       inline const XMVECTOR getRotation() const {
-        return {
-          DEG(atan2(VEC_X(m_rotation.r[1]),  VEC_X(m_rotation.r[0]))),
-          DEG(atan2(-VEC_X(m_rotation.r[2]), sqrt(pow(VEC_Y(m_rotation.r[2]), 2) + pow(VEC_Z(m_rotation.r[2]),2)))),
-          DEG(atan2(VEC_Y(m_rotation.r[2]),  VEC_Z(m_rotation.r[2]))),
-          0.0f
-        };
+        if(!m_eulerValid)
+          updateEuler();
+
+        return XMLoadFloat3(&m_euler);
       }
 
-      inline void translateXBy(const float& offset) { VEC_X(m_translation) += offset; invalidate(); }
-      inline void translateYBy(const float& offset) { VEC_Y(m_translation) += offset; invalidate(); }
-      inline void translateZBy(const float& offset) { VEC_Z(m_translation) += offset; invalidate(); }
+      // The rotation as unit quaternion, for SAE::Math::ComposeTransforms().
+      inline const XMVECTOR& getRotationQuaternion() const { return m_rotation; }
+
+      inline void translateXBy(const float& offset) { m_translation = XMVectorSetX(m_translation, VEC_X(m_translation) + offset); invalidate(); }
+      inline void translateYBy(const float& offset) { m_translation = XMVectorSetY(m_translation, VEC_Y(m_translation) + offset); invalidate(); }
+      inline void translateZBy(const float& offset) { m_translation = XMVectorSetZ(m_translation, VEC_Z(m_translation) + offset); invalidate(); }
 
-      inline void translateDirectionalBy(const float& offset) { m_translation += (offset * m_direction); invalidate(); }
-      inline void translateVerticalBy(const float& offset) { m_translation += (offset * m_up);        invalidate(); }
-      inline void translateLateralBy(const float& offset) { m_translation += (offset * m_right);     invalidate(); }
+      inline void translateDirectionalBy(const float& offset) { m_translation += (offset * getDirection()); invalidate(); }
+      inline void translateVerticalBy(const float& offset) { m_translation += (offset * getUp());        invalidate(); }
+      inline void translateLateralBy(const float& offset) { m_translation += (offset * getRight());     invalidate(); }
 
-      inline void setTranslationX(const float& offset) { VEC_X(m_translation) = offset; invalidate(); }
-      inline void setTranslationY(const float& offset) { VEC_Y(m_translation) = offset; invalidate(); }
-      inline void setTranslationZ(const float& offset) { VEC_Z(m_translation) = offset; invalidate(); }
+      inline void setTranslationX(const float& offset) { m_translation = XMVectorSetX(m_translation, offset); invalidate(); }
+      inline void setTranslationY(const float& offset) { m_translation = XMVectorSetY(m_translation, offset); invalidate(); }
+      inline void setTranslationZ(const float& offset) { m_translation = XMVectorSetZ(m_translation, offset); invalidate(); }
       inline void setTranslation(
         const float& x,
         const float& y,
         const float& z)
       {
-        setTranslationX(x);
-        setTranslationY(y);
-        setTranslationZ(z);
+        m_translation = XMVectorSet(x, y, z, 0.0f);
         invalidate();
       }
       inline void setTranslation(const XMVECTOR& vec) { m_translation = vec; invalidate(); }
 
       inline const XMVECTOR& getTranslation() const { return m_translation; }
 
-      inline void worldMatrix(const XMMATRIX& parent, XMMATRIX *pCombined)
+      // Scale, then rotation, then translation; composed on first use after a change, unless
+      // setLocalMatrices() hands in a batch's result first.
+      inline const XMMATRIX& localMatrix()       { compose(); return m_local; }
+      // Inverse transpose of localMatrix() without its translation, to transform normals.
+      inline const XMMATRIX& localNormalMatrix() { compose(); return m_localNormal; }
+      inline bool            localDirty() const  { return m_localDirty; }
+      inline void setLocalMatrices(const XMMATRIX& local, const XMMATRIX& localNormal)
       {
-        m_composed =  XMMatrixMultiply(m_local, parent);
-
-        if(pCombined)
-          *pCombined = composedWorldMatrix();
+        m_local       = local;
+        m_localNormal = localNormal;
+        m_localDirty  = false;
       }
 
-      inline XMMATRIX composedWorldMatrix() const
+      inline void worldMatrix(const XMMATRIX& parent, XMMATRIX *pCombined)
       {
-        return m_composed;
+        if(pCombined)
+          *pCombined = XMMatrixMultiply(localMatrix(), parent);
       }
 
     private:
       inline void invalidate()
       {
-        using namespace DirectX;
+        m_localDirty = true;
+      }
 
-        static XMVECTOR rgt ={ 1.0f, 0.0f, 0.0f, 0.0f };
-        static XMVECTOR up  ={ 0.0f, 1.0f, 0.0f, 0.0f };
-        static XMVECTOR fwd ={ 0.0f, 0.0f, 1.0f, 0.0f };
+      // Closed form of S * R * T and its normal matrix: the rotation's rows times, and divided
+      // by, the scale. Scales must not be zero.
+      inline void compose()
+      {
+        if(!m_localDirty)
+          return;
 
-        XMMATRIX T  = XMMatrixTranslation(VEC_X(m_translation), VEC_Y(m_translation), VEC_Z(m_translation));
-        XMMATRIX R  = m_rotation;
-        XMMATRIX S  = XMMatrixScaling(VEC_X(m_scale), VEC_Y(m_scale), VEC_Z(m_scale));
+        XMMATRIX const R  = XMMatrixRotationQuaternion(m_rotation);
+        XMVECTOR const sx = XMVectorSplatX(m_scale);
+        XMVECTOR const sy = XMVectorSplatY(m_scale);
+        XMVECTOR const sz = XMVectorSplatZ(m_scale);
 
-        m_local = XMMatrixMultiply(XMMatrixMultiply(S, R), T);
+        m_local.r[0] = XMVectorMultiply(R.r[0], sx);
+        m_local.r[1] = XMVectorMultiply(R.r[1], sy);
+        m_local.r[2] = XMVectorMultiply(R.r[2], sz);
+        m_local.r[3] = XMVectorSetW(m_translation, 1.0f);
 
-        // Recalculate the axis vectors
-        m_right     = R.r[0];
-        m_up        = R.r[1];
-        m_direction = R.r[2];
+        m_localNormal.r[0] = XMVectorDivide(R.r[0], sx);
+        m_localNormal.r[1] = XMVectorDivide(R.r[1], sy);
+        m_localNormal.r[2] = XMVectorDivide(R.r[2], sz);
+        m_localNormal.r[3] = g_XMIdentityR3;
+
+        m_localDirty = false;
+      }
+
+      // Inverts setRotation(): with R = Ry * Rx * Rz, R12 = sin x, R02 / R22 = -tan y and
+      // R10 / R11 = -tan z. At x = +-90 degrees y and z turn about the same axis; z is 0 then.
+      inline void updateEuler() const
+      {
+        float const x = XMVectorGetX(m_rotation), y = XMVectorGetY(m_rotation);
+        float const z = XMVectorGetZ(m_rotation), w = XMVectorGetW(m_rotation);
+
+        float const r12 = 2.0f * (y * z + x * w);
+        float const sinX = (r12 > 1.0f) ? 1.0f : ((r12 < -1.0f) ? -1.0f : r12);
+
+        m_euler.x = DEG(asinf(sinX));
+        if(fabsf(sinX) < 0.9999f) {
+          m_euler.y = DEG(atan2f(-2.0f * (x * z - y * w), 1.0f - 2.0f * (x * x + y * y)));
+          m_euler.z = DEG(atan2f(-2.0f * (x * y - z * w), 1.0f - 2.0f * (x * x + z * z)));
+        }
+        else {
+          m_euler.y = DEG(atan2f(sinX * 2.0f * (x * y + z * w), 1.0f - 2.0f * (y * y + z * z)));
+          m_euler.z = 0.0f;
+        }
+        m_eulerValid = true;
       }
 
+      // TRS state; the rotation is a unit quaternion.
       XMVECTOR m_scale;
-      XMMATRIX m_rotation;
+      XMVECTOR m_rotation;
       XMVECTOR m_translation;
 
-      XMVECTOR m_direction;
-      XMVECTOR m_right;
-      XMVECTOR m_up;
+      mutable XMFLOAT3 m_euler;       // degrees, valid if m_eulerValid
+      mutable bool     m_eulerValid;
+      bool             m_localDirty;
 
       XMMATRIX m_local;
-      XMMATRIX m_composed;
+      XMMATRIX m_localNormal;
     };
     using DX11TransformPtr = std::shared_ptr<DX11Transform>;
     using TransformPtr     = DX11TransformPtr;
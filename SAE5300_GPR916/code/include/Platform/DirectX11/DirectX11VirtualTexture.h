@@ -0,0 +1,56 @@
+#ifndef __SAE5300_GPR916_DX11VIRTUALTEXTURE_H__
+#define __SAE5300_GPR916_DX11VIRTUALTEXTURE_H__
+
+#include <memory>
+
+#include "Engine/VirtualTexture.h"
+#include "Platform/DirectX11/DirectX11ResourceManager.h"
+#include "Renderer/RendererDTO.h"
+
+namespace SAE {
+  namespace DirectX11 {
+    using SAE::Texture::VirtualTextureCache;
+    using SAE::DTO::VirtualTextureBuffer_t;
+
+    /**********************************************************************************************//**
+     * \class DirectX11VirtualTexture
+     *
+     * \brief GPU side of a VirtualTextureCache: the physical page texture and the page table.
+     *
+     * The physical texture is a physicalPagesX x physicalPagesY grid of tiles (RGBA8) and is
+     * the only texture memory a virtual texture ever uses, however large its source is. The
+     * page table is RGBA8_UINT with one texel per virtual page and one mip per virtual mip,
+     * padded to a power of two so the D3D mip chain covers every level of the page grid.
+     * Sample both with sampleVirtualTexture from code/shader/virtual_texture.hlsli.
+     **************************************************************************************************/
+    class DirectX11VirtualTexture {
+    public:
+      DirectX11VirtualTexture();
+
+      bool initialize(
+        std::shared_ptr<DirectX11ResourceManager> &resourceManager,
+        VirtualTextureCache                  const&cache);
+
+      // Runs cache.update, copies the mapped tiles into the physical texture and re-uploads
+      // the page table if it changed. Call once per frame after issuing the frame's requests.
+      size_t update(
+        ID3D11DeviceContext *context,
+        VirtualTextureCache &cache);
+
+      VirtualTextureBuffer_t shaderConstants(VirtualTextureCache const&cache) const;
+
+      inline uint64_t physicalTextureSRVId() const { return m_physicalTextureSRVId; }
+      inline uint64_t pageTableSRVId()       const { return m_pageTableSRVId; }
+
+    private:
+      uint64_t
+        m_physicalTextureId,
+        m_physicalTextureSRVId,
+        m_pageTableId,
+        m_pageTableSRVId;
+    };
+
+  }
+}
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef __SAE5300_GPR916_DIRECTXMATHCONFIG_H__
+#define __SAE5300_GPR916_DIRECTXMATHCONFIG_H__
+
+// The one place DirectXMath is configured. XMVECTOR and XMMATRIX change their layout and
+// every inline function its body with _XM_NO_INTRINSICS_, so all translation units have to
+// agree on it: the project force-includes this header, and headers using DirectXMath
+// include it instead of <DirectXMath.h>.
+//
+// DirectXMath uses SSE2 / NEON. Not on 32-bit x86: its heap aligns to 8 bytes only, and the
+// XMVECTOR / XMMATRIX members of heap objects and vertex arrays would be misaligned.
+#if defined(_M_IX86) && !defined(_XM_NO_INTRINSICS_)
+#define _XM_NO_INTRINSICS_
+#endif
+#include <DirectXMath.h>
+
+#endif
@@ -120,6 +120,9 @@ namespace SAE {
 
       bool reset();
 
+      // Keys pressed in other become pressed here; released keys keep their state.
+      void merge(InputState const&other);
+
     private:
       std::map< KeyCode, KeyState> m_keyStates;
     };
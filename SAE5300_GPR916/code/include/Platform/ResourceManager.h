@@ -23,6 +23,10 @@ namespace SAE {
 
         return true;
       }
+      bool release(uint64_t const&id) {
+        return m_resources.erase(id) > 0;
+      }
+
     protected:
       bool get(uint64_t const&id, std::shared_ptr<T>&out) {
         return (out = m_resources[id]) != nullptr;
@@ -47,6 +51,12 @@ namespace SAE {
 
         return ptr;
       }
+
+      // Drops the manager's reference; the object dies once nothing else holds it.
+      template <typename T>
+      bool release(uint64_t const&id) {
+        return this->ResourceHolder<T>::release(id);
+      }
     };
 
   }
@@ -0,0 +1,220 @@
+#ifndef __SAE5300_GPR916_COMMANDBUFFER_H__
+#define __SAE5300_GPR916_COMMANDBUFFER_H__
+
+#include <cstdint>
+#include <vector>
+
+#include "Engine/WorkerPool.h"
+#include "Renderer/RendererDTO.h"
+
+namespace SAE {
+  namespace Rendering {
+    using namespace SAE::DTO;
+
+    //
+    // Packets. Every packet starts with a CommandHeader, occupies a multiple of 16 bytes and
+    // refers to resources by the same uint64_t ids RenderObject uses.
+    //
+
+    enum class CommandType : uint16_t {
+      BindPipeline = 1,
+      BindResources,
+      UpdateConstants,
+      DrawIndexed,
+      UpdateBuffer
+    };
+
+    enum ShaderStage : uint32_t {
+      ShaderStageVertex = 1,
+      ShaderStagePixel  = 2
+    };
+
+    enum ConstantFlags : uint32_t {
+      ConstantFlagCacheable = 1  // per-pass block worth deduplicating by content
+    };
+
+    static const uint32_t MaxConstantBufferSlots       = 14; // D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT
+    static const uint32_t MaxPixelShaderResources      = 9;
+    static const uint32_t MaxPixelShaderSamplers       = 2;
+
+    struct CommandHeader {
+      CommandType type;
+      uint16_t    reserved;
+      uint32_t    size;      // whole packet, including header and trailing data
+    };
+
+    struct BindPipelineCommand {
+      CommandHeader header;
+      uint64_t      inputLayoutId;
+      uint64_t      vertexShaderId;
+      uint64_t      pixelShaderId;
+    };
+
+    struct BindResourcesCommand {
+      CommandHeader header;
+      uint64_t      vertexBufferId;
+      uint64_t      indexBufferId;
+      uint32_t      vertexStride;
+      uint32_t      pixelShaderResourceCount;  // bound from slot 0; 0 leaves the slots untouched
+      uint64_t      pixelShaderResources[MaxPixelShaderResources];
+      uint32_t      samplerCount;
+      uint32_t      reserved;
+      uint64_t      samplers[MaxPixelShaderSamplers];
+    };
+
+    // Followed by dataSize bytes of constants. dataSize 0 only binds the buffer.
+    struct UpdateConstantsCommand {
+      CommandHeader header;
+      uint64_t      bufferId;
+      uint32_t      slot;
+      uint32_t      stages;    // ShaderStage bits the buffer is bound to
+      uint32_t      dataSize;
+      uint32_t      flags;     // ConstantFlags
+    };
+
+    // Followed by dataSize bytes, written to the start of a dynamic shader resource buffer.
+    struct UpdateBufferCommand {
+      CommandHeader header;
+      uint64_t      bufferId;
+      uint32_t      dataSize;
+      uint32_t      reserved[3];
+    };
+
+    struct DrawIndexedCommand {
+      CommandHeader header;
+      uint32_t      indexCount;  // 0: the whole bound index buffer
+      uint32_t      startIndex;
+      int32_t       baseVertex;
+    };
+
+    /**********************************************************************************************//**
+     * \class CommandBackend
+     *
+     * \brief Executes replayed packets; one implementation per graphics API.
+     **************************************************************************************************/
+    class CommandBackend {
+    public:
+      virtual ~CommandBackend() = default;
+
+      virtual void bindPipeline(BindPipelineCommand const&command) = 0;
+      virtual void bindResources(BindResourcesCommand const&command) = 0;
+      virtual void updateConstants(UpdateConstantsCommand const&command, const void *data) = 0;
+      virtual void drawIndexed(DrawIndexedCommand const&command) = 0;
+      virtual void updateBuffer(UpdateBufferCommand const&command, const void *data) = 0;
+    };
+
+    /**********************************************************************************************//**
+     * \class CommandList
+     *
+     * \brief Linear packet stream written by a single thread.
+     *
+     * Storage is reused across reset() calls, so steady-state recording does not allocate.
+     **************************************************************************************************/
+    class CommandList {
+    public:
+      CommandList();
+      CommandList(CommandList const&other);
+      CommandList& operator=(CommandList const&other);
+
+      void reset();
+
+      void bindPipeline(uint64_t inputLayoutId, uint64_t vertexShaderId, uint64_t pixelShaderId);
+      void bindResources(BindResourcesCommand const&resources);
+
+      // Returns zeroed storage for dataSize bytes of constants; valid until the next call on this list.
+      void* updateConstants(uint64_t bufferId, uint32_t slot, uint32_t stages, uint32_t dataSize, uint32_t flags = 0);
+
+      void drawIndexed(uint32_t indexCount, uint32_t startIndex = 0, int32_t baseVertex = 0);
+
+      // Returns zeroed storage for dataSize bytes of buffer contents; valid until the next call on this list.
+      void* updateBuffer(uint64_t bufferId, uint32_t dataSize);
+
+      // Packets start 16-byte aligned, so constants can be written as XMMATRIX / XMVECTOR.
+      inline const uint8_t* data()         const { return m_base;         }
+      inline size_t         byteSize()     const { return m_size;         }
+      inline uint32_t       commandCount() const { return m_commandCount; }
+
+    private:
+      void* allocate(CommandType type, size_t size);
+      void  reserve(size_t size);
+
+      std::vector<uint8_t> m_storage;
+      uint8_t             *m_base;
+      size_t               m_capacity;
+      size_t               m_size;
+      uint32_t             m_commandCount;
+    };
+
+    /**********************************************************************************************//**
+     * \class CommandBuffer
+     *
+     * \brief A set of command lists recorded independently and replayed in list order.
+     **************************************************************************************************/
+    class CommandBuffer {
+    public:
+      // Keeps (and clears) listCount lists.
+      void reset(size_t listCount);
+
+      inline CommandList&       list(size_t index)       { return m_lists[index]; }
+      inline CommandList const& list(size_t index) const { return m_lists[index]; }
+      inline size_t             listCount()        const { return m_listCount;    }
+
+      size_t commandCount() const;
+      size_t byteSize()     const;
+
+      // Replays every packet of lists [0, listCount()) in order; returns false on a malformed packet.
+      bool submit(CommandBackend &backend) const;
+
+    private:
+      std::vector<CommandList> m_lists;
+      size_t                   m_listCount = 0;
+    };
+
+    //
+    // Recording RenderScenes
+    //
+
+    struct SceneRecordingOptions {
+      uint32_t vertexStride;
+      uint64_t defaultSamplerId;
+      uint64_t shadowMapSamplerId;
+      size_t   objectsPerList;    // draw list slice recorded by one task
+
+      SceneRecordingOptions()
+        : vertexStride(5 * sizeof(XMVECTOR)) // Mesh<XMVECTOR>::Vertex_t
+        , defaultSamplerId(0)
+        , shadowMapSamplerId(0)
+        , objectsPerList(64)
+      {}
+    };
+
+    // Per-pass shader resource buffers, then constants (camera, lights, other, ambient, clusters),
+    // in the slots the shaders expect.
+    void RecordPassConstants(
+      RenderScene           const&scene,
+      CommandList                &list);
+
+    // Pipeline, resources, object constants and draw for scene.objects[first, last). Bindings
+    // repeated from the previous object in the same list are skipped.
+    void RecordRenderObjects(
+      RenderScene           const&scene,
+      PassType              const&passType,
+      SceneRecordingOptions const&options,
+      size_t                      first,
+      size_t                      last,
+      CommandList                &list);
+
+    // List 0 holds the pass constants and is recorded first, on the calling thread; the remaining
+    // lists hold one object slice each and are recorded in parallel on pool (inline if null).
+    // objectBufferUpdateFn must therefore be safe to call concurrently for different objects.
+    void RecordScene(
+      RenderScene                 const&scene,
+      PassType                    const&passType,
+      SceneRecordingOptions       const&options,
+      SAE::Threading::WorkerPool       *pool,
+      CommandBuffer                    &buffer);
+
+  }
+}
+
+#endif
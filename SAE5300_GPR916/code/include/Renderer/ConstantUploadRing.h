@@ -0,0 +1,133 @@
+#ifndef __SAE5300_GPR916_CONSTANTUPLOADRING_H__
+#define __SAE5300_GPR916_CONSTANTUPLOADRING_H__
+
+#include <cstdint>
+#include <vector>
+
+#include "Renderer/CommandBuffer.h"
+
+namespace SAE {
+  namespace Rendering {
+
+    /**********************************************************************************************//**
+     * \class ConstantUploadDevice
+     *
+     * \brief The one dynamic buffer a ConstantUploadRing writes into.
+     **************************************************************************************************/
+    class ConstantUploadDevice {
+    public:
+      virtual ~ConstantUploadDevice() = default;
+
+      // (Re)creates the buffer; previous contents are dropped.
+      virtual bool  createBuffer(uint32_t byteSize) = 0;
+      // Maps the whole buffer. discard: the GPU may still read the old contents, hand out new
+      // memory (WRITE_DISCARD); otherwise the caller only writes unused ranges (WRITE_NO_OVERWRITE).
+      virtual void* map(bool discard) = 0;
+      virtual void  unmap() = 0;
+    };
+
+    /**********************************************************************************************//**
+     * \class ConstantUploadRing
+     *
+     * \brief Linear per-frame allocator for constant blocks in a single dynamic buffer.
+     *
+     * Blocks are bound as ranges of that buffer (offsets and sizes in multiples of 256 bytes,
+     * as *SetConstantBuffers1 requires), so a whole pass needs one Map instead of one per draw.
+     * The first batch of a frame maps with discard and restarts at offset 0; the others append.
+     *
+     * Cacheable blocks are hashed: a block identical to one already uploaded this frame reuses
+     * that range instead of being written again.
+     **************************************************************************************************/
+    class ConstantUploadRing {
+    public:
+      static const uint32_t Alignment = 256;
+
+      struct Allocation {
+        uint32_t offset;
+        uint32_t size;    // multiple of Alignment; 0 for blocks that were not uploaded
+      };
+
+      struct Stats {
+        uint64_t bytesUploaded;
+        uint64_t bytesSkipped;   // cacheable blocks found unchanged
+        uint64_t blocksUploaded;
+        uint64_t blocksSkipped;
+        uint64_t maps;
+        uint64_t discards;
+      };
+
+      ConstantUploadRing();
+
+      bool initialize(ConstantUploadDevice *device, uint32_t capacity = (1 << 20));
+      bool deinitialize();
+
+      // Opens a batch of at most maxByteSize bytes (sum of AlignedSize()); grows the buffer or
+      // starts over with a discard if the rest of the buffer is too small.
+      bool begin(uint32_t maxByteSize);
+      bool upload(const void *data, uint32_t size, bool cacheable, Allocation &outAllocation);
+      void end();
+
+      // Closes the frame: the next batch discards, frameStats() restart.
+      void endFrame();
+
+      inline Stats const&   frameStats()     const { return m_frameStats;     }
+      inline Stats const&   lastFrameStats() const { return m_lastFrameStats; }
+      inline uint32_t       capacity()       const { return m_capacity;       }
+
+      static inline uint32_t AlignedSize(uint32_t size) { return (size + (Alignment - 1)) & ~(Alignment - 1); }
+
+    private:
+      struct CacheEntry {
+        uint64_t             hash;
+        Allocation           allocation;
+        std::vector<uint8_t> data;
+      };
+
+      ConstantUploadDevice   *m_device;
+      uint32_t                m_capacity;
+      uint32_t                m_head;
+      bool                    m_discardPending;
+      uint8_t                *m_mapped;
+
+      std::vector<CacheEntry> m_cache;        // entries [0, m_cacheSize) are valid
+      size_t                  m_cacheSize;
+
+      Stats                   m_frameStats;
+      Stats                   m_lastFrameStats;
+    };
+
+    // Uploads the constants of every UpdateConstants packet in buffer that carries data and is
+    // bound to a stage, in one batch. outAllocations holds one entry per UpdateConstants packet,
+    // in replay order. Blocks flagged ConstantFlagCacheable are deduplicated.
+    bool UploadCommandConstants(
+      CommandBuffer                     const&buffer,
+      ConstantUploadRing                     &ring,
+      std::vector<ConstantUploadRing::Allocation> &outAllocations);
+
+    /**********************************************************************************************//**
+     * \class MemoryConstantUploadDevice
+     *
+     * \brief ConstantUploadDevice in system memory, for headless backends and benchmarks.
+     **************************************************************************************************/
+    class MemoryConstantUploadDevice
+      : public ConstantUploadDevice
+    {
+    public:
+      bool  createBuffer(uint32_t byteSize) override;
+      void* map(bool discard) override;
+      void  unmap() override;
+
+      inline std::vector<uint8_t> const& data()          const { return m_data;          }
+      inline uint64_t                    mapCount()      const { return m_mapCount;      }
+      inline uint64_t                    discardCount()  const { return m_discardCount;  }
+
+    private:
+      std::vector<uint8_t> m_data;
+      uint64_t             m_mapCount     = 0;
+      uint64_t             m_discardCount = 0;
+    };
+
+  }
+}
+
+#endif
@@ -3,8 +3,12 @@
 
 #include "Platform/DirectX11/DirectX11Environment.h"
 #include "Platform/DirectX11/DirectX11ResourceManager.h"
+#include "Platform/DirectX11/DirectX11CommandBackend.h"
 #include "Platform/Timer.h"
+#include "Engine/WorkerPool.h"
 #include "RendererDTO.h"
+#include "CommandBuffer.h"
+#include "ConstantUploadRing.h"
 
 namespace SAE {
   namespace Rendering {
@@ -26,6 +30,9 @@ namespace SAE {
         RenderScene               const&scene,
         PassType                  const&passType);
 
+      // Constant bytes uploaded / skipped as unchanged during the last presented frame.
+      inline ConstantUploadRing::Stats const& constantUploadStats() const { return m_constantUploadRing.lastFrameStats(); }
+
     private:
       std::shared_ptr<DirectX> 
         m_dx11Environment;
@@ -33,8 +40,6 @@ namespace SAE {
         m_resourceManager;
 
       uint64_t m_rasterizerStateId;
-      uint64_t m_dsvTexHandle;
-      uint64_t m_dsvViewHandle;
       uint64_t m_dssHandle;
 
       uint64_t 
@@ -42,6 +47,13 @@ namespace SAE {
         m_shadowMapSamplerStateId;
 
       D3D11_VIEWPORT m_viewPort;
+
+      SAE::Threading::WorkerPool m_recordingPool;
+      CommandBuffer              m_commandBuffer;
+
+      std::shared_ptr<SAE::DirectX11::DirectX11ConstantUploadDevice> m_constantUploadDevice;
+      ConstantUploadRing                                             m_constantUploadRing;
+      std::shared_ptr<SAE::DirectX11::DirectX11CommandBackend>       m_commandBackend;
     };
 
   }
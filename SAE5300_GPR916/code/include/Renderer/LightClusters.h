@@ -0,0 +1,131 @@
+#ifndef __SAE5300_GPR916_LIGHTCLUSTERS_H__
+#define __SAE5300_GPR916_LIGHTCLUSTERS_H__
+
+#include <cstdint>
+#include <vector>
+
+#include "Engine/WorkerPool.h"
+
+namespace SAE {
+  namespace Rendering {
+
+    /**********************************************************************************************//**
+     * \class LightClusters
+     *
+     * \brief Assigns lights to the clusters (froxels) of a view frustum.
+     *
+     * The frustum is split into gridX x gridY screen tiles and gridZ depth slices, spaced
+     * exponentially between nearPlane and farPlane so that clusters stay roughly cubic. Depths
+     * below nearPlane fall into the first slice, depths beyond farPlane into the last. Cluster
+     * bounds are view space boxes, precomputed whenever the projection changes.
+     *
+     * build() tests every light's bounding sphere against the boxes of the slices it overlaps,
+     * four clusters at a time, slices in parallel on the pool. The result is one (offset, count)
+     * cell per cluster into a flat index list; within a cell, lights keep their input order.
+     * Cells are stored slice by slice, rows top to bottom:
+     *   cell = (slice * gridY + y) * gridX + x
+     * and a view depth maps to slice floor(log(depth) * depthScale() + depthBias()).
+     **************************************************************************************************/
+    class LightClusters {
+    public:
+      struct Options {
+        uint32_t gridX;
+        uint32_t gridY;
+        uint32_t gridZ;
+        uint32_t maxLightsPerCluster;  // further lights in a cluster are dropped
+        uint32_t maxIndices;           // capacity of the index list, the size of the GPU buffer
+        bool     allowSIMD;            // false forces the scalar path
+
+        Options()
+          : gridX(16)
+          , gridY(9)
+          , gridZ(24)
+          , maxLightsPerCluster(128)
+          , maxIndices(128 * 1024)
+          , allowSIMD(true)
+        {}
+      };
+
+      // View space bounding sphere of a light. An infinite radius reaches every cluster.
+      struct LightSphere {
+        float x;
+        float y;
+        float z;
+        float radius;
+      };
+
+      // Layout of the shader's uint2 cell.
+      struct Cell {
+        uint32_t offset;  // first entry in indices()
+        uint32_t count;
+      };
+
+      struct Stats {
+        uint32_t lights;
+        uint32_t occupiedClusters;
+        uint32_t indices;
+        uint32_t indicesDropped;      // over maxLightsPerCluster or maxIndices
+        uint32_t maxClusterLights;    // before dropping
+        double   buildMs;
+      };
+
+      LightClusters();
+
+      // pool may be null or shared with other systems; it must outlive this object.
+      bool initialize(Options const&options = Options(), SAE::Threading::WorkerPool *pool = nullptr);
+      void deinitialize();
+
+      // scaleX, scaleY: projection._11 and ._22 of a centred perspective projection.
+      void setProjection(float scaleX, float scaleY, float nearPlane, float farPlane);
+
+      void build(std::vector<LightSphere> const&lights);
+
+      inline std::vector<Cell>     const& cells()   const { return m_cells;   }
+      inline std::vector<uint32_t> const& indices() const { return m_indices; }
+      inline Stats                 const& stats()   const { return m_stats;   }
+
+      inline uint32_t gridX()        const { return m_options.gridX; }
+      inline uint32_t gridY()        const { return m_options.gridY; }
+      inline uint32_t gridZ()        const { return m_options.gridZ; }
+      inline uint32_t clusterCount() const { return m_options.gridX * m_options.gridY * m_options.gridZ; }
+      inline float    depthScale()   const { return m_depthScale; }
+      inline float    depthBias()    const { return m_depthBias;  }
+
+    private:
+      void computeBounds();
+      void assignSlice(uint32_t slice, std::vector<LightSphere> const&lights);
+
+      Options                     m_options;
+      SAE::Threading::WorkerPool *m_pool;
+      bool                        m_useSIMD;
+
+      float m_scaleX;
+      float m_scaleY;
+      float m_nearPlane;
+      float m_farPlane;
+      float m_depthScale;
+      float m_depthBias;
+
+      // Cluster boxes as structure of arrays, slice by slice; every slice is padded to
+      // m_sliceStride clusters with empty boxes, so that whole groups of four can be tested.
+      uint32_t           m_sliceStride;
+      std::vector<float> m_sliceNear;
+      std::vector<float> m_sliceFar;
+      std::vector<float> m_boundsMin[3];
+      std::vector<float> m_boundsMax[3];
+
+      // Per cluster light lists of maxLightsPerCluster entries, filled by the slice tasks.
+      std::vector<uint32_t> m_clusterLights;
+      std::vector<uint32_t> m_clusterCounts;    // before dropping
+      std::vector<uint32_t> m_sliceMaxLights;
+
+      std::vector<Cell>     m_cells;
+      std::vector<uint32_t> m_indices;
+
+      Stats m_stats;
+    };
+
+  }
+}
+
+#endif
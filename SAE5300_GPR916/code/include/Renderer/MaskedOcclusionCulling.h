@@ -0,0 +1,173 @@
+#ifndef __SAE5300_GPR916_MASKEDOCCLUSIONCULLING_H__
+#define __SAE5300_GPR916_MASKEDOCCLUSIONCULLING_H__
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "Engine/WorkerPool.h"
+
+namespace SAE {
+  namespace Rendering {
+
+    /**********************************************************************************************//**
+     * \class MaskedOcclusionCulling
+     *
+     * \brief Conservative CPU occlusion culling against a low resolution masked depth buffer.
+     *
+     * Follows Andersson et al., "Masked Software Occlusion Culling" (HPG 2016): the screen is
+     * split into 32x8 pixel tiles, each holding one coverage bit per pixel and two depth
+     * bounds, a working layer z0 for the covered pixels and a reference layer z1 for the rest.
+     * Occluder triangles are rasterized a whole tile at a time: per scanline the edge
+     * x-intercepts turn into 32-bit span masks with shifts, eight scanlines per AVX2 register
+     * (scalar fallback). Triangles merge into the tile layers by the cheaper of extending the
+     * working layer or discarding it; once the mask is full, the working layer becomes the
+     * reference layer.
+     *
+     * Per-tile z1 forms the coarse level of the hierarchy: a test rejects whole tiles with one
+     * compare and only falls back to the coverage mask where its depth lies between z0 and z1.
+     *
+     * Usage per frame: clear(), addOccluder() for a few simplified meshes, flush(), then any
+     * number of testAABB() / testRect() calls, which are const and may run concurrently.
+     *
+     * Matrices are 16 floats in DirectXMath layout (row vectors, clip = v * M), clip space z
+     * in [0, w] and LESS depth, as everywhere else in the renderer.
+     **************************************************************************************************/
+    class MaskedOcclusionCulling {
+    public:
+      static const uint32_t TileWidth  = 32;
+      static const uint32_t TileHeight = 8;
+
+      enum class Result {
+        Visible,
+        Occluded,
+        ViewCulled
+      };
+
+      struct Options {
+        uint32_t width;                  // rounded up to TileWidth
+        uint32_t height;                 // rounded up to TileHeight
+        bool     frontCounterClockwise;  // winding of front faces, for occluders drawn with backface culling
+        bool     allowAVX2;              // false forces the scalar path
+
+        Options()
+          : width(320)
+          , height(192)
+          , frontCounterClockwise(true)
+          , allowAVX2(true)
+        {}
+      };
+
+      struct Stats {
+        uint64_t occluderTriangles;
+        uint64_t occluderTrianglesRasterized;  // after clipping, culling and the off-screen reject
+        uint64_t objectsTested;
+        uint64_t objectsOccluded;
+        uint64_t objectsViewCulled;
+        double   setupMs;
+        double   rasterMs;
+      };
+
+      MaskedOcclusionCulling();
+
+      // pool may be null or shared with other systems; it must outlive this object.
+      bool initialize(Options const&options = Options(), SAE::Threading::WorkerPool *pool = nullptr);
+      bool deinitialize();
+
+      // Resets the buffer to far depth and drops pending occluders.
+      void clear();
+
+      // Records an occluder; positions are xyz floats, stride bytes apart. Data is copied.
+      void addOccluder(
+        const float    *positions,
+        size_t          stride,
+        size_t          vertexCount,
+        const uint32_t *indices,
+        size_t          indexCount,
+        const float    *modelToClip,
+        bool            cullBackFaces = true);
+
+      // Rasterizes everything added since clear().
+      void flush();
+
+      Result testAABB(const float boundsMin[3], const float boundsMax[3], const float *modelToClip) const;
+
+      // Screen rectangle in pixels (exclusive max) with the nearest depth of the object.
+      Result testRect(float minX, float minY, float maxX, float maxY, float nearestDepth) const;
+
+      // Per-pixel conservative depth, width() * height(); for debugging only.
+      void resolveDepth(std::vector<float> &outDepth) const;
+
+      inline uint32_t width()   const { return m_tilesX * TileWidth;  }
+      inline uint32_t height()  const { return m_tilesY * TileHeight; }
+      inline bool     usesAVX2() const { return m_useAVX2; }
+
+      Stats stats() const;
+      void  resetStats();
+
+    private:
+      // Screen-space occluder triangle. For every non-horizontal edge the x-intercept at a
+      // scanline centre yc is offset + slope * yc; left edges bound the span from below.
+      struct Triangle {
+        float    slope[3];
+        float    offset[3];
+        bool     left[3];
+        uint32_t edgeCount;
+        float    depth[3];             // z = depth[0] * x + depth[1] * y + depth[2]
+        float    maxDepth;
+        float    minX, minY, maxX, maxY;
+        int32_t  firstRow, lastRow;
+      };
+
+      struct Occluder {
+        size_t   indexBase;        // indices are rebased onto m_vertices
+        size_t   triangleBase;
+        size_t   triangleCount;
+        bool     cullBackFaces;
+      };
+
+      // Triangles set up from a range of occluder triangles, plus per tile row indices into them.
+      struct Bin {
+        std::vector<Triangle>              triangles;
+        std::vector<std::vector<uint32_t>> rows;
+        uint64_t                           rasterized;
+      };
+
+      void setupRange(size_t first, size_t last, Bin &bin);
+      void setupTriangle(const float *v[3], bool cullBackFaces, Bin &bin);
+      void rasterizeTileRow(uint32_t tileY);
+      void rasterizeTriangle(Triangle const&tri, uint32_t tileY);
+      void parallelFor(size_t count, std::function<void(size_t, size_t)> const&fn);
+
+      Result testScreenRect(float minX, float minY, float maxX, float maxY, float nearestDepth) const;
+      Result countResult(Result result) const;
+
+      Options                     m_options;
+      SAE::Threading::WorkerPool *m_pool;
+      bool                        m_useAVX2;
+      uint32_t                    m_tilesX;
+      uint32_t                    m_tilesY;
+
+      // Tile state, structure of arrays; mask holds TileHeight rows of TileWidth bits per tile.
+      std::vector<uint32_t>       m_mask;
+      std::vector<float>          m_z0;
+      std::vector<float>          m_z1;
+
+      // Pending occluders, clip-space vertices
+      std::vector<float>          m_vertices;
+      std::vector<uint32_t>       m_indices;
+      std::vector<Occluder>       m_occluders;
+      size_t                      m_triangleCount;
+      std::vector<Bin>            m_bins;
+
+      Stats                       m_stats;
+      mutable std::atomic<uint64_t> m_objectsTested;
+      mutable std::atomic<uint64_t> m_objectsOccluded;
+      mutable std::atomic<uint64_t> m_objectsViewCulled;
+    };
+
+  }
+}
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef __SAE5300_GPR916_NULLCOMMANDBACKEND_H__
+#define __SAE5300_GPR916_NULLCOMMANDBACKEND_H__
+
+#include <string>
+#include <vector>
+
+#include "Renderer/CommandBuffer.h"
+#include "Renderer/ConstantUploadRing.h"
+
+namespace SAE {
+  namespace Rendering {
+
+    /**********************************************************************************************//**
+     * \class NullCommandBackend
+     *
+     * \brief Replay target that executes nothing, but counts and validates every packet.
+     *
+     * Checks the constraints the D3D11 backend relies on: non-null input layout, vertex shader
+     * and buffers, counts and slots within the API limits, 16-byte constant blocks, and no draw
+     * before a pipeline and resources were bound.
+     **************************************************************************************************/
+    class NullCommandBackend
+      : public CommandBackend
+    {
+    public:
+      struct Stats {
+        uint64_t pipelineBinds;
+        uint64_t resourceBinds;
+        uint64_t constantUpdates;
+        uint64_t constantBytes;
+        uint64_t draws;
+        uint64_t bufferUpdates;
+        uint64_t bufferBytes;
+        uint64_t errors;
+      };
+
+      NullCommandBackend();
+
+      void bindPipeline(BindPipelineCommand const&command) override;
+      void bindResources(BindResourcesCommand const&command) override;
+      void updateConstants(UpdateConstantsCommand const&command, const void *data) override;
+      void drawIndexed(DrawIndexedCommand const&command) override;
+      void updateBuffer(UpdateBufferCommand const&command, const void *data) override;
+
+      // Forgets bound state and counters, as ClearState does for the device.
+      void reset();
+
+      inline Stats       const& stats()      const { return m_stats;      }
+      inline std::string const& firstError() const { return m_firstError; }
+
+    private:
+      void error(const char *message);
+
+      Stats       m_stats;
+      std::string m_firstError;
+      bool        m_pipelineBound;
+      bool        m_resourcesBound;
+    };
+
+    struct CommandRecordingBenchmarkResult {
+      unsigned int threadCount;
+      size_t       commands;
+      size_t       bytes;
+      double       recordMs;
+      double       submitMs;
+      double       commandsPerSecond;
+      double       megabytesPerSecond;
+      uint64_t     constantBytesPerFrame;  // through a ConstantUploadRing on a MemoryConstantUploadDevice
+      bool         valid;
+    };
+
+    // Records a synthetic scene of objectCount objects with 1, 2, 4, ... maxThreads threads
+    // (0: hardware concurrency), uploads its constants and replays it into a NullCommandBackend.
+    std::vector<CommandRecordingBenchmarkResult> BenchmarkCommandRecording(
+      size_t       objectCount = 10000,
+      unsigned int maxThreads  = 0);
+
+  }
+}
+
+#endif
@@ -0,0 +1,212 @@
+#ifndef __SAE5300_GPR916_RENDERGRAPH_H__
+#define __SAE5300_GPR916_RENDERGRAPH_H__
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace SAE {
+  namespace Rendering {
+
+    enum class RenderGraphFormat : uint32_t {
+      D24S8 = 1,   // depth; sampled as R24_UNORM_X8
+      D32F,
+      RGBA8,
+      RGBA16F,
+      R32F
+    };
+
+    enum RenderGraphUsage : uint32_t {
+      RenderGraphUsageShaderResource = 1,
+      RenderGraphUsageDepthStencil   = 2,
+      RenderGraphUsageRenderTarget   = 4
+    };
+
+    struct RenderGraphTextureDesc {
+      uint32_t          width;
+      uint32_t          height;
+      uint32_t          arraySize;
+      RenderGraphFormat format;
+      bool              cube;       // arraySize is a multiple of 6, sampled as a cube (array)
+
+      bool operator==(RenderGraphTextureDesc const&other) const;
+      uint64_t byteSize() const;
+    };
+
+    // Physical texture as a backend created it. View ids are per array slice.
+    struct RenderGraphTexture {
+      uint64_t              textureId;
+      uint64_t              shaderResourceViewId;
+      std::vector<uint64_t> depthStencilViewIds;
+      std::vector<uint64_t> renderTargetViewIds;
+    };
+
+    /**********************************************************************************************//**
+     * \class RenderGraphAllocator
+     *
+     * \brief Creates the physical textures behind transient graph resources.
+     **************************************************************************************************/
+    class RenderGraphAllocator {
+    public:
+      virtual ~RenderGraphAllocator() = default;
+
+      // usage: RenderGraphUsage bits; views are created for each of them.
+      virtual bool create(RenderGraphTextureDesc const&desc, uint32_t usage, RenderGraphTexture &outTexture) = 0;
+      virtual void release(RenderGraphTexture &texture) = 0;
+    };
+
+    /**********************************************************************************************//**
+     * \class RenderGraph
+     *
+     * \brief Frame description as passes reading and writing textures, compiled each frame.
+     *
+     * Per frame: reset(), declare resources and passes, compile(), execute(). Passes declare
+     * their accesses in a setup function and do their work in an execute function, which looks
+     * up the physical textures it was given.
+     *
+     * compile()
+     *   - culls passes none of whose outputs are read by a surviving pass, unless the pass has
+     *     side effects (presenting, writing an imported resource);
+     *   - orders passes: writers of a resource run before its readers, writers among
+     *     themselves in declaration order, otherwise declaration order is kept;
+     *   - aliases transient textures: a texture whose lifetime (first to last pass using it)
+     *     does not overlap another one with the same description and usage reuses its
+     *     physical texture. Physical textures are pooled across frames and released after
+     *     some frames without use.
+     *
+     * An aliased texture starts with the contents of the previous one: its first writer has
+     * to clear it.
+     **************************************************************************************************/
+    class RenderGraph {
+    public:
+      typedef uint32_t ResourceHandle;
+      static const ResourceHandle InvalidResource = 0xFFFFFFFF;
+
+      class Builder {
+      public:
+        void read(ResourceHandle resource);
+        void writeDepthStencil(ResourceHandle resource);
+        void writeRenderTarget(ResourceHandle resource);
+        // Never culled.
+        void sideEffect();
+
+      private:
+        friend class RenderGraph;
+        Builder(RenderGraph &graph, uint32_t pass);
+
+        RenderGraph &m_graph;
+        uint32_t     m_pass;
+      };
+
+      class Context {
+      public:
+        RenderGraphTexture const& texture(ResourceHandle resource) const;
+
+      private:
+        friend class RenderGraph;
+        explicit Context(RenderGraph const&graph);
+
+        RenderGraph const&m_graph;
+      };
+
+      typedef std::function<void(Builder&)>       SetupFn;
+      typedef std::function<void(Context const&)> ExecuteFn;
+
+      struct Stats {
+        uint32_t passes;
+        uint32_t passesCulled;
+        uint32_t transientResources;
+        uint32_t physicalTextures;       // used this frame
+        uint32_t physicalTexturesCreated;
+        uint64_t transientBytes;         // sum over the transient resources
+        uint64_t physicalBytes;          // after aliasing
+      };
+
+      RenderGraph();
+      ~RenderGraph();
+
+      bool initialize(RenderGraphAllocator *allocator, uint32_t releaseAfterFrames = 8);
+      bool deinitialize();
+
+      // Drops the passes and resources of the previous frame; keeps the physical pool and the
+      // storage of the passes, so that a frame declaring the same graph does not allocate.
+      void reset();
+
+      ResourceHandle createTexture(std::string const&name, RenderGraphTextureDesc const&desc);
+      // External texture, e.g. the back buffer. Writing it counts as a side effect.
+      ResourceHandle importTexture(std::string const&name, RenderGraphTextureDesc const&desc, RenderGraphTexture const&texture);
+
+      void addPass(char const *name, SetupFn const&setup, ExecuteFn const&execute);
+
+      // False on a dependency cycle or allocation failure; see describe().
+      bool compile();
+      void execute();
+
+      // Schedule, culled passes, lifetimes and physical assignment of the last compile().
+      void describe(std::ostream &out) const;
+
+      inline Stats const& stats() const { return m_stats; }
+
+    private:
+      struct Access {
+        ResourceHandle resource;
+        uint32_t       usage;
+        bool           write;
+      };
+
+      struct Pass {
+        std::string         name;
+        ExecuteFn           execute;
+        std::vector<Access> accesses;
+        bool                sideEffect;
+        bool                culled;
+        uint32_t            order;      // position in the schedule
+      };
+
+      struct Resource {
+        std::string            name;
+        RenderGraphTextureDesc desc;
+        uint32_t               usage;
+        bool                   imported;
+        RenderGraphTexture     importedTexture;
+        bool                   culled;
+        uint32_t               firstPass;  // schedule positions
+        uint32_t               lastPass;
+        int32_t                physical;   // index into m_pool, -1 if none
+      };
+
+      struct PhysicalTexture {
+        RenderGraphTextureDesc desc;
+        uint32_t               usage;
+        RenderGraphTexture     texture;
+        uint32_t               busyUntil;    // last schedule position using it this frame
+        uint64_t               lastUsedFrame;
+        bool                   usedThisFrame;
+      };
+
+      void access(uint32_t pass, ResourceHandle resource, uint32_t usage, bool write);
+      void cull();
+      bool schedule();
+      bool assignPhysical();
+
+      RenderGraphAllocator        *m_allocator;
+      uint32_t                     m_releaseAfterFrames;
+      uint64_t                     m_frame;
+
+      std::vector<Pass>            m_passes;
+      std::vector<Pass>            m_spares;     // passes of earlier frames, reused by addPass()
+      std::vector<Resource>        m_resources;
+      std::vector<uint32_t>        m_schedule;   // pass indices
+      std::vector<PhysicalTexture> m_pool;
+      std::string                  m_error;
+      bool                         m_compiled;
+
+      Stats                        m_stats;
+    };
+
+  }
+}
+
+#endif
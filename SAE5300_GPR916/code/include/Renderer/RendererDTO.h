@@ -5,7 +5,10 @@
 #include <functional>
 #include <stdint.h>
 
-#include "Platform/DirectX11/DirectX11Common.h"
+#include "Engine/FrameArena.h"
+
+// Only DirectXMath: the DTOs are shared with backends that do not use D3D11.
+#include "Platform/DirectXMathConfig.h"
 
 namespace SAE {
   namespace DTO {
@@ -24,28 +27,60 @@ namespace SAE {
       XMMATRIX invTransposeWorld;
     };
 
+    // A shadowed light. Each view's projection is folded into its view on the CPU, once per
+    // change of the light; lighting parameters for the GPU are in ClusterLight_t.
     struct LightInfo_t {
-      XMMATRIX view[6];
-      XMMATRIX projection;
+      XMMATRIX viewProjection[6];
+      XMVECTOR shadowTiles[6];  // per view: atlas uv offset (xy), scale (z), half a texel (w); z 0: unshadowed
       XMVECTOR position;
       XMVECTOR direction;
       XMVECTOR color;
-      uint32_t type;
-      uint32_t lightViewIndex;
-      uint32_t unused1;
-      uint32_t unused2;
+      uint32_t type;            // 0: directional, 1: point, 2: spot
+      uint32_t shadowViewCount; // valid entries of viewProjection and shadowTiles
       float    intensity;
       float    distance;
-      float    hotSpotAngle;
-      float    falloffAngle;
     };
 
     struct LightBuffer_t {
       LightInfo_t lights[4];
-      uint32_t    lightIndex;
-      uint32_t    unused0;
-      uint32_t    unused1;
-      uint32_t    unused2;
+    };
+
+    // Layout of SAE::Texture::SHIrradiance plus environment info; written once at load.
+    struct AmbientBuffer_t {
+      XMVECTOR irradiance[9];
+      XMVECTOR environmentInfo; // x: mip count of the prefiltered environment map
+    };
+
+    // Addressing constants of a virtual texture, see code/shader/virtual_texture.hlsli.
+    struct VirtualTextureBuffer_t {
+      XMVECTOR physical;    // 1 / physical width, 1 / physical height, tile size, border
+      XMVECTOR virtualSize; // width, height, page size, mip levels
+    };
+
+    // One light of the clustered light list, StructuredBuffer<ClusterLight> in the fragment shader.
+    struct ClusterLight_t {
+      XMFLOAT3 position;
+      float    range;        // radius of the light's influence
+      XMFLOAT3 color;
+      float    intensity;
+      XMFLOAT3 direction;
+      int32_t  shadowIndex;  // slot in LightBuffer_t::lights holding the shadow views; -1: unshadowed
+      uint32_t type;         // as LightInfo_t::type
+      float    cosHotSpot;
+      float    cosFalloff;
+      uint32_t unused0;
+    };
+
+    // Addressing of the cluster grid, see Renderer/LightClusters.h.
+    struct ClusterBuffer_t {
+      uint32_t gridX;
+      uint32_t gridY;
+      uint32_t gridZ;
+      uint32_t lightCount;
+      float    tileScaleX;   // clusters per pixel
+      float    tileScaleY;
+      float    depthScale;   // slice = log(view depth) * depthScale + depthBias
+      float    depthBias;
     };
 
     struct OtherBuffer_t {
@@ -55,6 +90,21 @@ namespace SAE {
       uint32_t unused2;
     };
 
+    // Region of the render target a pass draws into, in pixels.
+    struct Viewport_t {
+      float x;
+      float y;
+      float width;
+      float height;
+    };
+
+    // Contents of a dynamic shader resource buffer, written from its start before the pass draws.
+    struct ShaderBufferUpdate {
+      uint64_t                   bufferId;
+      uint32_t                   dataSize;
+      std::function<bool(void*)> updateFn;
+    };
+
     struct RenderObject {
       uint64_t
         objectId,
@@ -69,15 +119,26 @@ namespace SAE {
         normalTextureSRVId;
     };
 
+    // Built per pass on the thread executing it: the lists live in that thread's frame arena.
     struct RenderScene {
       uint64_t
         cameraBufferId,
         objectBufferId,
         lightBufferId,
         otherBufferId,
-        shadowMapTextureSRVId;
+        ambientBufferId,
+        clusterBufferId,
+        shadowMapTextureSRVId,
+        environmentMapSRVId,
+        clusterLightsSRVId,
+        clusterCellsSRVId,
+        clusterIndicesSRVId;
       uint64_t
-        renderTargetId;
+        renderTargetId; // depth stencil view the pass renders into
+      Viewport_t
+        viewport;       // width 0: the whole target
+      bool
+        preserveDepth;  // draw over the target's contents instead of clearing it
       std::function<bool(CameraBuffer_t*)>
         cameraBufferUpdateFn;
       std::function<bool(ObjectBuffer_t*, uint64_t)>
@@ -86,9 +147,13 @@ namespace SAE {
         lightingBufferUpdateFn;
       std::function<bool(OtherBuffer_t*)>
         otherBufferUpdateFn;
-      std::vector<RenderObject> 
+      std::function<bool(ClusterBuffer_t*)>
+        clusterBufferUpdateFn;
+      SAE::Memory::FrameVector<ShaderBufferUpdate>
+        shaderBufferUpdates;
+      SAE::Memory::FrameVector<RenderObject>
         objects;
-      std::vector<uint64_t>
+      SAE::Memory::FrameVector<uint64_t>
         lights;
     };
     
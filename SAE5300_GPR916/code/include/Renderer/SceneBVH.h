@@ -0,0 +1,157 @@
+#ifndef __SAE5300_GPR916_SCENEBVH_H__
+#define __SAE5300_GPR916_SCENEBVH_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace SAE {
+  namespace Rendering {
+
+    /**********************************************************************************************//**
+     * \class SceneBVH
+     *
+     * \brief Bounding volume hierarchy over the world space boxes of a scene's items.
+     *
+     * Items are numbered 0 to itemCount - 1 by the caller; an empty box (minimum above maximum)
+     * keeps an item out of the tree, queries never report it. Nodes have four children, their
+     * boxes stored as structure of arrays, so that a query tests all four with one SSE
+     * operation per coordinate. build() splits every node with the surface area heuristic over
+     * binned centroids until leaves hold at most maxLeafItems items.
+     *
+     * Moving items are updated in place: update() marks the item's leaf, refit() grows and
+     * shrinks the boxes of the marked leaves and their ancestors. Refitted trees degrade, so a
+     * subtree whose box outgrew its surface area at build time by rebuildAreaRatio is rebuilt
+     * by refit(), the whole tree once the root has.
+     *
+     * Queries are const and may run concurrently; build(), update() and refit() must not
+     * overlap them. Queries write the items they find into outItems, which must hold
+     * itemCount() entries, in no particular order, and return how many they wrote.
+     **************************************************************************************************/
+    class SceneBVH {
+    public:
+      struct Options {
+        uint32_t maxLeafItems;      // 1 to 4
+        uint32_t binCount;          // SAH bins per axis
+        float    rebuildAreaRatio;  // refitted surface area over built surface area
+
+        Options()
+          : maxLeafItems(4)
+          , binCount(12)
+          , rebuildAreaRatio(2.0f)
+        {}
+      };
+
+      struct Box {
+        float minimum[3];
+        float maximum[3];
+      };
+
+      // Points p with x * p.x + y * p.y + z * p.z + w >= 0 are inside.
+      struct Plane {
+        float x;
+        float y;
+        float z;
+        float w;
+      };
+
+      struct Stats {
+        uint32_t items;         // in the tree
+        uint32_t nodes;
+        uint32_t depth;
+        uint32_t refitItems;    // moved items of the last refit()
+        uint32_t rebuilds;      // subtrees rebuilt by the last refit()
+        uint32_t fullRebuilds;  // since build()
+      };
+
+      SceneBVH();
+
+      void setOptions(Options const&options);
+
+      // Builds the tree from scratch; items keep the boxes given here until update().
+      void build(Box const*boxes, size_t itemCount);
+      void clear();
+
+      void update(uint32_t item, Box const&box);
+      void refit();
+
+      // Items whose box is not entirely outside one of the planes; planeCount at most 6.
+      size_t queryFrustum(Plane const*planes, uint32_t planeCount, uint32_t *outItems) const;
+      size_t querySphere(float const center[3], float radius, uint32_t *outItems) const;
+      // Items whose box the ray enters within maxDistance; outDistances, if given, receives the
+      // entry distances in units of direction.
+      size_t queryRay(float const origin[3], float const direction[3], float maxDistance, uint32_t *outItems, float *outDistances = nullptr) const;
+
+      // Whether any item's box touches the sphere; stops at the first one.
+      bool overlapsSphere(float const center[3], float radius) const;
+
+      inline bool   contains(uint32_t item) const { return item < m_itemSlots.size() && m_itemSlots[item] != InvalidSlot; }
+      inline size_t itemCount()             const { return m_itemBoxes.size(); }
+      inline Stats const& stats()           const { return m_stats; }
+
+      // Frustum planes of a view-projection in DirectXMath layout (16 floats, row vectors,
+      // clip = v * M, clip space z in [0, w]). Without the near plane when clipNear is false.
+      static uint32_t FrustumPlanes(float const *viewProjection, bool clipNear, Plane outPlanes[6]);
+
+    private:
+      static const uint32_t InvalidNode = 0xFFFFFFFF;
+      static const uint32_t InvalidSlot = 0xFFFFFFFF;
+      static const uint32_t LeafBit     = 0x80000000;  // in Node::child: first entry in m_leafItems
+      static const uint32_t MaxSAHDepth = 48;          // deeper nodes split at the median
+      static const uint32_t StackSize   = 256;         // traversal stack, enough for any tree built
+
+      struct Node {
+        float    minX[4], minY[4], minZ[4];
+        float    maxX[4], maxY[4], maxZ[4];
+        uint32_t child[4];     // inner node, LeafBit | first leaf entry or InvalidNode
+        uint32_t count[4];     // items of a leaf child
+        uint32_t begin;        // range of m_leafItems covered by the subtree
+        uint32_t end;
+        uint32_t parent;       // InvalidNode for the root
+        uint32_t parentSlot;
+        float    builtArea;    // surface area of the node's box when its subtree was built
+        uint32_t rebuildMark;  // refit pass that scheduled the subtree for rebuilding
+      };
+
+      uint32_t allocateNode();
+      void     releaseSubtree(uint32_t node);
+      void     buildAll();
+      uint32_t buildNode(uint32_t begin, uint32_t end, uint32_t parent, uint32_t parentSlot, uint32_t depth);
+      uint32_t splitRange(uint32_t begin, uint32_t end, bool median);
+      void     rebuildSubtree(uint32_t node);
+      Box      nodeBox(uint32_t node) const;
+      Box      leafBox(uint32_t first, uint32_t count) const;
+      void     setSlot(uint32_t node, uint32_t slot, Box const&box);
+      Box      refitNode(uint32_t node);
+      void     checkDegraded(uint32_t node, Box const&box);
+      uint32_t nodeDepth(uint32_t node) const;
+
+      size_t   emitItems(uint32_t begin, uint32_t end, uint32_t *outItems) const;
+
+      Options m_options;
+
+      std::vector<Node>     m_nodes;
+      std::vector<uint32_t> m_freeNodes;
+      uint32_t              m_root;
+
+      std::vector<Box>      m_itemBoxes;
+      std::vector<uint32_t> m_itemSlots;      // per item: node * 4 + slot of its leaf, or InvalidSlot
+      // Items in the tree, partitioned by the build: every subtree covers a contiguous range,
+      // every leaf a range of up to maxLeafItems.
+      std::vector<uint32_t> m_leafItems;
+      std::vector<float>    m_centroids;      // per item, three floats; build scratch
+
+      std::vector<uint32_t> m_dirtyNodes;     // nodes with moved items in their leaves
+      std::vector<uint8_t>  m_dirtyFlags;     // per node
+      std::vector<uint32_t> m_rebuildNodes;
+      uint32_t              m_refitPass;
+      uint32_t              m_movedItems;     // update() calls since the last refit()
+      bool                  m_buildPending;   // an item entered the tree, see update()
+
+      Stats m_stats;
+    };
+
+  }
+}
+
+#endif
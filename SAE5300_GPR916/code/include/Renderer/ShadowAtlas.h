@@ -0,0 +1,108 @@
+#ifndef __SAE5300_GPR916_SHADOWATLAS_H__
+#define __SAE5300_GPR916_SHADOWATLAS_H__
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "Engine/FrameArena.h"
+
+namespace SAE {
+  namespace Rendering {
+
+    // Square region of the atlas, in texels. size 0: no tile, the caster is not shadowed.
+    struct ShadowAtlasTile {
+      uint32_t x;
+      uint32_t y;
+      uint32_t size;
+    };
+
+    /**********************************************************************************************//**
+     * \class ShadowAtlas
+     *
+     * \brief Places variable-size shadow map tiles in one square depth texture.
+     *
+     * Every frame the caller requests a tile per shadow view (light face, cascade, ...) with
+     * an importance in [0, 1], usually the share of the screen the light can affect. The tile
+     * size is maxTileSize scaled by the importance and rounded down to a power of two, so a far
+     * light gets proportionally fewer texels than a near one.
+     *
+     * Tiles are power-of-two squares managed by a quadtree (buddy) allocator: a free cell is
+     * split into four until it has the requested size, and four free siblings merge back.
+     * Tiles keep their place across frames as long as their size does not change; shrinking
+     * waits for shrinkDelayFrames consecutive frames, growing is immediate. Requests that do
+     * not fit are halved, least important first, down to minTileSize, then dropped. Sorted by
+     * size, power-of-two squares always pack into an area at least as large as their sum, so
+     * when fragmentation makes an allocation fail, all tiles are placed again from scratch.
+     **************************************************************************************************/
+    class ShadowAtlas {
+    public:
+      struct Request {
+        uint64_t key;         // caller's id of the shadow view
+        float    importance;  // 0: no tile
+      };
+
+      struct Stats {
+        uint32_t tiles;
+        uint32_t tilesReused;     // same place as in the previous frame
+        uint32_t tilesAllocated;
+        uint32_t tilesDropped;    // requested, but did not fit even at minTileSize
+        uint32_t repacks;         // total since initialize()
+        uint64_t texelsUsed;
+      };
+
+      ShadowAtlas();
+
+      bool initialize(
+        uint32_t atlasSize         = 4096,
+        uint32_t minTileSize       = 64,
+        uint32_t maxTileSize       = 1024,
+        uint32_t shrinkDelayFrames = 8);
+      void deinitialize();
+
+      // Places the tiles for this frame's requests. Keys not requested lose their tile.
+      void update(SAE::Memory::FrameVector<Request> const&requests);
+
+      ShadowAtlasTile tile(uint64_t key) const;
+
+      // Tile size for an importance, before fitting into the atlas.
+      uint32_t tileSize(float importance) const;
+
+      inline uint32_t     size()  const { return m_atlasSize; }
+      inline Stats const& stats() const { return m_stats;     }
+
+    private:
+      struct Cell {
+        uint32_t x;
+        uint32_t y;
+      };
+
+      struct Entry {
+        uint64_t        key;
+        ShadowAtlasTile tile;
+        uint32_t        targetSize;
+        uint32_t        shrinkFrames;  // consecutive frames a smaller tile was requested
+        float           importance;
+        bool            requested;
+      };
+
+      uint32_t levelOf(uint32_t size) const;
+      void     clearCells();
+      bool     allocateCell(uint32_t size, Cell &outCell);
+      void     freeCell(Cell cell, uint32_t size);
+
+      uint32_t m_atlasSize;
+      uint32_t m_minTileSize;
+      uint32_t m_maxTileSize;
+      uint32_t m_shrinkDelayFrames;
+
+      std::vector<std::vector<Cell>> m_freeCells;  // per level, level 0 is the whole atlas
+      std::map<uint64_t, Entry>      m_entries;
+
+      Stats m_stats;
+    };
+
+  }
+}
+
+#endif
@@ -0,0 +1,180 @@
+#ifndef __SAE5300_GPR916_SOFTWARERASTERIZER_H__
+#define __SAE5300_GPR916_SOFTWARERASTERIZER_H__
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "Engine/WorkerPool.h"
+
+namespace SAE {
+  namespace Rendering {
+
+    /**********************************************************************************************//**
+     * \class SoftwareRasterizer
+     *
+     * \brief Tile-binned triangle rasterizer running on a pool of worker threads.
+     *
+     * Draws are recorded with submit() and executed by flush():
+     *   1. setup, in parallel over triangle ranges: trivial reject, clipping against w (or the
+     *      near plane), projection to the viewport, culling, edge/depth/attribute plane setup
+     *      and binning into screen tiles;
+     *   2. rasterization, in parallel over tiles: every tile walks its bins in submission order
+     *      and evaluates the edge functions for four pixels at a time (SSE2, scalar fallback).
+     *
+     * Each pixel is only ever touched by the thread owning its tile, with the same operations
+     * in the same order, so the output is bit-identical for any thread count and on either the
+     * SIMD or the scalar path.
+     *
+     * Conventions follow D3D11: clip space z in [0, w], pixel centres at +0.5, top-left fill
+     * rule, depth test LESS, winding evaluated in render target space (y down).
+     **************************************************************************************************/
+    class SoftwareRasterizer {
+    public:
+      static const uint32_t MaxAttributes = 12;
+
+      // Clip-space position plus attributes that are interpolated perspective-correct.
+      struct Vertex {
+        float position[4];
+        float attributes[MaxAttributes];
+      };
+
+      enum class CullMode {
+        None,
+        Front,
+        Back
+      };
+
+      struct RasterizerState {
+        CullMode cullMode;
+        bool     frontCounterClockwise;
+        bool     depthClip;               // false: only clip against w > 0 and clamp depth, like DepthClipEnable = false
+
+        RasterizerState()
+          : cullMode(CullMode::Back)
+          , frontCounterClockwise(false)
+          , depthClip(true)
+        {}
+      };
+
+      // Receives the interpolated attributes of a pixel that passed the depth test; returns RGBA8.
+      typedef uint32_t (*PixelShaderFn)(const void *context, const float *attributes);
+
+      // Depth (and optionally colour) buffers; rows are stride pixels apart, stride % 4 == 0.
+      struct Target {
+        uint32_t  width;
+        uint32_t  height;
+        uint32_t  stride;
+        float    *depth;
+        uint32_t *color;   // nullptr: depth only
+      };
+
+      struct Options {
+        unsigned int threadCount; // 0: hardware concurrency
+        uint32_t     tileSize;    // multiple of 4
+
+        Options()
+          : threadCount(0)
+          , tileSize(64)
+        {}
+      };
+
+      struct Stats {
+        uint64_t trianglesSubmitted;
+        uint64_t trianglesCulled;    // back/front faces, degenerate, off screen
+        uint64_t trianglesClipped;   // needed clipping (may have produced two triangles)
+        uint64_t trianglesBinned;    // setup triangles, after clipping
+        uint64_t binEntries;         // triangle/tile pairs
+        uint64_t pixelsWritten;
+        double   setupMs;
+        double   rasterMs;
+      };
+
+      SoftwareRasterizer();
+      ~SoftwareRasterizer();
+
+      bool initialize(Options const&options = Options());
+      bool deinitialize();
+
+      // Starts recording draws into target. Does not clear.
+      void begin(Target const&target);
+
+      // vertices/indices are copied; attributeCount <= MaxAttributes; shader may be null (depth only).
+      void submit(
+        const Vertex          *vertices,
+        size_t                 vertexCount,
+        const uint32_t        *indices,
+        size_t                 indexCount,
+        uint32_t               attributeCount,
+        RasterizerState const &state,
+        PixelShaderFn          shader        = nullptr,
+        const void            *shaderContext = nullptr);
+
+      // Executes everything recorded since begin().
+      void flush();
+
+      // Runs fn(begin, end) over [0, count) in chunks on the worker pool; blocks until done.
+      void parallelFor(size_t count, size_t grain, std::function<void(size_t, size_t)> const&fn);
+
+      static void Clear(Target const&target, float depth, uint32_t color);
+
+      inline unsigned int threadCount() const { return m_pool.threadCount(); }
+      inline Stats const& stats() const { return m_stats; }
+      inline void resetStats() { m_stats = Stats(); }
+
+    private:
+      struct Draw {
+        size_t          vertexBase;
+        size_t          indexBase;
+        size_t          triangleBase;
+        size_t          triangleCount;
+        uint32_t        attributeCount;
+        RasterizerState state;
+        PixelShaderFn   shader;
+        const void     *shaderContext;
+      };
+
+      // Screen-space triangle; every quantity is a plane f(x, y) = a * x + b * y + c.
+      struct SetupTriangle {
+        float    edge[3][3];
+        float    depth[3];
+        float    invW[3];
+        bool     topLeft[3];
+        int32_t  minX, minY, maxX, maxY;
+        uint32_t draw;
+        uint32_t attributeOffset;    // attributeCount planes (of a / w) in Bin::attributes
+      };
+
+      struct Bin {
+        std::vector<SetupTriangle>         triangles;
+        std::vector<float>                 attributes;
+        std::vector<std::vector<uint32_t>> tiles;
+        uint64_t                           culled;
+        uint64_t                           clipped;
+      };
+
+      void setupRange(size_t first, size_t last, Bin &bin);
+      void setupTriangle(Vertex const*v[3], Draw const&draw, uint32_t drawIndex, Bin &bin);
+      void rasterizeTile(uint32_t tile, uint64_t &pixelsWritten);
+      void rasterizeTriangle(SetupTriangle const&tri, const float *attributePlanes, int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint64_t &pixelsWritten);
+
+      Options                 m_options;
+      Target                  m_target;
+      uint32_t                m_tilesX;
+      uint32_t                m_tilesY;
+
+      std::vector<Vertex>     m_vertices;
+      std::vector<uint32_t>   m_indices;
+      std::vector<Draw>       m_draws;
+      size_t                  m_triangleCount;
+      std::vector<Bin>        m_bins;
+
+      Stats                   m_stats;
+
+      SAE::Threading::WorkerPool m_pool;
+    };
+
+  }
+}
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef __SAE5300_GPR916_SOFTWARERENDERER_H__
+#define __SAE5300_GPR916_SOFTWARERENDERER_H__
+
+#include <map>
+#include <vector>
+
+#include "Renderer/RendererDTO.h"
+#include "Renderer/SoftwareRasterizer.h"
+
+namespace SAE {
+  namespace Rendering {
+    using namespace SAE::DTO;
+
+    /**********************************************************************************************//**
+     * \class SoftwareRenderer
+     *
+     * \brief Headless renderer backend executing RenderScenes on the CPU.
+     *
+     * Consumes the same RenderScene / RenderObject data as Renderer: the constant buffer update
+     * functions are called into CPU-side buffers, and the object ids refer to buffers created
+     * through this class instead of the D3D11 resource manager. Shader, input layout and SRV ids
+     * are ignored; the passes are fixed-function:
+     *   - ShadowMap: depth only into the depth target scene.renderTargetId, with the light
+     *                view/projection selected like shadowmap_vertex_shader does;
+     *   - Main:      depth plus Lambert lighting from the light buffer (no shadows, no textures)
+     *                into the renderer's colour target.
+     * Rasterizer state mirrors Renderer (back face culling, counter-clockwise front faces, no
+     * depth clip). Output is bit-reproducible for any thread count.
+     **************************************************************************************************/
+    class SoftwareRenderer {
+    public:
+      // Byte offsets into a vertex; the default matches Mesh<XMVECTOR>::Vertex_t.
+      struct VertexLayout {
+        uint32_t stride;
+        uint32_t positionOffset;
+        uint32_t normalOffset;
+        uint32_t colorOffset;
+
+        VertexLayout()
+          : stride(5 * sizeof(XMVECTOR))
+          , positionOffset(0)
+          , normalOffset(1 * sizeof(XMVECTOR))
+          , colorOffset(4 * sizeof(XMVECTOR))
+        {}
+      };
+
+      struct Options {
+        uint32_t                    width;
+        uint32_t                    height;
+        SoftwareRasterizer::Options rasterizer;
+        VertexLayout                vertexLayout;
+
+        Options()
+          : width(1920)
+          , height(1080)
+        {}
+      };
+
+      struct DepthTarget {
+        uint32_t           width;
+        uint32_t           height;
+        uint32_t           stride;
+        std::vector<float> depth;
+      };
+
+      SoftwareRenderer();
+
+      bool initialize(Options const&options = Options());
+      bool deinitialize();
+
+      // Resource ids for RenderObject::vertexBufferId / indexBufferId and RenderScene::renderTargetId.
+      uint64_t createVertexBuffer(const void *data, size_t byteSize);
+      uint64_t createIndexBuffer(std::vector<uint32_t> const&indices);
+      uint64_t createDepthTarget(uint32_t width, uint32_t height);
+      void     release(uint64_t id);
+
+      void renderPass(
+        RenderScene const&scene,
+        PassType    const&passType);
+
+      // Main pass output: RGBA8 (R in the low byte), colorStride() pixels per row.
+      inline std::vector<uint32_t> const& colorBuffer() const { return m_color; }
+      inline std::vector<float>    const& depthBuffer() const { return m_depth; }
+      inline uint32_t                     colorStride() const { return m_stride; }
+      DepthTarget const* depthTarget(uint64_t id) const;
+
+      inline SoftwareRasterizer::Stats const& stats() const { return m_rasterizer.stats(); }
+      inline void resetStats() { m_rasterizer.resetStats(); }
+
+    private:
+      bool transformObject(
+        RenderObject                     const&object,
+        XMMATRIX                         const&world,
+        XMMATRIX                         const&viewProjection,
+        bool                                   lit,
+        std::vector<SoftwareRasterizer::Vertex> &outVertices);
+
+      Options            m_options;
+      SoftwareRasterizer m_rasterizer;
+
+      uint32_t              m_stride;
+      std::vector<uint32_t> m_color;
+      std::vector<float>    m_depth;
+
+      uint64_t                                 m_nextId;
+      std::map<uint64_t, std::vector<uint8_t>>  m_vertexBuffers;
+      std::map<uint64_t, std::vector<uint32_t>> m_indexBuffers;
+      std::map<uint64_t, DepthTarget>           m_depthTargets;
+
+      std::vector<std::vector<SoftwareRasterizer::Vertex>> m_transformed;
+    };
+
+  }
+}
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef __SAE5300_GPR916_STATICBATCHER_H__
+#define __SAE5300_GPR916_STATICBATCHER_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace SAE {
+  namespace Rendering {
+
+    /**********************************************************************************************//**
+     * \class StaticBatcher
+     *
+     * \brief Merges static mesh instances into one vertex and index list per material and cell.
+     *
+     * Every instance is transformed into world space when it is added: positions by its world
+     * matrix, normals by the matrix' inverse transpose and tangents by its rotation and scale;
+     * mirroring transforms get their triangle winding flipped. The instance then goes into the
+     * batch of its material and of the cubic cell of cellSize containing the centre of its world
+     * bounds, so an instance is never split across batches. Batches keep the world space bounds
+     * of their vertices, so that merged cells can be culled like any other object.
+     *
+     * Batches are kept in the order in which their first instance was added.
+     **************************************************************************************************/
+    class StaticBatcher {
+    public:
+      struct Options {
+        float    cellSize;             // edge length of the cubic cells in world units
+        uint32_t maxVerticesPerBatch;  // a full batch starts another one in the same cell
+
+        Options()
+          : cellSize(16.0f)
+          , maxVerticesPerBatch(1 << 20)
+        {}
+      };
+
+      // Layout of SAE::Engine::Vertex<XMVECTOR>.
+      struct Vertex {
+        float position[4];
+        float normal[4];
+        float tangent[4];
+        float uv[4];
+        float color[4];
+      };
+
+      struct Batch {
+        uint64_t              materialId;
+        int32_t               cell[3];
+        uint32_t              instanceCount;
+        float                 boundsMin[3];  // world space
+        float                 boundsMax[3];
+        std::vector<Vertex>   vertices;      // world space
+        std::vector<uint32_t> indices;
+      };
+
+      struct Stats {
+        uint32_t instances;
+        uint32_t batches;
+        uint64_t vertices;
+        uint64_t indices;
+        double   buildMs;   // spent in add()
+      };
+
+      StaticBatcher();
+
+      bool initialize(Options const&options = Options());
+      void deinitialize();
+
+      // world is a row vector matrix (v' = v * world), laid out as XMFLOAT4X4. The source data is
+      // copied; instances without triangles are ignored. Returns false, adding nothing, if an
+      // index is not below vertexCount.
+      bool add(
+        uint64_t        materialId,
+        Vertex   const *vertices,
+        size_t          vertexCount,
+        uint32_t const *indices,
+        size_t          indexCount,
+        float    const  world[16]);
+
+      inline std::vector<Batch> const& batches() const { return m_batches; }
+      inline Stats              const& stats()   const { return m_stats;   }
+
+    private:
+      struct Key {
+        uint64_t materialId;
+        int32_t  cell[3];
+
+        bool operator<(Key const&other) const;
+      };
+
+      Options               m_options;
+      std::map<Key, size_t> m_open;         // batch still taking instances, per material and cell
+      std::vector<Batch>    m_batches;
+      std::vector<Vertex>   m_transformed;
+      Stats                 m_stats;
+    };
+
+  }
+}
+
+#endif
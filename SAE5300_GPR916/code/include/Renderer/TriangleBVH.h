@@ -0,0 +1,159 @@
+#ifndef __SAE5300_GPR916_TRIANGLEBVH_H__
+#define __SAE5300_GPR916_TRIANGLEBVH_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace SAE {
+  namespace Rendering {
+
+    /**********************************************************************************************//**
+     * \class TriangleBVH
+     *
+     * \brief Bounding volume hierarchy over the triangles of a mesh, for CPU ray casts.
+     *
+     * build() copies the triangles out of a vertex and index list, so the mesh may drop its
+     * CPU geometry afterwards. Nodes are split with the surface area heuristic over binned
+     * centroids; a range becomes a leaf once it holds maxLeafTriangles or splitting it would
+     * cost more than intersecting all of its triangles.
+     *
+     * Nodes are 32 bytes: the box and either the first of the node's triangles and their
+     * count, or the index of the left child, the right one following it. The root is node 1,
+     * so that both children of a node share one 64 byte cache line, and a traversal tests
+     * both boxes at once and visits the nearer child first.
+     *
+     * intersect() traces one ray, intersect4() a packet of four with SSE2, one ray per lane;
+     * packets of similar rays (neighbouring pixels, probe directions) share most of their
+     * traversal. Rays are in the mesh's space: an instance transforms its rays with
+     * TransformRay() and the inverse of its world matrix, distances stay those of the
+     * untransformed ray. Queries are const and may run concurrently.
+     **************************************************************************************************/
+    class TriangleBVH {
+    public:
+      struct Options {
+        uint32_t maxLeafTriangles;
+        uint32_t binCount;          // SAH bins per axis
+
+        Options()
+          : maxLeafTriangles(4)
+          , binCount(16)
+        {}
+      };
+
+      // Points origin + t * direction with 0 <= t <= maxDistance.
+      struct Ray {
+        float origin[3];
+        float direction[3];
+        float maxDistance;
+      };
+
+      struct Hit {
+        float    distance;  // t along the ray
+        float    u;         // barycentrics of the hit point, towards the second and third vertex
+        float    v;
+        uint32_t triangle;  // index of the triangle in the index list given to build()
+      };
+
+      struct Stats {
+        uint32_t triangles;
+        uint32_t nodes;
+        uint32_t leaves;
+        uint32_t depth;
+        double   buildMs;
+      };
+
+      TriangleBVH();
+
+      // positions: x, y, z floats of vertex k at positions + k * stride bytes. Triangles with
+      // out of range indices are skipped.
+      bool build(
+        float    const*positions,
+        size_t         stride,
+        size_t         vertexCount,
+        uint32_t const*indices,
+        size_t         indexCount,
+        Options  const&options = Options());
+      void clear();
+
+      // The closest hit within ray.maxDistance.
+      bool intersect(Ray const&ray, Hit &outHit) const;
+      // Whether anything is hit within ray.maxDistance; stops at the first hit.
+      bool occluded(Ray const&ray) const;
+      // Closest hits of four rays; bit k of the result is set if rays[k] hit.
+      uint32_t intersect4(Ray const rays[4], Hit outHits[4]) const;
+
+      inline bool         empty()   const { return m_triangles.empty(); }
+      inline Stats const& stats()   const { return m_stats; }
+      inline float const* boundsMin() const { return m_nodes ? m_nodes[1].minimum : nullptr; }
+      inline float const* boundsMax() const { return m_nodes ? m_nodes[1].maximum : nullptr; }
+
+      // Ray through a matrix in DirectXMath layout (16 floats, row vectors, p' = p * M). The
+      // direction is not normalised, so distances along the result are those along the input.
+      static Ray TransformRay(Ray const&ray, float const *matrix);
+
+    private:
+      static const uint32_t MaxSAHDepth = 48;   // deeper nodes split at the median
+      static const uint32_t StackSize   = 128;  // traversal stack, enough for any tree built
+
+      struct Node {
+        float    minimum[3];
+        uint32_t first;     // leaf: first triangle; inner node: left child
+        float    maximum[3];
+        uint32_t count;     // triangles of a leaf, 0 for an inner node
+      };
+
+      // Vertex and edges for the Moeller-Trumbore test.
+      struct Triangle {
+        float v0[3];
+        float e1[3];
+        float e2[3];
+      };
+
+      void     buildNode(std::vector<Node> &nodes, uint32_t node, uint32_t begin, uint32_t end, uint32_t depth);
+      uint32_t splitRange(uint32_t begin, uint32_t end, float const parentArea, bool median, bool &outLeaf);
+      bool     traverse(Ray const&ray, bool anyHit, Hit &outHit) const;
+
+      Options m_options;
+
+      std::unique_ptr<uint8_t[]> m_nodeStorage;
+      Node                      *m_nodes;       // m_nodeStorage aligned to 64 bytes
+      uint32_t                   m_nodeCount;
+
+      std::vector<Triangle> m_triangles;        // in leaf order
+      std::vector<uint32_t> m_triangleIndices;  // per leaf triangle: the index given to build()
+
+      // Build scratch: per input triangle its bounds and centroid.
+      std::vector<float> m_buildBounds;     // minimum and maximum, six floats per triangle
+      std::vector<float> m_buildCentroids;  // three floats per triangle
+
+      Stats m_stats;
+    };
+
+    struct TriangleBVHBenchmarkResult {
+      uint32_t triangles;
+      uint32_t nodes;
+      double   buildMs;
+      uint32_t rays;
+      double   hitRatio;
+      double   raysPerSecond;        // intersect()
+      double   packetRaysPerSecond;  // intersect4()
+      double   speedup;              // over testing every triangle, measured on a sample
+      bool     valid;                // all three found the same closest hits
+    };
+
+    // Casts rayCount rays, from points around the mesh's bounds towards random points within
+    // them, once by single rays, once in packets of four neighbouring rays.
+    TriangleBVHBenchmarkResult BenchmarkTriangleBVH(
+      float    const*positions,
+      size_t         stride,
+      size_t         vertexCount,
+      uint32_t const*indices,
+      size_t         indexCount,
+      uint32_t       rayCount = 1 << 20);
+
+  }
+}
+
+#endif
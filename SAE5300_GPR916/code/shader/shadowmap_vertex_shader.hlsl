@@ -9,30 +9,6 @@ cbuffer Camera : register(b0)
     float4   cameraDirection;
 }
 
-struct LightInfo { 
-    float4x4 view[6];
-    float4x4 projection;
-    float4 position;
-    float4 direction;
-    float4 color;
-    uint   type;
-    uint   lightViewIndex;
-    uint   unused1;
-    uint   unused2;
-    float  intensity;
-    float  distance;
-    float  hotSpotAngle;
-    float  falloffAngle;
-};
-
-cbuffer Lighting : register(b1) 
-{
-    LightInfo lights[4];
-    int       lightIndex;    
-    int       unused0;
-    int       unused1;
-    int       unused2;
-}
 // Holds the current object's world transform
 // and inverse transpose used for normal mapping
 // normal corrections, due to non-uniform scaling.
@@ -59,13 +35,13 @@ struct VertexOutput
 
 VertexOutput main(VertexInput input) {
     float4 position  = float4(input.position.xyz, 1.0f);
-    
-    LightInfo light = lights[lightIndex];
 
-    float4x4 lightViewProjection      = mul(light.projection, light.view[light.lightViewIndex]);
-    float4x4 lightWorldViewProjection = mul(lightViewProjection, world);
+    // Shadow passes bind the light's combined view-projection of the
+    // rendered face as view and identity as projection.
+    float4x4 viewProjection      = mul(projection, view);
+    float4x4 worldViewProjection = mul(viewProjection, world);
         
     VertexOutput output;
-    output.position    = mul(lightWorldViewProjection, position);
+    output.position    = mul(worldViewProjection, position);
     return output;    
 }
\ No newline at end of file
@@ -10,35 +10,60 @@ cbuffer Camera : register(b0)
 }
 
 struct LightInfo { 
-    float4x4 view[6];
-    float4x4 projection;
-    float4 position;
-    float4 direction;
-    float4 color;
-    uint   type;
-    uint   lightViewIndex;
-    uint   unused1;
-    uint   unused2;
-    float  intensity;
-    float  distance;
-    float  hotSpotAngle;
-    float  falloffAngle;
+    float4x4 viewProjection[6]; // per view, combined on the CPU whenever the light moves
+    float4   shadowTiles[6];    // per view: atlas uv offset (xy), scale (z), half a texel (w); z 0: unshadowed
+    float4   position;
+    float4   direction;
+    float4   color;
+    uint     type;
+    uint     shadowViewCount;
+    float    intensity;
+    float    distance;
 };
 
 cbuffer Lighting : register(b1) 
 {
     LightInfo lights[4];
-    int       lightIndex;    
-    int       unused0;
-    int       unused1;
-    int       unused2;
+}
+
+// Diffuse environment lighting as cosine-convolved L2 spherical harmonics,
+// precomputed on load (Engine/EnvironmentMap.h). Immutable, uploaded once.
+cbuffer Ambient : register(b3)
+{
+    float4 irradiance[9];
+    float4 environmentInfo; // x: mip count of the prefiltered environment map, 0 if none
+}
+
+// Clustered lights, built on the CPU every frame (Renderer/LightClusters.h).
+struct ClusterLight {
+    float3 position;
+    float  range;
+    float3 color;
+    float  intensity;
+    float3 direction;
+    int    shadowIndex; // slot in lights[] holding the shadow views; -1: unshadowed
+    uint   type;        // 0: directional, 1: point, 2: spot
+    float  cosHotSpot;
+    float  cosFalloff;
+    uint   unused0;
+};
+
+cbuffer Clusters : register(b4)
+{
+    uint  clusterGridX;
+    uint  clusterGridY;
+    uint  clusterGridZ;
+    uint  clusterLightCount;
+    float clusterTileScaleX; // clusters per pixel
+    float clusterTileScaleY;
+    float clusterDepthScale; // slice = log(view depth) * scale + bias
+    float clusterDepthBias;
 }
 
 struct FragmentInput
 {    
     float4 position          : SV_Position;
     float4 position_ws       : POSITION0;
-    float4 position_ls[4][6] : POSITION1;
     float3 tangent           : TANGENT0;
     float3 normal            : NORMAL0;
     float3 binormal          : NORMAL1;
@@ -52,7 +77,11 @@ Texture2D   diffuseTexture  : register(t0);
 Texture2D   specularTexture : register(t1);
 Texture2D   glossTexture    : register(t2);
 Texture2D   normalTexture   : register(t3);
-TextureCubeArray shadowMaps      : register(t4);
+Texture2D   shadowAtlas     : register(t4);
+TextureCube environmentMap  : register(t5);
+StructuredBuffer<ClusterLight> clusterLights       : register(t6);
+StructuredBuffer<uint2>        clusterCells        : register(t7); // offset, count in clusterLightIndices
+StructuredBuffer<uint>         clusterLightIndices : register(t8);
 SamplerState           samplerState : register(s0);
 SamplerComparisonState shadowMapSamplerState : register(s1);
 
@@ -86,6 +115,19 @@ float3 sampleCube(
 	return float3((uv * ma + 0.5).xy, faceIndex);
 }
 
+float3 evaluateIrradiance(float3 n)
+{
+    return irradiance[0].rgb
+         + irradiance[1].rgb * n.y
+         + irradiance[2].rgb * n.z
+         + irradiance[3].rgb * n.x
+         + irradiance[4].rgb * (n.x * n.y)
+         + irradiance[5].rgb * (n.y * n.z)
+         + irradiance[6].rgb * (3.0f * n.z * n.z - 1.0f)
+         + irradiance[7].rgb * (n.x * n.z)
+         + irradiance[8].rgb * (n.x * n.x - n.y * n.y);
+}
+
 struct phongLightingResult {
     float f_lambert;
     float beta;
@@ -140,18 +182,54 @@ struct shadowResult {
 
 shadowResult applyShadows(
         phongLightingResult phong, 
-        float4 P_ls[6],
+        float4 P_ws,
+        float4x4 viewProjection[6],
+        float4 shadowTiles[6],
+        uint   lightType,
+        uint   shadowViewCount,
         float3 L,
         float  d_L,
-        float  I_L,
-        float  d_Shadow) 
+        float  I_L) 
 { 
+    shadowResult result;
+    result.shadowFactor = 1.0f;
+
     // Remove shadow acne, also on sloped surfaces!
     float bias = 0.005 * tan(acos(phong.f_lambert)); 
     bias = clamp(bias, 0.0f, 0.01);
         
-    float3 cubeSampleCoordinates = sampleCube(-L); // Determine face and uv inside it to properly sample surface light space position.  
-    float  surface_d             = (P_ls[cubeSampleCoordinates.z].z / P_ls[cubeSampleCoordinates.z].w);
+    uint face = 0; // Spot lights have a single view.
+    if(lightType == 1) {
+        float3 cubeSampleCoordinates = sampleCube(-L); // Determine face and uv inside it to properly sample surface light space position.  
+        face = (uint)cubeSampleCoordinates.z;
+    }
+    else if(lightType == 0) {
+        // The first, i.e. finest, cascade containing the surface.
+        face = shadowViewCount;
+        for(uint c=0; c<shadowViewCount; ++c) {
+            float4 P_c       = mul(viewProjection[c], P_ws);
+            float3 P_cascade = P_c.xyz / P_c.w;
+            if(all(abs(P_cascade.xy) < 1.0f) && P_cascade.z < 1.0f) {
+                face = c;
+                break;
+            }
+        }
+        if(face >= shadowViewCount)
+            return result;
+    }
+
+    // The face's tile in the shadow atlas; lights that did not get one are unshadowed.
+    float4 tile = shadowTiles[face];
+    if(tile.z == 0.0f)
+        return result;
+
+    // Into light space for the selected view only.
+    float4 P       = mul(viewProjection[face], P_ws);
+    float2 uv      = (float2(0.5f, -0.5f) * (P.xy / P.w)) + 0.5f;
+    float2 atlasUV = clamp(tile.xy + (uv * tile.z), tile.xy + tile.w, tile.xy + tile.z - tile.w); // Never filter across into a neighbour tile.
+    float  d_Shadow = shadowAtlas.SampleLevel(samplerState, atlasUV, 0).r;
+
+    float  surface_d = (P.z / P.w);
    
     surface_d *= d_L;
     surface_d -= bias;
@@ -163,7 +241,6 @@ shadowResult applyShadows(
     if(surface_d > light_d)
       shadowFactor = 0.0f;    
     
-    shadowResult result;
     result.shadowFactor = shadowFactor;
     return result;
 }
@@ -199,25 +276,23 @@ float4 main(FragmentInput input) : SV_Target {
     
     float  s_specular = t_specularColor.r;
 
-    phongLightingResult lighting[4];
-    shadowResult        shadow[4];
+    // The fragment's cluster: screen tile and exponential depth slice.
+    float viewDepth = mul(view, float4(input.position_ws.xyz, 1.0f)).z;
+    uint3 cluster;
+    cluster.x = min((uint)(input.position.x * clusterTileScaleX), clusterGridX - 1);
+    cluster.y = min((uint)(input.position.y * clusterTileScaleY), clusterGridY - 1);
+    cluster.z = (uint)clamp(floor((log(max(viewDepth, 1e-4f)) * clusterDepthScale) + clusterDepthBias), 0.0f, clusterGridZ - 1.0f);
+    uint2 cell = clusterCells[(((cluster.z * clusterGridY) + cluster.y) * clusterGridX) + cluster.x];
 
-    uint affectingLightCount = 0;
+    float4 f_light = 0.0f;
+    for(uint i=0; i<cell.y; ++i) {
+        ClusterLight light = clusterLights[clusterLightIndices[cell.x + i]];
+
+        float4 lightPosition  = float4(light.position, 1.0f);
+        float4 lightDirection = float4(light.direction, 0.0f);
 
-    for(uint k=0; k<4; ++k) {        
-        LightInfo light = lights[k];
-    
-        int    lightType      = light.type;
-        int    lightIntensity = light.intensity;
-        int    lightDistance  = light.distance;
-        float4 lightPosition  = float4(light.position.xyz, 1.0f);
-        float4 lightDirection = float4(light.direction.xyz, 0.0f);
-
-        if(lightIntensity == 0)
-            continue;
-            
         float4 L = float4(0.0f, -1.0f, 0.0f, 0.0f);
-        switch(lightType) {
+        switch(light.type) {
             case 0: // Directional
             L = -lightDirection;
             break;
@@ -229,39 +304,64 @@ float4 main(FragmentInput input) : SV_Target {
             break;
         }    
         float3 L_normalized = normalize(L.xyz);       
+        float  d_L          = length(L);
+
+        // Spot cone: full intensity inside the hot spot, fading out towards the falloff angle.
+        float cone = 1.0f;
+        if(light.type == 2)
+            cone = smoothstep(light.cosFalloff, light.cosHotSpot, dot(-L_normalized, normalize(lightDirection.xyz)));
+
+        // Positional lights end at their range, the extent they were clustered with.
+        float window = 1.0f;
+        if(light.type != 0) {
+            window = saturate(1.0f - pow(d_L / light.range, 4.0f));
+            window *= window;
+        }
         
         float3 R = -reflect(L_normalized, N_normalized);
         float3 R_normalized = normalize(R);
 
-        float4 t_shadow = shadowMaps.Sample(samplerState, float4(-L_normalized, k));
-
-        lighting[affectingLightCount]
+        phongLightingResult lighting
             = phongLighting(
                 N_normalized, 
                 L_normalized,
-                length(L),
-                lightIntensity,
+                d_L,
+                light.intensity,
                 R_normalized, 
                 V_normalized,
                 t_diffuseColor,
-                light.color,
+                float4(light.color, 1.0f),
                 glossiness_factor,
                 s_specular);
-        shadow[affectingLightCount]
-            = applyShadows(
-                lighting[affectingLightCount],
-                input.position_ls[k],
-                L_normalized,
-                lightDistance,
-                lightIntensity,
-                t_shadow.r);
 
-        ++affectingLightCount;
+        float shadowFactor = 1.0f;
+        if(light.shadowIndex >= 0) {
+            LightInfo shadowLight = lights[light.shadowIndex];
+            shadowFactor
+                = applyShadows(
+                    lighting,
+                    float4(input.position_ws.xyz, 1.0f),
+                    shadowLight.viewProjection,
+                    shadowLight.shadowTiles,
+                    light.type,
+                    shadowLight.shadowViewCount,
+                    L_normalized,
+                    light.range,
+                    light.intensity).shadowFactor;
+        }
+
+        f_light += lighting.color * (cone * window * shadowFactor);
     }
-    
-    float4  f_light  = 0.0f;
-    for(k=0; k<affectingLightCount; ++k) {
-        f_light  += lighting[k].color * shadow[k].shadowFactor;
+
+    // Environment: SH irradiance for the diffuse part, the prefiltered map for specular.
+    // Mip m of the map holds roughness m / (mipCount - 1); map the phong exponent onto it.
+    float environmentMipCount = environmentInfo.x;
+    if(environmentMipCount > 0.0f) {
+        float3 ambient   = t_diffuseColor.rgb * max(0.0f, evaluateIrradiance(N_normalized));
+        float  roughness = sqrt(2.0f / (glossiness_factor + 2.0f));
+        float3 R_env     = reflect(-V_normalized, N_normalized);
+        float3 reflected = environmentMap.SampleLevel(samplerState, R_env, roughness * (environmentMipCount - 1.0f)).rgb;
+        f_light.rgb += ambient + (s_specular * reflected);
     }
    
     return saturate( f_light );
@@ -9,31 +9,6 @@ cbuffer Camera : register(b0)
     float4   cameraDirection;
 }
 
-struct LightInfo { 
-    float4x4 view[6];
-    float4x4 projection;
-    float4 position;
-    float4 direction;
-    float4 color;
-    uint   type;
-    uint   lightViewIndex;
-    uint   unused1;
-    uint   unused2;
-    float  intensity;
-    float  distance;
-    float  hotSpotAngle;
-    float  falloffAngle;
-};
-
-cbuffer Lighting : register(b1) 
-{
-    LightInfo lights[4];
-    int       lightIndex;    
-    int       unused0;
-    int       unused1;
-    int       unused2;
-}
-
 // Holds the current object's world transform
 // and inverse transpose used for normal mapping
 // normal corrections, due to non-uniform scaling.
@@ -57,7 +32,6 @@ struct VertexOutput
 {
     float4 position          : SV_Position;
     float4 position_ws       : POSITION0;
-    float4 position_ls[4][6] : POSITION1;
     float3 tangent           : TANGENT0;
     float3 normal            : NORMAL0;
     float3 binormal          : NORMAL1;
@@ -86,13 +60,6 @@ VertexOutput main(VertexInput input) {
     output.color       = input.color;
     output.position    = mul(worldViewProjection, position);
     output.position_ws = mul(world, position);
-    
-    for(uint i=0;i<4;++i) {
-        LightInfo light = lights[i];
-        
-        for(uint k=0;k<6;++k)
-            output.position_ls[i][k] = mul(mul(mul(light.projection, light.view[k]), world), position);
-    }
 
     output.tangent  = normalize(mul(normalMatrix, tangent.xyz));
     output.normal   = normalize(mul(normalMatrix, normal.xyz));
@@ -0,0 +1,41 @@
+// Virtual texture sampling, see Engine/VirtualTexture.h and DirectX11VirtualTexture.
+//
+// pageTable: RGBA8_UINT, one texel per virtual page and mip:
+//            x, y = physical slot, z = mip actually resident, w = valid.
+// Entries of missing pages already point at the nearest resident coarser page,
+// so a single lookup always resolves.
+
+struct VirtualTextureInfo {
+    float4 physical;    // 1 / physical width, 1 / physical height, tile size, border
+    float4 virtualSize; // width, height, page size, mip levels
+};
+
+float4 sampleVirtualTexture(
+    Texture2D<uint4>   pageTable,
+    Texture2D          physicalTexture,
+    SamplerState       physicalSampler,
+    VirtualTextureInfo info,
+    float2             uv)
+{
+    float  pageSize  = info.virtualSize.z;
+    uint   mipLevels = (uint)info.virtualSize.w;
+
+    // Hardware-style mip selection in level 0 texels.
+    float2 texel = uv * info.virtualSize.xy;
+    float2 dx    = ddx(texel);
+    float2 dy    = ddy(texel);
+    float  lod   = 0.5f * log2(max(dot(dx, dx), dot(dy, dy)));
+    uint   mip   = min((uint)max(lod, 0.0f), mipLevels - 1);
+
+    float2 mipSize = max(floor(info.virtualSize.xy / (float)(1u << mip)), 1.0f);
+    uint4  entry   = pageTable.Load(int3(floor(uv * mipSize / pageSize), mip));
+    if(entry.w == 0)
+        return float4(0.0f, 0.0f, 0.0f, 0.0f);
+
+    // Position inside the page that is resident, which may be an ancestor of the one asked for.
+    float2 residentSize = max(floor(info.virtualSize.xy / (float)(1u << entry.z)), 1.0f);
+    float2 inPage       = frac(uv * residentSize / pageSize);
+
+    float2 physicalTexel = entry.xy * info.physical.z + info.physical.w + inPage * pageSize;
+    return physicalTexture.SampleLevel(physicalSampler, physicalTexel * info.physical.xy, 0);
+}
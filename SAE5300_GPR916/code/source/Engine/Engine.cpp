@@ -1,16 +1,125 @@
-#include <map>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
 #include <functional>
+#include <limits>
+#include <sstream>
 
 #include "Logging/Logging.h"
 
 #include "Engine/Engine.h"
+#include "Engine/EnvironmentMap.h"
 
 #include "Platform/DirectX11/DirectX11Texture.h"
 
+#ifdef SAE_BENCHMARK_PIXEL_CONVERSION
+  #include "Engine/PixelConversion.h"
+#endif
+
+#ifdef SAE_BENCHMARK_COMMAND_RECORDING
+  #include "Renderer/NullCommandBackend.h"
+#endif
+
 namespace SAE {
   namespace Engine {
     using namespace SAE::Log;
 
+    // LightInfo_t::type and ClusterLight_t::type of a light.
+    static uint32_t ShaderLightType(Light::Type const&type)
+    {
+      switch(type) {
+      case Light::Type::Directional:
+        return 0;
+      case Light::Type::Spot:
+        return 2;
+      default:
+        return 1;
+      }
+    }
+
+    // Composes the local matrices of the transforms in [begin, end) changed since they were
+    // last composed, through SAE::Math::ComposeTransforms() in batches on the stack.
+    static void ComposeDirtyTransforms(
+      SAE::ECS::ComponentPool<DX11Transform> &transforms,
+      size_t                                  begin,
+      size_t                                  end)
+    {
+      size_t const BatchSize = 32;
+
+      size_t k = begin;
+      while(k < end) {
+        uint32_t dirty[BatchSize];
+        size_t   count = 0;
+        for(; k < end && count < BatchSize; ++k)
+          if(transforms[k].localDirty())
+            dirty[count++] = static_cast<uint32_t>(k);
+
+        if(!count)
+          continue;
+
+        float components[10][BatchSize];
+        for(size_t n=0; n < count; ++n) {
+          DX11Transform const&transform = transforms[dirty[n]];
+
+          XMFLOAT3 translation, scale;
+          XMFLOAT4 rotation;
+          XMStoreFloat3(&translation, transform.getTranslation());
+          XMStoreFloat4(&rotation,    transform.getRotationQuaternion());
+          XMStoreFloat3(&scale,       transform.getScale());
+
+          components[0][n] = translation.x; components[1][n] = translation.y; components[2][n] = translation.z;
+          components[3][n] = rotation.x;    components[4][n] = rotation.y;    components[5][n] = rotation.z; components[6][n] = rotation.w;
+          components[7][n] = scale.x;       components[8][n] = scale.y;       components[9][n] = scale.z;
+        }
+
+        SAE::Math::TransformsSoA const batch ={
+          components[0], components[1], components[2],
+          components[3], components[4], components[5], components[6],
+          components[7], components[8], components[9] };
+
+        XMFLOAT4X4 locals[BatchSize], normals[BatchSize];
+        SAE::Math::ComposeTransforms(batch, reinterpret_cast<float*>(locals), reinterpret_cast<float*>(normals), count);
+
+        for(size_t n=0; n < count; ++n)
+          transforms[dirty[n]].setLocalMatrices(XMLoadFloat4x4(&locals[n]), XMLoadFloat4x4(&normals[n]));
+      }
+    }
+
+    // Dynamic structured buffer of elementCount elements, rewritten every frame, and its SRV.
+    static void CreateDynamicStructuredBuffer(
+      std::shared_ptr<DirectX11ResourceManager> &resourceManager,
+      uint32_t                                   elementSize,
+      uint32_t                                   elementCount,
+      uint64_t                                  &outBufferId,
+      uint64_t                                  &outSRVId)
+    {
+      D3D11_BUFFER_DESC
+        bufferDesc ={};
+      bufferDesc.ByteWidth           = elementSize * elementCount;
+      bufferDesc.BindFlags           = D3D11_BIND_SHADER_RESOURCE;
+      bufferDesc.Usage               = D3D11_USAGE_DYNAMIC;
+      bufferDesc.MiscFlags           = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+      bufferDesc.CPUAccessFlags      = D3D11_CPU_ACCESS_WRITE;
+      bufferDesc.StructureByteStride = elementSize;
+
+      D3D11_SUBRESOURCE_DATA
+        initialData={};
+
+      outBufferId
+        = resourceManager->create<ID3D11Buffer>(bufferDesc, initialData);
+
+      D3D11_SHADER_RESOURCE_VIEW_DESC
+        srvDesc ={};
+      srvDesc.Format              = DXGI_FORMAT_UNKNOWN;
+      srvDesc.ViewDimension       = D3D11_SRV_DIMENSION_BUFFER;
+      srvDesc.Buffer.FirstElement = 0;
+      srvDesc.Buffer.NumElements  = elementCount;
+
+      outSRVId
+        = resourceManager->create<ID3D11ShaderResourceView>(srvDesc, reinterpret_cast<ID3D11Buffer*>(outBufferId));
+    }
+
     bool Engine
       ::initialize(std::shared_ptr<DirectX11ResourceManager> &resourceManager)
     {
@@ -53,45 +162,35 @@ namespace SAE {
       m_lightBuffer
         = resourceManager->create<ID3D11Buffer>(lightBufferDesc, lightInitialData);
 
-      Light::Properties props={};
-      props.intensity = 4.0f;
-      props.type      = Light::Type::Point;
-      props.color     ={ 1.0f, 1.0f, 1.0f, 1.0f };
-      props.specificProperties.point.distance = 10.0f;
-      Light light(props);
-      light.transform().setTranslation(0.0f, 1.0f, 20.0f);
-      light.transform().setScale(0.01f, 0.01f, 0.01f);
-      m_lights[1] = light;
-
-      props={};
-      props.intensity = 10.0f;
-      props.type      = Light::Type::Point;
-      props.color     ={ 0.0f, 1.0f, 0.0f, 1.0f };
-      props.specificProperties.point.distance = 10.0f;
-      light = Light(props);
-      light.transform().setTranslation(-1.0f, 3.0f, 17.0f);
-      light.transform().setScale(0.01f, 0.01f, 0.01f);
-      m_lights[2] = light;
-
-      props={};
-      props.intensity = 10.0f;
-      props.type      = Light::Type::Point;
-      props.color     ={ 1.0f, 0.0f, 0.0f, 1.0f };
-      props.specificProperties.point.distance = 10.0f;
-      light = Light(props);
-      light.transform().setTranslation(1.0f, 3.0f, 17.0f);
-      light.transform().setScale(0.01f, 0.01f, 0.01f);
-      m_lights[3] = light;
-
-      props={};
-      props.intensity = 10.0f;
-      props.type      = Light::Type::Point;
-      props.color     ={ 0.0f, 0.0f, 1.0f, 1.0f };
-      props.specificProperties.point.distance = 10.0f;
-      light = Light(props);
-      light.transform().setTranslation(0.0f, 3.0f, 23.0f);
-      light.transform().setScale(0.01f, 0.01f, 0.01f);
-      m_lights[4] = light;
+      // Lights are created first and never removed, so the Light pool holds them in this order:
+      // light id k + 1 is the k-th, see FramePacket::lights.
+      m_registry.clear();
+      m_meshAssets.clear();
+
+      struct {
+        float    intensity;
+        XMVECTOR color;
+        float    translation[3];
+      } lightSetups[] ={
+        {  4.0f, { 1.0f, 1.0f, 1.0f, 1.0f }, {  0.0f, 1.0f, 20.0f } },
+        { 10.0f, { 0.0f, 1.0f, 0.0f, 1.0f }, { -1.0f, 3.0f, 17.0f } },
+        { 10.0f, { 1.0f, 0.0f, 0.0f, 1.0f }, {  1.0f, 3.0f, 17.0f } },
+        { 10.0f, { 0.0f, 0.0f, 1.0f, 1.0f }, {  0.0f, 3.0f, 23.0f } },
+      };
+
+      for(auto const&setup : lightSetups) {
+        Light::Properties props={};
+        props.intensity = setup.intensity;
+        props.type      = Light::Type::Point;
+        props.color     = setup.color;
+        props.specificProperties.point.distance = 10.0f;
+        Light light(props);
+        light.transform().setTranslation(setup.translation[0], setup.translation[1], setup.translation[2]);
+        light.transform().setScale(0.01f, 0.01f, 0.01f);
+
+        m_registry.add<Light>(m_registry.create(), light);
+      }
+      m_controlledLight = m_registry.pool<Light>().entities()[0];
 
       D3D11_BUFFER_DESC
         objectBufferDesc ={};
@@ -123,153 +222,302 @@ namespace SAE {
       m_otherBuffer
         = resourceManager->create<ID3D11Buffer>(otherBufferDesc, otherInitialData);
 
-      std::shared_ptr<SAE::DirectX11::DirectX11Mesh>
-        lightSphereMesh = nullptr;
-      lightSphereMesh = SAE::DirectX11::DirectX11Mesh::loadFromFile(resourceManager, "resources/meshes/regular_sphere.obj");
-      uint64_t lightSphereId[4];
+      D3D11_BUFFER_DESC
+        clusterBufferDesc ={};
+      clusterBufferDesc.ByteWidth           = sizeof(ClusterBuffer_t);
+      clusterBufferDesc.BindFlags           = D3D11_BIND_CONSTANT_BUFFER;
+      clusterBufferDesc.Usage               = D3D11_USAGE_DYNAMIC;
+      clusterBufferDesc.MiscFlags           = 0;
+      clusterBufferDesc.CPUAccessFlags      = D3D11_CPU_ACCESS_WRITE;
+      clusterBufferDesc.StructureByteStride = 0;
+
+      D3D11_SUBRESOURCE_DATA
+        clusterInitialData={};
+
+      m_clusterBuffer
+        = resourceManager->create<ID3D11Buffer>(clusterBufferDesc, clusterInitialData);
+
+      uint32_t const sphereMesh
+        = addMesh(SAE::DirectX11::DirectX11Mesh::loadFromFile(resourceManager, "resources/meshes/regular_sphere.obj", true));
+
+      // cubeMesh = SAE::DirectX11::DirectX11Mesh::loadFromFile(resourceManager, "resources/meshes/Sci-Fi-Floor-1-OBJ.obj");
+      uint32_t const planeMesh
+        = addMesh(SAE::DirectX11::DirectX11Mesh::loadFromFile(resourceManager, "resources/meshes/fourQuadPlane.obj", true));
+
+      float planeScale = 10.0f;
+      DX11Transform planeTransform;
+      planeTransform.setTranslationZ(20);
+      planeTransform.setScale(planeScale, 1.0f, planeScale);
+
       // LOAD MESHES HERE!!!
+      // The first light sphere marks the controlled light, see update(); the others ride the
+      // rotating floor.
+      m_floor = createObject(planeMesh, planeTransform);
       for(uint32_t k=0; k < 4; ++k) {
-        lightSphereId[k] = 1 + k;
+        DX11Transform lightSphereTransform;
+        lightSphereTransform.setTranslation(-0.1f + (k * 0.1f), 1.0f, -0.1f + (k * 0.1));
+        lightSphereTransform.setScale(0.001f, 0.01f, 0.001f);
+
+        SAE::ECS::Entity const lightSphere = createObject(sphereMesh, lightSphereTransform, (k ? m_floor : SAE::ECS::NullEntity));
+        if(!k)
+          m_lightMarker = lightSphere;
+      }
+
+      Light &controlledLight = *m_registry.find<Light>(m_controlledLight);
+      controlledLight.transform().setTranslation(planeTransform.getTranslation()); // Place light in the middle of the plane and shift up
+      controlledLight.transform().translateVerticalBy(1); // Place light in the middle of the plane and shift up
+
+      // Small coloured lights circling above the plane, on a 16 x 16 grid.
+      m_dynamicLights.clear();
+      for(uint32_t k=0; k < 256; ++k) {
+        float const hue = (k * 0.618034f) - std::floor(k * 0.618034f);
+
+        DynamicLight dynamicLight ={};
+        dynamicLight.center      = XMFLOAT3(-9.0f + 1.2f * (k % 16), 0.3f + 0.1f * (k % 5), 11.0f + 1.2f * (k / 16));
+        dynamicLight.position    = dynamicLight.center;
+        dynamicLight.color       = XMFLOAT3(
+          0.5f + 0.5f * std::cos(2.0f * float(M_PI) * hue),
+          0.5f + 0.5f * std::cos(2.0f * float(M_PI) * (hue - (1.0f / 3.0f))),
+          0.5f + 0.5f * std::cos(2.0f * float(M_PI) * (hue - (2.0f / 3.0f))));
+        dynamicLight.orbitRadius = 0.3f + 0.15f * (k % 4);
+        dynamicLight.orbitSpeed  = 0.5f + 0.2f  * (k % 7);
+        dynamicLight.phase       = 2.39996f * k; // golden angle
+        dynamicLight.range       = 2.5f;
+        dynamicLight.intensity   = 1.5f;
+        m_dynamicLights.push_back(dynamicLight);
+      }
 
-        DX11TransformPtr lightSphereTransform = DX11TransformPtr(new DX11Transform());
-        lightSphereTransform->setTranslation(-0.1f + (k * 0.1f), 1.0f, -0.1f + (k * 0.1));
-        lightSphereTransform->setScale(0.001f, 0.01f, 0.001f);
+      DX11Transform shadowSphereTransform;
+      shadowSphereTransform.setTranslation(0.0f, 1.0f, 20.0f);
+      shadowSphereTransform.setScale(0.01f, 0.01f, 0.01f);
+
+      createObject(sphereMesh, shadowSphereTransform);
+
+      // STATIC BATCHES HERE!!!
+      // The scene itself has no static props; a scattered set of them exercises the batcher.
+#ifdef SAE_BENCHMARK_STATIC_BATCHES
+      buildStaticBatches(resourceManager);
+#endif
+
+      // OCCLUDERS HERE!!!
+      // The floor is simple enough to serve as its own occluder mesh.
+      m_workerPool.initialize();
+      m_occlusionCulling.initialize(SAE::Rendering::MaskedOcclusionCulling::Options(), &m_workerPool);
+
+      // LIGHT CLUSTERS HERE!!!
+      // Rebuilt on the CPU every frame, see buildLightClusters(); the buffers are sized for the worst case.
+      m_lightClusters.initialize(SAE::Rendering::LightClusters::Options(), &m_workerPool);
+      m_clusterConstants ={};
+
+      static_assert(sizeof(SAE::Rendering::LightClusters::Cell) == 2 * sizeof(uint32_t), "Cells are uint2 in the shader.");
+      CreateDynamicStructuredBuffer(resourceManager, sizeof(ClusterLight_t), MaxClusterLights, m_clusterLightBuffer, m_clusterLightsSRVId);
+      CreateDynamicStructuredBuffer(
+        resourceManager,
+        sizeof(SAE::Rendering::LightClusters::Cell),
+        m_lightClusters.clusterCount(),
+        m_clusterCellBuffer,
+        m_clusterCellsSRVId);
+      CreateDynamicStructuredBuffer(
+        resourceManager,
+        sizeof(uint32_t),
+        SAE::Rendering::LightClusters::Options().maxIndices,
+        m_clusterIndexBuffer,
+        m_clusterIndicesSRVId);
+
+      OccluderMesh planeOccluder;
+      if(loadOccluderMesh("resources/meshes/fourQuadPlane.obj", m_floor, planeOccluder))
+        m_occluders.push_back(planeOccluder);
+
+#ifdef SAE_BENCHMARK_PIXEL_CONVERSION
+      for(SAE::Texture::PixelKernelBenchmarkResult const&result : SAE::Texture::BenchmarkPixelConversion()) {
+        Log(result.kernel << " [" << SAE::Texture::PixelKernelLevelName(result.level) << "]: "
+            << result.megapixelsPerSecond << " MPix/s, x" << result.speedupOverScalar << "\n");
+      }
+#endif
+
+#ifdef SAE_BENCHMARK_COMMAND_RECORDING
+      for(SAE::Rendering::CommandRecordingBenchmarkResult const&result : SAE::Rendering::BenchmarkCommandRecording()) {
+        Log("Command recording [" << result.threadCount << " threads]: "
+            << (result.commandsPerSecond / 1.0e6) << " MCmd/s, " << result.megabytesPerSecond << " MB/s, "
+            << result.constantBytesPerFrame << " constant bytes/frame"
+            << (result.valid ? "" : " (INVALID)") << "\n");
+      }
+#endif
+
+#ifdef SAE_BENCHMARK_JOB_SYSTEM
+      for(SAE::Threading::JobSystemBenchmarkResult const&result : SAE::Threading::BenchmarkJobSystem()) {
+        Log("Job system [" << result.threadCount << " threads]: "
+            << result.frameMs << "ms/frame (transform " << result.transformMs << "ms, cull " << result.cullMs
+            << "ms, draw list " << result.drawListMs << "ms), x" << result.speedup << ", "
+            << result.steals << " steals"
+            << (result.valid ? "" : " (INVALID)") << "\n");
+      }
+#endif
 
-        m_transforms[lightSphereId[k]] = lightSphereTransform;
-        m_meshes[lightSphereId[k]]     = lightSphereMesh;
+#ifdef SAE_BENCHMARK_ENTITIES
+      {
+        SAE::ECS::EntityBenchmarkResult const result = SAE::ECS::BenchmarkEntityIteration();
+        Log("Entity iteration [" << result.entityCount << " entities]: maps " << result.mapMs << "ms, registry "
+            << result.registryMs << "ms, x" << result.speedup
+            << (result.valid ? "" : " (INVALID)") << "\n");
       }
+#endif
 
-      uint64_t planeId = 5;
-      std::shared_ptr<SAE::DirectX11::DirectX11Mesh>
-        planeMesh = nullptr;
+#ifdef SAE_BENCHMARK_MATH
+      for(SAE::Math::MathKernelBenchmarkResult const&result : SAE::Math::BenchmarkMathKernels()) {
+        Log(result.kernel << " [" << SAE::Math::MathKernelLevelName(result.level) << "]: "
+            << result.millionsPerSecond << " M/s, x" << result.speedupOverScalar
+            << ", max error " << result.maxError << "\n");
+      }
+#endif
+
+#ifdef SAE_BENCHMARK_RAYCAST
+      for(char const *filename : { "resources/meshes/terrain.obj", "resources/meshes/Geografia.obj" }) {
+        Mesh<XMVECTOR>::VertexBuffer_t vertices;
+        Mesh<XMVECTOR>::IndexBuffer_t  indices;
+        uint64_t                       vertexCount = 0;
+        uint64_t                       indexCount  = 0;
+        if(!Mesh<XMVECTOR>::LoadMeshAssimp(filename, vertices, vertexCount, indices, indexCount) || vertices.empty())
+          continue;
+
+        SAE::Rendering::TriangleBVHBenchmarkResult const result
+          = SAE::Rendering::BenchmarkTriangleBVH(
+              reinterpret_cast<float const*>(&vertices.front().position), sizeof(Mesh<XMVECTOR>::Vertex_t), vertices.size(),
+              indices.data(), indices.size());
+        Log("Ray casts [" << filename << ", " << result.triangles << " triangles, " << result.nodes << " nodes, built in "
+            << result.buildMs << "ms]: " << (result.raysPerSecond / 1.0e6) << " MRays/s single, "
+            << (result.packetRaysPerSecond / 1.0e6) << " MRays/s packets of 4, x" << result.speedup << " over brute force, "
+            << (result.hitRatio * 100.0) << "% hit"
+            << (result.valid ? "" : " (INVALID)") << "\n");
+      }
+#endif
+
+      // LOAD TEXTURES HERE!!!
+      // Decode everything in parallel on the decode service, then upload on this thread.
+      m_textureDecodeService = std::make_shared<TextureDecodeService>();
+      m_textureDecodeService->initialize();
+
+      struct {
+        const char   *filename;
+        unsigned int  flags;
+        uint64_t     *textureId;
+        uint64_t     *srvId;
+      } textureLoads[] ={
+        { "resources/textures/Sci-Fi-Floor-Diffuse.tga",  TextureDecodeService::FlagNone,      &m_diffuseTextureId,  &m_diffuseTextureSRVId  },
+        { "resources/textures/Sci-Fi-Floor-Specular.tga", TextureDecodeService::FlagNone,      &m_specularTextureId, &m_specularTextureSRVId },
+        { "resources/textures/Sci-Fi-Floor-Gloss.tga",    TextureDecodeService::FlagNone,      &m_glossTextureId,    &m_glossTextureSRVId    },
+        { "resources/textures/Sci-Fi-Floor-Normal.tga",   TextureDecodeService::FlagNormalMap, &m_normalTextureId,   &m_normalTextureSRVId   },
+      };
 
-      // cubeMesh = SAE::DirectX11::DirectX11Mesh::loadFromFile(resourceManager, "resources/meshes/Sci-Fi-Floor-1-OBJ.obj");
-      planeMesh = SAE::DirectX11::DirectX11Mesh::loadFromFile(resourceManager, "resources/meshes/fourQuadPlane.obj");
+      // Environment lighting is preprocessed once and cached next to the cubemap;
+      // on a cache miss the faces decode alongside the other textures.
+      std::vector<std::string> environmentFaces
+        = SAE::Texture::CubeMapFaceFilenames("resources/textures/envmap_miramar/", "miramar", ".tga");
+      SAE::Texture::EnvironmentPreprocessOptions environmentOptions;
+      SAE::Texture::EnvironmentLighting          environmentLighting;
 
-      float planeScale = 10.0f;
-      DX11TransformPtr planeTransform = DX11TransformPtr(new DX11Transform());
-      planeTransform->setTranslationZ(20);
-      planeTransform->setScale(planeScale, 1.0f, planeScale);
-
-      m_transforms[planeId] = planeTransform;
-      m_meshes[planeId]     = planeMesh;
-
-      m_lights[1].transform().setTranslation(planeTransform->getTranslation()); // Place light in the middle of the plane and shift up
-      m_lights[1].transform().translateVerticalBy(1); // Place light in the middle of the plane and shift up
-
-      uint64_t shadowSphereId = 6;
-      std::shared_ptr<SAE::DirectX11::DirectX11Mesh>
-        shadowSphereMesh = nullptr;
-
-      shadowSphereMesh = SAE::DirectX11::DirectX11Mesh::loadFromFile(resourceManager, "resources/meshes/regular_sphere.obj");
-
-      DX11TransformPtr shadowSphereTransform = DX11TransformPtr(new DX11Transform());
-      shadowSphereTransform->setTranslation(0.0f, 1.0f, 20.0f);
-      shadowSphereTransform->setScale(0.01f, 0.01f, 0.01f);
-
-      m_transforms[shadowSphereId] = shadowSphereTransform;
-      m_meshes[shadowSphereId]     = shadowSphereMesh;
-
-      // LOAD TEXTURES HERE!!!      
-      if(!SAE::DirectX11::LoadTextureFromFile(resourceManager, "resources/textures/Sci-Fi-Floor-Diffuse.tga", m_diffuseTextureId, m_diffuseTextureSRVId)) {
-        // Ohoh...
-        m_diffuseTextureId = 0;
-        m_diffuseTextureSRVId = 0;
-      }
-      if(!SAE::DirectX11::LoadTextureFromFile(resourceManager, "resources/textures/Sci-Fi-Floor-Specular.tga", m_specularTextureId, m_specularTextureSRVId)) {
-        // Ohoh...
-        m_specularTextureId = 0;
-        m_specularTextureSRVId = 0;
-      }
-      if(!SAE::DirectX11::LoadTextureFromFile(resourceManager, "resources/textures/Sci-Fi-Floor-Gloss.tga", m_glossTextureId, m_glossTextureSRVId)) {
-        // Ohoh...
-        m_glossTextureId = 0;
-        m_glossTextureSRVId = 0;
-      }
-      if(!SAE::DirectX11::LoadTextureFromFile(resourceManager, "resources/textures/Sci-Fi-Floor-Normal.tga", m_normalTextureId, m_normalTextureSRVId)) {
-        // Ohoh...
-        m_normalTextureId = 0;
-        m_normalTextureSRVId = 0;
-      }
-
-      D3D11_TEXTURE2D_DESC shadowMapTextureDesc ={};
-      shadowMapTextureDesc.Width              = 1024;
-      shadowMapTextureDesc.Height             = 1024;
-      shadowMapTextureDesc.ArraySize          = 24;
-      shadowMapTextureDesc.MipLevels          = 1;
-      shadowMapTextureDesc.SampleDesc.Count   = 1;
-      shadowMapTextureDesc.SampleDesc.Quality = 0;
-      shadowMapTextureDesc.BindFlags          = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
-      shadowMapTextureDesc.Usage              = D3D11_USAGE_DEFAULT;
-      shadowMapTextureDesc.CPUAccessFlags     = 0;
-      shadowMapTextureDesc.Format             = DXGI_FORMAT_R24G8_TYPELESS;
-      shadowMapTextureDesc.MiscFlags          = D3D11_RESOURCE_MISC_TEXTURECUBE;
-
-      std::vector<D3D11_SUBRESOURCE_DATA> shadowMapInitialData;
-      m_shadowMapTextureId = resourceManager->create<ID3D11Texture2D>(shadowMapTextureDesc, shadowMapInitialData);
-
-      ID3D11Texture2D *pShadowMapTexture = reinterpret_cast<ID3D11Texture2D*>(m_shadowMapTextureId);
-
-      D3D11_SHADER_RESOURCE_VIEW_DESC shadowMapSRVDesc ={};
-      shadowMapSRVDesc.Format                            = DXGI_FORMAT_R24_UNORM_X8_TYPELESS;
-      shadowMapSRVDesc.ViewDimension                     = D3D11_SRV_DIMENSION_TEXTURECUBEARRAY;
-      shadowMapSRVDesc.TextureCubeArray.MipLevels        = shadowMapTextureDesc.MipLevels;
-      shadowMapSRVDesc.TextureCubeArray.MostDetailedMip  = 0;
-      shadowMapSRVDesc.TextureCubeArray.First2DArrayFace = 0;
-      shadowMapSRVDesc.TextureCubeArray.NumCubes         = 4;
-      m_shadowMapSRVId = resourceManager->create<ID3D11ShaderResourceView>(shadowMapSRVDesc, pShadowMapTexture);
-
-      D3D11_SUBRESOURCE_DATA emptyDSVData={};
-
-      D3D11_DEPTH_STENCIL_VIEW_DESC shadowMapDSVDesc ={};
-      shadowMapDSVDesc.Format                         = DXGI_FORMAT_D24_UNORM_S8_UINT;
-      shadowMapDSVDesc.ViewDimension                  = D3D11_DSV_DIMENSION_TEXTURE2DARRAY;
-      shadowMapDSVDesc.Texture2DArray.ArraySize       = 1;
-      shadowMapDSVDesc.Texture2DArray.MipSlice        = 0;
-      for(uint32_t j=0; j < 4; ++j) {
-        for(uint32_t k=0; k < 6; ++k) {
-          shadowMapDSVDesc.Texture2DArray.FirstArraySlice = (j * 6) + k;
-          m_shadowMapDSVId[(j * 6) + k] = resourceManager->create<ID3D11DepthStencilView>(shadowMapDSVDesc, pShadowMapTexture, emptyDSVData);
+      bool environmentReady = SAE::Texture::LoadEnvironmentCache(environmentFaces, environmentOptions, environmentLighting);
+
+      std::future<TextureDecodeService::Result> pendingEnvironment;
+      if(!environmentReady)
+        pendingEnvironment = m_textureDecodeService->submitArray(environmentFaces);
+
+      std::vector<std::future<TextureDecodeService::Result>> pendingTextures;
+      for(auto const&load : textureLoads)
+        pendingTextures.push_back(m_textureDecodeService->submit(load.filename, 0, nullptr, load.flags));
+
+      for(size_t k=0; k < pendingTextures.size(); ++k) {
+        TextureDecodeService::Result result = pendingTextures[k].get();
+        if(!result.success
+           || !SAE::DirectX11::CreateTextureFromDescriptor(resourceManager, result.image, *textureLoads[k].textureId, *textureLoads[k].srvId))
+        {
+          // Ohoh...
+          Log("Failed to load texture " << textureLoads[k].filename << ": " << result.error << "\n");
+          *textureLoads[k].textureId = 0;
+          *textureLoads[k].srvId     = 0;
         }
       }
-      // HIERARCHY GOES HERE!!!
-      Node root =
+
+      if(pendingEnvironment.valid()) {
+        TextureDecodeService::Result result = pendingEnvironment.get();
+        environmentReady = result.success
+                           && SAE::Texture::PreprocessEnvironmentMap(result.image, environmentOptions, environmentLighting);
+        if(environmentReady)
+          SAE::Texture::SaveEnvironmentCache(environmentFaces, environmentOptions, environmentLighting);
+        else
+          Log("Failed to preprocess environment map " << environmentFaces[0] << ": " << result.error << "\n");
+      }
+
+      AmbientBuffer_t ambient ={};
+      if(environmentReady
+         && SAE::DirectX11::CreateTextureFromDescriptor(resourceManager, environmentLighting.specular, m_environmentMapTextureId, m_environmentMapSRVId))
       {
-        0,
-        {
-        // First children: Triangle
-        {
-          lightSphereId[0],
-          {}
-        },
-        {
-          planeId,
-          {
+        memcpy(ambient.irradiance, environmentLighting.irradiance.coefficients, sizeof(ambient.irradiance));
+        ambient.environmentInfo = XMVectorSet(static_cast<float>(environmentLighting.specular.mipLevels), 0.0f, 0.0f, 0.0f);
+      }
+      else {
+        m_environmentMapTextureId = 0;
+        m_environmentMapSRVId     = 0;
+      }
 
-            {
-              lightSphereId[1],
-              {}
-            },
-            {
-              lightSphereId[2],
-              {}
-            },
-            {
-              lightSphereId[3],
-             {}
-            },
-          }
-        },
-        {
-          shadowSphereId,
-          {}
-         }
+      // Never changes at runtime: one immutable upload, no per-frame map.
+      D3D11_BUFFER_DESC
+        ambientBufferDesc ={};
+      ambientBufferDesc.ByteWidth           = sizeof(AmbientBuffer_t);
+      ambientBufferDesc.BindFlags           = D3D11_BIND_CONSTANT_BUFFER;
+      ambientBufferDesc.Usage               = D3D11_USAGE_IMMUTABLE;
+      ambientBufferDesc.MiscFlags           = 0;
+      ambientBufferDesc.CPUAccessFlags      = 0;
+      ambientBufferDesc.StructureByteStride = 0;
+
+      D3D11_SUBRESOURCE_DATA
+        ambientInitialData={};
+      ambientInitialData.pSysMem = &ambient;
+
+      m_ambientBuffer
+        = resourceManager->create<ID3D11Buffer>(ambientBufferDesc, ambientInitialData);
+
+      TextureDecodeService::Stats decodeStats = m_textureDecodeService->stats();
+      Log("Texture decode: " << decodeStats.imagesDecoded << " images, "
+          << decodeStats.imagesPerSecond << " images/s, "
+          << decodeStats.megabytesReadPerSecond << " MB/s read, peak queue depth "
+          << decodeStats.peakQueueDepth << "\n");
+      for(uint32_t k=0; k < TextureDecodeService::StageCount; ++k) {
+        TextureDecodeService::StageStats const&stage = decodeStats.stages[k];
+        Log("  " << TextureDecodeService::stageName(static_cast<TextureDecodeService::Stage>(k))
+            << ": avg " << stage.averageMs() << "ms, max " << stage.maxMs << "ms\n");
       }
-      };
 
-      m_hierarchyRoot = root;
+      // Shadow maps and depth targets are transient render graph textures, see renderFrame().
+      m_frameGraphAllocator = std::make_shared<DirectX11RenderGraphAllocator>(resourceManager);
+      m_frameGraph.initialize(m_frameGraphAllocator.get());
+      m_frameGraphPassCount = 0;
+
+      m_shadowAtlas.initialize();
+
+      // All objects use the standard material.
+      Material standardMaterial ={};
+      standardMaterial.diffuseTextureSRVId  = m_diffuseTextureSRVId;
+      standardMaterial.specularTextureSRVId = m_specularTextureSRVId;
+      standardMaterial.glossTextureSRVId    = m_glossTextureSRVId;
+      standardMaterial.normalTextureSRVId   = m_normalTextureSRVId;
+
+      SAE::ECS::ComponentPool<MeshRef> &meshRefs = m_registry.pool<MeshRef>();
+      for(size_t k=0; k < meshRefs.size(); ++k)
+        m_registry.add<Material>(meshRefs.entities()[k], standardMaterial);
+
+      // HIERARCHY GOES HERE!!!
+      // Parents are set by createObject(); the static batches are roots.
+      flattenHierarchy();
+
+      m_displayMode   = 1; // Normal
+      m_pickKeyDown   = false;
+      m_pickRequested = false;
+      m_frameIndex    = 0;
+      m_renderPacket  = nullptr;
 
-      m_displayMode = 1; // Normal
+      m_updateAllocationMark = 0;
+      m_allocationReports    = 0;
 
       return true;
     }
@@ -279,6 +527,10 @@ namespace SAE {
         const Timer::State &time,
         const InputState   &inputState)
     {
+      // A new update frame: frame arena memory of this thread from before is released.
+      SAE::Memory::FrameArena::local().reset();
+      m_updateAllocationMark = SAE::Memory::ThreadHeapAllocations();
+
       if(inputState.getPressed(KeyCode::ARROW_UP)) {
         m_defaultCamera.transform().translateVerticalBy(0.1f);
       }
@@ -311,23 +563,24 @@ namespace SAE {
       }
 
 
+      Light &controlledLight = *m_registry.find<Light>(m_controlledLight);
       if(inputState.getPressed(KeyCode::W)) {
-        m_lights[1].transform().translateDirectionalBy(0.1f);
+        controlledLight.transform().translateDirectionalBy(0.1f);
       }
       if(inputState.getPressed(KeyCode::A)) {
-        m_lights[1].transform().translateLateralBy(-0.1f);
+        controlledLight.transform().translateLateralBy(-0.1f);
       }
       if(inputState.getPressed(KeyCode::S)) {
-        m_lights[1].transform().translateDirectionalBy(-0.1);
+        controlledLight.transform().translateDirectionalBy(-0.1);
       }
       if(inputState.getPressed(KeyCode::D)) {
-        m_lights[1].transform().translateLateralBy(0.1f);
+        controlledLight.transform().translateLateralBy(0.1f);
       }
       if(inputState.getPressed(KeyCode::Q)) {
-        m_lights[1].transform().translateVerticalBy(-0.1f);
+        controlledLight.transform().translateVerticalBy(-0.1f);
       }
       if(inputState.getPressed(KeyCode::E)) {
-        m_lights[1].transform().translateVerticalBy(0.1f);
+        controlledLight.transform().translateVerticalBy(0.1f);
       }
 
       if(inputState.getPressed(KeyCode::D1)) {
@@ -346,32 +599,264 @@ namespace SAE {
         m_displayMode = 5;
       }
 
+      // One pick per key press, not per frame the key is held.
+      bool const pickKeyDown = inputState.getPressed(KeyCode::P);
+      m_pickRequested = pickKeyDown && !m_pickKeyDown;
+      m_pickKeyDown   = pickKeyDown;
+
       m_defaultCamera.update();
 
-      std::function<void(DX11TransformPtr const&, Node &)>
-        updateHierarchyFn = nullptr;
+      for(DynamicLight &dynamicLight : m_dynamicLights) {
+        float const angle = dynamicLight.phase + dynamicLight.orbitSpeed * static_cast<float>(time.totalElapsed);
+
+        dynamicLight.position.x = dynamicLight.center.x + dynamicLight.orbitRadius * std::cos(angle);
+        dynamicLight.position.y = dynamicLight.center.y;
+        dynamicLight.position.z = dynamicLight.center.z + dynamicLight.orbitRadius * std::sin(angle);
+      }
 
       // Transform all objects
       float rotation = (360.0f / 30.0f) * time.totalElapsed;
-      m_transforms[5]->setRotation(0.0f, rotation, 0.0f);
+      m_registry.find<DX11Transform>(m_floor)->setRotation(0.0f, rotation, 0.0f);
+
+      // The marker is drawn where the light is, at the light's scale.
+      *m_registry.find<DX11Transform>(m_lightMarker) = controlledLight.transform();
+
+      // Update hierarchy to generate world matrices, a level at a time: parents are final
+      // before their children read them. The transform and world matrix pools are in level
+      // order, see flattenHierarchy(), so every level is a contiguous range of both. Changed
+      // local matrices are composed in batches first; normal matrices multiply down the
+      // hierarchy like the world matrices, so no object's matrix is ever inverted.
+      SAE::ECS::ComponentPool<DX11Transform> &transforms = m_registry.pool<DX11Transform>();
+      SAE::ECS::ComponentPool<WorldMatrix>   &worlds     = m_registry.pool<WorldMatrix>();
+      for(size_t level=0; (level + 1) < m_hierarchyLevelOffsets.size(); ++level) {
+        size_t const first = m_hierarchyLevelOffsets[level];
+        size_t const count = m_hierarchyLevelOffsets[level + 1] - first;
+
+        m_workerPool.parallelFor(count, 64, [&] (size_t begin, size_t end)
+        {
+          ComposeDirtyTransforms(transforms, first + begin, first + end);
+
+          for(size_t k=(first + begin); k < (first + end); ++k) {
+            DX11Transform &transform = transforms[k];
+            uint32_t const parent    = m_transformParents[k];
+            if(parent == SAE::ECS::InvalidIndex) {
+              transform.worldMatrix(XMMatrixIdentity(), &worlds[k].matrix);
+              worlds[k].normalMatrix = transform.localNormalMatrix();
+              continue;
+            }
 
-      // Update hierarchy to generate world matrices
-      DX11TransformPtr parent = DX11TransformPtr(new DX11Transform());
-      updateHierarchyFn
-        = [&] (DX11TransformPtr const&parent, Node &root) ->void
-      {
-        DX11TransformPtr transform = DX11TransformPtr(new DX11Transform());
-        if(root.objectId) {
-          transform = m_transforms[root.objectId];
-          transform->worldMatrix(parent->composedWorldMatrix(), nullptr);
+            transform.worldMatrix(worlds[parent].matrix, &worlds[k].matrix);
+            worlds[k].normalMatrix = XMMatrixMultiply(transform.localNormalMatrix(), worlds[parent].normalMatrix);
+          }
+        });
+      }
+
+      return true;
+    }
+
+    /**********************************************************************************************//**
+     * \fn  void Engine ::capture(Timer::State const&time, FramePacket &outPacket)
+     *
+     * \brief Copies the simulated state of this frame into a packet for renderFrame().
+     *
+     * The packet's containers are assigned in place, so a reused packet does not reallocate.
+     * The lights go through m_lights first, which recomputes the shadow views of the lights
+     * that moved since the last capture only; the render side only fits the directional
+     * cascades, which depend on the frame's camera and shadow atlas.
+     *
+     * \param           time      The time update() simulated.
+     * \param [in,out]  outPacket The packet to overwrite.
+     **************************************************************************************************/
+    void Engine
+      ::capture(
+        const Timer::State &time,
+        FramePacket        &outPacket)
+    {
+      outPacket.frameIndex  = ++m_frameIndex;
+      outPacket.time        = time;
+      outPacket.camera      = m_defaultCamera;
+      outPacket.displayMode   = m_displayMode;
+      outPacket.pickRequested = m_pickRequested;
+
+      SAE::ECS::ComponentPool<Light> const&lights = m_registry.pool<Light>();
+      m_lights.sync(lights.data(), lights.size());
+
+      outPacket.lights = m_lights;
+      outPacket.dynamicLights.assign(m_dynamicLights.begin(), m_dynamicLights.end());
+
+      SAE::ECS::ComponentPool<WorldMatrix> const&worlds = m_registry.pool<WorldMatrix>();
+      outPacket.worldMatrices.resize(worlds.size());
+      outPacket.normalMatrices.resize(worlds.size());
+      for(size_t k=0; k < worlds.size(); ++k) {
+        outPacket.worldMatrices[k]  = worlds[k].matrix;
+        outPacket.normalMatrices[k] = worlds[k].normalMatrix;
+      }
+
+      checkFrameAllocations("update", outPacket.frameIndex, m_updateAllocationMark);
+    }
+
+    /**********************************************************************************************//**
+     * \fn  void Engine ::checkFrameAllocations(char const *stage, uint64_t frameIndex, uint64_t mark)
+     *
+     * \brief Reports a frame of a stage that allocated from the heap once it should not anymore.
+     *
+     * Transient containers live in the frame arenas and everything else keeps its storage, so
+     * after the first frames, which size the arenas, pools and caches, a frame is expected to
+     * make no heap allocation on its thread. Only builds defining SAE_CHECK_FRAME_ALLOCATIONS
+     * count allocations; the first reports are logged, later ones are dropped. The
+     * -checkFrameAllocations option of the application fails on them instead.
+     **************************************************************************************************/
+    void Engine
+      ::checkFrameAllocations(
+        char const *stage,
+        uint64_t    frameIndex,
+        uint64_t    mark)
+    {
+      static const uint64_t warmUpFrames = 120;
+      static const uint32_t maxReports   = 16;
+
+      uint64_t const allocations = SAE::Memory::ThreadHeapAllocations() - mark;
+      if(!allocations || frameIndex <= warmUpFrames)
+        return;
+
+      if(m_allocationReports.fetch_add(1) < maxReports)
+        Log("Frame " << frameIndex << ": " << allocations << " heap allocation(s) in " << stage << ".");
+    }
+
+    /**********************************************************************************************//**
+     * \fn  uint32_t Engine ::addMesh(DirectX11MeshPtr const&mesh)
+     *
+     * \brief Adds a mesh to the mesh table.
+     *
+     * \return  The MeshRef::mesh of the mesh.
+     **************************************************************************************************/
+    uint32_t Engine
+      ::addMesh(SAE::DirectX11::DirectX11MeshPtr const&mesh)
+    {
+      m_meshAssets.push_back(mesh);
+      return static_cast<uint32_t>(m_meshAssets.size() - 1);
+    }
+
+    /**********************************************************************************************//**
+     * \fn  SAE::ECS::Entity Engine ::createObject(uint32_t mesh, DX11Transform const&transform, SAE::ECS::Entity parent)
+     *
+     * \brief Creates a drawable object: transform, world matrix, mesh reference and bounds.
+     *
+     * The material is added once the textures are loaded. Call flattenHierarchy() before the
+     * next update().
+     *
+     * \param  mesh      Index into the mesh table, see addMesh().
+     * \param  transform Local transform, relative to the parent.
+     * \param  parent    NullEntity for a root.
+     *
+     * \return  The new entity.
+     **************************************************************************************************/
+    SAE::ECS::Entity Engine
+      ::createObject(
+        uint32_t             mesh,
+        DX11Transform const&transform,
+        SAE::ECS::Entity     parent)
+    {
+      SAE::ECS::Entity const entity = m_registry.create();
+
+      m_registry.add<DX11Transform>(entity, transform);
+      m_registry.add<WorldMatrix>(entity, { XMMatrixIdentity(), XMMatrixIdentity() });
+      m_registry.add<MeshRef>(entity, { mesh });
+      if(parent)
+        m_registry.add<Parent>(entity, { parent });
+
+      DirectX11MeshPtr const&meshAsset = m_meshAssets.at(mesh);
+      if(meshAsset) {
+        Bounds bounds ={};
+        XMStoreFloat3(&bounds.minimum, meshAsset->boundsMin());
+        XMStoreFloat3(&bounds.maximum, meshAsset->boundsMax());
+        m_registry.add<Bounds>(entity, bounds);
+      }
+
+      return entity;
+    }
+
+    /**********************************************************************************************//**
+     * \fn  void Engine ::flattenHierarchy()
+     *
+     * \brief Sorts the transform components into the level order update() processes in parallel.
+     *
+     * Entities are ordered by their depth in the Parent hierarchy, so every level is a range
+     * of m_hierarchyLevelOffsets that only reads world matrices of the levels before, and
+     * m_transformParents holds the parent's position in the pools. The world matrix pool is
+     * sorted alike, so a transform and its world matrix share their position; the drawable
+     * components follow the same order, so draws walk the world matrices front to back.
+     **************************************************************************************************/
+    void Engine
+      ::flattenHierarchy()
+    {
+      using namespace SAE::ECS;
+
+      ComponentPool<DX11Transform> &transforms = m_registry.pool<DX11Transform>();
+      ComponentPool<WorldMatrix>   &worlds     = m_registry.pool<WorldMatrix>();
+      ComponentPool<Parent>  const &parents    = m_registry.pool<Parent>();
+
+      size_t const count = transforms.size();
+
+      // Depth per transform, each chain of unknown ancestors resolved once; an entity whose
+      // parent has no transform is a root. Cycles are cut where they close.
+      std::vector<uint32_t> depth(count, InvalidIndex);
+      std::vector<uint32_t> chain;
+      uint32_t              levels = 0;
+      for(size_t k=0; k < count; ++k) {
+        chain.clear();
+
+        uint32_t slot  = static_cast<uint32_t>(k);
+        uint32_t level = 0;
+        while(depth[slot] == InvalidIndex) {
+          chain.push_back(slot);
+
+          Parent   const*parent     = parents.find(transforms.entities()[slot]);
+          uint32_t const parentSlot = parent ? transforms.indexOf(parent->entity) : InvalidIndex;
+          if(parentSlot == InvalidIndex || chain.size() > count)
+            break;
+
+          slot = parentSlot;
         }
-        for(Node &child : root.children)
-          updateHierarchyFn(transform, child);
-      };
+        if(depth[slot] != InvalidIndex)
+          level = depth[slot] + 1;
 
-      updateHierarchyFn(parent, m_hierarchyRoot);
+        for(size_t c=chain.size(); c-- > 0; )
+          depth[chain[c]] = level++;
 
-      return true;
+        levels = (level > levels) ? level : levels;
+      }
+
+      // Counting sort by depth, stable within a level.
+      m_hierarchyLevelOffsets.assign(levels + 1, 0);
+      for(uint32_t d : depth)
+        ++m_hierarchyLevelOffsets[d + 1];
+      for(uint32_t level=0; level < levels; ++level)
+        m_hierarchyLevelOffsets[level + 1] += m_hierarchyLevelOffsets[level];
+
+      std::vector<size_t> cursor(m_hierarchyLevelOffsets.begin(), m_hierarchyLevelOffsets.end() - 1);
+      std::vector<Entity> order(count, NullEntity);
+      for(size_t k=0; k < count; ++k)
+        order[cursor[depth[k]]++] = transforms.entities()[k];
+
+      transforms.reorder(order.data(), order.size());
+      worlds.reorder(order.data(), order.size());
+      m_registry.pool<MeshRef>().reorder(order.data(), order.size());
+      m_registry.pool<Material>().reorder(order.data(), order.size());
+      m_registry.pool<Bounds>().reorder(order.data(), order.size());
+
+      m_transformParents.assign(count, InvalidIndex);
+      for(size_t k=0; k < count; ++k) {
+        Parent const*parent = parents.find(transforms.entities()[k]);
+        if(parent)
+          m_transformParents[k] = transforms.indexOf(parent->entity);
+      }
+
+      bool aligned = (worlds.size() == count);
+      for(size_t k=0; aligned && k < count; ++k)
+        aligned = (worlds.entities()[k] == transforms.entities()[k]);
+      if(!aligned)
+        Log("Every entity with a transform needs a world matrix and vice versa.\n");
     }
 
     /**********************************************************************************************//**
@@ -390,102 +875,166 @@ namespace SAE {
         uint64_t    const&cubeIndex,
         uint64_t    const&shadowMapIndex)
     {
-      std::vector<RenderObject> renderObjects ={};
-
-      std::function<void(std::vector<RenderObject> &, Node &)>
-        renderHierarchyFn = nullptr;
-
-      renderHierarchyFn
-        = [&] (std::vector<RenderObject> &renderObjects, Node &root) ->void
+      // Everything that changes per frame comes from the packet renderFrame() executes, never
+      // from the state update() may already be advancing.
+      FramePacket *frame = m_renderPacket;
+      if(!frame)
+        return false;
+
+      // Every entity with a mesh, in the level order of flattenHierarchy(); lookups only.
+      SAE::ECS::ComponentPool<MeshRef>  const&meshRefs  = m_registry.pool<MeshRef>();
+      SAE::ECS::ComponentPool<Material> const&materials = m_registry.pool<Material>();
+
+      sceneHolder.objects.resize(meshRefs.size());
+      m_workerPool.parallelFor(meshRefs.size(), 64, [&] (size_t begin, size_t end)
       {
-        RenderObject object ={};
+        for(size_t k=begin; k < end; ++k) {
+          RenderObject &object = sceneHolder.objects[k];
+          object ={};
 
-        DirectX11MeshPtr mesh = nullptr;
-        if(root.objectId) {
+          SAE::ECS::Entity const entity = meshRefs.entities()[k];
+          if(meshRefs[k].mesh >= m_meshAssets.size() || !m_meshAssets[meshRefs[k].mesh])
+            continue;
 
-          mesh = m_meshes[root.objectId];
+          DirectX11MeshPtr const&mesh = m_meshAssets[meshRefs[k].mesh];
 
-          if(mesh) {
-            object.objectId            = root.objectId;
-            object.vertexBufferId      = mesh->vertexBufferHandle();
-            object.indexBufferId       = mesh->indexBufferHandle();
+          object.objectId            = entity;
+          object.vertexBufferId      = mesh->vertexBufferHandle();
+          object.indexBufferId       = mesh->indexBufferHandle();
 
-            if(passType == PassType::Main) {
-              object.vertexShaderId = mesh->vertexShaderHandle();
-              object.pixelShaderId  = mesh->pixelShaderHandle();
-              object.inputLayoutId  = mesh->inputLayoutHandle();
-            }
-            else {
-              object.vertexShaderId = mesh->shadowMapVertexShaderHandle();
-              object.pixelShaderId  = mesh->shadowMapPixelShaderHandle();
-              object.inputLayoutId  = mesh->shadowMapInputLayoutHandle();
-            }
+          if(passType == PassType::Main) {
+            object.vertexShaderId = mesh->vertexShaderHandle();
+            object.pixelShaderId  = mesh->pixelShaderHandle();
+            object.inputLayoutId  = mesh->inputLayoutHandle();
+          }
+          else {
+            object.vertexShaderId = mesh->shadowMapVertexShaderHandle();
+            object.pixelShaderId  = mesh->shadowMapPixelShaderHandle();
+            object.inputLayoutId  = mesh->shadowMapInputLayoutHandle();
+          }
 
-            // Register textures
-            object.diffuseTextureSRVId  = m_diffuseTextureSRVId;
-            object.specularTextureSRVId = m_specularTextureSRVId;
-            object.glossTextureSRVId    = m_glossTextureSRVId;
-            object.normalTextureSRVId   = m_normalTextureSRVId;
+          // Register textures
+          Material const*material = materials.find(entity);
+          if(material) {
+            object.diffuseTextureSRVId  = material->diffuseTextureSRVId;
+            object.specularTextureSRVId = material->specularTextureSRVId;
+            object.glossTextureSRVId    = material->glossTextureSRVId;
+            object.normalTextureSRVId   = material->normalTextureSRVId;
           }
         }
+      });
 
-        for(Node &child : root.children)
-          renderHierarchyFn(renderObjects, child);
-
-        if(root.objectId)
-          renderObjects.push_back(object);
-      };
-
-      renderHierarchyFn(renderObjects, m_hierarchyRoot);
-
-      sceneHolder.objects        = renderObjects;
-      sceneHolder.lights         ={ 1, 2, 3, 4 };
+      sceneHolder.lights ={ 1, 2, 3, 4 };
 
+      // renderTargetId and shadowMapTextureSRVId are the caller's: they come from the frame graph.
       if(passType == PassType::Main) {
-        sceneHolder.renderTargetId = 0;
         sceneHolder.cameraBufferId = m_cameraBuffer;
         sceneHolder.cameraBufferUpdateFn =
-          [this] (CameraBuffer_t *ptr) -> bool
+          [frame] (CameraBuffer_t *ptr) -> bool
+        {
+          ptr->view            = frame->camera.viewMatrix();
+          ptr->projection      = frame->camera.projectionMatrix();
+          ptr->cameraPosition  = frame->camera.transform().getTranslation();
+          ptr->cameraDirection = frame->camera.transform().getDirection();
+
+          return true;
+        };
+
+        sceneHolder.ambientBufferId     = m_ambientBuffer;
+        sceneHolder.environmentMapSRVId = m_environmentMapSRVId;
+
+        // Light clusters of this frame, see buildLightClusters().
+        sceneHolder.clusterBufferId     = m_clusterBuffer;
+        sceneHolder.clusterLightsSRVId  = m_clusterLightsSRVId;
+        sceneHolder.clusterCellsSRVId   = m_clusterCellsSRVId;
+        sceneHolder.clusterIndicesSRVId = m_clusterIndicesSRVId;
+        sceneHolder.clusterBufferUpdateFn =
+          [this] (ClusterBuffer_t *ptr) -> bool
         {
-          ptr->view            = m_defaultCamera.viewMatrix();
-          ptr->projection      = m_defaultCamera.projectionMatrix();
-          ptr->cameraPosition  = m_defaultCamera.transform().getTranslation();
-          ptr->cameraDirection = m_defaultCamera.transform().getDirection();
+          *ptr = m_clusterConstants;
 
           return true;
         };
 
+        sceneHolder.shaderBufferUpdates ={
+          {
+            m_clusterLightBuffer,
+            static_cast<uint32_t>(sizeof(ClusterLight_t) * m_clusterLights.size()),
+            [this] (void *ptr) -> bool
+            {
+              memcpy(ptr, m_clusterLights.data(), sizeof(ClusterLight_t) * m_clusterLights.size());
+              return true;
+            }
+          },
+          {
+            m_clusterCellBuffer,
+            static_cast<uint32_t>(sizeof(SAE::Rendering::LightClusters::Cell) * m_lightClusters.cells().size()),
+            [this] (void *ptr) -> bool
+            {
+              std::vector<SAE::Rendering::LightClusters::Cell> const&cells = m_lightClusters.cells();
+              memcpy(ptr, cells.data(), sizeof(SAE::Rendering::LightClusters::Cell) * cells.size());
+              return true;
+            }
+          },
+          {
+            m_clusterIndexBuffer,
+            static_cast<uint32_t>(sizeof(uint32_t) * m_lightClusters.indices().size()),
+            [this] (void *ptr) -> bool
+            {
+              std::vector<uint32_t> const&indices = m_lightClusters.indices();
+              memcpy(ptr, indices.data(), sizeof(uint32_t) * indices.size());
+              return true;
+            }
+          }
+        };
+
+        sceneHolder.lightBufferId = m_lightBuffer;
       }
       else {
-        sceneHolder.renderTargetId = m_shadowMapDSVId[(cubeIndex * 6) + shadowMapIndex];
+        // Shadow passes see the scene through one view of the light: its cached view-projection
+        // stands in for the camera, so the pass uploads one matrix instead of every light.
         sceneHolder.lightBufferId  = 0;
-        sceneHolder.cameraBufferId = 0;
+        sceneHolder.cameraBufferId = m_cameraBuffer;
+        sceneHolder.cameraBufferUpdateFn =
+          [frame, cubeIndex, shadowMapIndex] (CameraBuffer_t *ptr) -> bool
+        {
+          LightSystem const&lights = frame->lights;
+          uint32_t    const light  = static_cast<uint32_t>(cubeIndex);
+
+          ptr->view            = lights.viewProjectionMatrix(light, shadowMapIndex);
+          ptr->projection      = XMMatrixIdentity();
+          ptr->cameraPosition  = lights.position(light);
+          ptr->cameraDirection = lights.direction(light);
+
+          return true;
+        };
       }
-      sceneHolder.shadowMapTextureSRVId = m_shadowMapSRVId;
-      sceneHolder.lightBufferId  = m_lightBuffer;
       sceneHolder.lightingBufferUpdateFn =
-        [&, this] (LightBuffer_t *ptr, uint64_t const&lightId, uint64_t const&targetIndex) -> bool
+        [this, frame] (LightBuffer_t *ptr, uint64_t const&lightId, uint64_t const&targetIndex) -> bool
       {
-        if(!lightId)
+        if(!lightId || lightId > frame->lights.size())
           return false;
 
-        Light &light = m_lights[lightId];
-        light.transform().worldMatrix(XMMatrixIdentity(), nullptr);;
-
-        memcpy(ptr->lights[targetIndex].view, light.viewMatrices(), sizeof(XMMATRIX) * 6);
-        ptr->lights[targetIndex].projection   = light.projectionMatrix(shadowMapIndex);
-        ptr->lights[targetIndex].lightViewIndex = shadowMapIndex;
-        ptr->lights[targetIndex].position     = light.transform().getTranslation();
-        ptr->lights[targetIndex].direction    = light.transform().getDirection();
-        ptr->lights[targetIndex].color        = light.properties().color;
-        ptr->lights[targetIndex].distance     = light.properties().specificProperties.point.distance;
-        ptr->lights[targetIndex].type         = 1;          // 0-Dir, 1-Point, 2-Spot
-        ptr->lights[targetIndex].intensity    = light.properties().intensity;       // Intensity
-        // ptr->lights[targetIndex].hotSpotAngle = RAD(30.0f); // Hot Spot Angle
-        ptr->lights[targetIndex].falloffAngle = RAD(5.0f);  // Falloff Beam Angle
-        ptr->lights[targetIndex].hotSpotAngle = RAD(30.0f);
-
-        ptr->lightIndex = cubeIndex;
+        LightSystem const&lights = frame->lights;
+        uint32_t    const light  = static_cast<uint32_t>(lightId - 1);
+
+        // Combined on the CPU once per change of the light, see LightSystem::sync().
+        memcpy(ptr->lights[targetIndex].viewProjection, lights.viewProjectionMatrices(light), sizeof(XMMATRIX) * LightSystem::MaxShadowViews);
+        ptr->lights[targetIndex].shadowViewCount = lights.shadowViewCount(light);
+        ptr->lights[targetIndex].position        = lights.position(light);
+        ptr->lights[targetIndex].direction       = lights.direction(light);
+        ptr->lights[targetIndex].color           = lights.properties(light).color;
+        ptr->lights[targetIndex].distance        = lights.range(light);
+        ptr->lights[targetIndex].intensity       = lights.properties(light).intensity;
+        ptr->lights[targetIndex].type            = ShaderLightType(lights.type(light));
+
+        // Where the light's faces were placed in the shadow atlas this frame, see renderFrame().
+        float const atlasTexel = (m_shadowAtlas.size() ? (1.0f / m_shadowAtlas.size()) : 0.0f);
+        for(uint64_t face=0; face < 6; ++face) {
+          SAE::Rendering::ShadowAtlasTile const tile = m_shadowAtlas.tile(shadowViewKey(lightId, face));
+          ptr->lights[targetIndex].shadowTiles[face]
+            = XMVectorSet(tile.x * atlasTexel, tile.y * atlasTexel, tile.size * atlasTexel, 0.5f * atlasTexel);
+        }
 
         return true;
       };
@@ -493,38 +1042,920 @@ namespace SAE {
       sceneHolder.objectBufferId = m_objectBuffer;
       sceneHolder.otherBufferId  = m_otherBuffer;
 
+      // Called concurrently by the renderer's recording threads: lookups only.
       sceneHolder.objectBufferUpdateFn =
-        [this] (ObjectBuffer_t *ptr, uint64_t const&objectId) -> bool
+        [this, frame] (ObjectBuffer_t *ptr, uint64_t const&objectId) -> bool
       {
-        if(!objectId)
+        XMMATRIX const*world  = frameWorldMatrix(*frame, objectId);
+        XMMATRIX const*normal = frameNormalMatrix(*frame, objectId);
+        if(!world || !normal)
           return false;
 
-        for(uint32_t k=0; k < 1; ++k)
-          if(objectId == (k + 1)) { // Object for light
-            Light &light = m_lights[(k + 1)];
-            ptr->world             = light.transform().composedWorldMatrix();
-            ptr->invTransposeWorld = XMMatrixTranspose(XMMatrixInverse(nullptr, ptr->world));
-            return true;
-          }
-        
-
-        DX11TransformPtr transform = m_transforms[objectId];
-        ptr->world             = transform->composedWorldMatrix();
-        ptr->invTransposeWorld = XMMatrixTranspose(XMMatrixInverse(nullptr, ptr->world));
+        ptr->world             = *world;
+        ptr->invTransposeWorld = *normal;
 
         return true;
       };
 
       sceneHolder.otherBufferUpdateFn =
-        [this] (OtherBuffer_t *ptr) -> bool
+        [frame] (OtherBuffer_t *ptr) -> bool
       {
-        ptr->displayMode = m_displayMode;
+        ptr->displayMode = frame->displayMode;
 
         return true;
       };
+
+      // Shadow passes keep objects hidden from the camera: they still cast shadows.
+      if(passType == PassType::Main)
+        cullOccludedObjects(sceneHolder);
+      else
+        cullShadowCasters(sceneHolder, static_cast<uint32_t>(cubeIndex), shadowMapIndex);
+
+      return true;
+    }
+
+    /**********************************************************************************************//**
+     * \fn  XMMATRIX const* Engine ::frameWorldMatrix(FramePacket const&frame, uint64_t const&objectId)
+     *
+     * \brief World matrix of an object as captured into a frame packet.
+     *
+     * \return  nullptr if the object is no entity with a transform.
+     **************************************************************************************************/
+    XMMATRIX const* Engine
+      ::frameWorldMatrix(
+        FramePacket const&frame,
+        uint64_t    const&objectId)
+    {
+      if(!objectId || objectId > 0xFFFFFFFF)
+        return nullptr;
+
+      uint32_t const slot = m_registry.pool<WorldMatrix>().indexOf(static_cast<SAE::ECS::Entity>(objectId));
+      if(slot == SAE::ECS::InvalidIndex || slot >= frame.worldMatrices.size())
+        return nullptr;
+
+      return &frame.worldMatrices[slot];
+    }
+
+    /**********************************************************************************************//**
+     * \fn  XMMATRIX const* Engine ::frameNormalMatrix(FramePacket const&frame, uint64_t const&objectId)
+     *
+     * \brief Normal matrix of an object as captured into a frame packet, see WorldMatrix.
+     *
+     * \return  nullptr if the object is no entity with a transform.
+     **************************************************************************************************/
+    XMMATRIX const* Engine
+      ::frameNormalMatrix(
+        FramePacket const&frame,
+        uint64_t    const&objectId)
+    {
+      XMMATRIX const*world = frameWorldMatrix(frame, objectId);
+      if(!world || frame.normalMatrices.size() != frame.worldMatrices.size())
+        return nullptr;
+
+      return &frame.normalMatrices[world - frame.worldMatrices.data()];
+    }
+
+    /**********************************************************************************************//**
+     * \fn  void Engine ::updateSceneBVH()
+     *
+     * \brief Brings the scene BVH to the world matrices of the frame being rendered.
+     *
+     * Item k of m_sceneBVH is the k-th entity of the MeshRef pool, as object k of the scenes
+     * render() fills, with its model space Bounds transformed into a world space box. Only
+     * entities whose world matrix changed since the last frame are updated and refitted, which
+     * for the static props and batches is none. Entities are only created by initialize(), so
+     * the tree is built once; entities without bounds stay out of it.
+     **************************************************************************************************/
+    void Engine
+      ::updateSceneBVH()
+    {
+      using SAE::Rendering::SceneBVH;
+
+      FramePacket &frame = *m_renderPacket;
+
+      SAE::ECS::ComponentPool<MeshRef> const&meshRefs = m_registry.pool<MeshRef>();
+      SAE::ECS::ComponentPool<Bounds>  const&bounds   = m_registry.pool<Bounds>();
+
+      // World boxes of items, in one batch through SAE::Math::TransformBoxes(): the box around
+      // the transformed box, centre transformed, extents by the absolute matrix. Items without
+      // bounds or transform get an empty box.
+      auto worldBoxes = [&] (uint32_t const*items, size_t count, SceneBVH::Box *outBoxes)
+      {
+        if(!count)
+          return;
+
+        SAE::Memory::FrameVector<float>    matrices(16 * count);
+        SAE::Memory::FrameVector<float>    coordinates(6 * count);
+        SAE::Memory::FrameVector<uint32_t> transformed;
+        transformed.reserve(count);
+
+        for(size_t k=0; k < count; ++k) {
+          outBoxes[k] ={ { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 0.0f } };
+
+          SAE::ECS::Entity const entity = meshRefs.entities()[items[k]];
+          Bounds           const*box    = bounds.find(entity);
+          XMMATRIX         const*world  = frameWorldMatrix(frame, entity);
+          if(!box || !world)
+            continue;
+
+          size_t const n = transformed.size();
+          XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(&matrices[16 * n]), *world);
+          coordinates[n]             = box->minimum.x;
+          coordinates[count + n]     = box->minimum.y;
+          coordinates[2 * count + n] = box->minimum.z;
+          coordinates[3 * count + n] = box->maximum.x;
+          coordinates[4 * count + n] = box->maximum.y;
+          coordinates[5 * count + n] = box->maximum.z;
+          transformed.push_back(static_cast<uint32_t>(k));
+        }
+
+        SAE::Math::BoxesSoA const boxes ={
+          &coordinates[0],         &coordinates[count],     &coordinates[2 * count],
+          &coordinates[3 * count], &coordinates[4 * count], &coordinates[5 * count] };
+        SAE::Math::TransformBoxes(matrices.data(), boxes, boxes, transformed.size());
+
+        for(size_t n=0; n < transformed.size(); ++n)
+          outBoxes[transformed[n]] ={ { boxes.minX[n], boxes.minY[n], boxes.minZ[n] }, { boxes.maxX[n], boxes.maxY[n], boxes.maxZ[n] } };
+      };
+
+      if(m_sceneBVH.itemCount() != meshRefs.size()) {
+        SAE::Memory::FrameVector<uint32_t>      items(meshRefs.size());
+        SAE::Memory::FrameVector<SceneBVH::Box> boxes(meshRefs.size());
+        m_sceneBVHWorlds.assign(meshRefs.size(), XMMatrixIdentity());
+
+        for(size_t k=0; k < meshRefs.size(); ++k) {
+          XMMATRIX const*world = frameWorldMatrix(frame, meshRefs.entities()[k]);
+          if(world)
+            m_sceneBVHWorlds[k] = *world;
+          items[k] = static_cast<uint32_t>(k);
+        }
+
+        worldBoxes(items.data(), items.size(), boxes.data());
+        m_sceneBVH.build(boxes.data(), boxes.size());
+
+        Log("Scene BVH: " << m_sceneBVH.stats().items << " objects, " << m_sceneBVH.stats().nodes << " nodes, depth " << m_sceneBVH.stats().depth << ".");
+        return;
+      }
+
+      SAE::Memory::FrameVector<uint32_t> moved;
+      for(size_t k=0; k < meshRefs.size(); ++k) {
+        XMMATRIX const*world = frameWorldMatrix(frame, meshRefs.entities()[k]);
+        if(!world || !memcmp(world, &m_sceneBVHWorlds[k], sizeof(XMMATRIX)))
+          continue;
+
+        m_sceneBVHWorlds[k] = *world;
+        moved.push_back(static_cast<uint32_t>(k));
+      }
+
+      SAE::Memory::FrameVector<SceneBVH::Box> boxes(moved.size());
+      worldBoxes(moved.data(), moved.size(), boxes.data());
+      for(size_t k=0; k < moved.size(); ++k)
+        m_sceneBVH.update(moved[k], boxes[k]);
+
+      m_sceneBVH.refit();
+    }
+
+    /**********************************************************************************************//**
+     * \fn  void Engine ::queryFrustum(XMMATRIX const&viewProjection, bool clipNear, FrameVector<uint8_t> &outVisible) const
+     *
+     * \brief Flags the objects of a view, in the order of the MeshRef pool, from the scene BVH.
+     *
+     * An object is flagged when its world space box is not entirely outside one of the view's
+     * frustum planes, or when it is not in the BVH, having no bounds: it cannot be culled.
+     *
+     * \param           viewProjection The view's matrix.
+     * \param           clipNear       False ignores the near plane.
+     * \param [out]     outVisible     One flag per object.
+     **************************************************************************************************/
+    void Engine
+      ::queryFrustum(
+        XMMATRIX                    const&viewProjection,
+        bool                              clipNear,
+        SAE::Memory::FrameVector<uint8_t> &outVisible) const
+    {
+      using SAE::Rendering::SceneBVH;
+
+      XMFLOAT4X4 matrix;
+      XMStoreFloat4x4(&matrix, viewProjection);
+
+      SceneBVH::Plane planes[6];
+      uint32_t const  planeCount = SceneBVH::FrustumPlanes(&matrix.m[0][0], clipNear, planes);
+
+      queryFrustum(planes, planeCount, outVisible);
+    }
+
+    /**********************************************************************************************//**
+     * \fn  void Engine ::queryFrustum(LightSystem::Plane const *planes, uint32_t planeCount, FrameVector<uint8_t> &outVisible) const
+     *
+     * \brief As above, with the view's planes already extracted, see SceneBVH::FrustumPlanes().
+     **************************************************************************************************/
+    void Engine
+      ::queryFrustum(
+        LightSystem::Plane          const *planes,
+        uint32_t                          planeCount,
+        SAE::Memory::FrameVector<uint8_t> &outVisible) const
+    {
+      SAE::Memory::FrameVector<uint32_t> items(m_sceneBVH.itemCount());
+      items.resize(m_sceneBVH.queryFrustum(planes, planeCount, items.data()));
+
+      outVisible.assign(m_sceneBVH.itemCount(), 0);
+      for(size_t k=0; k < outVisible.size(); ++k)
+        outVisible[k] = m_sceneBVH.contains(static_cast<uint32_t>(k)) ? 0 : 1;
+      for(uint32_t const item : items)
+        outVisible[item] = 1;
+    }
+
+    /**********************************************************************************************//**
+     * \fn  bool Engine ::raycast(FramePacket const&frame, XMVECTOR const&origin, XMVECTOR const&direction, float maxDistance, RaycastHit &outHit)
+     *
+     * \brief Casts a ray against the triangles of the scene, for picking.
+     *
+     * The scene BVH yields the objects whose box the ray enters; they are tested nearest box
+     * first, until the next box starts behind the closest hit so far. Each object's mesh BVH
+     * is traced with the ray taken into object space by the inverse world matrix, so instances
+     * share their mesh's tree and distances need no conversion. Objects whose mesh was created
+     * without a TriangleBVH are not hit.
+     *
+     * \return  True if a triangle was hit; outHit is left alone otherwise.
+     **************************************************************************************************/
+    bool Engine
+      ::raycast(
+        FramePacket const&frame,
+        XMVECTOR    const&origin,
+        XMVECTOR    const&direction,
+        float             maxDistance,
+        RaycastHit       &outHit)
+    {
+      using SAE::Rendering::TriangleBVH;
+
+      TriangleBVH::Ray ray;
+      XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(ray.origin),    origin);
+      XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(ray.direction), direction);
+      ray.maxDistance = maxDistance;
+
+      SAE::Memory::FrameVector<uint32_t> items(m_sceneBVH.itemCount());
+      SAE::Memory::FrameVector<float>    entries(m_sceneBVH.itemCount());
+      size_t const count = m_sceneBVH.queryRay(ray.origin, ray.direction, maxDistance, items.data(), entries.data());
+
+      SAE::Memory::FrameVector<uint32_t> order(count);
+      for(uint32_t k=0; k < count; ++k)
+        order[k] = k;
+      std::sort(order.begin(), order.end(), [&entries] (uint32_t lhs, uint32_t rhs) -> bool { return entries[lhs] < entries[rhs]; });
+
+      SAE::ECS::ComponentPool<MeshRef> &meshRefs = m_registry.pool<MeshRef>();
+
+      bool found = false;
+      for(uint32_t k : order) {
+        if(entries[k] > ray.maxDistance)
+          break;
+
+        uint32_t const item = items[k];
+        uint32_t const mesh = meshRefs[item].mesh;
+        if(mesh >= m_meshAssets.size() || !m_meshAssets[mesh] || !m_meshAssets[mesh]->triangleBVH())
+          continue;
+
+        SAE::ECS::Entity const entity = meshRefs.entities()[item];
+        XMMATRIX         const*world  = frameWorldMatrix(frame, entity);
+        if(!world)
+          continue;
+
+        XMVECTOR determinant;
+        XMMATRIX const inverse = XMMatrixInverse(&determinant, *world);
+        if(XMVectorGetX(determinant) == 0.0f)
+          continue;
+
+        XMFLOAT4X4 objectFromWorld;
+        XMStoreFloat4x4(&objectFromWorld, inverse);
+
+        TriangleBVH::Hit hit;
+        if(!m_meshAssets[mesh]->triangleBVH()->intersect(TriangleBVH::TransformRay(ray, &objectFromWorld.m[0][0]), hit))
+          continue;
+
+        ray.maxDistance = hit.distance;
+        outHit          ={ entity, hit.triangle, hit.distance };
+        found           = true;
+      }
+
+      return found;
+    }
+
+    /**********************************************************************************************//**
+     * \fn  bool Engine ::renderFrame(FramePacket &packet, uint32_t width, uint32_t height, RenderPassFn const&renderPass)
+     *
+     * \brief Declares the frame of a packet as a render graph, compiles and executes it.
+     *
+     * Every light face gets a tile in the shadow atlas, sized by how much of the screen the
+     * light can affect, and one depth-only pass renders into it; the main pass reads the atlas
+     * and writes its depth target and the back buffer. renderPass executes a RenderScene; the
+     * graph provides the depth targets and the atlas SRV. The schedule is logged whenever the
+     * number of passes changes.
+     *
+     * Only the packet and state owned by the render side are read, so update() and capture()
+     * of the next frame may run concurrently on another thread. Starts a frame of the calling
+     * thread's frame arena, as update() does.
+     *
+     * \return  True if it succeeds, false if it fails.
+     **************************************************************************************************/
+    bool Engine
+      ::renderFrame(
+        FramePacket       &packet,
+        uint32_t     const&width,
+        uint32_t     const&height,
+        RenderPassFn const&renderPass)
+    {
+      using namespace SAE::Rendering;
+
+      m_renderPacket = &packet;
+
+      // Scenes and scratch lists of this frame live in the frame arena of this thread; the
+      // previous frame's are gone. The workers drop theirs before their next job.
+      SAE::Memory::FrameArena::local().reset();
+      m_workerPool.beginFrame();
+      uint64_t const allocationMark = SAE::Memory::ThreadHeapAllocations();
+
+      // Culling and light assignment of this frame query the BVH.
+      updateSceneBVH();
+
+      if(packet.pickRequested) {
+        XMMATRIX   const cameraWorld = XMMatrixInverse(nullptr, packet.camera.viewMatrix());
+        RaycastHit       hit;
+        if(raycast(packet, cameraWorld.r[3], cameraWorld.r[2], 1000.0f, hit))
+          Log("Pick: entity " << hit.entity << ", triangle " << hit.triangle << " at " << hit.distance << ".");
+        else
+          Log("Pick: nothing.");
+      }
+
+      static const uint32_t shadowCubeCount           = 4;
+      static const float    directionalShadowDistance = 50.0f;
+
+      // render() binds lights 1 to 4 to the light buffer slots 0 to 3; the pool may hold fewer.
+      uint32_t const shadowLightCount = (packet.lights.size() < shadowCubeCount) ? static_cast<uint32_t>(packet.lights.size()) : shadowCubeCount;
+
+      SAE::Memory::FrameVector<ShadowAtlas::Request> shadowRequests;
+      for(uint32_t i=0; i < shadowLightCount; ++i) {
+        float const importance = shadowImportance(packet.lights, i, packet.camera);
+
+        for(uint32_t k=0; k < packet.lights.shadowViewCount(i); ++k)
+          shadowRequests.push_back({ shadowViewKey(i + 1, k), importance });
+      }
+      m_shadowAtlas.update(shadowRequests);
+
+      // Cascades snap to the texel grid of the tiles they got.
+      for(uint32_t i=0; i < shadowLightCount; ++i) {
+        if(packet.lights.type(i) != Light::Type::Directional)
+          continue;
+
+        uint32_t tileSizes[Light::CascadeCount];
+        for(uint32_t c=0; c < Light::CascadeCount; ++c)
+          tileSizes[c] = m_shadowAtlas.tile(shadowViewKey(i + 1, c)).size;
+
+        packet.lights.fitCascades(i, packet.camera.viewMatrix(), packet.camera.projectionMatrix(), directionalShadowDistance, tileSizes);
+      }
+
+      buildLightClusters(width, height);
+
+      m_frameGraph.reset();
+
+      RenderGraphTextureDesc shadowAtlasDesc ={};
+      shadowAtlasDesc.width     = m_shadowAtlas.size();
+      shadowAtlasDesc.height    = m_shadowAtlas.size();
+      shadowAtlasDesc.arraySize = 1;
+      shadowAtlasDesc.format    = RenderGraphFormat::D24S8;
+      shadowAtlasDesc.cube      = false;
+
+      RenderGraphTextureDesc depthDesc ={};
+      depthDesc.width     = width;
+      depthDesc.height    = height;
+      depthDesc.arraySize = 1;
+      depthDesc.format    = RenderGraphFormat::D24S8;
+      depthDesc.cube      = false;
+
+      RenderGraphTextureDesc backBufferDesc = depthDesc;
+      backBufferDesc.format = RenderGraphFormat::RGBA8;
+
+      RenderGraph::ResourceHandle shadowAtlas = m_frameGraph.createTexture("shadowAtlas", shadowAtlasDesc);
+      RenderGraph::ResourceHandle mainDepth   = m_frameGraph.createTexture("mainDepth",   depthDesc);
+      // The renderer binds the swap chain itself; imported for the dependency only.
+      RenderGraph::ResourceHandle backBuffer  = m_frameGraph.importTexture("backBuffer", backBufferDesc, RenderGraphTexture());
+
+      // Writers run in declaration order: the first tile's pass clears the whole atlas.
+      bool clearAtlas = true;
+      for(uint32_t i=0; i < shadowLightCount; ++i)
+        for(uint32_t k=0; k < packet.lights.shadowViewCount(i); ++k) {
+          ShadowAtlasTile const tile = m_shadowAtlas.tile(shadowViewKey(i + 1, k));
+          if(!tile.size)
+            continue;
+
+          char name[64];
+          snprintf(name, sizeof(name), "shadowMap[%u][%u] %u@%u,%u", i, k, tile.size, tile.x, tile.y);
+
+          m_frameGraph.addPass(
+            name,
+            [&] (RenderGraph::Builder &builder) -> void
+          {
+            builder.writeDepthStencil(shadowAtlas);
+          },
+            [=, &renderPass] (RenderGraph::Context const&context) -> void
+          {
+            RenderScene scene ={};
+            render(PassType::ShadowMap, scene, i, k);
+            scene.renderTargetId  = context.texture(shadowAtlas).depthStencilViewIds[0];
+            scene.viewport        ={ float(tile.x), float(tile.y), float(tile.size), float(tile.size) };
+            scene.preserveDepth   = !clearAtlas;
+
+            renderPass(scene, PassType::ShadowMap);
+          });
+
+          clearAtlas = false;
+        }
+
+      m_frameGraph.addPass(
+        "main",
+        [&] (RenderGraph::Builder &builder) -> void
+      {
+        builder.read(shadowAtlas);
+        builder.writeDepthStencil(mainDepth);
+        builder.writeRenderTarget(backBuffer);
+      },
+        [=, &renderPass] (RenderGraph::Context const&context) -> void
+      {
+        RenderScene scene ={};
+        render(PassType::Main, scene);
+        scene.renderTargetId        = context.texture(mainDepth).depthStencilViewIds[0];
+        scene.shadowMapTextureSRVId = context.texture(shadowAtlas).shaderResourceViewId;
+
+        renderPass(scene, PassType::Main);
+      });
+
+      bool const compiled = m_frameGraph.compile();
+      if(!compiled || m_frameGraph.stats().passes != m_frameGraphPassCount) {
+        std::stringstream schedule;
+        m_frameGraph.describe(schedule);
+        Log(schedule.str());
+
+        m_frameGraphPassCount = m_frameGraph.stats().passes;
+      }
+
+      if(compiled)
+        m_frameGraph.execute();
+
+      m_renderPacket = nullptr;
+
+      checkFrameAllocations("renderFrame", packet.frameIndex, allocationMark);
+
+      return compiled;
+    }
+
+    /**********************************************************************************************//**
+     * \fn  float Engine ::shadowImportance(LightSystem const&lights, uint32_t light, Camera &camera)
+     *
+     * \brief Share of the screen a light can affect, as the importance of its shadow atlas tiles.
+     *
+     * The light's sphere of influence projected with the frame's camera, relative to half the
+     * screen height: 1 with the camera inside it, 0 when it lies entirely behind the camera or
+     * the scene BVH has no object within it, nothing to cast or receive a shadow. Directional
+     * lights affect the whole screen.
+     *
+     * \return  Importance in [0, 1].
+     **************************************************************************************************/
+    float Engine
+      ::shadowImportance(LightSystem const&lights, uint32_t light, Camera &camera)
+    {
+      if(lights.type(light) == Light::Type::Directional)
+        return 1.0f;
+
+      float const range = lights.range(light);
+
+      XMFLOAT3 position;
+      XMStoreFloat3(&position, lights.position(light));
+
+      float const center[3] ={ position.x, position.y, position.z };
+      if(!m_sceneBVH.overlapsSphere(center, range))
+        return 0.0f;
+
+      XMVECTOR const toLight  = XMVectorSubtract(lights.position(light), camera.transform().getTranslation());
+      float    const distance = XMVectorGetX(XMVector3Length(toLight));
+      if(distance <= range)
+        return 1.0f;
+
+      XMVECTOR const viewDirection = XMVector3Normalize(camera.transform().getDirection());
+      if(XMVectorGetX(XMVector3Dot(toLight, viewDirection)) < -range)
+        return 0.0f;
+
+      // projection._22 is cot(fovY / 2).
+      float const projectedRadius = (range * XMVectorGetY(camera.projectionMatrix().r[1])) / distance;
+      return (projectedRadius < 1.0f) ? projectedRadius : 1.0f;
+    }
+
+    /**********************************************************************************************//**
+     * \fn  void Engine ::buildLightClusters(uint32_t const&width, uint32_t const&height)
+     *
+     * \brief Collects this frame's lights into the cluster light list and assigns them to clusters.
+     *
+     * The shadowed lights 1 to 4 come first and keep their light buffer slot as shadowIndex,
+     * followed by the dynamic lights. Clusters start at clusterNearPlane rather than the
+     * camera's near plane, so that the exponential slices are not spent on the first metre;
+     * closer fragments use the first slice. Lights whose range reaches no object in the scene
+     * BVH light nothing and are left out.
+     *
+     * \param  width   Width of the main pass target in pixels.
+     * \param  height  Height of the main pass target in pixels.
+     **************************************************************************************************/
+    void Engine
+      ::buildLightClusters(
+        uint32_t const&width,
+        uint32_t const&height)
+    {
+      using SAE::Rendering::LightClusters;
+
+      static const float clusterNearPlane = 1.0f;
+
+      FramePacket    &frame      = *m_renderPacket;
+      XMMATRIX const&view       = frame.camera.viewMatrix();
+      XMMATRIX const&projection = frame.camera.projectionMatrix();
+
+      m_clusterLights.clear();
+      m_clusterSpheres.clear();
+
+      auto addLight = [&] (ClusterLight_t const&record, float const&radius) -> void
+      {
+        if(m_clusterLights.size() >= MaxClusterLights)
+          return;
+
+        float const worldCenter[3] ={ record.position.x, record.position.y, record.position.z };
+        if(radius < std::numeric_limits<float>::infinity() && !m_sceneBVH.overlapsSphere(worldCenter, radius))
+          return;
+
+        XMVECTOR const center = XMVector3TransformCoord(XMLoadFloat3(&record.position), view);
+
+        LightClusters::LightSphere sphere ={ XMVectorGetX(center), XMVectorGetY(center), XMVectorGetZ(center), radius };
+        m_clusterSpheres.push_back(sphere);
+        m_clusterLights.push_back(record);
+      };
+
+      // render() binds lights 1 to 4 to the light buffer slots 0 to 3; the pool may hold fewer.
+      uint32_t const lightCount = (frame.lights.size() < 4) ? static_cast<uint32_t>(frame.lights.size()) : 4;
+      for(uint32_t i=0; i < lightCount; ++i) {
+        Light::Properties const&properties = frame.lights.properties(i);
+        if(!(properties.intensity > 0.0f))
+          continue;
+
+        ClusterLight_t record ={};
+        XMStoreFloat3(&record.position,  frame.lights.position(i));
+        XMStoreFloat3(&record.color,     properties.color);
+        XMStoreFloat3(&record.direction, frame.lights.direction(i));
+        record.range       = frame.lights.range(i);
+        record.intensity   = properties.intensity;
+        record.shadowIndex = static_cast<int32_t>(i);
+        record.type        = ShaderLightType(properties.type);
+        record.cosHotSpot  = 1.0f;
+        record.cosFalloff  = 0.0f;
+        if(properties.type == Light::Type::Spot) {
+          record.cosHotSpot = std::cos(properties.specificProperties.Spot.hotSpotAngle);
+          record.cosFalloff = std::cos(properties.specificProperties.Spot.falloffAngle);
+        }
+
+        bool const directional = (properties.type == Light::Type::Directional);
+        addLight(record, (directional ? std::numeric_limits<float>::infinity() : record.range));
+      }
+
+      for(DynamicLight const&dynamicLight : frame.dynamicLights) {
+        ClusterLight_t record ={};
+        record.position    = dynamicLight.position;
+        record.color       = dynamicLight.color;
+        record.direction   = XMFLOAT3(0.0f, -1.0f, 0.0f);
+        record.range       = dynamicLight.range;
+        record.intensity   = dynamicLight.intensity;
+        record.shadowIndex = -1;
+        record.type        = 1;
+        record.cosHotSpot  = 1.0f;
+        record.cosFalloff  = 0.0f;
+
+        addLight(record, record.range);
+      }
+
+      // A perspective projection stores z * far / (far - near) - near * far / (far - near) in z.
+      float const m33       = XMVectorGetZ(projection.r[2]);
+      float const m43       = XMVectorGetZ(projection.r[3]);
+      float const nearPlane = -m43 / m33;
+      float const farPlane  = m43 / (1.0f - m33);
+
+      m_lightClusters.setProjection(
+        XMVectorGetX(projection.r[0]),
+        XMVectorGetY(projection.r[1]),
+        (nearPlane > clusterNearPlane ? nearPlane : clusterNearPlane),
+        farPlane);
+      m_lightClusters.build(m_clusterSpheres);
+
+      m_clusterConstants.gridX      = m_lightClusters.gridX();
+      m_clusterConstants.gridY      = m_lightClusters.gridY();
+      m_clusterConstants.gridZ      = m_lightClusters.gridZ();
+      m_clusterConstants.lightCount = static_cast<uint32_t>(m_clusterLights.size());
+      m_clusterConstants.tileScaleX = (width  ? (float(m_lightClusters.gridX()) / width)  : 0.0f);
+      m_clusterConstants.tileScaleY = (height ? (float(m_lightClusters.gridY()) / height) : 0.0f);
+      m_clusterConstants.depthScale = m_lightClusters.depthScale();
+      m_clusterConstants.depthBias  = m_lightClusters.depthBias();
+    }
+
+    /**********************************************************************************************//**
+     * \fn  void Engine ::cullShadowCasters(RenderScene &sceneHolder, uint32_t light, uint64_t const&view)
+     *
+     * \brief Removes objects that cannot cast into one shadow view of a light from its pass.
+     *
+     * An object is culled when all corners of its world space bounding box lie outside the same
+     * plane of the view's frustum. The near plane of directional cascades is ignored: casters
+     * between the light and the cascade still cast, their depth is clamped. Only the objects
+     * the scene BVH finds in the frustum are tested; the scene still holds the objects of the
+     * MeshRef pool in pool order, as render() put them. The BVH query uses the planes the
+     * frame's LightSystem keeps with the view.
+     *
+     * \param [in,out]  sceneHolder The shadow pass scene; objects are filtered in place.
+     * \param           light       The light the pass renders for, in the frame's LightSystem.
+     * \param           view        Cube face, spot view or cascade.
+     **************************************************************************************************/
+    void Engine
+      ::cullShadowCasters(
+        RenderScene    &sceneHolder,
+        uint32_t        light,
+        uint64_t  const&view)
+    {
+      FramePacket &frame = *m_renderPacket;
+
+      XMMATRIX const viewProjection = frame.lights.viewProjectionMatrix(light, view);
+      bool     const clipNear       = (frame.lights.type(light) != Light::Type::Directional);
+
+      SAE::ECS::ComponentPool<Bounds> const&bounds = m_registry.pool<Bounds>();
+
+      SAE::Memory::FrameVector<uint8_t> isCaster;
+      queryFrustum(frame.lights.frustumPlanes(light, view), frame.lights.frustumPlaneCount(light), isCaster);
+      isCaster.resize(sceneHolder.objects.size(), 1);
+
+      SAE::Memory::FrameVector<uint32_t> candidates;
+      for(size_t o=0; o < sceneHolder.objects.size(); ++o)
+        if(isCaster[o] && m_sceneBVH.contains(static_cast<uint32_t>(o)))
+          candidates.push_back(static_cast<uint32_t>(o));
+
+      // Candidates are tested in parallel; the survivors keep their order.
+      m_workerPool.parallelFor(candidates.size(), 64, [&] (size_t begin, size_t end)
+      {
+        for(size_t c=begin; c < end; ++c) {
+          size_t       const o      = candidates[c];
+          RenderObject const&object = sceneHolder.objects[o];
+
+          Bounds   const*box   = bounds.find(static_cast<SAE::ECS::Entity>(object.objectId));
+          XMMATRIX const*world = frameWorldMatrix(frame, object.objectId);
+          if(!box || !world)
+            continue;
+
+          XMMATRIX const modelToClip = XMMatrixMultiply(*world, viewProjection);
+
+          // Bit per frustum plane, set while every corner so far is outside of it.
+          uint32_t outside = 0x3F;
+          for(uint32_t k=0; k < 8 && outside; ++k) {
+            XMVECTOR const corner = XMVectorSet(
+              (k & 1) ? box->maximum.x : box->minimum.x,
+              (k & 2) ? box->maximum.y : box->minimum.y,
+              (k & 4) ? box->maximum.z : box->minimum.z,
+              1.0f);
+            XMVECTOR const clip = XMVector4Transform(corner, modelToClip);
+
+            float const x = XMVectorGetX(clip);
+            float const y = XMVectorGetY(clip);
+            float const z = XMVectorGetZ(clip);
+            float const w = XMVectorGetW(clip);
+
+            uint32_t planes = 0;
+            planes |= (x < -w) ? 0x01 : 0;
+            planes |= (x >  w) ? 0x02 : 0;
+            planes |= (y < -w) ? 0x04 : 0;
+            planes |= (y >  w) ? 0x08 : 0;
+            planes |= (z >  w) ? 0x10 : 0;
+            planes |= (clipNear && z < 0.0f) ? 0x20 : 0;
+            outside &= planes;
+          }
+
+          isCaster[o] = outside ? 0 : 1;
+        }
+      });
+
+      size_t casters = 0;
+      for(size_t o=0; o < sceneHolder.objects.size(); ++o)
+        if(isCaster[o])
+          sceneHolder.objects[casters++] = sceneHolder.objects[o];
+
+      sceneHolder.objects.resize(casters);
+    }
+
+    /**********************************************************************************************//**
+     * \fn  void Engine ::buildStaticBatches(std::shared_ptr<DirectX11ResourceManager> &resourceManager)
+     *
+     * \brief Scatters static props around the floor and merges them into one mesh per cell.
+     *
+     * Benchmark scenery, built only with SAE_BENCHMARK_STATIC_BATCHES.
+     *
+     * The props never move and all use the standard material, so StaticBatcher pre-transforms
+     * them into world space and every cell of props becomes a single mesh with an identity
+     * transform. Culling tests the batch's world space bounds like any other object's, and a
+     * visible batch costs one draw instead of one per prop.
+     **************************************************************************************************/
+    void Engine
+      ::buildStaticBatches(std::shared_ptr<DirectX11ResourceManager> &resourceManager)
+    {
+      using SAE::Rendering::StaticBatcher;
+      using MeshData = SAE::Engine::Mesh<XMVECTOR>;
+
+      static_assert(sizeof(StaticBatcher::Vertex) == sizeof(MeshData::Vertex_t), "StaticBatcher::Vertex mirrors the mesh vertex layout.");
+
+      static const uint64_t standardMaterial = 0;
+      static const uint32_t propCount        = 384;
+
+      struct {
+        const char *filename;
+        float       scale;      // to props about 0.3 units across
+        float       lift;       // rests the scaled prop on the ground
+      } propMeshes[] ={
+        { "resources/meshes/Cube.obj",           0.15f,   0.15f },
+        { "resources/meshes/regular_sphere.obj", 0.008f,  0.16f },
+      };
+      uint32_t const propMeshCount = sizeof(propMeshes) / sizeof(propMeshes[0]);
+
+      MeshData::VertexBuffer_t vertices[propMeshCount];
+      MeshData::IndexBuffer_t  indices[propMeshCount];
+      for(uint32_t k=0; k < propMeshCount; ++k) {
+        uint64_t vertexCount = 0;
+        uint64_t indexCount  = 0;
+        if(!MeshData::LoadMeshAssimp(propMeshes[k].filename, vertices[k], vertexCount, indices[k], indexCount))
+          Log("Failed to load prop mesh " << propMeshes[k].filename << "\n");
+      }
+
+      StaticBatcher batcher;
+      batcher.initialize();
+
+      // A ring around the rotating floor, between 16 and 30 units from its centre.
+      for(uint32_t k=0; k < propCount; ++k) {
+        uint32_t const mesh   = k % propMeshCount;
+        float    const spread = (k * 0.618034f) - std::floor(k * 0.618034f);
+        float    const angle  = 2.39996f * k; // golden angle
+        float    const radius = 16.0f + 14.0f * spread;
+        float    const scale  = 0.7f + 0.6f * ((k * 0.414214f) - std::floor(k * 0.414214f));
+
+        XMFLOAT4X4 world;
+        XMStoreFloat4x4(&world,
+          XMMatrixMultiply(
+            XMMatrixMultiply(
+              XMMatrixScaling(propMeshes[mesh].scale * scale, propMeshes[mesh].scale * scale, propMeshes[mesh].scale * scale),
+              XMMatrixRotationY(angle)),
+            XMMatrixTranslation(radius * std::cos(angle), propMeshes[mesh].lift * scale, 20.0f + radius * std::sin(angle))));
+
+        if(!batcher.add(
+             standardMaterial,
+             reinterpret_cast<StaticBatcher::Vertex const*>(vertices[mesh].data()),
+             vertices[mesh].size(),
+             indices[mesh].data(),
+             indices[mesh].size(),
+             &world.m[0][0]))
+        {
+          // Dropped: empty meshes are ignored from now on.
+          Log("Prop mesh " << propMeshes[mesh].filename << " has indices out of range, not batched.\n");
+          vertices[mesh].clear();
+          indices[mesh].clear();
+        }
+      }
+
+      m_staticBatches.clear();
+      for(StaticBatcher::Batch const&batch : batcher.batches()) {
+        MeshData::VertexBuffer_t batchVertices(batch.vertices.size());
+        memcpy(batchVertices.data(), batch.vertices.data(), sizeof(StaticBatcher::Vertex) * batch.vertices.size());
+
+        uint32_t const mesh = addMesh(SAE::DirectX11::DirectX11Mesh::createFromData(resourceManager, batchVertices, batch.indices, true));
+        m_staticBatches.push_back(createObject(mesh, DX11Transform()));
+      }
+
+      StaticBatcher::Stats const&stats = batcher.stats();
+      Log("Static batching: " << stats.instances << " props in " << stats.batches << " draws, "
+          << stats.vertices << " vertices, " << stats.indices << " indices, " << stats.buildMs << "ms\n");
+    }
+
+    /**********************************************************************************************//**
+     * \fn  bool Engine ::loadOccluderMesh(std::string const&filename, uint64_t objectId, OccluderMesh &outOccluder)
+     *
+     * \brief Loads the positions and indices of an occluder mesh standing in for objectId.
+     *
+     * \return  True if it succeeds, false if it fails.
+     **************************************************************************************************/
+    bool Engine
+      ::loadOccluderMesh(
+        std::string const&filename,
+        uint64_t          objectId,
+        OccluderMesh     &outOccluder)
+    {
+      SAE::Engine::Mesh<XMVECTOR>::VertexBuffer_t vertices;
+      SAE::Engine::Mesh<XMVECTOR>::IndexBuffer_t  indices;
+      uint64_t vertexCount = 0;
+      uint64_t indexCount  = 0;
+
+      if(!SAE::Engine::Mesh<XMVECTOR>::LoadMeshAssimp(filename.c_str(), vertices, vertexCount, indices, indexCount))
+        return false;
+
+      outOccluder.objectId = objectId;
+      outOccluder.positions.clear();
+      outOccluder.positions.reserve(vertices.size() * 3);
+      for(auto const&vertex : vertices) {
+        outOccluder.positions.push_back(VEC_X(vertex.position));
+        outOccluder.positions.push_back(VEC_Y(vertex.position));
+        outOccluder.positions.push_back(VEC_Z(vertex.position));
+      }
+      outOccluder.indices = indices;
+
       return true;
     }
 
+    /**********************************************************************************************//**
+     * \fn  void Engine ::cullOccludedObjects(RenderScene &sceneHolder)
+     *
+     * \brief Removes objects hidden behind the occluders or outside the view from the main pass.
+     *
+     * Rasterizes m_occluders from the frame's camera into the occlusion buffer and tests the
+     * world space bounding box of every other object the scene BVH finds in the view frustum
+     * against it; the rest are culled without a test. World matrices come from the frame
+     * packet, as the object buffer updates of the pass read them.
+     *
+     * \param [in,out]  sceneHolder The main pass scene; objects are filtered in place.
+     **************************************************************************************************/
+    void Engine
+      ::cullOccludedObjects(RenderScene &sceneHolder)
+    {
+      using SAE::Rendering::MaskedOcclusionCulling;
+
+      FramePacket &frame = *m_renderPacket;
+
+      XMMATRIX   viewProjection = XMMatrixMultiply(frame.camera.viewMatrix(), frame.camera.projectionMatrix());
+      XMFLOAT4X4 modelToClip;
+
+      m_occlusionCulling.clear();
+      for(OccluderMesh const&occluder : m_occluders) {
+        XMMATRIX const*world = frameWorldMatrix(frame, occluder.objectId);
+        if(!world)
+          continue;
+
+        XMStoreFloat4x4(&modelToClip, XMMatrixMultiply(*world, viewProjection));
+        m_occlusionCulling.addOccluder(
+          occluder.positions.data(),
+          3 * sizeof(float),
+          occluder.positions.size() / 3,
+          occluder.indices.data(),
+          occluder.indices.size(),
+          &modelToClip.m[0][0]);
+      }
+      m_occlusionCulling.flush();
+
+      // Objects in the view are tested in parallel, testAABB() is const; the visible ones keep
+      // their order.
+      SAE::ECS::ComponentPool<Bounds> const&bounds = m_registry.pool<Bounds>();
+
+      SAE::Memory::FrameVector<uint8_t> isVisible;
+      queryFrustum(viewProjection, true, isVisible);
+      isVisible.resize(sceneHolder.objects.size(), 1);
+
+      SAE::Memory::FrameVector<uint32_t> candidates;
+      for(size_t o=0; o < sceneHolder.objects.size(); ++o)
+        if(isVisible[o])
+          candidates.push_back(static_cast<uint32_t>(o));
+
+      m_workerPool.parallelFor(candidates.size(), 64, [&] (size_t begin, size_t end)
+      {
+        XMFLOAT4X4 objectToClip;
+
+        for(size_t c=begin; c < end; ++c) {
+          size_t       const o      = candidates[c];
+          RenderObject const&object = sceneHolder.objects[o];
+
+          bool isOccluder = false;
+          for(OccluderMesh const&occluder : m_occluders)
+            isOccluder |= (occluder.objectId == object.objectId);
+
+          Bounds   const*box   = bounds.find(static_cast<SAE::ECS::Entity>(object.objectId));
+          XMMATRIX const*world = frameWorldMatrix(frame, object.objectId);
+          if(isOccluder || !box || !world)
+            continue;
+
+          XMStoreFloat4x4(&objectToClip, XMMatrixMultiply(*world, viewProjection));
+
+          float minimum[3] ={ box->minimum.x, box->minimum.y, box->minimum.z };
+          float maximum[3] ={ box->maximum.x, box->maximum.y, box->maximum.z };
+
+          isVisible[o] = (m_occlusionCulling.testAABB(minimum, maximum, &objectToClip.m[0][0]) == MaskedOcclusionCulling::Result::Visible) ? 1 : 0;
+        }
+      });
+
+      size_t visibleObjects = 0;
+      for(size_t o=0; o < sceneHolder.objects.size(); ++o)
+        if(isVisible[o])
+          sceneHolder.objects[visibleObjects++] = sceneHolder.objects[o];
+
+      sceneHolder.objects.resize(visibleObjects);
+    }
+
     /**********************************************************************************************//**
      * \fn  bool Engine ::deinitialize()
      *
@@ -537,6 +1968,19 @@ namespace SAE {
     {
       m_defaultCamera.deinitialize();
 
+      if(m_textureDecodeService)
+        m_textureDecodeService->deinitialize();
+
+      m_frameGraph.deinitialize();
+      m_frameGraphAllocator = nullptr;
+      m_shadowAtlas.deinitialize();
+
+      m_lightClusters.deinitialize();
+      m_occlusionCulling.deinitialize();
+      m_sceneBVH.clear();
+      m_sceneBVHWorlds.clear();
+      m_workerPool.deinitialize();
+
       return true;
     }
 
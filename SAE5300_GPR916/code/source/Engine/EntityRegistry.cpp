@@ -0,0 +1,187 @@
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <map>
+
+#include "Engine/EntityRegistry.h"
+
+namespace SAE {
+  namespace ECS {
+
+    uint32_t NextComponentType()
+    {
+      static std::atomic<uint32_t> next(0);
+      return next.fetch_add(1);
+    }
+
+    Registry::Registry()
+      : m_generations(1, 0)
+      , m_free()
+      , m_pools()
+    {}
+
+    Entity Registry
+      ::create()
+    {
+      uint32_t index = 0;
+      if(!m_free.empty()) {
+        index = m_free.back();
+        m_free.pop_back();
+      }
+      else {
+        index = static_cast<uint32_t>(m_generations.size());
+        if(index > EntityMask)
+          return NullEntity;
+
+        m_generations.push_back(0);
+      }
+
+      return (uint32_t(m_generations[index]) << EntityBits) | index;
+    }
+
+    bool Registry
+      ::destroy(Entity entity)
+    {
+      if(!alive(entity))
+        return false;
+
+      for(std::unique_ptr<ComponentPoolBase> &pool : m_pools)
+        if(pool)
+          pool->remove(entity);
+
+      uint32_t const index = EntityIndex(entity);
+      ++m_generations[index];
+      m_free.push_back(index);
+      return true;
+    }
+
+    bool Registry
+      ::alive(Entity entity) const
+    {
+      uint32_t const index = EntityIndex(entity);
+      if(!index || index >= m_generations.size())
+        return false;
+
+      return (m_generations[index] == EntityGeneration(entity));
+    }
+
+    void Registry
+      ::clear()
+    {
+      m_pools.clear();
+      m_free.clear();
+      m_generations.assign(1, 0);
+    }
+
+    namespace {
+
+      typedef std::chrono::high_resolution_clock Clock;
+
+      struct BenchmarkPosition {
+        float x, y, z;
+        float radius;
+      };
+
+      struct BenchmarkVelocity {
+        float x, y, z;
+      };
+
+      static double ElapsedMs(Clock::time_point const&start)
+      {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+      }
+
+    }
+
+    EntityBenchmarkResult BenchmarkEntityIteration(size_t entityCount, uint32_t iterations)
+    {
+      EntityBenchmarkResult result ={};
+      result.entityCount = entityCount;
+
+      uint32_t seed = 0x2545F491u;
+      auto random = [&seed] () -> float
+      {
+        seed = seed * 1664525u + 1013904223u;
+        return float(seed >> 8) / float(1u << 24);
+      };
+
+      std::map<uint64_t, std::shared_ptr<BenchmarkPosition>> positionMap;
+      std::map<uint64_t, std::shared_ptr<BenchmarkVelocity>> velocityMap;
+      Registry registry;
+
+      for(size_t k=0; k < entityCount; ++k) {
+        BenchmarkPosition const position ={ 1000.0f * random(), 1000.0f * random(), 1000.0f * random(), 0.5f + random() };
+        BenchmarkVelocity const velocity ={ random() - 0.5f, random() - 0.5f, random() - 0.5f };
+
+        Entity const entity = registry.create();
+        registry.add<BenchmarkPosition>(entity, position);
+        positionMap[entity] = std::make_shared<BenchmarkPosition>(position);
+
+        if(k % 2) {
+          registry.add<BenchmarkVelocity>(entity, velocity);
+          velocityMap[entity] = std::make_shared<BenchmarkVelocity>(velocity);
+        }
+      }
+
+      // Integrate the moving entities, then count everything inside a sphere: one update and
+      // one query pass, as a frame of the engine does.
+      float const center[3] ={ 500.0f, 500.0f, 500.0f };
+      float const radius    = 300.0f;
+
+      auto inside = [&] (BenchmarkPosition const&position) -> bool
+      {
+        float const dx = position.x - center[0];
+        float const dy = position.y - center[1];
+        float const dz = position.z - center[2];
+        float const r  = radius + position.radius;
+        return (dx * dx + dy * dy + dz * dz) <= (r * r);
+      };
+
+      size_t mapInside = 0;
+      Clock::time_point start = Clock::now();
+      for(uint32_t i=0; i < iterations; ++i) {
+        for(std::map<uint64_t, std::shared_ptr<BenchmarkVelocity>>::value_type const&velocity : velocityMap) {
+          BenchmarkPosition &position = *positionMap.at(velocity.first);
+          position.x += velocity.second->x;
+          position.y += velocity.second->y;
+          position.z += velocity.second->z;
+        }
+
+        mapInside = 0;
+        for(std::map<uint64_t, std::shared_ptr<BenchmarkPosition>>::value_type const&position : positionMap)
+          mapInside += inside(*position.second) ? 1 : 0;
+      }
+      result.mapMs = ElapsedMs(start);
+
+      size_t registryInside = 0;
+      start = Clock::now();
+      for(uint32_t i=0; i < iterations; ++i) {
+        registry.each<BenchmarkVelocity, BenchmarkPosition>(
+          [] (Entity, BenchmarkVelocity const&velocity, BenchmarkPosition &position) -> void
+        {
+          position.x += velocity.x;
+          position.y += velocity.y;
+          position.z += velocity.z;
+        });
+
+        ComponentPool<BenchmarkPosition> const&positions = registry.pool<BenchmarkPosition>();
+        registryInside = 0;
+        for(size_t k=0; k < positions.size(); ++k)
+          registryInside += inside(positions[k]) ? 1 : 0;
+      }
+      result.registryMs = ElapsedMs(start);
+
+      result.speedup = (result.registryMs > 0.0) ? (result.mapMs / result.registryMs) : 0.0;
+      result.valid   = (mapInside == registryInside);
+      for(size_t k=0; k < registry.pool<BenchmarkPosition>().size() && result.valid; ++k) {
+        Entity            const entity   = registry.pool<BenchmarkPosition>().entities()[k];
+        BenchmarkPosition const&position = registry.pool<BenchmarkPosition>()[k];
+        BenchmarkPosition const&expected = *positionMap.at(entity);
+        result.valid = (position.x == expected.x && position.y == expected.y && position.z == expected.z);
+      }
+
+      return result;
+    }
+
+  }
+}
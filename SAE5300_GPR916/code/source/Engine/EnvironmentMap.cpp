@@ -0,0 +1,636 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+  #define SAE_ENVIRONMENT_SSE2 1
+  #include <emmintrin.h>
+#else
+  #define SAE_ENVIRONMENT_SSE2 0
+#endif
+
+#include "Engine/EnvironmentMap.h"
+#include "Engine/PixelConversion.h"
+
+namespace SAE {
+  namespace Texture {
+
+    static const float s_pi = 3.14159265358979f;
+
+    std::vector<std::string> CubeMapFaceFilenames(
+      std::string const&directory,
+      std::string const&prefix,
+      std::string const&extension)
+    {
+      static const char *suffixes[CubeFaceCount] ={ "_rt", "_lf", "_up", "_dn", "_ft", "_bk" };
+
+      std::vector<std::string> filenames;
+      for(unsigned int k=0; k < CubeFaceCount; ++k)
+        filenames.push_back(directory + prefix + suffixes[k] + extension);
+      return filenames;
+    }
+
+    //
+    // Cube geometry
+    //
+
+    // Direction through face coordinates (u, v) in [-1, 1], v pointing down the face.
+    // Every component is linear in u for a fixed row: dir = a * u + b.
+    static void FaceRowBasis(unsigned int face, float v, float a[3], float b[3])
+    {
+      switch(face) {
+      case CubeFacePositiveX: a[0] =  0; a[1] = 0; a[2] = -1; b[0] =  1; b[1] = -v; b[2] =  0; break;
+      case CubeFaceNegativeX: a[0] =  0; a[1] = 0; a[2] =  1; b[0] = -1; b[1] = -v; b[2] =  0; break;
+      case CubeFacePositiveY: a[0] =  1; a[1] = 0; a[2] =  0; b[0] =  0; b[1] =  1; b[2] =  v; break;
+      case CubeFaceNegativeY: a[0] =  1; a[1] = 0; a[2] =  0; b[0] =  0; b[1] = -1; b[2] = -v; break;
+      case CubeFacePositiveZ: a[0] =  1; a[1] = 0; a[2] =  0; b[0] =  0; b[1] = -v; b[2] =  1; break;
+      default:                a[0] = -1; a[1] = 0; a[2] =  0; b[0] =  0; b[1] = -v; b[2] = -1; break;
+      }
+    }
+
+    static void DirectionToFace(float x, float y, float z, unsigned int &face, float &u, float &v)
+    {
+      float ax = std::fabs(x), ay = std::fabs(y), az = std::fabs(z);
+      if(ax >= ay && ax >= az) {
+        face = (x > 0.0f) ? CubeFacePositiveX : CubeFaceNegativeX;
+        u    = ((x > 0.0f) ? -z : z) / ax;
+        v    = -y / ax;
+      }
+      else if(ay >= az) {
+        face = (y > 0.0f) ? CubeFacePositiveY : CubeFaceNegativeY;
+        u    = x / ay;
+        v    = ((y > 0.0f) ? z : -z) / ay;
+      }
+      else {
+        face = (z > 0.0f) ? CubeFacePositiveZ : CubeFaceNegativeZ;
+        u    = ((z > 0.0f) ? x : -x) / az;
+        v    = -y / az;
+      }
+    }
+
+    static bool ValidateCube(Texture2DDescriptor const&cube)
+    {
+      if(cube.depth != CubeFaceCount || cube.width == 0 || cube.width != cube.height || cube.inData.size() != CubeFaceCount)
+        return false;
+      for(std::vector<Byte> const&face : cube.inData)
+        if(face.size() < (size_t)cube.width * cube.height * 4)
+          return false;
+      return true;
+    }
+
+    static unsigned int ResolveThreadCount(unsigned int requested)
+    {
+      if(requested)
+        return requested;
+      unsigned int hw = std::thread::hardware_concurrency();
+      return hw ? hw : 1;
+    }
+
+    // Splits [0, rows) into contiguous chunks, one per thread; fn(begin, end, threadIndex).
+    template <typename TFn>
+    static void ParallelRows(unsigned int rows, unsigned int threads, TFn const&fn)
+    {
+      threads = std::max(1u, std::min(threads, rows));
+
+      std::vector<std::thread> workers;
+      for(unsigned int t=1; t < threads; ++t)
+        workers.push_back(std::thread(fn, (rows * t) / threads, (rows * (t + 1)) / threads, t));
+      fn(0u, rows / threads, 0u);
+
+      for(std::thread &worker : workers)
+        worker.join();
+    }
+
+    //
+    // SH projection
+    //
+
+    // acc: 9 coefficients x RGB, then the total solid-angle weight.
+    static const unsigned int s_shAccumulators = 28;
+
+    static void ProjectTexelsScalar(
+      float const  a[3],
+      float const  b[3],
+      float        v,
+      unsigned int size,
+      unsigned int begin,
+      const float *linear,
+      double      *acc)
+    {
+      for(unsigned int x=begin; x < size; ++x) {
+        float u  = (2.0f * (x + 0.5f) / size) - 1.0f;
+        float il = 1.0f / std::sqrt(1.0f + u * u + v * v);
+        float w  = il * il * il; // solid angle, up to the constant (2 / size)^2
+
+        float dx = (a[0] * u + b[0]) * il;
+        float dy = (a[1] * u + b[1]) * il;
+        float dz = (a[2] * u + b[2]) * il;
+        float p[9] ={ 1.0f, dy, dz, dx, dx * dy, dy * dz, 3.0f * dz * dz - 1.0f, dx * dz, dx * dx - dy * dy };
+
+        const float *c = linear + x * 4;
+        for(int i=0; i < 9; ++i) {
+          float pw = p[i] * w;
+          acc[i * 3 + 0] += pw * c[0];
+          acc[i * 3 + 1] += pw * c[1];
+          acc[i * 3 + 2] += pw * c[2];
+        }
+        acc[27] += w;
+      }
+    }
+
+    static void ProjectRow(
+      unsigned int face,
+      unsigned int y,
+      unsigned int size,
+      const float *linear,
+      double      *acc)
+    {
+      float v = (2.0f * (y + 0.5f) / size) - 1.0f;
+      float a[3], b[3];
+      FaceRowBasis(face, v, a, b);
+
+      unsigned int x = 0;
+#if SAE_ENVIRONMENT_SSE2
+      // Four texels per step, structure-of-arrays; row sums are folded into doubles at the end.
+      __m128 sum[s_shAccumulators];
+      for(unsigned int i=0; i < s_shAccumulators; ++i)
+        sum[i] = _mm_setzero_ps();
+
+      const __m128 one   = _mm_set1_ps(1.0f);
+      const __m128 three = _mm_set1_ps(3.0f);
+      const __m128 v2    = _mm_set1_ps(v * v);
+      const __m128 ax = _mm_set1_ps(a[0]), ay = _mm_set1_ps(a[1]), az = _mm_set1_ps(a[2]);
+      const __m128 bx = _mm_set1_ps(b[0]), by = _mm_set1_ps(b[1]), bz = _mm_set1_ps(b[2]);
+      const __m128 step   = _mm_set1_ps(2.0f / size);
+      const __m128 offset = _mm_set1_ps(1.0f / size - 1.0f);
+
+      for(; x + 4 <= size; x += 4) {
+        __m128 xi = _mm_setr_ps((float)x, (float)(x + 1), (float)(x + 2), (float)(x + 3));
+        __m128 u  = _mm_add_ps(_mm_mul_ps(xi, step), offset);
+        __m128 il = _mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(one, _mm_mul_ps(u, u)), v2)));
+        __m128 w  = _mm_mul_ps(_mm_mul_ps(il, il), il);
+
+        __m128 dx = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(ax, u), bx), il);
+        __m128 dy = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(ay, u), by), il);
+        __m128 dz = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(az, u), bz), il);
+
+        __m128 r = _mm_loadu_ps(linear + (x + 0) * 4);
+        __m128 g = _mm_loadu_ps(linear + (x + 1) * 4);
+        __m128 c = _mm_loadu_ps(linear + (x + 2) * 4);
+        __m128 d = _mm_loadu_ps(linear + (x + 3) * 4);
+        _MM_TRANSPOSE4_PS(r, g, c, d); // r, g, c(=b) now hold one channel of four texels
+
+        __m128 p[9] ={
+          one, dy, dz, dx,
+          _mm_mul_ps(dx, dy),
+          _mm_mul_ps(dy, dz),
+          _mm_sub_ps(_mm_mul_ps(three, _mm_mul_ps(dz, dz)), one),
+          _mm_mul_ps(dx, dz),
+          _mm_sub_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy))
+        };
+        for(int i=0; i < 9; ++i) {
+          __m128 pw = _mm_mul_ps(p[i], w);
+          sum[i * 3 + 0] = _mm_add_ps(sum[i * 3 + 0], _mm_mul_ps(pw, r));
+          sum[i * 3 + 1] = _mm_add_ps(sum[i * 3 + 1], _mm_mul_ps(pw, g));
+          sum[i * 3 + 2] = _mm_add_ps(sum[i * 3 + 2], _mm_mul_ps(pw, c));
+        }
+        sum[27] = _mm_add_ps(sum[27], w);
+      }
+
+      for(unsigned int i=0; i < s_shAccumulators; ++i) {
+        float lanes[4];
+        _mm_storeu_ps(lanes, sum[i]);
+        acc[i] += (double)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+      }
+#endif
+      ProjectTexelsScalar(a, b, v, size, x, linear, acc);
+    }
+
+    bool ProjectCubeMapToSH(
+      Texture2DDescriptor const&cube,
+      SHIrradiance             &outIrradiance,
+      unsigned int              threadCount)
+    {
+      if(!ValidateCube(cube))
+        return false;
+
+      unsigned int size    = cube.width;
+      unsigned int threads = ResolveThreadCount(threadCount);
+
+      std::vector<std::vector<double>> partial(threads, std::vector<double>(s_shAccumulators, 0.0));
+      ParallelRows(CubeFaceCount * size, threads, [&] (unsigned int begin, unsigned int end, unsigned int t)
+      {
+        std::vector<float> linear(size * 4);
+        for(unsigned int row=begin; row < end; ++row) {
+          unsigned int face = row / size;
+          unsigned int y    = row % size;
+
+          const uint8_t *src = reinterpret_cast<const uint8_t*>(cube.inData[face].data()) + (size_t)y * size * 4;
+          SRGBToLinear(src, linear.data(), size);
+          ProjectRow(face, y, size, linear.data(), partial[t].data());
+        }
+      });
+
+      double total[s_shAccumulators] ={};
+      for(std::vector<double> const&p : partial)
+        for(unsigned int i=0; i < s_shAccumulators; ++i)
+          total[i] += p[i];
+
+      // Normalising by the summed weight makes the discrete solid angles add up to exactly 4pi.
+      double scale = (4.0 * s_pi) / total[27];
+
+      // Cosine lobe convolution (A_l), basis normalisation (k_i) and the 1/pi of the Lambert BRDF.
+      static const double A[9] ={ 1.0, 2.0 / 3.0, 2.0 / 3.0, 2.0 / 3.0, 0.25, 0.25, 0.25, 0.25, 0.25 };
+      static const double k[9] ={ 0.282095, 0.488603, 0.488603, 0.488603, 1.092548, 1.092548, 0.315392, 1.092548, 0.546274 };
+
+      for(int i=0; i < 9; ++i) {
+        for(int c=0; c < 3; ++c)
+          outIrradiance.coefficients[i][c] = static_cast<float>(total[i * 3 + c] * scale * k[i] * k[i] * A[i]);
+        outIrradiance.coefficients[i][3] = 0.0f;
+      }
+
+      return true;
+    }
+
+    //
+    // Specular prefiltering
+    //
+    struct FloatCube {
+      unsigned int                    size;
+      std::vector<std::vector<float>> faces; // RGBA32F linear
+    };
+
+    static void BilinearFace(FloatCube const&level, unsigned int face, float u, float v, float out[4])
+    {
+      int   size = static_cast<int>(level.size);
+      float s    = (u * 0.5f + 0.5f) * size - 0.5f;
+      float t    = (v * 0.5f + 0.5f) * size - 0.5f;
+      s = std::min(std::max(s, 0.0f), size - 1.0f);
+      t = std::min(std::max(t, 0.0f), size - 1.0f);
+
+      int   x0 = static_cast<int>(s), y0 = static_cast<int>(t);
+      int   x1 = std::min(x0 + 1, size - 1), y1 = std::min(y0 + 1, size - 1);
+      float fx = s - x0, fy = t - y0;
+
+      const float *p   = level.faces[face].data();
+      const float *p00 = p + (y0 * size + x0) * 4;
+      const float *p10 = p + (y0 * size + x1) * 4;
+      const float *p01 = p + (y1 * size + x0) * 4;
+      const float *p11 = p + (y1 * size + x1) * 4;
+      for(int c=0; c < 4; ++c) {
+        float top    = p00[c] + (p10[c] - p00[c]) * fx;
+        float bottom = p01[c] + (p11[c] - p01[c]) * fx;
+        out[c] = top + (bottom - top) * fy;
+      }
+    }
+
+    static void SampleCube(std::vector<FloatCube> const&mips, float x, float y, float z, float lod, float out[4])
+    {
+      unsigned int face;
+      float        u, v;
+      DirectionToFace(x, y, z, face, u, v);
+
+      float maxLod = static_cast<float>(mips.size() - 1);
+      lod = std::min(std::max(lod, 0.0f), maxLod);
+
+      unsigned int l0 = static_cast<unsigned int>(lod);
+      unsigned int l1 = std::min(l0 + 1, static_cast<unsigned int>(mips.size() - 1));
+      float        f  = lod - l0;
+
+      BilinearFace(mips[l0], face, u, v, out);
+      if(f > 0.0f && l1 != l0) {
+        float hi[4];
+        BilinearFace(mips[l1], face, u, v, hi);
+        for(int c=0; c < 4; ++c)
+          out[c] += (hi[c] - out[c]) * f;
+      }
+    }
+
+    static float RadicalInverse(uint32_t bits)
+    {
+      bits = (bits << 16) | (bits >> 16);
+      bits = ((bits & 0x55555555u) << 1) | ((bits & 0xAAAAAAAAu) >> 1);
+      bits = ((bits & 0x33333333u) << 2) | ((bits & 0xCCCCCCCCu) >> 2);
+      bits = ((bits & 0x0F0F0F0Fu) << 4) | ((bits & 0xF0F0F0F0u) >> 4);
+      bits = ((bits & 0x00FF00FFu) << 8) | ((bits & 0xFF00FF00u) >> 8);
+      return bits * 2.3283064365386963e-10f;
+    }
+
+    struct SpecularSample {
+      float l[3];  // light direction in the tangent frame of N (= V = R)
+      float nDotL;
+      float lod;   // source mip from filtered importance sampling
+    };
+
+    static std::vector<SpecularSample> BuildSpecularSamples(float roughness, unsigned int count, unsigned int sourceSize)
+    {
+      std::vector<SpecularSample> samples;
+
+      float alpha  = roughness * roughness;
+      float alpha2 = alpha * alpha;
+      float texelSolidAngle = 4.0f * s_pi / (6.0f * sourceSize * sourceSize);
+
+      for(unsigned int k=0; k < count; ++k) {
+        float phi      = 2.0f * s_pi * (k + 0.5f) / count;
+        float e        = RadicalInverse(k);
+        float cosTheta = std::sqrt((1.0f - e) / (1.0f + (alpha2 - 1.0f) * e));
+        float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+
+        // With N = V the reflected direction is L = 2 (N.H) H - N, all in tangent space.
+        float h[3]  ={ sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta };
+        float nDotL = 2.0f * cosTheta * cosTheta - 1.0f;
+        if(nDotL <= 0.0f)
+          continue;
+
+        float denominator = cosTheta * cosTheta * (alpha2 - 1.0f) + 1.0f;
+        float D           = alpha2 / (s_pi * denominator * denominator);
+        float pdf         = D * 0.25f; // D * NoH / (4 VoH), NoH == VoH here
+        float sampleSolidAngle = 1.0f / (count * pdf + 1.0e-6f);
+
+        SpecularSample sample;
+        sample.l[0]  = 2.0f * cosTheta * h[0];
+        sample.l[1]  = 2.0f * cosTheta * h[1];
+        sample.l[2]  = nDotL;
+        sample.nDotL = nDotL;
+        sample.lod   = (roughness == 0.0f) ? 0.0f : std::max(0.0f, 0.5f * std::log2(sampleSolidAngle / texelSolidAngle) + 1.0f);
+        samples.push_back(sample);
+      }
+
+      return samples;
+    }
+
+    bool PrefilterSpecularCubeMap(
+      Texture2DDescriptor          const&cube,
+      EnvironmentPreprocessOptions const&options,
+      Texture2DDescriptor               &outSpecular)
+    {
+      if(!ValidateCube(cube))
+        return false;
+
+      unsigned int threads    = ResolveThreadCount(options.threadCount);
+      unsigned int sourceSize = cube.width;
+      unsigned int size       = std::max(1u, std::min(options.specularSize, sourceSize));
+      unsigned int levels     = MipLevelCount(size, size);
+
+      // Linear float source with a box-filtered mip chain for filtered importance sampling.
+      std::vector<FloatCube> source;
+      source.push_back({ sourceSize, std::vector<std::vector<float>>(CubeFaceCount) });
+      for(unsigned int f=0; f < CubeFaceCount; ++f) {
+        source[0].faces[f].resize((size_t)sourceSize * sourceSize * 4);
+        SRGBToLinear(reinterpret_cast<const uint8_t*>(cube.inData[f].data()), source[0].faces[f].data(), (size_t)sourceSize * sourceSize);
+      }
+      while(source.back().size > 1) {
+        FloatCube const&prev = source.back();
+        unsigned int     s   = prev.size;
+        unsigned int     n   = std::max(1u, s / 2);
+
+        FloatCube next ={ n, std::vector<std::vector<float>>(CubeFaceCount) };
+        for(unsigned int f=0; f < CubeFaceCount; ++f) {
+          next.faces[f].resize((size_t)n * n * 4);
+          for(unsigned int y=0; y < n; ++y)
+            for(unsigned int x=0; x < n; ++x)
+              for(int c=0; c < 4; ++c) {
+                unsigned int x0 = std::min(2 * x, s - 1), x1 = std::min(2 * x + 1, s - 1);
+                unsigned int y0 = std::min(2 * y, s - 1), y1 = std::min(2 * y + 1, s - 1);
+                next.faces[f][(y * n + x) * 4 + c] = 0.25f * (prev.faces[f][(y0 * s + x0) * 4 + c] + prev.faces[f][(y0 * s + x1) * 4 + c]
+                                                            + prev.faces[f][(y1 * s + x0) * 4 + c] + prev.faces[f][(y1 * s + x1) * 4 + c]);
+              }
+        }
+        source.push_back(next);
+      }
+
+      outSpecular = Texture2DDescriptor();
+      outSpecular.width      = size;
+      outSpecular.height     = size;
+      outSpecular.depth      = CubeFaceCount;
+      outSpecular.channels   = 4;
+      outSpecular.mipLevels  = levels;
+      outSpecular.inByteSize = size * size * 4 * sizeof(Byte);
+      outSpecular.inData.resize(CubeFaceCount);
+      for(unsigned int f=0; f < CubeFaceCount; ++f)
+        outSpecular.inData[f].resize(MipChainByteSize(size, size, levels));
+
+      size_t       levelOffset = 0;
+      unsigned int levelSize   = size;
+      for(unsigned int m=0; m < levels; ++m) {
+        float roughness = (levels > 1) ? (float)m / (levels - 1) : 0.0f;
+
+        std::vector<SpecularSample> samples;
+        if(m == 0) {
+          // Mirror level: one tap, filtered down to this level's resolution.
+          SpecularSample mirror ={ { 0.0f, 0.0f, 1.0f }, 1.0f, std::log2((float)sourceSize / size) };
+          samples.push_back(mirror);
+        }
+        else {
+          samples = BuildSpecularSamples(roughness, options.sampleCount, sourceSize);
+        }
+
+        unsigned int s = levelSize;
+        ParallelRows(CubeFaceCount * s, threads, [&] (unsigned int begin, unsigned int end, unsigned int)
+        {
+          std::vector<float> row(s * 4);
+          for(unsigned int r=begin; r < end; ++r) {
+            unsigned int face = r / s;
+            unsigned int y    = r % s;
+            float v = (2.0f * (y + 0.5f) / s) - 1.0f;
+            float a[3], b[3];
+            FaceRowBasis(face, v, a, b);
+
+            for(unsigned int x=0; x < s; ++x) {
+              float u  = (2.0f * (x + 0.5f) / s) - 1.0f;
+              float n[3] ={ a[0] * u + b[0], a[1] * u + b[1], a[2] * u + b[2] };
+              float il = 1.0f / std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+              n[0] *= il; n[1] *= il; n[2] *= il;
+
+              // Tangent frame around N.
+              float up[3] ={ 0.0f, 0.0f, 1.0f };
+              if(std::fabs(n[2]) > 0.999f) { up[0] = 1.0f; up[2] = 0.0f; }
+              float t[3] ={ up[1] * n[2] - up[2] * n[1], up[2] * n[0] - up[0] * n[2], up[0] * n[1] - up[1] * n[0] };
+              float it = 1.0f / std::sqrt(t[0] * t[0] + t[1] * t[1] + t[2] * t[2]);
+              t[0] *= it; t[1] *= it; t[2] *= it;
+              float bt[3] ={ n[1] * t[2] - n[2] * t[1], n[2] * t[0] - n[0] * t[2], n[0] * t[1] - n[1] * t[0] };
+
+              float color[4] ={ 0.0f, 0.0f, 0.0f, 0.0f };
+              float weight   = 0.0f;
+              for(SpecularSample const&sample : samples) {
+                float l[3];
+                for(int c=0; c < 3; ++c)
+                  l[c] = t[c] * sample.l[0] + bt[c] * sample.l[1] + n[c] * sample.l[2];
+
+                float texel[4];
+                SampleCube(source, l[0], l[1], l[2], sample.lod, texel);
+                for(int c=0; c < 4; ++c)
+                  color[c] += texel[c] * sample.nDotL;
+                weight += sample.nDotL;
+              }
+
+              float iw = (weight > 0.0f) ? (1.0f / weight) : 0.0f;
+              row[x * 4 + 0] = color[0] * iw;
+              row[x * 4 + 1] = color[1] * iw;
+              row[x * 4 + 2] = color[2] * iw;
+              row[x * 4 + 3] = 1.0f;
+            }
+
+            uint8_t *dst = reinterpret_cast<uint8_t*>(outSpecular.inData[face].data()) + levelOffset + (size_t)y * s * 4;
+            LinearToSRGB(row.data(), dst, s);
+          }
+        });
+
+        levelOffset += (size_t)s * s * 4;
+        levelSize    = std::max(1u, levelSize / 2);
+      }
+
+      return true;
+    }
+
+    bool PreprocessEnvironmentMap(
+      Texture2DDescriptor          const&cube,
+      EnvironmentPreprocessOptions const&options,
+      EnvironmentLighting               &outLighting)
+    {
+      return ProjectCubeMapToSH(cube, outLighting.irradiance, options.threadCount)
+          && PrefilterSpecularCubeMap(cube, options, outLighting.specular);
+    }
+
+    //
+    // Cache
+    //
+    static const char     s_cacheMagic[8] ={ 'S', 'A', 'E', 'E', 'N', 'V', 'C', 'H' };
+    static const uint32_t s_cacheVersion  = 1;
+
+    static bool FileStamp(std::string const&filename, uint64_t &size, int64_t &modified)
+    {
+#if defined(_MSC_VER)
+      struct _stat64 info;
+      if(_stat64(filename.c_str(), &info) != 0)
+        return false;
+#else
+      struct stat info;
+      if(stat(filename.c_str(), &info) != 0)
+        return false;
+#endif
+      size     = static_cast<uint64_t>(info.st_size);
+      modified = static_cast<int64_t>(info.st_mtime);
+      return true;
+    }
+
+    template <typename T>
+    static void WritePod(std::ofstream &out, T const&value)
+    {
+      out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    static bool ReadPod(std::ifstream &in, T &value)
+    {
+      return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+    }
+
+    std::string EnvironmentCachePath(std::vector<std::string> const&faceFilenames)
+    {
+      return faceFilenames.empty() ? std::string() : (faceFilenames[0] + ".envcache");
+    }
+
+    bool LoadEnvironmentCache(
+      std::vector<std::string>     const&faceFilenames,
+      EnvironmentPreprocessOptions const&options,
+      EnvironmentLighting               &outLighting)
+    {
+      if(faceFilenames.size() != CubeFaceCount)
+        return false;
+
+      std::ifstream in(EnvironmentCachePath(faceFilenames), std::ios::binary);
+      if(!in)
+        return false;
+
+      char     magic[8];
+      uint32_t version = 0, faceCount = 0, specularSize = 0, sampleCount = 0;
+      if(!in.read(magic, sizeof(magic)) || memcmp(magic, s_cacheMagic, sizeof(magic)) != 0
+         || !ReadPod(in, version) || version != s_cacheVersion
+         || !ReadPod(in, faceCount) || faceCount != CubeFaceCount
+         || !ReadPod(in, specularSize) || specularSize != options.specularSize
+         || !ReadPod(in, sampleCount) || sampleCount != options.sampleCount)
+      {
+        return false;
+      }
+
+      for(std::string const&filename : faceFilenames) {
+        uint64_t size = 0, cachedSize = 0;
+        int64_t  modified = 0, cachedModified = 0;
+        if(!FileStamp(filename, size, modified)
+           || !ReadPod(in, cachedSize) || !ReadPod(in, cachedModified)
+           || size != cachedSize || modified != cachedModified)
+        {
+          return false;
+        }
+      }
+
+      EnvironmentLighting lighting;
+      uint32_t width = 0, levels = 0;
+      if(!ReadPod(in, lighting.irradiance) || !ReadPod(in, width) || !ReadPod(in, levels)
+         || width == 0 || levels != MipLevelCount(width, width))
+      {
+        return false;
+      }
+
+      lighting.specular = Texture2DDescriptor();
+      lighting.specular.width      = width;
+      lighting.specular.height     = width;
+      lighting.specular.depth      = CubeFaceCount;
+      lighting.specular.channels   = 4;
+      lighting.specular.mipLevels  = levels;
+      lighting.specular.inByteSize = width * width * 4 * sizeof(Byte);
+      lighting.specular.inData.resize(CubeFaceCount);
+      for(std::vector<Byte> &face : lighting.specular.inData) {
+        face.resize(MipChainByteSize(width, width, levels));
+        if(!in.read(face.data(), face.size()))
+          return false;
+      }
+
+      outLighting = std::move(lighting);
+      return true;
+    }
+
+    bool SaveEnvironmentCache(
+      std::vector<std::string>     const&faceFilenames,
+      EnvironmentPreprocessOptions const&options,
+      EnvironmentLighting          const&lighting)
+    {
+      if(faceFilenames.size() != CubeFaceCount || lighting.specular.inData.size() != CubeFaceCount)
+        return false;
+
+      std::ofstream out(EnvironmentCachePath(faceFilenames), std::ios::binary | std::ios::trunc);
+      if(!out)
+        return false;
+
+      out.write(s_cacheMagic, sizeof(s_cacheMagic));
+      WritePod(out, s_cacheVersion);
+      WritePod(out, static_cast<uint32_t>(CubeFaceCount));
+      WritePod(out, static_cast<uint32_t>(options.specularSize));
+      WritePod(out, static_cast<uint32_t>(options.sampleCount));
+
+      for(std::string const&filename : faceFilenames) {
+        uint64_t size = 0;
+        int64_t  modified = 0;
+        if(!FileStamp(filename, size, modified))
+          return false;
+        WritePod(out, size);
+        WritePod(out, modified);
+      }
+
+      WritePod(out, lighting.irradiance);
+      WritePod(out, static_cast<uint32_t>(lighting.specular.width));
+      WritePod(out, static_cast<uint32_t>(lighting.specular.mipLevels));
+      for(std::vector<Byte> const&face : lighting.specular.inData)
+        out.write(face.data(), face.size());
+
+      return static_cast<bool>(out);
+    }
+
+  }
+}
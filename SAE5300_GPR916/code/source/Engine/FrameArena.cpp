@@ -0,0 +1,158 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "Engine/FrameArena.h"
+
+#ifdef SAE_CHECK_FRAME_ALLOCATIONS
+// Heap allocations of the calling thread, see SAE::Memory::ThreadHeapAllocations().
+static thread_local uint64_t t_heapAllocations = 0;
+// Of all threads, see SAE::Memory::HeapAllocations().
+static std::atomic<uint64_t> s_heapAllocations(0);
+#endif
+
+namespace SAE {
+  namespace Memory {
+
+    FrameArena::FrameArena()
+      : m_chunks()
+      , m_offset(0)
+      , m_retired(0)
+      , m_peak(0)
+      , m_grows(0)
+    {}
+
+    FrameArena& FrameArena
+      ::local()
+    {
+      thread_local FrameArena arena;
+      return arena;
+    }
+
+    void FrameArena
+      ::addChunk(size_t size)
+    {
+      if(!m_chunks.empty())
+        m_retired += m_offset;
+
+      Chunk chunk;
+      chunk.memory.reset(new uint8_t[size]);
+      chunk.size = size;
+
+      m_chunks.push_back(std::move(chunk));
+      m_offset = 0;
+      ++m_grows;
+    }
+
+    void* FrameArena
+      ::allocate(size_t size, size_t alignment)
+    {
+      if(!alignment)
+        alignment = 1;
+
+      for(;;) {
+        if(!m_chunks.empty()) {
+          Chunk     &chunk   = m_chunks.back();
+          uintptr_t  base    = reinterpret_cast<uintptr_t>(chunk.memory.get());
+          uintptr_t  aligned = (base + m_offset + (alignment - 1)) & ~uintptr_t(alignment - 1);
+          size_t     offset  = static_cast<size_t>(aligned - base);
+
+          if(offset <= chunk.size && size <= (chunk.size - offset)) {
+            m_offset = offset + size;
+            return chunk.memory.get() + offset;
+          }
+        }
+
+        // Doubling keeps the number of chunks of a frame logarithmic in its size.
+        size_t next = (m_chunks.empty() ? InitialChunkSize : 2 * m_chunks.back().size);
+        if(next < (size + alignment))
+          next = size + alignment;
+
+        addChunk(next);
+      }
+    }
+
+    void FrameArena
+      ::reset()
+    {
+      uint64_t const used = m_retired + m_offset;
+      if(used > m_peak)
+        m_peak = used;
+
+      if(m_chunks.size() > 1) {
+        size_t capacity = 0;
+        for(Chunk const&chunk : m_chunks)
+          capacity += chunk.size;
+
+        m_chunks.clear();
+        addChunk(capacity);
+      }
+
+      m_offset  = 0;
+      m_retired = 0;
+    }
+
+    FrameArena::Stats FrameArena
+      ::stats() const
+    {
+      Stats stats ={};
+      stats.used   = m_retired + m_offset;
+      stats.peak   = m_peak;
+      stats.chunks = static_cast<uint32_t>(m_chunks.size());
+      stats.grows  = m_grows;
+      for(Chunk const&chunk : m_chunks)
+        stats.capacity += chunk.size;
+
+      return stats;
+    }
+
+    uint64_t ThreadHeapAllocations()
+    {
+#ifdef SAE_CHECK_FRAME_ALLOCATIONS
+      return t_heapAllocations;
+#else
+      return 0;
+#endif
+    }
+
+    uint64_t HeapAllocations()
+    {
+#ifdef SAE_CHECK_FRAME_ALLOCATIONS
+      return s_heapAllocations.load(std::memory_order_relaxed);
+#else
+      return 0;
+#endif
+    }
+
+  }
+}
+
+#ifdef SAE_CHECK_FRAME_ALLOCATIONS
+// Counting replacements of the global allocation functions; the nothrow and sized forms
+// forward to these.
+void* operator new(size_t size)
+{
+  ++t_heapAllocations;
+  s_heapAllocations.fetch_add(1, std::memory_order_relaxed);
+
+  void *memory = std::malloc(size ? size : 1);
+  if(!memory)
+    throw std::bad_alloc();
+  return memory;
+}
+
+void* operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void *memory) noexcept
+{
+  std::free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+  std::free(memory);
+}
+#endif
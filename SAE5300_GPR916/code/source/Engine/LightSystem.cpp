@@ -0,0 +1,283 @@
+#include <cstring>
+
+#include "Engine/LightSystem.h"
+#include "Engine/SIMDMath.h"
+
+namespace SAE {
+  namespace Engine {
+    using namespace DirectX;
+    using SAE::Math::Mat4;
+    using SAE::Math::Vec4;
+    using SAE::Rendering::SceneBVH;
+
+    // Look-to direction and up vector of the cube faces, in the order of the cube map faces.
+    static const float s_cubeFaceDirections[LightSystem::MaxShadowViews][3] ={
+      {  1.0f,  0.0f,  0.0f }, { -1.0f,  0.0f,  0.0f },
+      {  0.0f,  1.0f,  0.0f }, {  0.0f, -1.0f,  0.0f },
+      {  0.0f,  0.0f,  1.0f }, {  0.0f,  0.0f, -1.0f }
+    };
+    static const float s_cubeFaceUps[LightSystem::MaxShadowViews][3] ={
+      {  0.0f,  1.0f,  0.0f }, {  0.0f,  1.0f,  0.0f },
+      {  0.0f,  0.0f, -1.0f }, {  0.0f,  0.0f,  1.0f },
+      {  0.0f,  1.0f,  0.0f }, {  0.0f,  1.0f,  0.0f }
+    };
+
+    static const float s_shadowNearPlane = 0.001f;
+
+    // Point lights cover a cube face each, spot lights their outer cone.
+    static float ShadowFieldOfView(Light::Properties const&properties)
+    {
+      if(properties.type != Light::Type::Spot)
+        return (float)(M_PI / 2.0f);
+
+      float falloffAngle = properties.specificProperties.Spot.falloffAngle;
+      if(!(falloffAngle > 0.0f))
+        falloffAngle = RAD(45.0f);
+
+      float const fieldOfView = 2.0f * falloffAngle;
+      return (fieldOfView > RAD(170.0f)) ? RAD(170.0f) : fieldOfView;
+    }
+
+    /**********************************************************************************************//**
+     * \fn  uint32_t LightSystem ::sync(Light const *lights, size_t count)
+     *
+     * \brief Copies the lights into the arrays and recomputes the shadow views that changed.
+     *
+     * Values are compared exactly: a light that did not move keeps its matrices and planes
+     * bit for bit, one that moved by any amount gets new ones.
+     *
+     * \param  lights  The Light pool in dense order.
+     * \param  count   Number of lights.
+     *
+     * \return  The number of lights whose view-projections and planes were recomputed.
+     **************************************************************************************************/
+    uint32_t LightSystem
+      ::sync(
+        Light const *lights,
+        size_t       count)
+    {
+      if(m_types.size() != count) {
+        m_types.resize(count, Light::Type::Point);
+        m_properties.resize(count);
+        m_positionX.resize(count);
+        m_positionY.resize(count);
+        m_positionZ.resize(count);
+        m_directionX.resize(count);
+        m_directionY.resize(count);
+        m_directionZ.resize(count);
+        m_ranges.resize(count);
+        m_fieldOfViews.resize(count);
+        m_valid.resize(count, 0);
+        m_viewProjections.resize(count * MaxShadowViews, XMMatrixIdentity());
+        m_planes.resize(count * MaxShadowViews * PlanesPerView);
+      }
+
+      m_changed.clear();
+      for(uint32_t k=0; k < count; ++k) {
+        Light::Properties const&properties = lights[k].properties();
+
+        XMFLOAT3 position;
+        XMFLOAT3 direction;
+        XMStoreFloat3(&position,  lights[k].transform().getTranslation());
+        XMStoreFloat3(&direction, XMVector3Normalize(lights[k].transform().getDirection()));
+
+        float const range       = properties.specificProperties.point.distance;
+        float const fieldOfView = ShadowFieldOfView(properties);
+
+        // Cube faces are axis aligned: turning a point light does not move them.
+        bool const turned = (properties.type == Light::Type::Spot)
+                         && (direction.x  != m_directionX[k]
+                          || direction.y  != m_directionY[k]
+                          || direction.z  != m_directionZ[k]
+                          || fieldOfView  != m_fieldOfViews[k]);
+        bool const changed = !m_valid[k]
+                          || turned
+                          || properties.type != m_types[k]
+                          || position.x      != m_positionX[k]
+                          || position.y      != m_positionY[k]
+                          || position.z      != m_positionZ[k]
+                          || range           != m_ranges[k];
+
+        m_types[k]        = properties.type;
+        m_properties[k]   = properties;
+        m_positionX[k]    = position.x;
+        m_positionY[k]    = position.y;
+        m_positionZ[k]    = position.z;
+        m_directionX[k]   = direction.x;
+        m_directionY[k]   = direction.y;
+        m_directionZ[k]   = direction.z;
+        m_ranges[k]       = range;
+        m_fieldOfViews[k] = fieldOfView;
+        m_valid[k]        = 1;
+
+        // Directional cascades follow the camera, fitCascades() combines them.
+        if(changed && properties.type != Light::Type::Directional)
+          m_changed.push_back(k);
+      }
+
+      updateShadowViews();
+
+      uint32_t const recomputed = static_cast<uint32_t>(m_changed.size());
+      m_changed.clear();
+      return recomputed;
+    }
+
+    /**********************************************************************************************//**
+     * \fn  void LightSystem ::updateShadowViews()
+     *
+     * \brief Recomputes the view-projections and frustum planes of the lights in m_changed.
+     *
+     * Views and projections of all changed lights are built into the scratch arrays first and
+     * combined by a single SAE::Math::MultiplyMatrices() call, which takes them four or eight
+     * at a time where the CPU allows.
+     **************************************************************************************************/
+    void LightSystem
+      ::updateShadowViews()
+    {
+      size_t const viewCount = m_changed.size() * MaxShadowViews;
+      if(!viewCount)
+        return;
+
+      m_views.resize(viewCount * 16);
+      m_projections.resize(viewCount * 16);
+
+      for(size_t c=0; c < m_changed.size(); ++c) {
+        uint32_t const k           = m_changed[c];
+        float         *views       = &m_views[c * MaxShadowViews * 16];
+        float         *projections = &m_projections[c * MaxShadowViews * 16];
+
+        Vec4 const eye        = SAE::Math::Set(m_positionX[k], m_positionY[k], m_positionZ[k], 1.0f);
+        Mat4 const projection = SAE::Math::PerspectiveFovLH(m_fieldOfViews[k], 1.0f, s_shadowNearPlane, m_ranges[k]);
+
+        if(m_types[k] == Light::Type::Spot) {
+          Vec4 const direction = SAE::Math::Set(m_directionX[k], m_directionY[k], m_directionZ[k], 0.0f);
+          Vec4 const up        = (fabsf(m_directionY[k]) > 0.99f) ? SAE::Math::Set(0.0f, 0.0f, 1.0f, 0.0f) : SAE::Math::Set(0.0f, 1.0f, 0.0f, 0.0f);
+          Mat4 const view      = SAE::Math::LookToLH(eye, direction, up);
+
+          for(uint32_t v=0; v < MaxShadowViews; ++v) {
+            SAE::Math::StoreMat4(views       + (v * 16), view);
+            SAE::Math::StoreMat4(projections + (v * 16), projection);
+          }
+          continue;
+        }
+
+        for(uint32_t v=0; v < MaxShadowViews; ++v) {
+          Vec4 const direction = SAE::Math::Load3(s_cubeFaceDirections[v], 0.0f);
+          Vec4 const up        = SAE::Math::Load3(s_cubeFaceUps[v],        0.0f);
+
+          SAE::Math::StoreMat4(views       + (v * 16), SAE::Math::LookToLH(eye, direction, up));
+          SAE::Math::StoreMat4(projections + (v * 16), projection);
+        }
+      }
+
+      SAE::Math::MultiplyMatrices(m_views.data(), m_projections.data(), m_views.data(), viewCount);
+
+      for(size_t c=0; c < m_changed.size(); ++c) {
+        uint32_t const k = m_changed[c];
+        memcpy(&m_viewProjections[k * MaxShadowViews], &m_views[c * MaxShadowViews * 16], sizeof(XMMATRIX) * MaxShadowViews);
+        updateFrustumPlanes(k);
+      }
+
+      m_views.clear();
+      m_projections.clear();
+    }
+
+    void LightSystem
+      ::updateFrustumPlanes(uint32_t light)
+    {
+      bool const clipNear = (m_types[light] != Light::Type::Directional);
+
+      for(uint32_t v=0; v < MaxShadowViews; ++v) {
+        uint32_t const view = (light * MaxShadowViews) + v;
+
+        XMFLOAT4X4 matrix;
+        XMStoreFloat4x4(&matrix, m_viewProjections[view]);
+        SceneBVH::FrustumPlanes(&matrix.m[0][0], clipNear, &m_planes[view * PlanesPerView]);
+      }
+    }
+
+    void LightSystem
+      ::fitCascades(
+        uint32_t       light,
+        XMMATRIX const&cameraView,
+        XMMATRIX const&cameraProjection,
+        float          shadowDistance,
+        uint32_t const tileSizes[Light::CascadeCount])
+    {
+      if(m_types[light] != Light::Type::Directional)
+        return;
+
+      // Left handed perspective projection: _33 = f / (f - n), _43 = -n * f / (f - n).
+      float const p33        = VEC_Z(cameraProjection.r[2]);
+      float const p43        = VEC_Z(cameraProjection.r[3]);
+      float const nearPlane  = -p43 / p33;
+      float const cameraFar  = (p33 * nearPlane) / (p33 - 1.0f);
+      float const farPlane   = (shadowDistance < cameraFar) ? shadowDistance : cameraFar;
+      float const tanHalfFovX = 1.0f / VEC_X(cameraProjection.r[0]);
+      float const tanHalfFovY = 1.0f / VEC_Y(cameraProjection.r[1]);
+
+      XMVECTOR lightDirection = direction(light);
+      XMVECTOR up             = (fabsf(VEC_Y(lightDirection)) > 0.99f) ? XMVECTOR({ 0.0f, 0.0f, 1.0f, 0.0f }) : XMVECTOR({ 0.0f, 1.0f, 0.0f, 0.0f });
+
+      // Orientation only: the cascades move through light space with the camera, they do not rotate.
+      XMMATRIX const lightView   = XMMatrixLookToLH(XMVECTOR({ 0.0f, 0.0f, 0.0f, 1.0f }), lightDirection, up);
+      XMMATRIX const viewToLight = XMMatrixMultiply(XMMatrixInverse(nullptr, cameraView), lightView);
+
+      XMMATRIX *viewProjections = &m_viewProjections[light * MaxShadowViews];
+
+      float splitNear = nearPlane;
+      for(uint32_t c=0; c < Light::CascadeCount; ++c) {
+        // Practical split scheme: mostly logarithmic, blended with uniform splits.
+        float const t        = float(c + 1) / float(Light::CascadeCount);
+        float const splitFar = (0.75f * nearPlane * powf(farPlane / nearPlane, t))
+                             + (0.25f * (nearPlane + ((farPlane - nearPlane) * t)));
+
+        XMVECTOR corners[8];
+        XMVECTOR center = XMVECTOR({ 0.0f, 0.0f, 0.0f, 0.0f });
+        for(uint32_t k=0; k < 8; ++k) {
+          float const z = (k & 4) ? splitFar : splitNear;
+          float const x = ((k & 1) ? 1.0f : -1.0f) * tanHalfFovX * z;
+          float const y = ((k & 2) ? 1.0f : -1.0f) * tanHalfFovY * z;
+
+          corners[k] = XMVector3TransformCoord(XMVECTOR({ x, y, z, 1.0f }), viewToLight);
+          center     = XMVectorAdd(center, corners[k]);
+        }
+        center = XMVectorScale(center, 1.0f / 8.0f);
+
+        // x/y: the slice's bounding sphere, whose size does not change when the camera turns,
+        // so neither does the texel size. z: exactly the slice; casters in front of it are
+        // clamped to the near plane, the rasterizer does not clip depth.
+        float radius = 0.0f;
+        float minZ   = VEC_Z(corners[0]);
+        float maxZ   = VEC_Z(corners[0]);
+        for(uint32_t k=0; k < 8; ++k) {
+          float const distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(corners[k], center)));
+          if(distance > radius)          radius = distance;
+          if(VEC_Z(corners[k]) < minZ)   minZ   = VEC_Z(corners[k]);
+          if(VEC_Z(corners[k]) > maxZ)   maxZ   = VEC_Z(corners[k]);
+        }
+        radius = ceilf(radius * 16.0f) / 16.0f;
+
+        // Move in whole texels only, so edges do not crawl when the camera moves.
+        float centerX = VEC_X(center);
+        float centerY = VEC_Y(center);
+        if(tileSizes && tileSizes[c]) {
+          float const texel = (2.0f * radius) / float(tileSizes[c]);
+          centerX = floorf(centerX / texel) * texel;
+          centerY = floorf(centerY / texel) * texel;
+        }
+
+        XMMATRIX const projection = XMMatrixOrthographicOffCenterLH(centerX - radius, centerX + radius, centerY - radius, centerY + radius, minZ, maxZ);
+        viewProjections[c] = XMMatrixMultiply(lightView, projection);
+
+        splitNear = splitFar;
+      }
+
+      for(uint32_t k=Light::CascadeCount; k < MaxShadowViews; ++k)
+        viewProjections[k] = viewProjections[Light::CascadeCount - 1];
+
+      updateFrustumPlanes(light);
+    }
+
+  }
+}
@@ -0,0 +1,779 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <random>
+
+#include "Engine/PixelConversion.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+  #define SAE_PIXEL_X86 1
+  #include <immintrin.h>
+  #if defined(_MSC_VER)
+    #include <intrin.h>
+    // MSVC emits any intrinsic regardless of /arch, dispatch guards the call sites.
+    #define SAE_TARGET_SSE41
+    #define SAE_TARGET_AVX2
+  #else
+    #define SAE_TARGET_SSE41 __attribute__((target("sse4.1")))
+    #define SAE_TARGET_AVX2  __attribute__((target("avx2")))
+  #endif
+#else
+  #define SAE_PIXEL_X86 0
+#endif
+
+namespace SAE {
+  namespace Texture {
+
+    //
+    // Dispatch
+    //
+    static PixelKernelLevel DetectPixelKernelLevel()
+    {
+#if SAE_PIXEL_X86
+  #if defined(_MSC_VER)
+      int info[4];
+      __cpuid(info, 0);
+      int maxLeaf = info[0];
+
+      __cpuid(info, 1);
+      bool sse41   = (info[2] & (1 << 19)) != 0;
+      bool osxsave = (info[2] & (1 << 27)) != 0;
+      bool avx     = (info[2] & (1 << 28)) != 0;
+      bool avx2    = false;
+      if(maxLeaf >= 7 && osxsave && avx && ((_xgetbv(0) & 6) == 6)) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+      }
+  #else
+      __builtin_cpu_init();
+      bool sse41 = __builtin_cpu_supports("sse4.1") != 0;
+      bool avx2  = __builtin_cpu_supports("avx2")   != 0;
+  #endif
+      if(avx2 && sse41)
+        return PixelKernelLevel::AVX2;
+      if(sse41)
+        return PixelKernelLevel::SSE41;
+#endif
+      return PixelKernelLevel::Scalar;
+    }
+
+    PixelKernelLevel SupportedPixelKernelLevel()
+    {
+      static const PixelKernelLevel supported = DetectPixelKernelLevel();
+      return supported;
+    }
+
+    const char* PixelKernelLevelName(PixelKernelLevel level)
+    {
+      switch(level) {
+      case PixelKernelLevel::Scalar: return "scalar";
+      case PixelKernelLevel::SSE41:  return "SSE4.1";
+      case PixelKernelLevel::AVX2:   return "AVX2";
+      default:                       return "best";
+      }
+    }
+
+    static PixelKernelLevel Resolve(PixelKernelLevel requested)
+    {
+      PixelKernelLevel supported = SupportedPixelKernelLevel();
+      if(requested == PixelKernelLevel::Best || requested > supported)
+        return supported;
+      return requested;
+    }
+
+    //
+    // Tables
+    //
+    struct SRGBTables {
+      // [0, 256): sRGB -> linear, [256, 512): alpha / 255. One table so AVX2 can gather
+      // colour and alpha in the same instruction.
+      float toLinear[512];
+
+      SRGBTables()
+      {
+        for(int k=0; k < 256; ++k) {
+          float c = k / 255.0f;
+          toLinear[k]       = (c <= 0.04045f) ? (c / 12.92f) : std::pow((c + 0.055f) / 1.055f, 2.4f);
+          toLinear[256 + k] = c;
+        }
+      }
+    };
+
+    static const SRGBTables& GetSRGBTables()
+    {
+      static const SRGBTables tables;
+      return tables;
+    }
+
+    // From stb_image_resize (public domain): 104 bias/scale pairs covering [2^-13, 1).
+    static const uint32_t s_linearToSRGBTable[104] ={
+      0x0073000d, 0x007a000d, 0x0080000d, 0x0087000d, 0x008d000d, 0x0094000d, 0x009a000d, 0x00a1000d,
+      0x00a7001a, 0x00b4001a, 0x00c1001a, 0x00ce001a, 0x00da001a, 0x00e7001a, 0x00f4001a, 0x0101001a,
+      0x010e0033, 0x01280033, 0x01410033, 0x015b0033, 0x01750033, 0x018f0033, 0x01a80033, 0x01c20033,
+      0x01dc0067, 0x020f0067, 0x02430067, 0x02760067, 0x02aa0067, 0x02dd0067, 0x03110067, 0x03440067,
+      0x037800ce, 0x03df00ce, 0x044600ce, 0x04ad00ce, 0x051400ce, 0x057b00c5, 0x05dd00bc, 0x063b00b5,
+      0x06970158, 0x07420142, 0x07e30130, 0x087b0120, 0x090b0112, 0x09940106, 0x0a1700fc, 0x0a9500f2,
+      0x0b0f01cb, 0x0bf401ae, 0x0ccb0195, 0x0d950180, 0x0e56016e, 0x0f0d015e, 0x0fbc0150, 0x10630143,
+      0x11070264, 0x1238023e, 0x1357021d, 0x14660201, 0x156601e9, 0x165a01d3, 0x174401c0, 0x182401af,
+      0x18fe0331, 0x1a9602fe, 0x1c1502d2, 0x1d7e02ad, 0x1ed4028d, 0x201a0270, 0x21520256, 0x227d0240,
+      0x239f0443, 0x25c003fe, 0x27bf03c4, 0x29a10392, 0x2b6a0367, 0x2d1d0341, 0x2ebe031f, 0x304d0300,
+      0x31d105b0, 0x34a80555, 0x37520507, 0x39d504c5, 0x3c37048b, 0x3e7c0458, 0x40a8042a, 0x42bd0401,
+      0x44c20798, 0x488e071e, 0x4c1c06b6, 0x4f76065d, 0x52a50610, 0x55ac05cc, 0x5892058f, 0x5b590559,
+      0x5e0c0a23, 0x631c0980, 0x67db08f6, 0x6c55087f, 0x70940818, 0x74a007bd, 0x787d076c, 0x7c330723,
+    };
+
+    static const uint32_t s_srgbMinValBits    = (127 - 13) << 23; // 2^-13
+    static const uint32_t s_srgbAlmostOneBits = 0x3f7fffff;       // 1 - eps
+
+    static inline float BitsToFloat(uint32_t bits) { float f; memcpy(&f, &bits, 4); return f; }
+    static inline uint32_t FloatToBits(float f)    { uint32_t u; memcpy(&u, &f, 4); return u; }
+
+    static inline uint8_t LinearToSRGB8(float in)
+    {
+      // Written so that NaN maps to 0.
+      if(!(in > BitsToFloat(s_srgbMinValBits)))
+        in = BitsToFloat(s_srgbMinValBits);
+      if(in > BitsToFloat(s_srgbAlmostOneBits))
+        in = BitsToFloat(s_srgbAlmostOneBits);
+
+      uint32_t u     = FloatToBits(in);
+      uint32_t tab   = s_linearToSRGBTable[(u - s_srgbMinValBits) >> 20];
+      uint32_t bias  = (tab >> 16) << 9;
+      uint32_t scale = tab & 0xffff;
+      uint32_t t     = (u >> 12) & 0xff;
+      return static_cast<uint8_t>((bias + scale * t) >> 16);
+    }
+
+    static inline uint8_t UnitToByte(float in)
+    {
+      if(!(in > 0.0f))
+        in = 0.0f;
+      if(in > 1.0f)
+        in = 1.0f;
+      return static_cast<uint8_t>(static_cast<int>(in * 255.0f + 0.5f));
+    }
+
+    static const float s_normalScale = 1.0f / 127.5f;
+
+    //
+    // Scalar reference kernels
+    //
+    static void ExpandScalar(const uint8_t *src, unsigned int channels, uint8_t *dst, size_t count)
+    {
+      switch(channels) {
+      case 1:
+        for(size_t k=0; k < count; ++k, src += 1, dst += 4) {
+          dst[0] = dst[1] = dst[2] = src[0]; dst[3] = 255;
+        }
+        break;
+      case 2:
+        for(size_t k=0; k < count; ++k, src += 2, dst += 4) {
+          dst[0] = dst[1] = dst[2] = src[0]; dst[3] = src[1];
+        }
+        break;
+      case 3:
+        for(size_t k=0; k < count; ++k, src += 3, dst += 4) {
+          dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2]; dst[3] = 255;
+        }
+        break;
+      case 4:
+        if(src != dst)
+          memmove(dst, src, count * 4);
+        break;
+      }
+    }
+
+    static void SwizzleScalar(const uint8_t *src, uint8_t *dst, size_t count, const uint8_t order[4])
+    {
+      for(size_t k=0; k < count; ++k, src += 4, dst += 4) {
+        uint8_t p[4] ={ src[0], src[1], src[2], src[3] };
+        dst[0] = p[order[0] & 3];
+        dst[1] = p[order[1] & 3];
+        dst[2] = p[order[2] & 3];
+        dst[3] = p[order[3] & 3];
+      }
+    }
+
+    static void PremultiplyScalar(const uint8_t *src, uint8_t *dst, size_t count)
+    {
+      for(size_t k=0; k < count; ++k, src += 4, dst += 4) {
+        unsigned int a = src[3];
+        for(int c=0; c < 3; ++c) {
+          unsigned int t = src[c] * a + 128;
+          dst[c] = static_cast<uint8_t>((t + (t >> 8)) >> 8); // == round(c * a / 255)
+        }
+        dst[3] = static_cast<uint8_t>(a);
+      }
+    }
+
+    static void SRGBToLinearScalar(const uint8_t *src, float *dst, size_t count)
+    {
+      const float *lut = GetSRGBTables().toLinear;
+      for(size_t k=0; k < count; ++k, src += 4, dst += 4) {
+        dst[0] = lut[src[0]];
+        dst[1] = lut[src[1]];
+        dst[2] = lut[src[2]];
+        dst[3] = lut[256 + src[3]];
+      }
+    }
+
+    static void LinearToSRGBScalar(const float *src, uint8_t *dst, size_t count)
+    {
+      for(size_t k=0; k < count; ++k, src += 4, dst += 4) {
+        dst[0] = LinearToSRGB8(src[0]);
+        dst[1] = LinearToSRGB8(src[1]);
+        dst[2] = LinearToSRGB8(src[2]);
+        dst[3] = UnitToByte(src[3]);
+      }
+    }
+
+    static void ExtractNormalXYScalar(const uint8_t *src, uint8_t *dst, size_t count)
+    {
+      for(size_t k=0; k < count; ++k, src += 4, dst += 2) {
+        dst[0] = src[0];
+        dst[1] = src[1];
+      }
+    }
+
+    static void ReconstructNormalZScalar(const uint8_t *src, uint8_t *dst, size_t count)
+    {
+      for(size_t k=0; k < count; ++k, src += 2, dst += 4) {
+        float x  = src[0] * s_normalScale - 1.0f;
+        float y  = src[1] * s_normalScale - 1.0f;
+        float z2 = (1.0f - x * x) - y * y;
+        float z  = std::sqrt(z2 > 0.0f ? z2 : 0.0f);
+
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = static_cast<uint8_t>(static_cast<int>((z + 1.0f) * 127.5f + 0.5f));
+        dst[3] = 255;
+      }
+    }
+
+#if SAE_PIXEL_X86
+    //
+    // SSE4.1 kernels. Each one handles the bulk of the image and returns how many
+    // pixels it converted; the caller finishes the tail on the scalar path.
+    //
+    SAE_TARGET_SSE41
+    static size_t ExpandSSE41(const uint8_t *src, unsigned int channels, uint8_t *dst, size_t count)
+    {
+      const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+      size_t k = 0;
+
+      if(channels == 3) {
+        const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+        // Each load reads 16 bytes for 12 used, so stop while 16 bytes remain readable.
+        for(; k + 6 <= count; k += 4) {
+          __m128i rgb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + k * 3));
+          _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + k * 4), _mm_or_si128(_mm_shuffle_epi8(rgb, shuffle), alpha));
+        }
+      }
+      else if(channels == 2) {
+        const __m128i lo = _mm_setr_epi8(0, 0, 0, 1, 2, 2, 2, 3,  4,  4,  4,  5,  6,  6,  6,  7);
+        const __m128i hi = _mm_setr_epi8(8, 8, 8, 9, 10, 10, 10, 11, 12, 12, 12, 13, 14, 14, 14, 15);
+        for(; k + 8 <= count; k += 8) {
+          __m128i ga = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + k * 2));
+          _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + k * 4),      _mm_shuffle_epi8(ga, lo));
+          _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + k * 4 + 16), _mm_shuffle_epi8(ga, hi));
+        }
+      }
+      else if(channels == 1) {
+        for(; k + 16 <= count; k += 16) {
+          __m128i g    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + k));
+          __m128i gg0  = _mm_unpacklo_epi8(g, g);
+          __m128i gg1  = _mm_unpackhi_epi8(g, g);
+          __m128i *out = reinterpret_cast<__m128i*>(dst + k * 4);
+          _mm_storeu_si128(out + 0, _mm_or_si128(_mm_unpacklo_epi16(gg0, gg0), alpha));
+          _mm_storeu_si128(out + 1, _mm_or_si128(_mm_unpackhi_epi16(gg0, gg0), alpha));
+          _mm_storeu_si128(out + 2, _mm_or_si128(_mm_unpacklo_epi16(gg1, gg1), alpha));
+          _mm_storeu_si128(out + 3, _mm_or_si128(_mm_unpackhi_epi16(gg1, gg1), alpha));
+        }
+      }
+
+      return k;
+    }
+
+    SAE_TARGET_SSE41
+    static size_t SwizzleSSE41(const uint8_t *src, uint8_t *dst, size_t count, const uint8_t order[4])
+    {
+      int8_t mask[16];
+      for(int p=0; p < 4; ++p)
+        for(int c=0; c < 4; ++c)
+          mask[p * 4 + c] = static_cast<int8_t>(p * 4 + (order[c] & 3));
+      const __m128i shuffle = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask));
+
+      size_t k = 0;
+      for(; k + 4 <= count; k += 4) {
+        __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + k * 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + k * 4), _mm_shuffle_epi8(px, shuffle));
+      }
+      return k;
+    }
+
+    SAE_TARGET_SSE41
+    static size_t PremultiplySSE41(const uint8_t *src, uint8_t *dst, size_t count)
+    {
+      const __m128i zero      = _mm_setzero_si128();
+      const __m128i round     = _mm_set1_epi16(128);
+      const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(0xFF000000));
+
+      size_t k = 0;
+      for(; k + 4 <= count; k += 4) {
+        __m128i px  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + k * 4));
+        __m128i lo  = _mm_unpacklo_epi8(px, zero);
+        __m128i hi  = _mm_unpackhi_epi8(px, zero);
+        __m128i alo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, 0xFF), 0xFF);
+        __m128i ahi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, 0xFF), 0xFF);
+
+        lo = _mm_add_epi16(_mm_mullo_epi16(lo, alo), round);
+        hi = _mm_add_epi16(_mm_mullo_epi16(hi, ahi), round);
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+
+        __m128i res = _mm_blendv_epi8(_mm_packus_epi16(lo, hi), px, alphaMask);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + k * 4), res);
+      }
+      return k;
+    }
+
+    SAE_TARGET_SSE41
+    static size_t LinearToSRGBSSE41(const float *src, uint8_t *dst, size_t count)
+    {
+      const __m128  minVal    = _mm_castsi128_ps(_mm_set1_epi32(s_srgbMinValBits));
+      const __m128  almostOne = _mm_castsi128_ps(_mm_set1_epi32(s_srgbAlmostOneBits));
+      const __m128i minValU   = _mm_set1_epi32(s_srgbMinValBits);
+      const __m128i low16     = _mm_set1_epi32(0xffff);
+      const __m128i low8      = _mm_set1_epi32(0xff);
+      const __m128  zero      = _mm_setzero_ps();
+      const __m128  one       = _mm_set1_ps(1.0f);
+      const __m128  scale255  = _mm_set1_ps(255.0f);
+      const __m128  half      = _mm_set1_ps(0.5f);
+
+      size_t k = 0;
+      for(; k + 4 <= count; k += 4) {
+        __m128i res[4];
+        for(int p=0; p < 4; ++p) {
+          __m128  v   = _mm_loadu_ps(src + (k + p) * 4);
+          // max(v, minVal) returns minVal for NaN, matching the scalar clamp.
+          __m128  c   = _mm_min_ps(_mm_max_ps(v, minVal), almostOne);
+          __m128i u   = _mm_castps_si128(c);
+          __m128i idx = _mm_srli_epi32(_mm_sub_epi32(u, minValU), 20);
+          __m128i tab = _mm_setr_epi32(
+            s_linearToSRGBTable[_mm_extract_epi32(idx, 0)],
+            s_linearToSRGBTable[_mm_extract_epi32(idx, 1)],
+            s_linearToSRGBTable[_mm_extract_epi32(idx, 2)],
+            s_linearToSRGBTable[_mm_extract_epi32(idx, 3)]);
+          __m128i bias = _mm_slli_epi32(_mm_srli_epi32(tab, 16), 9);
+          __m128i t    = _mm_and_si128(_mm_srli_epi32(u, 12), low8);
+          __m128i rgb  = _mm_srli_epi32(_mm_add_epi32(bias, _mm_mullo_epi32(_mm_and_si128(tab, low16), t)), 16);
+
+          __m128  a    = _mm_min_ps(_mm_max_ps(v, zero), one);
+          __m128i a8   = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(a, scale255), half));
+          res[p] = _mm_blend_epi16(rgb, a8, 0xC0);
+        }
+        __m128i packed = _mm_packus_epi16(_mm_packus_epi32(res[0], res[1]), _mm_packus_epi32(res[2], res[3]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + k * 4), packed);
+      }
+      return k;
+    }
+
+    SAE_TARGET_SSE41
+    static size_t ExtractNormalXYSSE41(const uint8_t *src, uint8_t *dst, size_t count)
+    {
+      const __m128i shuffle = _mm_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+
+      size_t k = 0;
+      for(; k + 4 <= count; k += 4) {
+        __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + k * 4));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + k * 2), _mm_shuffle_epi8(px, shuffle));
+      }
+      return k;
+    }
+
+    SAE_TARGET_SSE41
+    static size_t ReconstructNormalZSSE41(const uint8_t *src, uint8_t *dst, size_t count)
+    {
+      const __m128i low16 = _mm_set1_epi32(0xffff);
+      const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+      const __m128  scale = _mm_set1_ps(s_normalScale);
+      const __m128  one   = _mm_set1_ps(1.0f);
+      const __m128  zero  = _mm_setzero_ps();
+      const __m128  h     = _mm_set1_ps(127.5f);
+      const __m128  half  = _mm_set1_ps(0.5f);
+
+      size_t k = 0;
+      for(; k + 4 <= count; k += 4) {
+        // x0 y0 x1 y1 ... widened to 16 bit, so every 32-bit lane holds one pixel's (x, y).
+        __m128i xy = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + k * 2)));
+        __m128i xi = _mm_and_si128(xy, low16);
+        __m128i yi = _mm_srli_epi32(xy, 16);
+
+        __m128 x  = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(xi), scale), one);
+        __m128 y  = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(yi), scale), one);
+        __m128 z2 = _mm_sub_ps(_mm_sub_ps(one, _mm_mul_ps(x, x)), _mm_mul_ps(y, y));
+        __m128 z  = _mm_sqrt_ps(_mm_max_ps(z2, zero));
+        __m128i zi = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_add_ps(z, one), h), half));
+
+        __m128i px = _mm_or_si128(_mm_or_si128(xi, _mm_slli_epi32(yi, 8)), _mm_or_si128(_mm_slli_epi32(zi, 16), alpha));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + k * 4), px);
+      }
+      return k;
+    }
+
+    //
+    // AVX2 kernels, same structure at twice the width. 128-bit lane-local shuffles see
+    // four pixels each, so the byte masks are simply the SSE ones repeated.
+    //
+    SAE_TARGET_AVX2
+    static size_t ExpandAVX2(const uint8_t *src, unsigned int channels, uint8_t *dst, size_t count)
+    {
+      if(channels != 3)
+        return ExpandSSE41(src, channels, dst, count);
+
+      const __m256i shuffle = _mm256_setr_epi8(
+        0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+        0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+      const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+
+      size_t k = 0;
+      for(; k + 10 <= count; k += 8) {
+        const uint8_t *s = src + k * 3;
+        __m256i rgb = _mm256_inserti128_si256(
+          _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s))),
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 12)), 1);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + k * 4), _mm256_or_si256(_mm256_shuffle_epi8(rgb, shuffle), alpha));
+      }
+      return k;
+    }
+
+    SAE_TARGET_AVX2
+    static size_t SwizzleAVX2(const uint8_t *src, uint8_t *dst, size_t count, const uint8_t order[4])
+    {
+      int8_t mask[32];
+      for(int p=0; p < 8; ++p)
+        for(int c=0; c < 4; ++c)
+          mask[p * 4 + c] = static_cast<int8_t>((p & 3) * 4 + (order[c] & 3));
+      const __m256i shuffle = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mask));
+
+      size_t k = 0;
+      for(; k + 8 <= count; k += 8) {
+        __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + k * 4));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + k * 4), _mm256_shuffle_epi8(px, shuffle));
+      }
+      return k;
+    }
+
+    SAE_TARGET_AVX2
+    static size_t PremultiplyAVX2(const uint8_t *src, uint8_t *dst, size_t count)
+    {
+      const __m256i zero      = _mm256_setzero_si256();
+      const __m256i round     = _mm256_set1_epi16(128);
+      const __m256i alphaMask = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+
+      size_t k = 0;
+      for(; k + 8 <= count; k += 8) {
+        __m256i px  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + k * 4));
+        __m256i lo  = _mm256_unpacklo_epi8(px, zero);
+        __m256i hi  = _mm256_unpackhi_epi8(px, zero);
+        __m256i alo = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(lo, 0xFF), 0xFF);
+        __m256i ahi = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(hi, 0xFF), 0xFF);
+
+        lo = _mm256_add_epi16(_mm256_mullo_epi16(lo, alo), round);
+        hi = _mm256_add_epi16(_mm256_mullo_epi16(hi, ahi), round);
+        lo = _mm256_srli_epi16(_mm256_add_epi16(lo, _mm256_srli_epi16(lo, 8)), 8);
+        hi = _mm256_srli_epi16(_mm256_add_epi16(hi, _mm256_srli_epi16(hi, 8)), 8);
+
+        __m256i res = _mm256_blendv_epi8(_mm256_packus_epi16(lo, hi), px, alphaMask);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + k * 4), res);
+      }
+      return k;
+    }
+
+    SAE_TARGET_AVX2
+    static size_t SRGBToLinearAVX2(const uint8_t *src, float *dst, size_t count)
+    {
+      const float  *lut         = GetSRGBTables().toLinear;
+      const __m256i alphaOffset = _mm256_setr_epi32(0, 0, 0, 256, 0, 0, 0, 256);
+
+      size_t k = 0;
+      for(; k + 2 <= count; k += 2) {
+        __m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + k * 4)));
+        __m256  v   = _mm256_i32gather_ps(lut, _mm256_add_epi32(idx, alphaOffset), 4);
+        _mm256_storeu_ps(dst + k * 4, v);
+      }
+      return k;
+    }
+
+    SAE_TARGET_AVX2
+    static size_t LinearToSRGBAVX2(const float *src, uint8_t *dst, size_t count)
+    {
+      const __m256  minVal    = _mm256_castsi256_ps(_mm256_set1_epi32(s_srgbMinValBits));
+      const __m256  almostOne = _mm256_castsi256_ps(_mm256_set1_epi32(s_srgbAlmostOneBits));
+      const __m256i minValU   = _mm256_set1_epi32(s_srgbMinValBits);
+      const __m256i low16     = _mm256_set1_epi32(0xffff);
+      const __m256i low8      = _mm256_set1_epi32(0xff);
+      const __m256  zero      = _mm256_setzero_ps();
+      const __m256  one       = _mm256_set1_ps(1.0f);
+      const __m256  scale255  = _mm256_set1_ps(255.0f);
+      const __m256  half      = _mm256_set1_ps(0.5f);
+      const __m256i order     = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+      const int    *table     = reinterpret_cast<const int*>(s_linearToSRGBTable);
+
+      size_t k = 0;
+      for(; k + 8 <= count; k += 8) {
+        __m256i res[4];
+        for(int p=0; p < 4; ++p) {
+          __m256  v    = _mm256_loadu_ps(src + (k + p * 2) * 4);
+          __m256  c    = _mm256_min_ps(_mm256_max_ps(v, minVal), almostOne);
+          __m256i u    = _mm256_castps_si256(c);
+          __m256i idx  = _mm256_srli_epi32(_mm256_sub_epi32(u, minValU), 20);
+          __m256i tab  = _mm256_i32gather_epi32(table, idx, 4);
+          __m256i bias = _mm256_slli_epi32(_mm256_srli_epi32(tab, 16), 9);
+          __m256i t    = _mm256_and_si256(_mm256_srli_epi32(u, 12), low8);
+          __m256i rgb  = _mm256_srli_epi32(_mm256_add_epi32(bias, _mm256_mullo_epi32(_mm256_and_si256(tab, low16), t)), 16);
+
+          __m256  a    = _mm256_min_ps(_mm256_max_ps(v, zero), one);
+          __m256i a8   = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(a, scale255), half));
+          res[p] = _mm256_blend_epi32(rgb, a8, 0x88);
+        }
+        // The lane-wise packs leave pixels as 0 2 4 6 | 1 3 5 7; put them back in order.
+        __m256i packed = _mm256_packus_epi16(_mm256_packus_epi32(res[0], res[1]), _mm256_packus_epi32(res[2], res[3]));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + k * 4), _mm256_permutevar8x32_epi32(packed, order));
+      }
+      return k;
+    }
+
+    SAE_TARGET_AVX2
+    static size_t ExtractNormalXYAVX2(const uint8_t *src, uint8_t *dst, size_t count)
+    {
+      const __m256i shuffle = _mm256_setr_epi8(
+        0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1,
+        0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+
+      size_t k = 0;
+      for(; k + 8 <= count; k += 8) {
+        __m256i px = _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + k * 4)), shuffle);
+        px = _mm256_permute4x64_epi64(px, 0x08); // qwords 0, 2 -> low lane
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + k * 2), _mm256_castsi256_si128(px));
+      }
+      return k;
+    }
+
+    SAE_TARGET_AVX2
+    static size_t ReconstructNormalZAVX2(const uint8_t *src, uint8_t *dst, size_t count)
+    {
+      const __m256i low16 = _mm256_set1_epi32(0xffff);
+      const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+      const __m256  scale = _mm256_set1_ps(s_normalScale);
+      const __m256  one   = _mm256_set1_ps(1.0f);
+      const __m256  zero  = _mm256_setzero_ps();
+      const __m256  h     = _mm256_set1_ps(127.5f);
+      const __m256  half  = _mm256_set1_ps(0.5f);
+
+      size_t k = 0;
+      for(; k + 8 <= count; k += 8) {
+        __m256i xy = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + k * 2)));
+        __m256i xi = _mm256_and_si256(xy, low16);
+        __m256i yi = _mm256_srli_epi32(xy, 16);
+
+        __m256 x  = _mm256_sub_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(xi), scale), one);
+        __m256 y  = _mm256_sub_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(yi), scale), one);
+        __m256 z2 = _mm256_sub_ps(_mm256_sub_ps(one, _mm256_mul_ps(x, x)), _mm256_mul_ps(y, y));
+        __m256 z  = _mm256_sqrt_ps(_mm256_max_ps(z2, zero));
+        __m256i zi = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(z, one), h), half));
+
+        __m256i px = _mm256_or_si256(_mm256_or_si256(xi, _mm256_slli_epi32(yi, 8)), _mm256_or_si256(_mm256_slli_epi32(zi, 16), alpha));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + k * 4), px);
+      }
+      return k;
+    }
+#endif
+
+    //
+    // Public entry points
+    //
+    void ExpandToRGBA(
+      const uint8_t   *src,
+      unsigned int     channels,
+      uint8_t         *dst,
+      size_t           count,
+      PixelKernelLevel level)
+    {
+      size_t done = 0;
+#if SAE_PIXEL_X86
+      switch(Resolve(level)) {
+      case PixelKernelLevel::AVX2:  done = ExpandAVX2(src, channels, dst, count);  break;
+      case PixelKernelLevel::SSE41: done = ExpandSSE41(src, channels, dst, count); break;
+      default: break;
+      }
+#endif
+      ExpandScalar(src + done * channels, channels, dst + done * 4, count - done);
+    }
+
+    void SwizzleRGBA(
+      const uint8_t   *src,
+      uint8_t         *dst,
+      size_t           count,
+      const uint8_t    order[4],
+      PixelKernelLevel level)
+    {
+      size_t done = 0;
+#if SAE_PIXEL_X86
+      switch(Resolve(level)) {
+      case PixelKernelLevel::AVX2:  done = SwizzleAVX2(src, dst, count, order);  break;
+      case PixelKernelLevel::SSE41: done = SwizzleSSE41(src, dst, count, order); break;
+      default: break;
+      }
+#endif
+      SwizzleScalar(src + done * 4, dst + done * 4, count - done, order);
+    }
+
+    void PremultiplyAlpha(
+      const uint8_t   *src,
+      uint8_t         *dst,
+      size_t           count,
+      PixelKernelLevel level)
+    {
+      size_t done = 0;
+#if SAE_PIXEL_X86
+      switch(Resolve(level)) {
+      case PixelKernelLevel::AVX2:  done = PremultiplyAVX2(src, dst, count);  break;
+      case PixelKernelLevel::SSE41: done = PremultiplySSE41(src, dst, count); break;
+      default: break;
+      }
+#endif
+      PremultiplyScalar(src + done * 4, dst + done * 4, count - done);
+    }
+
+    void SRGBToLinear(
+      const uint8_t   *src,
+      float           *dst,
+      size_t           count,
+      PixelKernelLevel level)
+    {
+      size_t done = 0;
+#if SAE_PIXEL_X86
+      // A table lookup per channel; without a gather instruction SSE has nothing on the scalar loop.
+      if(Resolve(level) == PixelKernelLevel::AVX2)
+        done = SRGBToLinearAVX2(src, dst, count);
+#endif
+      SRGBToLinearScalar(src + done * 4, dst + done * 4, count - done);
+    }
+
+    void LinearToSRGB(
+      const float     *src,
+      uint8_t         *dst,
+      size_t           count,
+      PixelKernelLevel level)
+    {
+      size_t done = 0;
+#if SAE_PIXEL_X86
+      switch(Resolve(level)) {
+      case PixelKernelLevel::AVX2:  done = LinearToSRGBAVX2(src, dst, count);  break;
+      case PixelKernelLevel::SSE41: done = LinearToSRGBSSE41(src, dst, count); break;
+      default: break;
+      }
+#endif
+      LinearToSRGBScalar(src + done * 4, dst + done * 4, count - done);
+    }
+
+    void ExtractNormalXY(
+      const uint8_t   *src,
+      uint8_t         *dst,
+      size_t           count,
+      PixelKernelLevel level)
+    {
+      size_t done = 0;
+#if SAE_PIXEL_X86
+      switch(Resolve(level)) {
+      case PixelKernelLevel::AVX2:  done = ExtractNormalXYAVX2(src, dst, count);  break;
+      case PixelKernelLevel::SSE41: done = ExtractNormalXYSSE41(src, dst, count); break;
+      default: break;
+      }
+#endif
+      ExtractNormalXYScalar(src + done * 4, dst + done * 2, count - done);
+    }
+
+    void ReconstructNormalZ(
+      const uint8_t   *src,
+      uint8_t         *dst,
+      size_t           count,
+      PixelKernelLevel level)
+    {
+      size_t done = 0;
+#if SAE_PIXEL_X86
+      switch(Resolve(level)) {
+      case PixelKernelLevel::AVX2:  done = ReconstructNormalZAVX2(src, dst, count);  break;
+      case PixelKernelLevel::SSE41: done = ReconstructNormalZSSE41(src, dst, count); break;
+      default: break;
+      }
+#endif
+      ReconstructNormalZScalar(src + done * 2, dst + done * 4, count - done);
+    }
+
+    //
+    // Benchmark
+    //
+    std::vector<PixelKernelBenchmarkResult> BenchmarkPixelConversion(
+      size_t       pixelCount,
+      unsigned int iterations)
+    {
+      typedef std::chrono::high_resolution_clock Clock;
+
+      std::vector<uint8_t> bytesIn(pixelCount * 4), bytesOut(pixelCount * 4);
+      std::vector<float>   floatsIn(pixelCount * 4), floatsOut(pixelCount * 4);
+
+      std::mt19937 rng(5300);
+      for(uint8_t &b : bytesIn)
+        b = static_cast<uint8_t>(rng() & 0xff);
+      for(float &f : floatsIn)
+        f = (rng() & 0xffff) / 65535.0f;
+
+      static const uint8_t bgra[4] ={ 2, 1, 0, 3 };
+
+      struct Kernel {
+        const char                          *name;
+        std::function<void(PixelKernelLevel)> run;
+      };
+      std::vector<Kernel> kernels ={
+        { "expand gray->rgba", [&] (PixelKernelLevel l) { ExpandToRGBA(bytesIn.data(), 1, bytesOut.data(), pixelCount, l); } },
+        { "expand rgb->rgba",  [&] (PixelKernelLevel l) { ExpandToRGBA(bytesIn.data(), 3, bytesOut.data(), pixelCount, l); } },
+        { "swizzle rgba->bgra",[&] (PixelKernelLevel l) { SwizzleRGBA(bytesIn.data(), bytesOut.data(), pixelCount, bgra, l); } },
+        { "premultiply alpha", [&] (PixelKernelLevel l) { PremultiplyAlpha(bytesIn.data(), bytesOut.data(), pixelCount, l); } },
+        { "srgb->linear",      [&] (PixelKernelLevel l) { SRGBToLinear(bytesIn.data(), floatsOut.data(), pixelCount, l); } },
+        { "linear->srgb",      [&] (PixelKernelLevel l) { LinearToSRGB(floatsIn.data(), bytesOut.data(), pixelCount, l); } },
+        { "normal extract xy", [&] (PixelKernelLevel l) { ExtractNormalXY(bytesIn.data(), bytesOut.data(), pixelCount, l); } },
+        { "normal rebuild z",  [&] (PixelKernelLevel l) { ReconstructNormalZ(bytesIn.data(), bytesOut.data(), pixelCount, l); } },
+      };
+
+      std::vector<PixelKernelBenchmarkResult> results;
+      for(Kernel const&kernel : kernels) {
+        double scalarRate = 0.0;
+        for(int l=0; l <= static_cast<int>(SupportedPixelKernelLevel()); ++l) {
+          PixelKernelLevel level = static_cast<PixelKernelLevel>(l);
+
+          kernel.run(level); // warm caches and tables
+          Clock::time_point start = Clock::now();
+          for(unsigned int k=0; k < iterations; ++k)
+            kernel.run(level);
+          double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+          PixelKernelBenchmarkResult result;
+          result.kernel              = kernel.name;
+          result.level               = level;
+          result.megapixelsPerSecond = (seconds > 0.0) ? ((double)pixelCount * iterations / seconds / 1.0e6) : 0.0;
+          if(level == PixelKernelLevel::Scalar)
+            scalarRate = result.megapixelsPerSecond;
+          result.speedupOverScalar   = (scalarRate > 0.0) ? (result.megapixelsPerSecond / scalarRate) : 0.0;
+          results.push_back(result);
+        }
+      }
+
+      return results;
+    }
+
+  }
+}
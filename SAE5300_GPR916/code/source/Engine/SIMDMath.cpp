@@ -0,0 +1,889 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <random>
+
+#include "Engine/SIMDMath.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+  #define SAE_MATH_X86 1
+  #include <immintrin.h>
+  #if defined(_MSC_VER)
+    #include <intrin.h>
+    // MSVC emits any intrinsic regardless of /arch, dispatch guards the call sites.
+    #define SAE_MATH_TARGET_SSE41
+    #define SAE_MATH_TARGET_AVX2
+  #else
+    #define SAE_MATH_TARGET_SSE41 __attribute__((target("sse4.1")))
+    #define SAE_MATH_TARGET_AVX2  __attribute__((target("avx2")))
+  #endif
+#else
+  #define SAE_MATH_X86 0
+#endif
+
+namespace SAE {
+  namespace Math {
+
+    //
+    // Dispatch
+    //
+    static MathKernelLevel DetectMathKernelLevel()
+    {
+#if SAE_MATH_X86
+  #if defined(_MSC_VER)
+      int info[4];
+      __cpuid(info, 0);
+      int maxLeaf = info[0];
+
+      __cpuid(info, 1);
+      bool sse41   = (info[2] & (1 << 19)) != 0;
+      bool osxsave = (info[2] & (1 << 27)) != 0;
+      bool avx     = (info[2] & (1 << 28)) != 0;
+      bool avx2    = false;
+      if(maxLeaf >= 7 && osxsave && avx && ((_xgetbv(0) & 6) == 6)) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+      }
+  #else
+      __builtin_cpu_init();
+      bool sse41 = __builtin_cpu_supports("sse4.1") != 0;
+      bool avx2  = __builtin_cpu_supports("avx2")   != 0;
+  #endif
+      if(avx2 && sse41)
+        return MathKernelLevel::AVX2;
+      if(sse41)
+        return MathKernelLevel::SSE41;
+#elif SAE_MATH_NEON
+      return MathKernelLevel::NEON;
+#endif
+      return MathKernelLevel::Scalar;
+    }
+
+    MathKernelLevel SupportedMathKernelLevel()
+    {
+      static const MathKernelLevel supported = DetectMathKernelLevel();
+      return supported;
+    }
+
+    const char* MathKernelLevelName(MathKernelLevel level)
+    {
+      switch(level) {
+      case MathKernelLevel::Scalar: return "scalar";
+      case MathKernelLevel::SSE41:  return "SSE4.1";
+      case MathKernelLevel::AVX2:   return "AVX2";
+      case MathKernelLevel::NEON:   return "NEON";
+      default:                      return "best";
+      }
+    }
+
+    // Levels of another architecture resolve to the scalar path.
+    static MathKernelLevel Resolve(MathKernelLevel requested)
+    {
+      MathKernelLevel supported = SupportedMathKernelLevel();
+      if(requested == MathKernelLevel::Best || requested > supported)
+        return supported;
+#if SAE_MATH_X86
+      return requested;
+#else
+      return (requested == supported) ? requested : MathKernelLevel::Scalar;
+#endif
+    }
+
+    //
+    // Scalar reference
+    //
+    static void MultiplyScalar(float const *lhs, float const *rhs, float *out, size_t count)
+    {
+      for(size_t k=0; k < count; ++k, lhs += 16, rhs += 16, out += 16) {
+        float result[16];
+        for(int r=0; r < 4; ++r)
+          for(int c=0; c < 4; ++c)
+            result[4 * r + c]
+              = lhs[4 * r] * rhs[c] + lhs[4 * r + 1] * rhs[4 + c] + lhs[4 * r + 2] * rhs[8 + c] + lhs[4 * r + 3] * rhs[12 + c];
+        memcpy(out, result, sizeof(result));
+      }
+    }
+
+    // Cofactor expansion of the 2x2 minors.
+    static void InvertScalar(float const *in, float *out, size_t count)
+    {
+      for(size_t k=0; k < count; ++k, in += 16, out += 16) {
+        float const*m = in;
+
+        float const s0 = m[0] * m[5]  - m[4]  * m[1];
+        float const s1 = m[0] * m[6]  - m[4]  * m[2];
+        float const s2 = m[0] * m[7]  - m[4]  * m[3];
+        float const s3 = m[1] * m[6]  - m[5]  * m[2];
+        float const s4 = m[1] * m[7]  - m[5]  * m[3];
+        float const s5 = m[2] * m[7]  - m[6]  * m[3];
+        float const c5 = m[10] * m[15] - m[14] * m[11];
+        float const c4 = m[9]  * m[15] - m[13] * m[11];
+        float const c3 = m[9]  * m[14] - m[13] * m[10];
+        float const c2 = m[8]  * m[15] - m[12] * m[11];
+        float const c1 = m[8]  * m[14] - m[12] * m[10];
+        float const c0 = m[8]  * m[13] - m[12] * m[9];
+
+        float const inverseDet = 1.0f / (s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0);
+
+        float result[16];
+        result[0]  = ( m[5]  * c5 - m[6]  * c4 + m[7]  * c3) * inverseDet;
+        result[1]  = (-m[1]  * c5 + m[2]  * c4 - m[3]  * c3) * inverseDet;
+        result[2]  = ( m[13] * s5 - m[14] * s4 + m[15] * s3) * inverseDet;
+        result[3]  = (-m[9]  * s5 + m[10] * s4 - m[11] * s3) * inverseDet;
+        result[4]  = (-m[4]  * c5 + m[6]  * c2 - m[7]  * c1) * inverseDet;
+        result[5]  = ( m[0]  * c5 - m[2]  * c2 + m[3]  * c1) * inverseDet;
+        result[6]  = (-m[12] * s5 + m[14] * s2 - m[15] * s1) * inverseDet;
+        result[7]  = ( m[8]  * s5 - m[10] * s2 + m[11] * s1) * inverseDet;
+        result[8]  = ( m[4]  * c4 - m[5]  * c2 + m[7]  * c0) * inverseDet;
+        result[9]  = (-m[0]  * c4 + m[1]  * c2 - m[3]  * c0) * inverseDet;
+        result[10] = ( m[12] * s4 - m[13] * s2 + m[15] * s0) * inverseDet;
+        result[11] = (-m[8]  * s4 + m[9]  * s2 - m[11] * s0) * inverseDet;
+        result[12] = (-m[4]  * c3 + m[5]  * c1 - m[6]  * c0) * inverseDet;
+        result[13] = ( m[0]  * c3 - m[1]  * c1 + m[2]  * c0) * inverseDet;
+        result[14] = (-m[12] * s3 + m[13] * s1 - m[14] * s0) * inverseDet;
+        result[15] = ( m[8]  * s3 - m[9]  * s1 + m[10] * s0) * inverseDet;
+        memcpy(out, result, sizeof(result));
+      }
+    }
+
+    static void TransformPointsScalar(
+      float const *m,
+      float const *x,
+      float const *y,
+      float const *z,
+      float       *outX,
+      float       *outY,
+      float       *outZ,
+      size_t       count)
+    {
+      for(size_t k=0; k < count; ++k) {
+        float const px = x[k], py = y[k], pz = z[k];
+        outX[k] = px * m[0] + py * m[4] + pz * m[8]  + m[12];
+        outY[k] = px * m[1] + py * m[5] + pz * m[9]  + m[13];
+        outZ[k] = px * m[2] + py * m[6] + pz * m[10] + m[14];
+      }
+    }
+
+    static void TransformBoxesScalar(
+      float    const *matrices,
+      BoxesSoA const &in,
+      BoxesSoA const &out,
+      size_t          begin,
+      size_t          end)
+    {
+      for(size_t k=begin; k < end; ++k) {
+        float const*m = matrices + 16 * k;
+
+        float const center[3] ={ 0.5f * (in.minX[k] + in.maxX[k]), 0.5f * (in.minY[k] + in.maxY[k]), 0.5f * (in.minZ[k] + in.maxZ[k]) };
+        float const extent[3] ={ 0.5f * (in.maxX[k] - in.minX[k]), 0.5f * (in.maxY[k] - in.minY[k]), 0.5f * (in.maxZ[k] - in.minZ[k]) };
+
+        float worldCenter[3], worldExtent[3];
+        for(int a=0; a < 3; ++a) {
+          worldCenter[a] = center[0] * m[a] + center[1] * m[4 + a] + center[2] * m[8 + a] + m[12 + a];
+          worldExtent[a] = extent[0] * std::fabs(m[a]) + extent[1] * std::fabs(m[4 + a]) + extent[2] * std::fabs(m[8 + a]);
+        }
+
+        out.minX[k] = worldCenter[0] - worldExtent[0];
+        out.minY[k] = worldCenter[1] - worldExtent[1];
+        out.minZ[k] = worldCenter[2] - worldExtent[2];
+        out.maxX[k] = worldCenter[0] + worldExtent[0];
+        out.maxY[k] = worldCenter[1] + worldExtent[1];
+        out.maxZ[k] = worldCenter[2] + worldExtent[2];
+      }
+    }
+
+    static void ComposeScalar(
+      TransformsSoA const &in,
+      float               *outMatrices,
+      float               *outNormals,
+      size_t               begin,
+      size_t               end)
+    {
+      for(size_t k=begin; k < end; ++k) {
+        float const x = in.rotationX[k], y = in.rotationY[k], z = in.rotationZ[k], w = in.rotationW[k];
+        float const x2 = x + x, y2 = y + y, z2 = z + z;
+        float const xx = x * x2, xy = x * y2, xz = x * z2, xw = w * x2;
+        float const yy = y * y2, yz = y * z2, yw = w * y2;
+        float const zz = z * z2, zw = w * z2;
+
+        float const rotation[3][3] ={
+          { 1.0f - yy - zz, xy + zw,        xz - yw        },
+          { xy - zw,        1.0f - xx - zz, yz + xw        },
+          { xz + yw,        yz - xw,        1.0f - xx - yy } };
+        float const scale[3] ={ in.scaleX[k], in.scaleY[k], in.scaleZ[k] };
+
+        float *m = outMatrices + 16 * k;
+        for(int r=0; r < 3; ++r) {
+          for(int c=0; c < 3; ++c)
+            m[4 * r + c] = rotation[r][c] * scale[r];
+          m[4 * r + 3] = 0.0f;
+        }
+        m[12] = in.translationX[k];
+        m[13] = in.translationY[k];
+        m[14] = in.translationZ[k];
+        m[15] = 1.0f;
+
+        if(!outNormals)
+          continue;
+
+        float *n = outNormals + 16 * k;
+        for(int r=0; r < 3; ++r) {
+          float const inverse = 1.0f / scale[r];
+          for(int c=0; c < 3; ++c)
+            n[4 * r + c] = rotation[r][c] * inverse;
+          n[4 * r + 3] = 0.0f;
+        }
+        n[12] = n[13] = n[14] = 0.0f;
+        n[15] = 1.0f;
+      }
+    }
+
+    //
+    // Register layer: SSE4.1 and NEON paths of the matrix kernels
+    //
+#if SAE_MATH_X86
+    SAE_MATH_TARGET_SSE41
+#endif
+    static void MultiplyVec4(float const *lhs, float const *rhs, float *out, size_t count)
+    {
+      for(size_t k=0; k < count; ++k, lhs += 16, rhs += 16, out += 16)
+        StoreMat4(out, Multiply(LoadMat4(lhs), LoadMat4(rhs)));
+    }
+
+#if SAE_MATH_X86
+    SAE_MATH_TARGET_SSE41
+#endif
+    static void InvertVec4(float const *in, float *out, size_t count)
+    {
+      for(size_t k=0; k < count; ++k, in += 16, out += 16)
+        StoreMat4(out, Inverse(LoadMat4(in)));
+    }
+
+#if SAE_MATH_X86
+    SAE_MATH_TARGET_SSE41
+#endif
+    static void ComposeVec4(
+      TransformsSoA const &in,
+      float               *outMatrices,
+      float               *outNormals,
+      size_t               count)
+    {
+      Vec4 const one  = Splat(1.0f);
+      Vec4 const zero = Zero();
+
+      // One transform per lane; the rows are transposed into the matrices on the way out.
+      size_t k=0;
+      for(; (k + 4) <= count; k += 4) {
+        Vec4 const x = Load4(in.rotationX + k), y = Load4(in.rotationY + k);
+        Vec4 const z = Load4(in.rotationZ + k), w = Load4(in.rotationW + k);
+        Vec4 const x2 = Add(x, x), y2 = Add(y, y), z2 = Add(z, z);
+        Vec4 const xx = Multiply(x, x2), xy = Multiply(x, y2), xz = Multiply(x, z2), xw = Multiply(w, x2);
+        Vec4 const yy = Multiply(y, y2), yz = Multiply(y, z2), yw = Multiply(w, y2);
+        Vec4 const zz = Multiply(z, z2), zw = Multiply(w, z2);
+
+        Vec4 const rotation[3][3] ={
+          { Subtract(Subtract(one, yy), zz), Add(xy, zw),                      Subtract(xz, yw)                 },
+          { Subtract(xy, zw),                Subtract(Subtract(one, xx), zz), Add(yz, xw)                      },
+          { Add(xz, yw),                     Subtract(yz, xw),                 Subtract(Subtract(one, xx), yy) } };
+        Vec4 const scale[3] ={ Load4(in.scaleX + k), Load4(in.scaleY + k), Load4(in.scaleZ + k) };
+
+        float *matrices = outMatrices + 16 * k;
+        for(int r=0; r < 3; ++r) {
+          Mat4 const rows = Transpose({ {
+            Multiply(rotation[r][0], scale[r]), Multiply(rotation[r][1], scale[r]), Multiply(rotation[r][2], scale[r]), zero } });
+          for(int j=0; j < 4; ++j)
+            Store4(matrices + 16 * j + 4 * r, rows.r[j]);
+        }
+        Mat4 const translations = Transpose({ { Load4(in.translationX + k), Load4(in.translationY + k), Load4(in.translationZ + k), one } });
+        for(int j=0; j < 4; ++j)
+          Store4(matrices + 16 * j + 12, translations.r[j]);
+
+        if(!outNormals)
+          continue;
+
+        float *normals = outNormals + 16 * k;
+        for(int r=0; r < 3; ++r) {
+          Vec4 const inverse = Divide(one, scale[r]);
+          Mat4 const rows = Transpose({ {
+            Multiply(rotation[r][0], inverse), Multiply(rotation[r][1], inverse), Multiply(rotation[r][2], inverse), zero } });
+          for(int j=0; j < 4; ++j)
+            Store4(normals + 16 * j + 4 * r, rows.r[j]);
+        }
+        Vec4 const lastRow = Set(0.0f, 0.0f, 0.0f, 1.0f);
+        for(int j=0; j < 4; ++j)
+          Store4(normals + 16 * j + 12, lastRow);
+      }
+      ComposeScalar(in, outMatrices, outNormals, k, count);
+    }
+
+#if SAE_MATH_X86
+    //
+    // SSE4.1
+    //
+    SAE_MATH_TARGET_SSE41
+    static void TransformPointsSSE41(
+      float const *m,
+      float const *x,
+      float const *y,
+      float const *z,
+      float       *outX,
+      float       *outY,
+      float       *outZ,
+      size_t       count)
+    {
+      __m128 const m00 = _mm_set1_ps(m[0]), m01 = _mm_set1_ps(m[1]), m02 = _mm_set1_ps(m[2]);
+      __m128 const m10 = _mm_set1_ps(m[4]), m11 = _mm_set1_ps(m[5]), m12 = _mm_set1_ps(m[6]);
+      __m128 const m20 = _mm_set1_ps(m[8]), m21 = _mm_set1_ps(m[9]), m22 = _mm_set1_ps(m[10]);
+      __m128 const m30 = _mm_set1_ps(m[12]), m31 = _mm_set1_ps(m[13]), m32 = _mm_set1_ps(m[14]);
+
+      size_t k=0;
+      for(; (k + 4) <= count; k += 4) {
+        __m128 const px = _mm_loadu_ps(x + k);
+        __m128 const py = _mm_loadu_ps(y + k);
+        __m128 const pz = _mm_loadu_ps(z + k);
+        _mm_storeu_ps(outX + k, _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px, m00), _mm_mul_ps(py, m10)), _mm_mul_ps(pz, m20)), m30));
+        _mm_storeu_ps(outY + k, _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px, m01), _mm_mul_ps(py, m11)), _mm_mul_ps(pz, m21)), m31));
+        _mm_storeu_ps(outZ + k, _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px, m02), _mm_mul_ps(py, m12)), _mm_mul_ps(pz, m22)), m32));
+      }
+      TransformPointsScalar(m, x + k, y + k, z + k, outX + k, outY + k, outZ + k, count - k);
+    }
+
+    // Rows `row` of four matrices, transposed: outColumns[c] holds element c of each.
+    SAE_MATH_TARGET_SSE41
+    static inline void GatherRow(float const *matrices, int row, __m128 outColumns[4])
+    {
+      outColumns[0] = _mm_loadu_ps(matrices + 4 * row);
+      outColumns[1] = _mm_loadu_ps(matrices + 4 * row + 16);
+      outColumns[2] = _mm_loadu_ps(matrices + 4 * row + 32);
+      outColumns[3] = _mm_loadu_ps(matrices + 4 * row + 48);
+      _MM_TRANSPOSE4_PS(outColumns[0], outColumns[1], outColumns[2], outColumns[3]);
+    }
+
+    SAE_MATH_TARGET_SSE41
+    static void TransformBoxesSSE41(
+      float    const *matrices,
+      BoxesSoA const &in,
+      BoxesSoA const &out,
+      size_t          count)
+    {
+      __m128 const half     = _mm_set1_ps(0.5f);
+      __m128 const signMask = _mm_set1_ps(-0.0f);
+
+      size_t k=0;
+      for(; (k + 4) <= count; k += 4) {
+        // rows[i][a]: element a of row i of the four matrices.
+        __m128 rows[4][4];
+        for(int i=0; i < 4; ++i)
+          GatherRow(matrices + 16 * k, i, rows[i]);
+
+        __m128 const minX = _mm_loadu_ps(in.minX + k), maxX = _mm_loadu_ps(in.maxX + k);
+        __m128 const minY = _mm_loadu_ps(in.minY + k), maxY = _mm_loadu_ps(in.maxY + k);
+        __m128 const minZ = _mm_loadu_ps(in.minZ + k), maxZ = _mm_loadu_ps(in.maxZ + k);
+
+        __m128 const cx = _mm_mul_ps(half, _mm_add_ps(minX, maxX));
+        __m128 const cy = _mm_mul_ps(half, _mm_add_ps(minY, maxY));
+        __m128 const cz = _mm_mul_ps(half, _mm_add_ps(minZ, maxZ));
+        __m128 const ex = _mm_mul_ps(half, _mm_sub_ps(maxX, minX));
+        __m128 const ey = _mm_mul_ps(half, _mm_sub_ps(maxY, minY));
+        __m128 const ez = _mm_mul_ps(half, _mm_sub_ps(maxZ, minZ));
+
+        float *outMin[3] ={ out.minX, out.minY, out.minZ };
+        float *outMax[3] ={ out.maxX, out.maxY, out.maxZ };
+        for(int a=0; a < 3; ++a) {
+          __m128 const center
+            = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, rows[0][a]), _mm_mul_ps(cy, rows[1][a])), _mm_mul_ps(cz, rows[2][a])), rows[3][a]);
+          __m128 const extent
+            = _mm_add_ps(_mm_add_ps(
+                _mm_mul_ps(ex, _mm_andnot_ps(signMask, rows[0][a])),
+                _mm_mul_ps(ey, _mm_andnot_ps(signMask, rows[1][a]))),
+                _mm_mul_ps(ez, _mm_andnot_ps(signMask, rows[2][a])));
+
+          _mm_storeu_ps(outMin[a] + k, _mm_sub_ps(center, extent));
+          _mm_storeu_ps(outMax[a] + k, _mm_add_ps(center, extent));
+        }
+      }
+      TransformBoxesScalar(matrices, in, out, k, count);
+    }
+
+    //
+    // AVX2
+    //
+    // Two rows of the left matrix per register, each lane broadcasting its own row's element.
+    SAE_MATH_TARGET_AVX2
+    static void MultiplyAVX2(float const *lhs, float const *rhs, float *out, size_t count)
+    {
+      for(size_t k=0; k < count; ++k, lhs += 16, rhs += 16, out += 16) {
+        __m128 const r0 = _mm_loadu_ps(rhs),     r1 = _mm_loadu_ps(rhs + 4);
+        __m128 const r2 = _mm_loadu_ps(rhs + 8), r3 = _mm_loadu_ps(rhs + 12);
+        __m256 const b0 = _mm256_insertf128_ps(_mm256_castps128_ps256(r0), r0, 1);
+        __m256 const b1 = _mm256_insertf128_ps(_mm256_castps128_ps256(r1), r1, 1);
+        __m256 const b2 = _mm256_insertf128_ps(_mm256_castps128_ps256(r2), r2, 1);
+        __m256 const b3 = _mm256_insertf128_ps(_mm256_castps128_ps256(r3), r3, 1);
+
+        __m256 const a01 = _mm256_loadu_ps(lhs);
+        __m256 const a23 = _mm256_loadu_ps(lhs + 8);
+
+        __m256 out01 = _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, 0x00), b0);
+        out01 = _mm256_add_ps(out01, _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, 0x55), b1));
+        out01 = _mm256_add_ps(out01, _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, 0xAA), b2));
+        out01 = _mm256_add_ps(out01, _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, 0xFF), b3));
+
+        __m256 out23 = _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, 0x00), b0);
+        out23 = _mm256_add_ps(out23, _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, 0x55), b1));
+        out23 = _mm256_add_ps(out23, _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, 0xAA), b2));
+        out23 = _mm256_add_ps(out23, _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, 0xFF), b3));
+
+        _mm256_storeu_ps(out,     out01);
+        _mm256_storeu_ps(out + 8, out23);
+      }
+    }
+
+    SAE_MATH_TARGET_AVX2
+    static void TransformPointsAVX2(
+      float const *m,
+      float const *x,
+      float const *y,
+      float const *z,
+      float       *outX,
+      float       *outY,
+      float       *outZ,
+      size_t       count)
+    {
+      __m256 const m00 = _mm256_set1_ps(m[0]), m01 = _mm256_set1_ps(m[1]), m02 = _mm256_set1_ps(m[2]);
+      __m256 const m10 = _mm256_set1_ps(m[4]), m11 = _mm256_set1_ps(m[5]), m12 = _mm256_set1_ps(m[6]);
+      __m256 const m20 = _mm256_set1_ps(m[8]), m21 = _mm256_set1_ps(m[9]), m22 = _mm256_set1_ps(m[10]);
+      __m256 const m30 = _mm256_set1_ps(m[12]), m31 = _mm256_set1_ps(m[13]), m32 = _mm256_set1_ps(m[14]);
+
+      size_t k=0;
+      for(; (k + 8) <= count; k += 8) {
+        __m256 const px = _mm256_loadu_ps(x + k);
+        __m256 const py = _mm256_loadu_ps(y + k);
+        __m256 const pz = _mm256_loadu_ps(z + k);
+        _mm256_storeu_ps(outX + k, _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px, m00), _mm256_mul_ps(py, m10)), _mm256_mul_ps(pz, m20)), m30));
+        _mm256_storeu_ps(outY + k, _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px, m01), _mm256_mul_ps(py, m11)), _mm256_mul_ps(pz, m21)), m31));
+        _mm256_storeu_ps(outZ + k, _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px, m02), _mm256_mul_ps(py, m12)), _mm256_mul_ps(pz, m22)), m32));
+      }
+      TransformPointsScalar(m, x + k, y + k, z + k, outX + k, outY + k, outZ + k, count - k);
+    }
+
+    // Eight boxes per iteration; the matrix elements are gathered four matrices at a time.
+    SAE_MATH_TARGET_AVX2
+    static void TransformBoxesAVX2(
+      float    const *matrices,
+      BoxesSoA const &in,
+      BoxesSoA const &out,
+      size_t          count)
+    {
+      __m256 const half     = _mm256_set1_ps(0.5f);
+      __m256 const signMask = _mm256_set1_ps(-0.0f);
+
+      size_t k=0;
+      for(; (k + 8) <= count; k += 8) {
+        __m256 rows[4][4];
+        for(int i=0; i < 4; ++i) {
+          __m128 low[4], high[4];
+          GatherRow(matrices + 16 * k,       i, low);
+          GatherRow(matrices + 16 * (k + 4), i, high);
+          for(int a=0; a < 4; ++a)
+            rows[i][a] = _mm256_insertf128_ps(_mm256_castps128_ps256(low[a]), high[a], 1);
+        }
+
+        __m256 const minX = _mm256_loadu_ps(in.minX + k), maxX = _mm256_loadu_ps(in.maxX + k);
+        __m256 const minY = _mm256_loadu_ps(in.minY + k), maxY = _mm256_loadu_ps(in.maxY + k);
+        __m256 const minZ = _mm256_loadu_ps(in.minZ + k), maxZ = _mm256_loadu_ps(in.maxZ + k);
+
+        __m256 const cx = _mm256_mul_ps(half, _mm256_add_ps(minX, maxX));
+        __m256 const cy = _mm256_mul_ps(half, _mm256_add_ps(minY, maxY));
+        __m256 const cz = _mm256_mul_ps(half, _mm256_add_ps(minZ, maxZ));
+        __m256 const ex = _mm256_mul_ps(half, _mm256_sub_ps(maxX, minX));
+        __m256 const ey = _mm256_mul_ps(half, _mm256_sub_ps(maxY, minY));
+        __m256 const ez = _mm256_mul_ps(half, _mm256_sub_ps(maxZ, minZ));
+
+        float *outMin[3] ={ out.minX, out.minY, out.minZ };
+        float *outMax[3] ={ out.maxX, out.maxY, out.maxZ };
+        for(int a=0; a < 3; ++a) {
+          __m256 const center
+            = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(cx, rows[0][a]), _mm256_mul_ps(cy, rows[1][a])), _mm256_mul_ps(cz, rows[2][a])), rows[3][a]);
+          __m256 const extent
+            = _mm256_add_ps(_mm256_add_ps(
+                _mm256_mul_ps(ex, _mm256_andnot_ps(signMask, rows[0][a])),
+                _mm256_mul_ps(ey, _mm256_andnot_ps(signMask, rows[1][a]))),
+                _mm256_mul_ps(ez, _mm256_andnot_ps(signMask, rows[2][a])));
+
+          _mm256_storeu_ps(outMin[a] + k, _mm256_sub_ps(center, extent));
+          _mm256_storeu_ps(outMax[a] + k, _mm256_add_ps(center, extent));
+        }
+      }
+      TransformBoxesSSE41(matrices + 16 * k, { in.minX + k, in.minY + k, in.minZ + k, in.maxX + k, in.maxY + k, in.maxZ + k }, { out.minX + k, out.minY + k, out.minZ + k, out.maxX + k, out.maxY + k, out.maxZ + k }, count - k);
+    }
+    // Eight consecutive matrix elements of eight transforms, element e in lane j of rows[e]
+    // for transform j: transposed 8 x 8 and stored as those elements of each matrix, one
+    // 32 byte store per transform, the matrices 16 floats apart from out on.
+    SAE_MATH_TARGET_AVX2
+    static inline void StoreTransposed8(__m256 const rows[8], float *out)
+    {
+      __m256 const t0 = _mm256_unpacklo_ps(rows[0], rows[1]), t1 = _mm256_unpackhi_ps(rows[0], rows[1]);
+      __m256 const t2 = _mm256_unpacklo_ps(rows[2], rows[3]), t3 = _mm256_unpackhi_ps(rows[2], rows[3]);
+      __m256 const t4 = _mm256_unpacklo_ps(rows[4], rows[5]), t5 = _mm256_unpackhi_ps(rows[4], rows[5]);
+      __m256 const t6 = _mm256_unpacklo_ps(rows[6], rows[7]), t7 = _mm256_unpackhi_ps(rows[6], rows[7]);
+
+      // Lane j of the low and j + 4 of the high half: elements 0-3 and 4-7 of transforms j, j + 4.
+      __m256 const q0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0)), q1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+      __m256 const q2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0)), q3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+      __m256 const q4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0)), q5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+      __m256 const q6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0)), q7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+      _mm256_storeu_ps(out,           _mm256_permute2f128_ps(q0, q4, 0x20));
+      _mm256_storeu_ps(out + 16,      _mm256_permute2f128_ps(q1, q5, 0x20));
+      _mm256_storeu_ps(out + 16 * 2,  _mm256_permute2f128_ps(q2, q6, 0x20));
+      _mm256_storeu_ps(out + 16 * 3,  _mm256_permute2f128_ps(q3, q7, 0x20));
+      _mm256_storeu_ps(out + 16 * 4,  _mm256_permute2f128_ps(q0, q4, 0x31));
+      _mm256_storeu_ps(out + 16 * 5,  _mm256_permute2f128_ps(q1, q5, 0x31));
+      _mm256_storeu_ps(out + 16 * 6,  _mm256_permute2f128_ps(q2, q6, 0x31));
+      _mm256_storeu_ps(out + 16 * 7,  _mm256_permute2f128_ps(q3, q7, 0x31));
+    }
+
+    SAE_MATH_TARGET_AVX2
+    static void ComposeAVX2(
+      TransformsSoA const &in,
+      float               *outMatrices,
+      float               *outNormals,
+      size_t               count)
+    {
+      __m256 const one  = _mm256_set1_ps(1.0f);
+      __m256 const zero = _mm256_setzero_ps();
+
+      // One transform per lane. The 16 elements of the matrices are transposed in two halves,
+      // rows 0-1 and rows 2-3, so every transform takes two full width stores per matrix.
+      size_t k=0;
+      for(; (k + 8) <= count; k += 8) {
+        __m256 const x = _mm256_loadu_ps(in.rotationX + k), y = _mm256_loadu_ps(in.rotationY + k);
+        __m256 const z = _mm256_loadu_ps(in.rotationZ + k), w = _mm256_loadu_ps(in.rotationW + k);
+        __m256 const x2 = _mm256_add_ps(x, x), y2 = _mm256_add_ps(y, y), z2 = _mm256_add_ps(z, z);
+        __m256 const xx = _mm256_mul_ps(x, x2), xy = _mm256_mul_ps(x, y2), xz = _mm256_mul_ps(x, z2), xw = _mm256_mul_ps(w, x2);
+        __m256 const yy = _mm256_mul_ps(y, y2), yz = _mm256_mul_ps(y, z2), yw = _mm256_mul_ps(w, y2);
+        __m256 const zz = _mm256_mul_ps(z, z2), zw = _mm256_mul_ps(w, z2);
+
+        __m256 const rotation[3][3] ={
+          { _mm256_sub_ps(_mm256_sub_ps(one, yy), zz), _mm256_add_ps(xy, zw),                       _mm256_sub_ps(xz, yw)                       },
+          { _mm256_sub_ps(xy, zw),                      _mm256_sub_ps(_mm256_sub_ps(one, xx), zz), _mm256_add_ps(yz, xw)                       },
+          { _mm256_add_ps(xz, yw),                      _mm256_sub_ps(yz, xw),                       _mm256_sub_ps(_mm256_sub_ps(one, xx), yy) } };
+        __m256 const scale[3] ={ _mm256_loadu_ps(in.scaleX + k), _mm256_loadu_ps(in.scaleY + k), _mm256_loadu_ps(in.scaleZ + k) };
+
+        float *matrices = outMatrices + 16 * k;
+        __m256 const upper[8] ={
+          _mm256_mul_ps(rotation[0][0], scale[0]), _mm256_mul_ps(rotation[0][1], scale[0]), _mm256_mul_ps(rotation[0][2], scale[0]), zero,
+          _mm256_mul_ps(rotation[1][0], scale[1]), _mm256_mul_ps(rotation[1][1], scale[1]), _mm256_mul_ps(rotation[1][2], scale[1]), zero };
+        __m256 const lower[8] ={
+          _mm256_mul_ps(rotation[2][0], scale[2]), _mm256_mul_ps(rotation[2][1], scale[2]), _mm256_mul_ps(rotation[2][2], scale[2]), zero,
+          _mm256_loadu_ps(in.translationX + k),    _mm256_loadu_ps(in.translationY + k),    _mm256_loadu_ps(in.translationZ + k),    one };
+        StoreTransposed8(upper, matrices);
+        StoreTransposed8(lower, matrices + 8);
+
+        if(!outNormals)
+          continue;
+
+        float       *normals = outNormals + 16 * k;
+        __m256 const inverse[3] ={ _mm256_div_ps(one, scale[0]), _mm256_div_ps(one, scale[1]), _mm256_div_ps(one, scale[2]) };
+        __m256 const normalUpper[8] ={
+          _mm256_mul_ps(rotation[0][0], inverse[0]), _mm256_mul_ps(rotation[0][1], inverse[0]), _mm256_mul_ps(rotation[0][2], inverse[0]), zero,
+          _mm256_mul_ps(rotation[1][0], inverse[1]), _mm256_mul_ps(rotation[1][1], inverse[1]), _mm256_mul_ps(rotation[1][2], inverse[1]), zero };
+        StoreTransposed8(normalUpper, normals);
+
+        // Rows 2-3 of a normal matrix: the third row, then (0, 0, 0, 1). Only the first four
+        // elements differ per transform, so half the transpose suffices.
+        __m128 const lastRow = _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f);
+        __m256 const r0 = _mm256_mul_ps(rotation[2][0], inverse[2]);
+        __m256 const r1 = _mm256_mul_ps(rotation[2][1], inverse[2]);
+        __m256 const r2 = _mm256_mul_ps(rotation[2][2], inverse[2]);
+        __m256 const t0 = _mm256_unpacklo_ps(r0, r1), t1 = _mm256_unpackhi_ps(r0, r1);
+        __m256 const t2 = _mm256_unpacklo_ps(r2, zero), t3 = _mm256_unpackhi_ps(r2, zero);
+        __m256 const rows[4] ={
+          _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0)), _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2)),
+          _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0)), _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2)) };
+        for(int j=0; j < 4; ++j) {
+          _mm256_storeu_ps(normals + 16 * j + 8,       _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_castps256_ps128(rows[j])), lastRow, 1));
+          _mm256_storeu_ps(normals + 16 * (j + 4) + 8, _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_extractf128_ps(rows[j], 1)), lastRow, 1));
+        }
+      }
+      ComposeScalar(in, outMatrices, outNormals, k, count);
+    }
+#endif
+
+#if SAE_MATH_NEON
+    //
+    // NEON
+    //
+    static void TransformPointsNEON(
+      float const *m,
+      float const *x,
+      float const *y,
+      float const *z,
+      float       *outX,
+      float       *outY,
+      float       *outZ,
+      size_t       count)
+    {
+      size_t k=0;
+      for(; (k + 4) <= count; k += 4) {
+        float32x4_t const px = vld1q_f32(x + k);
+        float32x4_t const py = vld1q_f32(y + k);
+        float32x4_t const pz = vld1q_f32(z + k);
+        vst1q_f32(outX + k, vfmaq_n_f32(vfmaq_n_f32(vfmaq_n_f32(vdupq_n_f32(m[12]), px, m[0]), py, m[4]), pz, m[8]));
+        vst1q_f32(outY + k, vfmaq_n_f32(vfmaq_n_f32(vfmaq_n_f32(vdupq_n_f32(m[13]), px, m[1]), py, m[5]), pz, m[9]));
+        vst1q_f32(outZ + k, vfmaq_n_f32(vfmaq_n_f32(vfmaq_n_f32(vdupq_n_f32(m[14]), px, m[2]), py, m[6]), pz, m[10]));
+      }
+      TransformPointsScalar(m, x + k, y + k, z + k, outX + k, outY + k, outZ + k, count - k);
+    }
+
+    // One box per iteration: centre and extents through the register layer.
+    static void TransformBoxesNEON(
+      float    const *matrices,
+      BoxesSoA const &in,
+      BoxesSoA const &out,
+      size_t          count)
+    {
+      for(size_t k=0; k < count; ++k) {
+        Mat4 const m = LoadMat4(matrices + 16 * k);
+        Vec4 const minimum = Set(in.minX[k], in.minY[k], in.minZ[k], 0.0f);
+        Vec4 const maximum = Set(in.maxX[k], in.maxY[k], in.maxZ[k], 0.0f);
+
+        Vec4 const center = TransformPoint(Scale(Add(minimum, maximum), 0.5f), m);
+        Vec4 const extent = Scale(Subtract(maximum, minimum), 0.5f);
+
+        Vec4 worldExtent = Multiply(SplatX(extent), Abs(m.r[0]));
+        worldExtent = MultiplyAdd(SplatY(extent), Abs(m.r[1]), worldExtent);
+        worldExtent = MultiplyAdd(SplatZ(extent), Abs(m.r[2]), worldExtent);
+
+        Vec4 const lower = Subtract(center, worldExtent);
+        Vec4 const upper = Add(center, worldExtent);
+        out.minX[k] = GetX(lower); out.minY[k] = GetY(lower); out.minZ[k] = GetZ(lower);
+        out.maxX[k] = GetX(upper); out.maxY[k] = GetY(upper); out.maxZ[k] = GetZ(upper);
+      }
+    }
+#endif
+
+    //
+    // Public entry points
+    //
+    void MultiplyMatrices(
+      float const    *lhs,
+      float const    *rhs,
+      float          *out,
+      size_t          count,
+      MathKernelLevel level)
+    {
+      switch(Resolve(level)) {
+#if SAE_MATH_X86
+      case MathKernelLevel::AVX2:  MultiplyAVX2(lhs, rhs, out, count); return;
+      case MathKernelLevel::SSE41: MultiplyVec4(lhs, rhs, out, count); return;
+#elif SAE_MATH_NEON
+      case MathKernelLevel::NEON:  MultiplyVec4(lhs, rhs, out, count); return;
+#endif
+      default: break;
+      }
+      MultiplyScalar(lhs, rhs, out, count);
+    }
+
+    void InvertMatrices(
+      float const    *in,
+      float          *out,
+      size_t          count,
+      MathKernelLevel level)
+    {
+      // The 2x2 block inverse fills 128 bit registers exactly; AVX2 has nothing to add.
+      switch(Resolve(level)) {
+#if SAE_MATH_X86
+      case MathKernelLevel::AVX2:
+      case MathKernelLevel::SSE41: InvertVec4(in, out, count); return;
+#elif SAE_MATH_NEON
+      case MathKernelLevel::NEON:  InvertVec4(in, out, count); return;
+#endif
+      default: break;
+      }
+      InvertScalar(in, out, count);
+    }
+
+    void TransformPoints(
+      float const    *matrix,
+      float const    *x,
+      float const    *y,
+      float const    *z,
+      float          *outX,
+      float          *outY,
+      float          *outZ,
+      size_t          count,
+      MathKernelLevel level)
+    {
+      switch(Resolve(level)) {
+#if SAE_MATH_X86
+      case MathKernelLevel::AVX2:  TransformPointsAVX2(matrix, x, y, z, outX, outY, outZ, count);  return;
+      case MathKernelLevel::SSE41: TransformPointsSSE41(matrix, x, y, z, outX, outY, outZ, count); return;
+#elif SAE_MATH_NEON
+      case MathKernelLevel::NEON:  TransformPointsNEON(matrix, x, y, z, outX, outY, outZ, count);  return;
+#endif
+      default: break;
+      }
+      TransformPointsScalar(matrix, x, y, z, outX, outY, outZ, count);
+    }
+
+    void TransformBoxes(
+      float    const *matrices,
+      BoxesSoA const &boxes,
+      BoxesSoA const &outBoxes,
+      size_t          count,
+      MathKernelLevel level)
+    {
+      switch(Resolve(level)) {
+#if SAE_MATH_X86
+      case MathKernelLevel::AVX2:  TransformBoxesAVX2(matrices, boxes, outBoxes, count);  return;
+      case MathKernelLevel::SSE41: TransformBoxesSSE41(matrices, boxes, outBoxes, count); return;
+#elif SAE_MATH_NEON
+      case MathKernelLevel::NEON:  TransformBoxesNEON(matrices, boxes, outBoxes, count);  return;
+#endif
+      default: break;
+      }
+      TransformBoxesScalar(matrices, boxes, outBoxes, 0, count);
+    }
+
+    void ComposeTransforms(
+      TransformsSoA const &transforms,
+      float               *outMatrices,
+      float               *outNormalMatrices,
+      size_t               count,
+      MathKernelLevel      level)
+    {
+      switch(Resolve(level)) {
+#if SAE_MATH_X86
+      case MathKernelLevel::AVX2:  ComposeAVX2(transforms, outMatrices, outNormalMatrices, count); return;
+      case MathKernelLevel::SSE41: ComposeVec4(transforms, outMatrices, outNormalMatrices, count); return;
+#elif SAE_MATH_NEON
+      case MathKernelLevel::NEON:  ComposeVec4(transforms, outMatrices, outNormalMatrices, count); return;
+#endif
+      default: break;
+      }
+      ComposeScalar(transforms, outMatrices, outNormalMatrices, 0, count);
+    }
+
+    //
+    // Benchmark
+    //
+    std::vector<MathKernelBenchmarkResult> BenchmarkMathKernels(
+      size_t       count,
+      unsigned int iterations)
+    {
+      typedef std::chrono::high_resolution_clock Clock;
+
+      std::mt19937 rng(5300);
+      std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+      // Rigid transforms with scale: invertible and of moderate condition, like world matrices.
+      std::vector<float> matrices(16 * count), others(16 * count);
+      for(size_t k=0; k < 2 * count; ++k) {
+        Vec4 const rotation    = QuatNormalize(Set(unit(rng), unit(rng), unit(rng), unit(rng) + 2.0f));
+        Vec4 const scale       = Set(1.5f + unit(rng), 1.5f + unit(rng), 1.5f + unit(rng), 0.0f);
+        Vec4 const translation = Set(10.0f * unit(rng), 10.0f * unit(rng), 10.0f * unit(rng), 0.0f);
+        StoreMat4(((k < count) ? matrices.data() : others.data()) + 16 * (k % count), ScalingRotationTranslation(scale, rotation, translation));
+      }
+
+      std::vector<float> coordinates(6 * count);
+      for(size_t k=0; k < count; ++k)
+        for(int a=0; a < 3; ++a) {
+          float const center = 10.0f * unit(rng);
+          float const extent = 1.0f + unit(rng);
+          coordinates[a * count + k]       = center - extent;
+          coordinates[(3 + a) * count + k] = center + extent;
+        }
+
+      // Translation, rotation and scale of as many transforms, as structure of arrays.
+      std::vector<float> components(10 * count);
+      for(size_t k=0; k < count; ++k) {
+        Vec4 const rotation = QuatNormalize(Set(unit(rng), unit(rng), unit(rng), unit(rng)));
+        float const values[10] ={
+          10.0f * unit(rng), 10.0f * unit(rng), 10.0f * unit(rng),
+          GetX(rotation), GetY(rotation), GetZ(rotation), GetW(rotation),
+          1.5f + unit(rng), 1.5f + unit(rng), 1.5f + unit(rng) };
+        for(int c=0; c < 10; ++c)
+          components[c * count + k] = values[c];
+      }
+      TransformsSoA const transforms ={
+        &components[0],         &components[count],     &components[2 * count],
+        &components[3 * count], &components[4 * count], &components[5 * count], &components[6 * count],
+        &components[7 * count], &components[8 * count], &components[9 * count] };
+
+      // The compose kernel writes world and normal matrices.
+      std::vector<float> outputs(32 * count), reference(32 * count);
+      BoxesSoA const boxes ={
+        &coordinates[0], &coordinates[count], &coordinates[2 * count],
+        &coordinates[3 * count], &coordinates[4 * count], &coordinates[5 * count] };
+      BoxesSoA const outBoxes ={
+        &outputs[0], &outputs[count], &outputs[2 * count],
+        &outputs[3 * count], &outputs[4 * count], &outputs[5 * count] };
+
+      struct Kernel {
+        const char                           *name;
+        size_t                                outputFloats;
+        std::function<void(MathKernelLevel)>  run;
+      };
+      std::vector<Kernel> kernels ={
+        { "matrix multiply",   16 * count, [&] (MathKernelLevel l) { MultiplyMatrices(matrices.data(), others.data(), outputs.data(), count, l); } },
+        { "matrix inverse",    16 * count, [&] (MathKernelLevel l) { InvertMatrices(matrices.data(), outputs.data(), count, l); } },
+        { "point transform",   3 * count,  [&] (MathKernelLevel l)
+          {
+            TransformPoints(matrices.data(), boxes.minX, boxes.minY, boxes.minZ, outBoxes.minX, outBoxes.minY, outBoxes.minZ, count, l);
+          } },
+        { "box transform",     6 * count,  [&] (MathKernelLevel l) { TransformBoxes(matrices.data(), boxes, outBoxes, count, l); } },
+        { "transform compose", 32 * count, [&] (MathKernelLevel l)
+          {
+            ComposeTransforms(transforms, outputs.data(), outputs.data() + 16 * count, count, l);
+          } },
+      };
+
+      std::vector<int> levels(1, static_cast<int>(MathKernelLevel::Scalar));
+      MathKernelLevel const supported = SupportedMathKernelLevel();
+      if(supported == MathKernelLevel::NEON) {
+        levels.push_back(static_cast<int>(MathKernelLevel::NEON));
+      }
+      else {
+        for(int l=1; l <= static_cast<int>(supported); ++l)
+          levels.push_back(l);
+      }
+
+      std::vector<MathKernelBenchmarkResult> results;
+      for(Kernel const&kernel : kernels) {
+        double scalarRate = 0.0;
+        for(int l : levels) {
+          MathKernelLevel level = static_cast<MathKernelLevel>(l);
+
+          kernel.run(level); // warm caches
+          if(level == MathKernelLevel::Scalar)
+            reference.assign(outputs.begin(), outputs.begin() + kernel.outputFloats);
+
+          double maxError = 0.0;
+          for(size_t k=0; k < kernel.outputFloats; ++k)
+            maxError = std::max(maxError, static_cast<double>(std::fabs(outputs[k] - reference[k])));
+
+          Clock::time_point start = Clock::now();
+          for(unsigned int k=0; k < iterations; ++k)
+            kernel.run(level);
+          double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+          MathKernelBenchmarkResult result;
+          result.kernel            = kernel.name;
+          result.level             = level;
+          result.millionsPerSecond = (seconds > 0.0) ? ((double)count * iterations / seconds / 1.0e6) : 0.0;
+          if(level == MathKernelLevel::Scalar)
+            scalarRate = result.millionsPerSecond;
+          result.speedupOverScalar = (scalarRate > 0.0) ? (result.millionsPerSecond / scalarRate) : 0.0;
+          result.maxError          = maxError;
+          results.push_back(result);
+        }
+      }
+
+      return results;
+    }
+
+  }
+}
@@ -1,14 +1,85 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
+#define STB_IMAGE_RESIZE_IMPLEMENTATION
+#include <stb_image_resize.h>
 
 #include "Engine/Texture.h"
+#include "Engine/PixelConversion.h"
 
 namespace SAE {
   namespace Texture {
 
+    // Expands decoded pixels of c channels to RGBA8 and releases them. stbi's own channel
+    // conversion is a scalar per-pixel loop, so images are decoded in their native layout
+    // and expanded with the SIMD kernel instead.
+    static unsigned char* ToRGBA(unsigned char *pixels, int w, int h, int c)
+    {
+      if(!pixels || c == 4)
+        return pixels;
+
+      unsigned char *rgba = (unsigned char*) STBI_MALLOC((size_t)w * h * 4);
+      if(rgba)
+        ExpandToRGBA(pixels, c, rgba, (size_t)w * h);
+
+      stbi_image_free(pixels);
+      return rgba;
+    }
+
+    /**********************************************************************************************//**
+     * \fn static unsigned char* LoadRGBA(const char *filename, unsigned int scaleDenominator, int &w, int &h, int &c)
+     *
+     * \brief Loads an image as RGBA8, reduced by 1/scaleDenominator.
+     *
+     * JPEGs are reconstructed at the reduced size straight from their DCT coefficients.
+     * Everything else is decoded at full size and box-filtered down, so both paths yield
+     * ceil(w/scaleDenominator) x ceil(h/scaleDenominator).
+     *
+     * \return stbi-allocated pixels (release with stbi_image_free) or nullptr on failure.
+     **************************************************************************************************/
+    static unsigned char* LoadRGBA(
+      const char   *filename,
+      unsigned int  scaleDenominator,
+      int          &w,
+      int          &h,
+      int          &c)
+    {
+      // stbi_load fills w, h and c, so it has to run before they are passed on.
+      if(scaleDenominator <= 1) {
+        unsigned char *pixels = stbi_load(filename, &w, &h, &c, 0);
+        return ToRGBA(pixels, w, h, c);
+      }
+
+      unsigned char *scaled = stbi_load_jpeg_scaled(filename, &w, &h, &c, 0, scaleDenominator);
+      if(scaled)
+        return ToRGBA(scaled, w, h, c);
+
+      int fw = 0, fh = 0;
+      unsigned char *full = stbi_load(filename, &fw, &fh, &c, 0);
+      full = ToRGBA(full, fw, fh, c);
+      if(!full)
+        return nullptr;
+
+      w = (fw + scaleDenominator - 1) / scaleDenominator;
+      h = (fh + scaleDenominator - 1) / scaleDenominator;
+
+      scaled = (unsigned char*) STBI_MALLOC(w * h * 4);
+      if(scaled 
+         && !stbir_resize_uint8_generic(
+              full, fw, fh, 0, scaled, w, h, 0, 4, 3, 0, 
+              STBIR_EDGE_CLAMP, STBIR_FILTER_BOX, STBIR_COLORSPACE_LINEAR, nullptr))
+      {
+        STBI_FREE(scaled);
+        scaled = nullptr;
+      }
+
+      stbi_image_free(full);
+      return scaled;
+    }
+
     bool SAELoadTextureArrayFromFiles(
       const std::vector<std::string> &filenames, 
-      Texture2DDescriptor            &outImage)
+      Texture2DDescriptor            &outImage,
+      unsigned int                    scaleDenominator)
     {
       try
       {
@@ -21,7 +92,9 @@ namespace SAE {
         for(unsigned int k=0; k < outImage.depth; ++k)
         {
           int w = 0, h = 0, c = 0;
-          unsigned char* stbuc = stbi_load(filenames[k].c_str(), &w, &h, &c, 4);
+          unsigned char* stbuc = LoadRGBA(filenames[k].c_str(), scaleDenominator, w, h, c);
+          if(!stbuc)
+            throw std::exception("Failed to load texture array slice");
 
           outImage.inByteSize = w * h * 4 * sizeof(Byte);
           outImage.inData[k].resize(outImage.inByteSize);
@@ -57,12 +130,14 @@ namespace SAE {
       }
     }
 
-    bool SAELoadTextureFromFile(const char* filename, Texture2DDescriptor& outImage)
+    bool SAELoadTextureFromFile(const char* filename, Texture2DDescriptor& outImage, unsigned int scaleDenominator)
     {
       try
       {
         int w = 0, h = 0, c = 0;
-        unsigned char* stbuc = stbi_load(filename, &w, &h, &c, 4);
+        unsigned char* stbuc = LoadRGBA(filename, scaleDenominator, w, h, c);
+        if(!stbuc)
+          throw std::exception("Failed to load texture");
 
         outImage.inData.resize(1);
 
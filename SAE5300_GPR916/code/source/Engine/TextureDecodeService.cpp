@@ -0,0 +1,546 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include <stb_image.h>
+#include <stb_image_resize.h>
+
+#include "Engine/PixelConversion.h"
+#include "Engine/TextureDecodeService.h"
+
+namespace SAE {
+  namespace Texture {
+
+    struct TextureDecodeService::Request {
+      std::vector<std::string> filenames;
+      std::promise<Result>     promise;
+      Callback                 callback;
+      unsigned int             flags;
+      Clock::time_point        submitted;
+
+      std::mutex               mutex;
+      Result                   result;
+      size_t                   remaining;
+    };
+
+    struct TextureDecodeService::Job {
+      std::shared_ptr<Request>   request;
+      size_t                     slice;
+      Stage                      stage;
+      bool                       started;
+      std::string                error;
+
+      std::vector<unsigned char> fileData;
+      std::shared_ptr<unsigned char> decoded;
+      bool                       decodedScaled;
+      int                        width;
+      int                        height;
+      int                        channels;
+      std::vector<Byte>          rgba;
+      unsigned int               mipLevels;
+    };
+
+    bool TextureDecodeService::TaskOrder
+      ::operator()(Task const&l, Task const&r) const
+    {
+      // std::priority_queue pops the largest element, so "l < r" means r goes first.
+      if(l.priority != r.priority)
+        return (l.priority < r.priority);
+      if(l.job->stage != r.job->stage)
+        return (l.job->stage < r.job->stage); // drain images already in flight first
+      return (l.sequence > r.sequence);
+    }
+
+    TextureDecodeService
+      ::TextureDecodeService()
+      : m_sequence(0)
+      , m_inFlight(0)
+      , m_outstandingRequests(0)
+      , m_running(false)
+      , m_stats({})
+    {}
+
+    TextureDecodeService
+      ::~TextureDecodeService()
+    {
+      deinitialize();
+    }
+
+    /**********************************************************************************************//**
+     * \fn  bool TextureDecodeService ::initialize(Options const&options)
+     *
+     * \brief Starts the worker threads.
+     *
+     * \param options Pool size, in-flight limit and decode settings.
+     *
+     * \return  False if the service is already running or the options are invalid.
+     **************************************************************************************************/
+    bool TextureDecodeService
+      ::initialize(Options const&options)
+    {
+      if(m_running)
+        return false;
+
+      unsigned int scale = options.scaleDenominator;
+      if(!(scale == 1 || scale == 2 || scale == 4 || scale == 8))
+        return false;
+
+      m_options = options;
+      if(!m_options.workerCount) {
+        unsigned int hw = std::thread::hardware_concurrency();
+        m_options.workerCount = (hw > 1) ? (hw - 1) : 1;
+      }
+      if(!m_options.maxInFlight)
+        m_options.maxInFlight = 2 * m_options.workerCount;
+
+      m_running = true;
+      m_workers.reserve(m_options.workerCount);
+      for(unsigned int k=0; k < m_options.workerCount; ++k)
+        m_workers.push_back(std::thread(&TextureDecodeService::workerMain, this));
+
+      return true;
+    }
+
+    /**********************************************************************************************//**
+     * \fn  bool TextureDecodeService ::deinitialize()
+     *
+     * \brief Stops the workers. Requests that did not complete yet fail with an error.
+     **************************************************************************************************/
+    bool TextureDecodeService
+      ::deinitialize()
+    {
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(!m_running)
+          return true;
+        m_running = false;
+      }
+      m_workAvailable.notify_all();
+
+      for(std::thread &worker : m_workers)
+        worker.join();
+      m_workers.clear();
+
+      std::vector<std::shared_ptr<Job>> abandoned;
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for(TaskQueue *queue : { &m_ready, &m_pendingReads }) {
+          while(!queue->empty()) {
+            abandoned.push_back(queue->top().job);
+            queue->pop();
+          }
+        }
+      }
+
+      for(std::shared_ptr<Job> &job : abandoned) {
+        job->error = "Texture decode service shut down";
+        finishJob(job, false);
+      }
+
+      return true;
+    }
+
+    std::future<TextureDecodeService::Result> TextureDecodeService
+      ::submit(
+        std::string const&filename,
+        int               priority,
+        Callback          callback,
+        unsigned int      flags)
+    {
+      return enqueue({ filename }, priority, callback, flags);
+    }
+
+    std::future<TextureDecodeService::Result> TextureDecodeService
+      ::submitArray(
+        std::vector<std::string> const&filenames,
+        int                            priority,
+        Callback                       callback,
+        unsigned int                   flags)
+    {
+      return enqueue(filenames, priority, callback, flags);
+    }
+
+    std::future<TextureDecodeService::Result> TextureDecodeService
+      ::enqueue(
+        std::vector<std::string> const&filenames,
+        int                            priority,
+        Callback                       callback,
+        unsigned int                   flags)
+    {
+      std::shared_ptr<Request> request = std::make_shared<Request>();
+      request->filenames = filenames;
+      request->callback  = callback;
+      request->flags     = flags;
+      request->submitted = Clock::now();
+      request->remaining = filenames.size();
+      request->result.success = true;
+      request->result.image   = Texture2DDescriptor();
+      request->result.image.depth = static_cast<unsigned int>(filenames.size());
+      request->result.image.inData.resize(filenames.size());
+
+      std::future<Result> future = request->promise.get_future();
+
+      bool running = false;
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        running = m_running;
+      }
+
+      if(filenames.empty() || !running) {
+        request->result.success = false;
+        request->result.error   = filenames.empty() ? "No files given" : "Texture decode service not running";
+        if(request->callback)
+          request->callback(request->result);
+        request->promise.set_value(std::move(request->result));
+        return future;
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(!m_outstandingRequests++)
+          m_busySince = Clock::now();
+        ++m_stats.requestsSubmitted;
+
+        for(size_t k=0; k < filenames.size(); ++k) {
+          std::shared_ptr<Job> job = std::make_shared<Job>();
+          job->request       = request;
+          job->slice         = k;
+          job->stage         = StageRead;
+          job->started       = false;
+          job->decodedScaled = false;
+          job->width         = 0;
+          job->height        = 0;
+          job->channels      = 0;
+          job->mipLevels     = 1;
+
+          m_pendingReads.push({ job, priority, m_sequence++ });
+        }
+
+        m_stats.peakQueueDepth = std::max(m_stats.peakQueueDepth, m_pendingReads.size() + m_ready.size());
+      }
+      m_workAvailable.notify_all();
+
+      return future;
+    }
+
+    void TextureDecodeService
+      ::waitIdle()
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_idle.wait(lock, [this] () { return (m_outstandingRequests == 0); });
+    }
+
+    TextureDecodeService::Stats TextureDecodeService
+      ::stats() const
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+
+      Stats stats = m_stats;
+      if(m_outstandingRequests)
+        stats.busySeconds += std::chrono::duration<double>(Clock::now() - m_busySince).count();
+
+      stats.queueDepth = m_pendingReads.size() + m_ready.size();
+      stats.inFlight   = m_inFlight;
+      if(stats.busySeconds > 0.0) {
+        stats.imagesPerSecond        = stats.imagesDecoded / stats.busySeconds;
+        stats.megabytesReadPerSecond = (stats.bytesRead / (1024.0 * 1024.0)) / stats.busySeconds;
+      }
+
+      return stats;
+    }
+
+    void TextureDecodeService
+      ::resetStats()
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stats     = {};
+      m_busySince = Clock::now();
+    }
+
+    const char* TextureDecodeService
+      ::stageName(Stage stage)
+    {
+      switch(stage) {
+      case StageRead:    return "read";
+      case StageDecode:  return "decode";
+      case StageConvert: return "convert";
+      case StageMips:    return "mips";
+      default:           return "unknown";
+      }
+    }
+
+    void TextureDecodeService
+      ::record(StageStats &stats, double ms)
+    {
+      ++stats.count;
+      stats.totalMs += ms;
+      stats.maxMs    = std::max(stats.maxMs, ms);
+    }
+
+    void TextureDecodeService
+      ::workerMain()
+    {
+      for(;;) {
+        Task task;
+        {
+          std::unique_lock<std::mutex> lock(m_mutex);
+          m_workAvailable.wait(lock, [this] () {
+            return !m_running
+              || !m_ready.empty()
+              || (!m_pendingReads.empty() && m_inFlight < m_options.maxInFlight);
+          });
+
+          if(!m_running)
+            return;
+
+          if(!m_ready.empty()) {
+            task = m_ready.top();
+            m_ready.pop();
+          }
+          else {
+            task = m_pendingReads.top();
+            m_pendingReads.pop();
+
+            task.job->started = true;
+            ++m_inFlight;
+            record(m_stats.queueWait, std::chrono::duration<double, std::milli>(Clock::now() - task.job->request->submitted).count());
+          }
+        }
+
+        Job  &job   = *task.job;
+        Stage stage = job.stage;
+
+        Clock::time_point start = Clock::now();
+        bool ok = runStage(job);
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        bool done = (!ok || stage == StageMips);
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          record(m_stats.stages[stage], ms);
+          if(ok && stage == StageRead)
+            m_stats.bytesRead += job.fileData.size();
+
+          if(!done) {
+            job.stage = static_cast<Stage>(stage + 1);
+            m_ready.push({ task.job, task.priority, m_sequence++ });
+          }
+        }
+
+        if(done)
+          finishJob(task.job, ok);
+        else
+          m_workAvailable.notify_one();
+      }
+    }
+
+    bool TextureDecodeService
+      ::runStage(Job &job)
+    {
+      std::string const&filename = job.request->filenames[job.slice];
+
+      switch(job.stage) {
+      case StageRead:
+      {
+        std::ifstream file(filename, std::ios::binary | std::ios::ate);
+        if(!file) {
+          job.error = "Cannot open " + filename;
+          return false;
+        }
+
+        std::streamoff size = file.tellg();
+        file.seekg(0, std::ios::beg);
+        job.fileData.resize(static_cast<size_t>(size));
+        if(size <= 0 || !file.read(reinterpret_cast<char*>(job.fileData.data()), size)) {
+          job.error = "Cannot read " + filename;
+          return false;
+        }
+        return true;
+      }
+      case StageDecode:
+      {
+        int len = static_cast<int>(job.fileData.size());
+        unsigned char *pixels = nullptr;
+
+        if(m_options.scaleDenominator > 1) {
+          pixels = stbi_load_jpeg_scaled_from_memory(
+            job.fileData.data(), len, &job.width, &job.height, &job.channels, 0, m_options.scaleDenominator);
+          job.decodedScaled = (pixels != nullptr);
+        }
+        if(!pixels)
+          pixels = stbi_load_from_memory(job.fileData.data(), len, &job.width, &job.height, &job.channels, 0);
+
+        std::vector<unsigned char>().swap(job.fileData);
+
+        if(!pixels) {
+          job.error = filename + ": " + stbi_failure_reason();
+          return false;
+        }
+
+        job.decoded = std::shared_ptr<unsigned char>(pixels, stbi_image_free);
+        return true;
+      }
+      case StageConvert:
+      {
+        size_t pixelCount = static_cast<size_t>(job.width) * job.height;
+        job.rgba.resize(pixelCount * 4);
+
+        if(job.channels < 1 || job.channels > 4) {
+          job.error = filename + ": unsupported channel count";
+          return false;
+        }
+
+        unsigned char *rgba = reinterpret_cast<unsigned char*>(job.rgba.data());
+        ExpandToRGBA(job.decoded.get(), job.channels, rgba, pixelCount);
+        job.decoded.reset();
+
+        if((job.request->flags & FlagPremultiplyAlpha) && (job.channels == 2 || job.channels == 4))
+          PremultiplyAlpha(rgba, rgba, pixelCount);
+
+        unsigned int scale = m_options.scaleDenominator;
+        if(scale > 1 && !job.decodedScaled) {
+          // Not a JPEG, so it could not be decoded at the reduced size directly.
+          int w = (job.width  + scale - 1) / scale;
+          int h = (job.height + scale - 1) / scale;
+          std::vector<Byte> scaled(static_cast<size_t>(w) * h * 4);
+          if(!stbir_resize_uint8_generic(
+               reinterpret_cast<unsigned char*>(job.rgba.data()), job.width, job.height, 0,
+               reinterpret_cast<unsigned char*>(scaled.data()), w, h, 0, 4, 3, 0,
+               STBIR_EDGE_CLAMP, STBIR_FILTER_BOX, STBIR_COLORSPACE_LINEAR, nullptr))
+          {
+            job.error = filename + ": resize failed";
+            return false;
+          }
+          job.rgba.swap(scaled);
+          job.width  = w;
+          job.height = h;
+        }
+
+        return true;
+      }
+      case StageMips:
+      {
+        unsigned int levels = m_options.generateMips ? MipLevelCount(job.width, job.height) : 1;
+        job.rgba.resize(MipChainByteSize(job.width, job.height, levels));
+
+        unsigned char *src = reinterpret_cast<unsigned char*>(job.rgba.data());
+        int w = job.width;
+        int h = job.height;
+        for(unsigned int level=1; level < levels; ++level) {
+          int nw = std::max(1, w >> 1);
+          int nh = std::max(1, h >> 1);
+          unsigned char *dst = src + (static_cast<size_t>(w) * h * 4);
+
+          for(int y=0; y < nh; ++y) {
+            const unsigned char *row0 = src + (static_cast<size_t>(std::min(2 * y,     h - 1)) * w * 4);
+            const unsigned char *row1 = src + (static_cast<size_t>(std::min(2 * y + 1, h - 1)) * w * 4);
+            for(int x=0; x < nw; ++x) {
+              int x0 = std::min(2 * x,     w - 1) * 4;
+              int x1 = std::min(2 * x + 1, w - 1) * 4;
+              unsigned char *out = dst + ((static_cast<size_t>(y) * nw + x) * 4);
+              for(int c=0; c < 4; ++c)
+                out[c] = static_cast<unsigned char>((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+            }
+          }
+
+          src = dst;
+          w   = nw;
+          h   = nh;
+        }
+
+        if(job.request->flags & FlagNormalMap) {
+          // Box filtering shortens the normals; rebuild z from the filtered xy on every level
+          // so each mip stays unit length. Level 0 is rebuilt too, which drops whatever z the
+          // source stored and leaves the map ready for two-channel (RG/BC5) storage.
+          size_t pixels = job.rgba.size() / 4;
+          std::vector<uint8_t> xy(pixels * 2);
+          unsigned char *chain = reinterpret_cast<unsigned char*>(job.rgba.data());
+          ExtractNormalXY(chain, xy.data(), pixels);
+          ReconstructNormalZ(xy.data(), chain, pixels);
+        }
+
+        job.mipLevels = levels;
+        return true;
+      }
+      default:
+        return false;
+      }
+    }
+
+    void TextureDecodeService
+      ::finishJob(std::shared_ptr<Job> const&job, bool success)
+    {
+      std::shared_ptr<Request> request = job->request;
+
+      bool last = false;
+      {
+        std::lock_guard<std::mutex> lock(request->mutex);
+
+        Texture2DDescriptor &image = request->result.image;
+        if(success) {
+          if(!image.width) {
+            image.width     = job->width;
+            image.height    = job->height;
+            image.channels  = job->channels;
+            image.mipLevels = job->mipLevels;
+          }
+          else if(image.width != static_cast<unsigned int>(job->width)
+                  || image.height != static_cast<unsigned int>(job->height))
+          {
+            success = false;
+            job->error = "Dimension mismatch loading texture array";
+          }
+        }
+
+        if(success) {
+          image.inData[job->slice].swap(job->rgba);
+          image.inByteSize = job->width * job->height * 4 * sizeof(Byte);
+        }
+        else if(request->result.success) {
+          request->result.success = false;
+          request->result.error   = job->error;
+        }
+
+        last = (--request->remaining == 0);
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(job->started)
+          --m_inFlight;
+        if(success)
+          ++m_stats.imagesDecoded;
+        if(last) {
+          if(request->result.success) {
+            ++m_stats.requestsCompleted;
+            for(std::vector<Byte> const&slice : request->result.image.inData)
+              m_stats.bytesProduced += slice.size();
+          }
+          else {
+            ++m_stats.requestsFailed;
+          }
+        }
+      }
+      m_workAvailable.notify_one();
+
+      if(!last)
+        return;
+
+      if(!request->result.success)
+        request->result.image.inData.clear();
+
+      if(request->callback)
+        request->callback(request->result);
+      request->promise.set_value(std::move(request->result));
+
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(!--m_outstandingRequests) {
+          m_stats.busySeconds += std::chrono::duration<double>(Clock::now() - m_busySince).count();
+          m_idle.notify_all();
+        }
+      }
+    }
+
+  }
+}
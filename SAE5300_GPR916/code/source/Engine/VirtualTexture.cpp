@@ -0,0 +1,596 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "Engine/VirtualTexture.h"
+
+namespace SAE {
+  namespace Texture {
+
+    //
+    // Layout
+    //
+
+    uint64_t VirtualTextureLayout
+      ::pageIndex(uint32_t mip, uint32_t x, uint32_t y) const
+    {
+      uint64_t index = 0;
+      for(uint32_t m=0; m < mip; ++m)
+        index += (uint64_t)pagesX(m) * pagesY(m);
+      return index + (uint64_t)y * pagesX(mip) + x;
+    }
+
+    uint64_t VirtualTextureLayout
+      ::pageCount() const
+    {
+      return pageIndex(mipLevels, 0, 0);
+    }
+
+    VirtualTextureLayout VirtualTextureLayout
+      ::Create(uint32_t width, uint32_t height, uint32_t pageSize, uint32_t border)
+    {
+      VirtualTextureLayout layout ={};
+      layout.width     = width;
+      layout.height    = height;
+      layout.pageSize  = pageSize;
+      layout.border    = border;
+      layout.mipLevels = 1;
+      if(!width || !height || !pageSize)
+        return layout;
+
+      while(layout.pagesX(layout.mipLevels - 1) > 1 || layout.pagesY(layout.mipLevels - 1) > 1)
+        ++layout.mipLevels;
+
+      return layout;
+    }
+
+    //
+    // Page file
+    //
+    static const char     s_pageFileMagic[8] ={ 'S', 'A', 'E', 'V', 'T', 'E', 'X', '1' };
+    static const uint32_t s_pageFileVersion  = 1;
+
+    bool CookVirtualTexture(
+      Texture2DDescriptor       const&image,
+      VirtualTextureCookOptions const&options,
+      std::string               const&pageFilename)
+    {
+      if(image.inData.empty() || !image.width || !image.height
+         || image.inData[0].size() < (size_t)image.width * image.height * 4
+         || !options.pageSize || options.border >= options.pageSize)
+      {
+        return false;
+      }
+
+      VirtualTextureLayout layout = VirtualTextureLayout::Create(image.width, image.height, options.pageSize, options.border);
+      if(layout.pagesX(0) > 4096 || layout.pagesY(0) > 4096 || layout.mipLevels > 255)
+        return false;
+
+      std::ofstream out(pageFilename, std::ios::binary | std::ios::trunc);
+      if(!out)
+        return false;
+
+      uint32_t header[7] ={ s_pageFileVersion, layout.width, layout.height, layout.pageSize, layout.border, layout.mipLevels, options.wrap ? 1u : 0u };
+      out.write(s_pageFileMagic, sizeof(s_pageFileMagic));
+      out.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+      std::vector<Byte> level(image.inData[0].begin(), image.inData[0].begin() + (size_t)image.width * image.height * 4);
+      std::vector<Byte> tile(layout.tileBytes());
+      uint32_t          tileSize = layout.tileSize();
+
+      for(uint32_t mip=0; mip < layout.mipLevels; ++mip) {
+        int32_t w = static_cast<int32_t>(layout.mipWidth(mip));
+        int32_t h = static_cast<int32_t>(layout.mipHeight(mip));
+
+        for(uint32_t py=0; py < layout.pagesY(mip); ++py) {
+          for(uint32_t px=0; px < layout.pagesX(mip); ++px) {
+            for(uint32_t ty=0; ty < tileSize; ++ty) {
+              int32_t sy = static_cast<int32_t>(py * layout.pageSize + ty) - static_cast<int32_t>(layout.border);
+              sy = options.wrap ? (((sy % h) + h) % h) : std::min(std::max(sy, 0), h - 1);
+
+              for(uint32_t tx=0; tx < tileSize; ++tx) {
+                int32_t sx = static_cast<int32_t>(px * layout.pageSize + tx) - static_cast<int32_t>(layout.border);
+                sx = options.wrap ? (((sx % w) + w) % w) : std::min(std::max(sx, 0), w - 1);
+
+                memcpy(&tile[((size_t)ty * tileSize + tx) * 4], &level[((size_t)sy * w + sx) * 4], 4);
+              }
+            }
+            out.write(tile.data(), tile.size());
+          }
+        }
+
+        // 2x2 box filter into the next level.
+        if(mip + 1 < layout.mipLevels) {
+          int32_t nw = static_cast<int32_t>(layout.mipWidth(mip + 1));
+          int32_t nh = static_cast<int32_t>(layout.mipHeight(mip + 1));
+
+          std::vector<Byte> next((size_t)nw * nh * 4);
+          for(int32_t y=0; y < nh; ++y) {
+            int32_t y0 = std::min(2 * y, h - 1), y1 = std::min(2 * y + 1, h - 1);
+            for(int32_t x=0; x < nw; ++x) {
+              int32_t x0 = std::min(2 * x, w - 1), x1 = std::min(2 * x + 1, w - 1);
+              for(int32_t c=0; c < 4; ++c) {
+                unsigned int sum = (uint8_t)level[((size_t)y0 * w + x0) * 4 + c] + (uint8_t)level[((size_t)y0 * w + x1) * 4 + c]
+                                 + (uint8_t)level[((size_t)y1 * w + x0) * 4 + c] + (uint8_t)level[((size_t)y1 * w + x1) * 4 + c];
+                next[((size_t)y * nw + x) * 4 + c] = static_cast<Byte>((sum + 2) / 4);
+              }
+            }
+          }
+          level.swap(next);
+        }
+      }
+
+      return static_cast<bool>(out);
+    }
+
+    bool VirtualTexturePageFile
+      ::open(std::string const&pageFilename)
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+
+      m_file.close();
+      m_file.clear();
+      m_file.open(pageFilename, std::ios::binary);
+      if(!m_file)
+        return false;
+
+      char     magic[8];
+      uint32_t header[7];
+      if(!m_file.read(magic, sizeof(magic)) || memcmp(magic, s_pageFileMagic, sizeof(magic)) != 0
+         || !m_file.read(reinterpret_cast<char*>(header), sizeof(header)) || header[0] != s_pageFileVersion)
+      {
+        m_file.close();
+        return false;
+      }
+
+      m_layout     = VirtualTextureLayout::Create(header[1], header[2], header[3], header[4]);
+      m_dataOffset = sizeof(magic) + sizeof(header);
+      if(m_layout.mipLevels != header[5]) {
+        m_file.close();
+        return false;
+      }
+
+      return true;
+    }
+
+    void VirtualTexturePageFile
+      ::close()
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_file.close();
+    }
+
+    bool VirtualTexturePageFile
+      ::readPage(VirtualPage const&page, Byte *outTile)
+    {
+      if(page.mip >= m_layout.mipLevels || page.x >= m_layout.pagesX(page.mip) || page.y >= m_layout.pagesY(page.mip))
+        return false;
+
+      uint64_t offset = m_dataOffset + m_layout.pageIndex(page.mip, page.x, page.y) * m_layout.tileBytes();
+
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_file.clear();
+      m_file.seekg(static_cast<std::streamoff>(offset));
+      return static_cast<bool>(m_file.read(outTile, m_layout.tileBytes()));
+    }
+
+    //
+    // Cache
+    //
+
+    VirtualTextureCache::VirtualTextureCache()
+      : m_layout()
+      , m_pageTableDirty(false)
+      , m_frame(0)
+      , m_stats()
+      , m_running(false)
+    {}
+
+    VirtualTextureCache::~VirtualTextureCache()
+    {
+      deinitialize();
+    }
+
+    bool VirtualTextureCache
+      ::initialize(std::shared_ptr<VirtualTexturePageSource> const&source, Options const&options)
+    {
+      deinitialize();
+
+      if(!source || !options.physicalPagesX || !options.physicalPagesY
+         || options.physicalPagesX > 256 || options.physicalPagesY > 256
+         || (options.physicalPagesX * options.physicalPagesY) < 2
+         || !options.maxUploadsPerFrame || !options.maxPendingLoads)
+      {
+        return false;
+      }
+
+      m_source  = source;
+      m_layout  = source->layout();
+      m_options = options;
+      if(!m_layout.pageSize || !m_layout.mipLevels)
+        return false;
+
+      uint32_t slotCount = options.physicalPagesX * options.physicalPagesY;
+      m_slots.assign(slotCount, Slot());
+      m_lru.clear();
+      for(uint32_t k=0; k < slotCount; ++k) {
+        m_slots[k].key       = 0;
+        m_slots[k].used      = false;
+        m_slots[k].pinned    = false;
+        m_slots[k].lastFrame = 0;
+        m_slots[k].lru       = m_lru.insert(m_lru.end(), k);
+      }
+
+      m_pageTable.assign(m_layout.mipLevels, std::vector<PageTableEntry>());
+      for(uint32_t mip=0; mip < m_layout.mipLevels; ++mip)
+        m_pageTable[mip].assign((size_t)m_layout.pagesX(mip) * m_layout.pagesY(mip), PageTableEntry());
+      m_pageTableDirty = true;
+
+      m_resident.clear();
+      m_pending.clear();
+      m_requested.clear();
+      m_frame = 0;
+      m_stats = Stats();
+
+      // The single page of the coarsest level is the fallback of last resort: load it now
+      // and map it (pinned) on the first update.
+      VirtualPage root ={ m_layout.mipLevels - 1, 0, 0 };
+      LoadedPage  rootPage;
+      load(root.key(), rootPage);
+      if(!rootPage.success)
+        return false;
+
+      m_pending.insert(root.key());
+      m_completed.push_back(std::move(rootPage));
+
+      m_running = true;
+      for(uint32_t k=0; k < options.loaderThreads; ++k)
+        m_loaders.push_back(std::thread(&VirtualTextureCache::loaderMain, this));
+
+      return true;
+    }
+
+    bool VirtualTextureCache
+      ::deinitialize()
+    {
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+      }
+      m_loadAvailable.notify_all();
+
+      for(std::thread &loader : m_loaders)
+        loader.join();
+      m_loaders.clear();
+
+      m_loadQueue.clear();
+      m_completed.clear();
+      m_resident.clear();
+      m_pending.clear();
+      m_requested.clear();
+      m_slots.clear();
+      m_lru.clear();
+      m_pageTable.clear();
+      m_source = nullptr;
+
+      return true;
+    }
+
+    void VirtualTextureCache
+      ::beginFrame()
+    {
+      ++m_frame;
+    }
+
+    void VirtualTextureCache
+      ::request(VirtualPage const&page)
+    {
+      if(page.mip >= m_layout.mipLevels || page.x >= m_layout.pagesX(page.mip) || page.y >= m_layout.pagesY(page.mip))
+        return;
+
+      ++m_stats.requests;
+
+      // Walk towards the root: request what is missing, keep the page that currently stands in
+      // for it (the finest resident ancestor) from being evicted.
+      VirtualPage current = page;
+      for(;;) {
+        uint32_t key = current.key();
+
+        std::unordered_map<uint32_t, uint32_t>::const_iterator it = m_resident.find(key);
+        if(it != m_resident.end()) {
+          touch(it->second);
+          if(current.mip == page.mip)
+            ++m_stats.hits;
+          return;
+        }
+
+        if(current.mip == page.mip)
+          ++m_stats.misses;
+
+        if(!m_pending.count(key))
+          m_requested.insert(key);
+
+        if(current.mip + 1 >= m_layout.mipLevels)
+          return;
+
+        current ={ current.mip + 1, current.x / 2, current.y / 2 };
+      }
+    }
+
+    void VirtualTextureCache
+      ::requestRegion(float u0, float v0, float u1, float v1, uint32_t mip)
+    {
+      if(mip >= m_layout.mipLevels)
+        mip = m_layout.mipLevels - 1;
+
+      if(u0 > u1) std::swap(u0, u1);
+      if(v0 > v1) std::swap(v0, v1);
+      u0 = std::min(std::max(u0, 0.0f), 1.0f);
+      u1 = std::min(std::max(u1, 0.0f), 1.0f);
+      v0 = std::min(std::max(v0, 0.0f), 1.0f);
+      v1 = std::min(std::max(v1, 0.0f), 1.0f);
+
+      uint32_t pagesX = m_layout.pagesX(mip);
+      uint32_t pagesY = m_layout.pagesY(mip);
+      float    scaleX = static_cast<float>(m_layout.mipWidth(mip))  / m_layout.pageSize;
+      float    scaleY = static_cast<float>(m_layout.mipHeight(mip)) / m_layout.pageSize;
+
+      uint32_t x0 = std::min(pagesX - 1, static_cast<uint32_t>(u0 * scaleX));
+      uint32_t x1 = std::min(pagesX - 1, static_cast<uint32_t>(u1 * scaleX));
+      uint32_t y0 = std::min(pagesY - 1, static_cast<uint32_t>(v0 * scaleY));
+      uint32_t y1 = std::min(pagesY - 1, static_cast<uint32_t>(v1 * scaleY));
+
+      for(uint32_t y=y0; y <= y1; ++y)
+        for(uint32_t x=x0; x <= x1; ++x)
+          request({ mip, x, y });
+    }
+
+    size_t VirtualTextureCache
+      ::update(UploadFn const&uploadFn)
+    {
+      if(!m_source)
+        return 0;
+
+      // Issue new loads, coarse levels first: they unblock the fallback for the most pixels.
+      std::vector<uint32_t> requested(m_requested.begin(), m_requested.end());
+      m_requested.clear();
+      std::sort(requested.begin(), requested.end(), [] (uint32_t l, uint32_t r) { return l > r; });
+
+      // Every pending page takes a slot when it arrives. Only slots not used this frame can be
+      // given to it: loading more would read tiles that have nowhere to go.
+      size_t freeSlots = 0;
+      for(Slot const&slot : m_slots)
+        if(!slot.used || (slot.lastFrame != m_frame && !slot.pinned))
+          ++freeSlots;
+
+      size_t capacity = (m_pending.size() < m_options.maxPendingLoads) ? (m_options.maxPendingLoads - m_pending.size()) : 0;
+      size_t slots    = (m_pending.size() < freeSlots) ? (freeSlots - m_pending.size()) : 0;
+      if(capacity > slots)
+        capacity = slots;
+      if(requested.size() > capacity)
+        requested.resize(capacity); // dropped requests come back with next frame's visibility
+
+      for(uint32_t key : requested) {
+        m_pending.insert(key);
+        ++m_stats.loadsIssued;
+
+        if(m_options.loaderThreads == 0) {
+          LoadedPage page;
+          load(key, page);
+          m_completed.push_back(std::move(page));
+        }
+      }
+
+      std::vector<LoadedPage> completed;
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(m_options.loaderThreads)
+          m_loadQueue.insert(m_loadQueue.end(), requested.begin(), requested.end());
+
+        completed.reserve(m_completed.size());
+        for(LoadedPage &page : m_completed)
+          completed.push_back(std::move(page));
+        m_completed.clear();
+      }
+      if(m_options.loaderThreads && !requested.empty())
+        m_loadAvailable.notify_all();
+
+      // Map finished tiles, coarse first, at most maxUploadsPerFrame; the rest wait. So do
+      // tiles finding every slot in use this frame: they stay pending until one frees up.
+      std::stable_sort(completed.begin(), completed.end(), [] (LoadedPage const&l, LoadedPage const&r) { return (l.key >> 24) > (r.key >> 24); });
+
+      size_t uploads = 0;
+      size_t k       = 0;
+      for(; k < completed.size() && uploads < m_options.maxUploadsPerFrame; ++k) {
+        LoadedPage const&page = completed[k];
+
+        if(!page.success) {
+          m_pending.erase(page.key);
+          ++m_stats.loadsFailed;
+          continue;
+        }
+
+        uint32_t slotIndex = 0;
+        if(!m_resident.count(page.key) && !allocateSlot(slotIndex))
+          break; // mapping only touches slots, none frees up for the rest of this frame
+
+        m_pending.erase(page.key);
+        ++m_stats.loadsCompleted;
+        if(mapPage(page, slotIndex, uploadFn))
+          ++uploads;
+      }
+
+      if(k < completed.size()) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for(size_t j=completed.size(); j > k; --j)
+          m_completed.push_front(std::move(completed[j - 1]));
+      }
+
+      if(m_pageTableDirty)
+        rebuildPageTable();
+
+      m_stats.uploads += uploads;
+      return uploads;
+    }
+
+    bool VirtualTextureCache
+      ::isResident(VirtualPage const&page) const
+    {
+      return m_resident.count(page.key()) != 0;
+    }
+
+    VirtualTextureCache::PageTableEntry VirtualTextureCache
+      ::lookup(VirtualPage const&page) const
+    {
+      if(page.mip >= m_layout.mipLevels || page.x >= m_layout.pagesX(page.mip) || page.y >= m_layout.pagesY(page.mip))
+        return PageTableEntry();
+
+      return m_pageTable[page.mip][(size_t)page.y * m_layout.pagesX(page.mip) + page.x];
+    }
+
+    VirtualTextureCache::Stats VirtualTextureCache
+      ::stats() const
+    {
+      Stats stats = m_stats;
+      stats.pendingLoads  = m_pending.size();
+      stats.residentPages = m_resident.size();
+      return stats;
+    }
+
+    void VirtualTextureCache
+      ::resetStats()
+    {
+      m_stats = Stats();
+    }
+
+    uint32_t VirtualTextureCache
+      ::mipForFootprint(float texelsPerPixel) const
+    {
+      if(!(texelsPerPixel > 1.0f) || !m_layout.mipLevels)
+        return 0;
+
+      uint32_t mip = static_cast<uint32_t>(std::floor(std::log2(texelsPerPixel)));
+      return std::min(mip, m_layout.mipLevels - 1);
+    }
+
+    void VirtualTextureCache
+      ::loaderMain()
+    {
+      for(;;) {
+        uint32_t key = 0;
+        {
+          std::unique_lock<std::mutex> lock(m_mutex);
+          m_loadAvailable.wait(lock, [this] () { return !m_running || !m_loadQueue.empty(); });
+          if(!m_running)
+            return;
+
+          key = m_loadQueue.front();
+          m_loadQueue.pop_front();
+        }
+
+        LoadedPage page;
+        load(key, page);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_completed.push_back(std::move(page));
+      }
+    }
+
+    void VirtualTextureCache
+      ::load(uint32_t key, LoadedPage &outPage)
+    {
+      outPage.key     = key;
+      outPage.tile.resize(m_layout.tileBytes());
+      outPage.success = m_source->readPage(VirtualPage::FromKey(key), outPage.tile.data());
+    }
+
+    bool VirtualTextureCache
+      ::mapPage(LoadedPage const&page, uint32_t slotIndex, UploadFn const&uploadFn)
+    {
+      if(m_resident.count(page.key))
+        return false;
+
+      Slot &slot = m_slots[slotIndex];
+      if(slot.used) {
+        m_resident.erase(slot.key);
+        ++m_stats.evictions;
+      }
+
+      VirtualPage virtualPage = VirtualPage::FromKey(page.key);
+      slot.key       = page.key;
+      slot.used      = true;
+      slot.pinned    = (virtualPage.mip == m_layout.mipLevels - 1);
+      slot.lastFrame = m_frame;
+      touch(slotIndex);
+      m_resident[page.key] = slotIndex;
+
+      if(uploadFn) {
+        Upload upload ={ virtualPage, slotIndex % m_options.physicalPagesX, slotIndex / m_options.physicalPagesX, page.tile.data() };
+        uploadFn(upload);
+      }
+
+      m_pageTableDirty = true;
+      return true;
+    }
+
+    void VirtualTextureCache
+      ::touch(uint32_t slotIndex)
+    {
+      Slot &slot = m_slots[slotIndex];
+      slot.lastFrame = m_frame;
+      m_lru.splice(m_lru.begin(), m_lru, slot.lru);
+    }
+
+    bool VirtualTextureCache
+      ::allocateSlot(uint32_t &outSlot)
+    {
+      // Least recently used from the back; free slots never get touched and sit there too.
+      // Everything touched this frame is in front of the first such slot, so stop there.
+      for(std::list<uint32_t>::reverse_iterator it=m_lru.rbegin(); it != m_lru.rend(); ++it) {
+        Slot const&slot = m_slots[*it];
+        if(!slot.used) {
+          outSlot = *it;
+          return true;
+        }
+        if(slot.lastFrame == m_frame)
+          return false;
+        if(!slot.pinned) {
+          outSlot = *it;
+          return true;
+        }
+      }
+      return false;
+    }
+
+    void VirtualTextureCache
+      ::rebuildPageTable()
+    {
+      // Top-down: every entry is either its own resident page or inherits its parent's.
+      for(uint32_t mip=m_layout.mipLevels; mip-- > 0;) {
+        uint32_t pagesX = m_layout.pagesX(mip);
+        uint32_t pagesY = m_layout.pagesY(mip);
+        std::vector<PageTableEntry> &table = m_pageTable[mip];
+
+        for(uint32_t y=0; y < pagesY; ++y) {
+          for(uint32_t x=0; x < pagesX; ++x) {
+            PageTableEntry entry ={};
+
+            std::unordered_map<uint32_t, uint32_t>::const_iterator it = m_resident.find(VirtualPage{ mip, x, y }.key());
+            if(it != m_resident.end()) {
+              entry.slotX = static_cast<uint8_t>(it->second % m_options.physicalPagesX);
+              entry.slotY = static_cast<uint8_t>(it->second / m_options.physicalPagesX);
+              entry.mip   = static_cast<uint8_t>(mip);
+              entry.valid = 1;
+            }
+            else if(mip + 1 < m_layout.mipLevels) {
+              entry = m_pageTable[mip + 1][(size_t)(y / 2) * m_layout.pagesX(mip + 1) + (x / 2)];
+            }
+
+            table[(size_t)y * pagesX + x] = entry;
+          }
+        }
+      }
+    }
+
+  }
+}
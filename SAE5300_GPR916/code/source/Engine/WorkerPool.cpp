@@ -0,0 +1,548 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "Engine/WorkerPool.h"
+#include "Engine/FrameArena.h"
+
+namespace SAE {
+  namespace Threading {
+
+    // Queue of the pool the current thread works for; threads outside any pool use queue 0.
+    static thread_local WorkerPool const *t_pool  = nullptr;
+    static thread_local unsigned int      t_queue = 0;
+
+    void WorkerPool::Queue
+      ::pushBack(Job &&job)
+    {
+      if(count == jobs.size()) {
+        std::vector<Job> grown(2 * jobs.size());
+        for(size_t k=0; k < count; ++k)
+          grown[k] = std::move(jobs[(head + k) % jobs.size()]);
+
+        jobs.swap(grown);
+        head = 0;
+      }
+
+      jobs[(head + count) % jobs.size()] = std::move(job);
+      ++count;
+    }
+
+    void WorkerPool::Queue
+      ::popBack(Job &outJob)
+    {
+      --count;
+      outJob = std::move(jobs[(head + count) % jobs.size()]);
+    }
+
+    void WorkerPool::Queue
+      ::popFront(Job &outJob)
+    {
+      outJob = std::move(jobs[head]);
+      head   = (head + 1) % jobs.size();
+      --count;
+    }
+
+    WorkerPool::WorkerPool()
+      : m_queued(0)
+      , m_jobs(0)
+      , m_steals(0)
+      , m_frame(0)
+      , m_running(false)
+    {}
+
+    WorkerPool::~WorkerPool()
+    {
+      deinitialize();
+    }
+
+    bool WorkerPool
+      ::initialize(unsigned int threadCount)
+    {
+      deinitialize();
+
+      if(!threadCount)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+      for(unsigned int k=0; k < threadCount; ++k)
+        m_queues.push_back(std::unique_ptr<Queue>(new Queue()));
+
+      m_running = true;
+      for(unsigned int k=1; k < threadCount; ++k)
+        m_workers.push_back(std::thread(&WorkerPool::workerMain, this, k));
+
+      return true;
+    }
+
+    bool WorkerPool
+      ::deinitialize()
+    {
+      {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_running = false;
+      }
+      m_workAvailable.notify_all();
+
+      for(std::thread &worker : m_workers)
+        worker.join();
+      m_workers.clear();
+
+      // Jobs still queued are dropped, their counters never drop to zero.
+      m_queues.clear();
+      m_queued = 0;
+
+      return true;
+    }
+
+    WorkerPool::Stats WorkerPool
+      ::stats() const
+    {
+      Stats stats;
+      stats.jobs   = m_jobs.load();
+      stats.steals = m_steals.load();
+      return stats;
+    }
+
+    unsigned int WorkerPool
+      ::currentQueue() const
+    {
+      return (t_pool == this) ? t_queue : 0;
+    }
+
+    void WorkerPool
+      ::run(
+        std::function<void()> const&fn,
+        JobCounter                 *counter,
+        JobCounter                 *dependency)
+    {
+      if(counter)
+        counter->m_value.fetch_add(1, std::memory_order_relaxed);
+
+      Job job ={ fn, counter };
+
+      if(dependency) {
+        std::lock_guard<std::mutex> lock(dependency->m_mutex);
+        if(dependency->m_value.load(std::memory_order_acquire)) {
+          dependency->m_continuations.push_back(std::move(job));
+          return;
+        }
+      }
+
+      push(std::move(job));
+    }
+
+    void WorkerPool
+      ::push(Job &&job)
+    {
+      if(m_workers.empty()) {
+        execute(job);
+        return;
+      }
+
+      Queue &queue = *m_queues[currentQueue()];
+      {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.pushBack(std::move(job));
+        m_queued.fetch_add(1);
+      }
+
+      // A worker checks m_queued under m_sleepMutex before sleeping: taking it here means
+      // the worker either sees the job or is already waiting for the notification.
+      { std::lock_guard<std::mutex> lock(m_sleepMutex); }
+      m_workAvailable.notify_one();
+    }
+
+    bool WorkerPool
+      ::pop(unsigned int queueIndex, Job &outJob)
+    {
+      Queue &queue = *m_queues[queueIndex];
+
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if(!queue.count)
+        return false;
+
+      queue.popBack(outJob);
+      m_queued.fetch_sub(1);
+      return true;
+    }
+
+    bool WorkerPool
+      ::steal(unsigned int thief, Job &outJob)
+    {
+      size_t const queueCount = m_queues.size();
+      for(size_t k=1; k < queueCount; ++k) {
+        Queue &queue = *m_queues[(thief + k) % queueCount];
+
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if(!queue.count)
+          continue;
+
+        queue.popFront(outJob);
+        m_queued.fetch_sub(1);
+        m_steals.fetch_add(1, std::memory_order_relaxed);
+        return true;
+      }
+
+      return false;
+    }
+
+    void WorkerPool
+      ::execute(Job &job)
+    {
+      job.fn();
+      m_jobs.fetch_add(1, std::memory_order_relaxed);
+
+      JobCounter *counter = job.counter;
+      if(!counter)
+        return;
+
+      // Decrement under the lock: a waiter seeing zero takes it once more before it may destroy
+      // the counter, and a job added as continuation meanwhile is not lost.
+      std::vector<Job> ready;
+      {
+        std::lock_guard<std::mutex> lock(counter->m_mutex);
+        if(counter->m_value.fetch_sub(1, std::memory_order_acq_rel) == 1)
+          ready.swap(counter->m_continuations);
+      }
+
+      for(Job &continuation : ready)
+        push(std::move(continuation));
+    }
+
+    void WorkerPool
+      ::wait(JobCounter &counter)
+    {
+      unsigned int const queue = currentQueue();
+
+      while(!counter.done()) {
+        Job job;
+        if(!m_workers.empty() && (pop(queue, job) || steal(queue, job)))
+          execute(job);
+        else
+          std::this_thread::yield();
+      }
+
+      std::lock_guard<std::mutex> lock(counter.m_mutex);
+    }
+
+    void WorkerPool
+      ::parallelFor(size_t count, size_t grain, std::function<void(size_t, size_t)> const&fn)
+    {
+      if(!count)
+        return;
+      grain = std::max<size_t>(1, grain);
+
+      size_t const chunks = (count + grain - 1) / grain;
+      if(m_workers.empty() || chunks == 1) {
+        for(size_t begin=0; begin < count; begin += grain)
+          fn(begin, std::min(begin + grain, count));
+        return;
+      }
+
+      // Helpers pull chunks from a shared counter until none are left; the caller is one of them,
+      // and helpers that start late find nothing to do and return right away. The jobs capture
+      // a single pointer, which std::function stores without allocating.
+      struct Shared {
+        std::atomic<size_t>                        next;
+        size_t                                     count;
+        size_t                                     grain;
+        std::function<void(size_t, size_t)> const *fn;
+      } shared;
+      shared.next  = 0;
+      shared.count = count;
+      shared.grain = grain;
+      shared.fn    = &fn;
+
+      Shared *state = &shared;
+      auto body = [state] () -> void
+      {
+        for(size_t begin=state->next.fetch_add(state->grain); begin < state->count; begin=state->next.fetch_add(state->grain))
+          (*state->fn)(begin, std::min(begin + state->grain, state->count));
+      };
+
+      JobCounter   helpers;
+      size_t const helperCount = std::min(chunks - 1, m_workers.size());
+      for(size_t k=0; k < helperCount; ++k)
+        run(body, &helpers);
+
+      body();
+      wait(helpers);
+    }
+
+    void WorkerPool
+      ::workerMain(unsigned int queue)
+    {
+      t_pool  = this;
+      t_queue = queue;
+
+      uint64_t frame = m_frame.load(std::memory_order_relaxed);
+
+      for(;;) {
+        Job job;
+        if(pop(queue, job) || steal(queue, job)) {
+          // No job runs on this thread here, so nothing uses its frame arena.
+          uint64_t const current = m_frame.load(std::memory_order_relaxed);
+          if(current != frame) {
+            SAE::Memory::FrameArena::local().reset();
+            frame = current;
+          }
+
+          execute(job);
+          continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_workAvailable.wait(lock, [this] () { return !m_running || m_queued.load() > 0; });
+        if(!m_running)
+          break;
+      }
+
+      t_pool = nullptr;
+    }
+
+    namespace {
+
+      typedef std::chrono::high_resolution_clock Clock;
+
+      struct BenchmarkObject {
+        float    translation[3];
+        float    yaw;
+        float    scale;
+        int32_t  parent;    // -1: root
+        uint32_t material;
+      };
+
+      // Row vector matrices, v' = v * m.
+      struct BenchmarkMatrix {
+        float m[16];
+      };
+
+      struct BenchmarkPlane {
+        float normal[3];
+        float distance;
+      };
+
+      static void MultiplyBenchmarkMatrix(BenchmarkMatrix const&a, BenchmarkMatrix const&b, BenchmarkMatrix &out)
+      {
+        for(uint32_t r=0; r < 4; ++r)
+          for(uint32_t c=0; c < 4; ++c)
+            out.m[4 * r + c]
+              = a.m[4 * r + 0] * b.m[c]
+              + a.m[4 * r + 1] * b.m[4 + c]
+              + a.m[4 * r + 2] * b.m[8 + c]
+              + a.m[4 * r + 3] * b.m[12 + c];
+      }
+
+      // Scale, rotation about y, translation.
+      static void LocalBenchmarkMatrix(BenchmarkObject const&object, BenchmarkMatrix &out)
+      {
+        float const s = std::sin(object.yaw) * object.scale;
+        float const c = std::cos(object.yaw) * object.scale;
+
+        BenchmarkMatrix const local ={{
+          c,                     0.0f,                  -s,                    0.0f,
+          0.0f,                  object.scale,          0.0f,                  0.0f,
+          s,                     0.0f,                  c,                     0.0f,
+          object.translation[0], object.translation[1], object.translation[2], 1.0f
+        }};
+        out = local;
+      }
+
+    }
+
+    std::vector<JobSystemBenchmarkResult> BenchmarkJobSystem(
+      size_t       objectCount,
+      unsigned int viewCount,
+      unsigned int maxThreads)
+    {
+      if(!maxThreads)
+        maxThreads = std::max(1u, std::thread::hardware_concurrency());
+      viewCount = std::max(1u, viewCount);
+
+      // Three levels: a hundredth of the objects are roots, nine hundredths their children,
+      // the rest grandchildren; parents are picked from the previous level.
+      size_t const rootCount  = std::max<size_t>(1, objectCount / 100);
+      size_t const childCount = std::min(objectCount - rootCount, rootCount * 9);
+      size_t const levels[4]  ={ 0, rootCount, rootCount + childCount, objectCount };
+
+      uint32_t seed = 0x2545F491u;
+      auto random = [&seed] () -> float
+      {
+        seed = seed * 1664525u + 1013904223u;
+        return float(seed >> 8) / float(1u << 24);
+      };
+
+      std::vector<BenchmarkObject> objects(objectCount);
+      for(uint32_t level=0; level < 3; ++level)
+        for(size_t k=levels[level]; k < levels[level + 1]; ++k) {
+          BenchmarkObject &object = objects[k];
+          float const extent = (level == 0) ? 500.0f : 10.0f;
+          object.translation[0] = extent * (2.0f * random() - 1.0f);
+          object.translation[1] = (level == 0) ? 0.0f : 2.0f * random();
+          object.translation[2] = extent * (2.0f * random() - 1.0f);
+          object.yaw            = 6.2831853f * random();
+          object.scale          = 0.5f + random();
+          object.material       = static_cast<uint32_t>(k % 16);
+          object.parent         = -1;
+          if(level) {
+            size_t const parents = levels[level] - levels[level - 1];
+            object.parent = static_cast<int32_t>(levels[level - 1] + std::min(parents - 1, static_cast<size_t>(random() * parents)));
+          }
+        }
+
+      // Views from the origin, spread around the up axis, 90 degrees wide, 1 to 400 units deep.
+      std::vector<BenchmarkPlane> planes(6 * viewCount);
+      for(unsigned int v=0; v < viewCount; ++v) {
+        float const angle     = 6.2831853f * v / viewCount;
+        float const forward[3] ={ std::sin(angle), 0.0f, std::cos(angle) };
+        float const right[3]   ={ std::cos(angle), 0.0f, -std::sin(angle) };
+        float const up[3]      ={ 0.0f, 1.0f, 0.0f };
+        float const h          = 0.70710678f;
+
+        BenchmarkPlane *view = &planes[6 * v];
+        for(uint32_t c=0; c < 3; ++c) {
+          view[0].normal[c] = h * (forward[c] - right[c]);
+          view[1].normal[c] = h * (forward[c] + right[c]);
+          view[2].normal[c] = h * (forward[c] - up[c]);
+          view[3].normal[c] = h * (forward[c] + up[c]);
+          view[4].normal[c] = forward[c];
+          view[5].normal[c] = -forward[c];
+        }
+        view[0].distance = view[1].distance = view[2].distance = view[3].distance = 0.0f;
+        view[4].distance = -1.0f;
+        view[5].distance = 400.0f;
+      }
+
+      std::vector<BenchmarkMatrix>      world(objectCount);
+      std::vector<std::vector<uint8_t>> visible(viewCount, std::vector<uint8_t>(objectCount, 0));
+      std::vector<uint32_t>             drawList;
+      std::vector<uint32_t>             baselineDrawList;
+      std::vector<size_t>               baselineVisible;
+
+      size_t const drawListChunk  = 4096;
+      size_t const drawListChunks = (objectCount + drawListChunk - 1) / drawListChunk;
+      std::vector<size_t> chunkOffsets(drawListChunks + 1, 0);
+
+      std::vector<JobSystemBenchmarkResult> results;
+      for(unsigned int threads=1; threads <= maxThreads; threads *= 2) {
+        WorkerPool pool;
+        pool.initialize(threads);
+
+        auto transformFn = [&] () -> void
+        {
+          for(uint32_t level=0; level < 3; ++level)
+            pool.parallelFor(levels[level + 1] - levels[level], 1024, [&] (size_t begin, size_t end)
+            {
+              for(size_t k=levels[level] + begin; k < levels[level] + end; ++k) {
+                BenchmarkMatrix local;
+                LocalBenchmarkMatrix(objects[k], local);
+                if(objects[k].parent < 0)
+                  world[k] = local;
+                else
+                  MultiplyBenchmarkMatrix(local, world[objects[k].parent], world[k]);
+              }
+            });
+        };
+
+        // Bounding sphere of the unit cube around every object against the view's planes.
+        auto cullFn = [&] (unsigned int v) -> void
+        {
+          BenchmarkPlane const *view = &planes[6 * v];
+          pool.parallelFor(objectCount, 2048, [&, view, v] (size_t begin, size_t end)
+          {
+            for(size_t k=begin; k < end; ++k) {
+              float const *m      = world[k].m;
+              float const  scale  = std::sqrt(m[0] * m[0] + m[1] * m[1] + m[2] * m[2]);
+              float const  radius = 1.7320508f * scale;
+
+              bool inside = true;
+              for(uint32_t p=0; p < 6 && inside; ++p)
+                inside = (view[p].normal[0] * m[12] + view[p].normal[1] * m[13] + view[p].normal[2] * m[14] + view[p].distance) >= -radius;
+              visible[v][k] = inside ? 1 : 0;
+            }
+          });
+        };
+
+        // Visible objects of the first view in scene order: count per chunk, offsets, write.
+        auto drawListFn = [&] () -> void
+        {
+          pool.parallelFor(drawListChunks, 1, [&] (size_t begin, size_t end)
+          {
+            for(size_t c=begin; c < end; ++c) {
+              size_t count = 0;
+              for(size_t k=c * drawListChunk; k < std::min(objectCount, (c + 1) * drawListChunk); ++k)
+                count += visible[0][k];
+              chunkOffsets[c + 1] = count;
+            }
+          });
+          for(size_t c=0; c < drawListChunks; ++c)
+            chunkOffsets[c + 1] += chunkOffsets[c];
+
+          drawList.resize(chunkOffsets[drawListChunks]);
+          pool.parallelFor(drawListChunks, 1, [&] (size_t begin, size_t end)
+          {
+            for(size_t c=begin; c < end; ++c) {
+              size_t offset = chunkOffsets[c];
+              for(size_t k=c * drawListChunk; k < std::min(objectCount, (c + 1) * drawListChunk); ++k)
+                if(visible[0][k])
+                  drawList[offset++] = static_cast<uint32_t>(k);
+            }
+          });
+        };
+
+        int const repetitions = 10;
+        double transformSeconds = 0.0;
+        double cullSeconds      = 0.0;
+        double drawListSeconds  = 0.0;
+        double frameSeconds     = 0.0;
+        for(int r=0; r <= repetitions; ++r) {
+          Clock::time_point const start = Clock::now();
+          Clock::time_point transformed, culled, listed;
+
+          // Culling depends on the transforms, the draw list on the culling.
+          JobCounter transformCounter, cullCounter, drawListCounter;
+          pool.run([&] () { transformFn(); transformed = Clock::now(); }, &transformCounter);
+          for(unsigned int v=0; v < viewCount; ++v)
+            pool.run([&, v] () { cullFn(v); }, &cullCounter, &transformCounter);
+          pool.run([&] () { culled = Clock::now(); drawListFn(); listed = Clock::now(); }, &drawListCounter, &cullCounter);
+          pool.wait(drawListCounter);
+
+          Clock::time_point const end = Clock::now();
+          if(!r)
+            continue; // warm-up
+
+          transformSeconds += std::chrono::duration<double>(transformed - start).count();
+          cullSeconds      += std::chrono::duration<double>(culled      - transformed).count();
+          drawListSeconds  += std::chrono::duration<double>(listed      - culled).count();
+          frameSeconds     += std::chrono::duration<double>(end         - start).count();
+        }
+
+        std::vector<size_t> visibleCounts(viewCount, 0);
+        for(unsigned int v=0; v < viewCount; ++v)
+          for(uint8_t const&flag : visible[v])
+            visibleCounts[v] += flag;
+
+        if(results.empty()) {
+          baselineDrawList = drawList;
+          baselineVisible  = visibleCounts;
+        }
+
+        JobSystemBenchmarkResult result;
+        result.threadCount = threads;
+        result.transformMs = (transformSeconds * 1000.0) / repetitions;
+        result.cullMs      = (cullSeconds      * 1000.0) / repetitions;
+        result.drawListMs  = (drawListSeconds  * 1000.0) / repetitions;
+        result.frameMs     = (frameSeconds     * 1000.0) / repetitions;
+        result.speedup     = (!results.empty() && result.frameMs > 0.0) ? (results.front().frameMs / result.frameMs) : 1.0;
+        result.steals      = pool.stats().steals;
+        result.valid       = (drawList == baselineDrawList) && (visibleCounts == baselineVisible);
+        results.push_back(result);
+
+        pool.deinitialize();
+      }
+
+      return results;
+    }
+
+  }
+}
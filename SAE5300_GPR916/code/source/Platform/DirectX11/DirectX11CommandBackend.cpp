@@ -0,0 +1,204 @@
+#include <cstring>
+
+#include "Platform/DirectX11/DirectX11CommandBackend.h"
+
+namespace SAE {
+  namespace DirectX11 {
+
+    DirectX11ConstantUploadDevice::DirectX11ConstantUploadDevice(
+      ID3D11DevicePtr        const&device,
+      ID3D11DeviceContextPtr const&context)
+      : m_device(device)
+      , m_context(context)
+    {}
+
+    bool DirectX11ConstantUploadDevice
+      ::IsSupported(ID3D11DevicePtr const&device)
+    {
+      D3D11_FEATURE_DATA_D3D11_OPTIONS options ={};
+      HRESULT hres = device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options));
+      if(FAILED(hres))
+        return false;
+
+      return (options.ConstantBufferOffsetting && options.MapNoOverwriteOnDynamicConstantBuffer);
+    }
+
+    bool DirectX11ConstantUploadDevice
+      ::createBuffer(uint32_t byteSize)
+    {
+      D3D11_BUFFER_DESC desc ={};
+      desc.ByteWidth      = byteSize;
+      desc.Usage          = D3D11_USAGE_DYNAMIC;
+      desc.BindFlags      = D3D11_BIND_CONSTANT_BUFFER;
+      desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+      ID3D11Buffer *pBufferUnmanaged = nullptr;
+      HRESULT hres = m_device->CreateBuffer(&desc, nullptr, &pBufferUnmanaged);
+      if(FAILED(hres))
+        return false;
+
+      m_buffer = MakeDirectX11ResourceSharedPointer(pBufferUnmanaged);
+      return true;
+    }
+
+    void* DirectX11ConstantUploadDevice
+      ::map(bool discard)
+    {
+      D3D11_MAPPED_SUBRESOURCE mapped ={};
+      HRESULT hres = m_context->Map(
+        m_buffer.get(),
+        0,
+        (discard ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE),
+        0,
+        &mapped);
+
+      return (FAILED(hres) ? nullptr : mapped.pData);
+    }
+
+    void DirectX11ConstantUploadDevice
+      ::unmap()
+    {
+      m_context->Unmap(m_buffer.get(), 0);
+    }
+
+    DirectX11CommandBackend::DirectX11CommandBackend(
+      ID3D11DeviceContextPtr        const&context,
+      ConstantUploadRing                 *constantRing,
+      DirectX11ConstantUploadDevice      *constantRingDevice)
+      : m_context(context)
+      , m_indexBufferId(0)
+      , m_indexCount(0)
+      , m_constantRing(nullptr)
+      , m_constantRingDevice(nullptr)
+      , m_nextConstants(0)
+    {
+      if(!constantRing || !constantRingDevice)
+        return;
+
+      ID3D11DeviceContext1 *pContext1Unmanaged = nullptr;
+      HRESULT hres = m_context->QueryInterface(__uuidof(ID3D11DeviceContext1), (void**)&pContext1Unmanaged);
+      if(FAILED(hres))
+        return;
+
+      m_context1           = MakeDirectX11ResourceSharedPointer(pContext1Unmanaged);
+      m_constantRing       = constantRing;
+      m_constantRingDevice = constantRingDevice;
+    }
+
+    bool DirectX11CommandBackend
+      ::uploadConstants(CommandBuffer const&buffer)
+    {
+      m_constantAllocations.clear();
+      m_nextConstants = 0;
+
+      if(!m_constantRing)
+        return false;
+
+      // Blocks that did not make it into the ring keep a zero size and take the Map path.
+      return UploadCommandConstants(buffer, *m_constantRing, m_constantAllocations);
+    }
+
+    void DirectX11CommandBackend
+      ::bindPipeline(BindPipelineCommand const&command)
+    {
+      m_context->IASetInputLayout(reinterpret_cast<ID3D11InputLayout*>(command.inputLayoutId));
+      m_context->VSSetShader(reinterpret_cast<ID3D11VertexShader*>(command.vertexShaderId), nullptr, 0);
+      m_context->PSSetShader(reinterpret_cast<ID3D11PixelShader*>(command.pixelShaderId), nullptr, 0);
+    }
+
+    void DirectX11CommandBackend
+      ::bindResources(BindResourcesCommand const&command)
+    {
+      ID3D11Buffer *vertexBuffer = reinterpret_cast<ID3D11Buffer*>(command.vertexBufferId);
+      ID3D11Buffer *indexBuffer  = reinterpret_cast<ID3D11Buffer*>(command.indexBufferId);
+
+      UINT vertexSize = command.vertexStride;
+      UINT offset     = 0;
+      m_context->IASetVertexBuffers(0, 1, &vertexBuffer, &vertexSize, &offset);
+      m_context->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+
+      if(command.indexBufferId != m_indexBufferId) {
+        D3D11_BUFFER_DESC indexBufferDesc ={};
+        if(indexBuffer)
+          indexBuffer->GetDesc(&indexBufferDesc);
+
+        m_indexBufferId = command.indexBufferId;
+        m_indexCount    = indexBufferDesc.ByteWidth / sizeof(uint32_t);
+      }
+
+      if(command.pixelShaderResourceCount) {
+        ID3D11ShaderResourceView *views[MaxPixelShaderResources] ={};
+        for(uint32_t k=0; k < command.pixelShaderResourceCount; ++k)
+          views[k] = reinterpret_cast<ID3D11ShaderResourceView*>(command.pixelShaderResources[k]);
+        m_context->PSSetShaderResources(0, command.pixelShaderResourceCount, views);
+      }
+
+      if(command.samplerCount) {
+        ID3D11SamplerState *samplers[MaxPixelShaderSamplers] ={};
+        for(uint32_t k=0; k < command.samplerCount; ++k)
+          samplers[k] = reinterpret_cast<ID3D11SamplerState*>(command.samplers[k]);
+        m_context->PSSetSamplers(0, command.samplerCount, samplers);
+      }
+    }
+
+    void DirectX11CommandBackend
+      ::updateConstants(UpdateConstantsCommand const&command, const void *data)
+    {
+      size_t const index = m_nextConstants++;
+      if(index < m_constantAllocations.size() && m_constantAllocations[index].size) {
+        ConstantUploadRing::Allocation const&allocation = m_constantAllocations[index];
+
+        ID3D11Buffer *ringBuffer    = m_constantRingDevice->buffer();
+        UINT          firstConstant = allocation.offset / 16;
+        UINT          numConstants  = allocation.size   / 16;
+
+        if(command.stages & ShaderStageVertex)
+          m_context1->VSSetConstantBuffers1(command.slot, 1, &ringBuffer, &firstConstant, &numConstants);
+        if(command.stages & ShaderStagePixel)
+          m_context1->PSSetConstantBuffers1(command.slot, 1, &ringBuffer, &firstConstant, &numConstants);
+        return;
+      }
+
+      ID3D11Buffer *buffer = reinterpret_cast<ID3D11Buffer*>(command.bufferId);
+
+      if(command.dataSize) {
+        D3D11_MAPPED_SUBRESOURCE mapped ={};
+        HRESULT hres = m_context->Map(buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+        if(FAILED(hres))
+          return;
+
+        memcpy(mapped.pData, data, command.dataSize);
+        m_context->Unmap(buffer, 0);
+      }
+
+      if(command.stages & ShaderStageVertex)
+        m_context->VSSetConstantBuffers(command.slot, 1, &buffer);
+      if(command.stages & ShaderStagePixel)
+        m_context->PSSetConstantBuffers(command.slot, 1, &buffer);
+    }
+
+    void DirectX11CommandBackend
+      ::drawIndexed(DrawIndexedCommand const&command)
+    {
+      UINT indexCount = (command.indexCount ? command.indexCount : m_indexCount);
+      m_context->DrawIndexed(indexCount, command.startIndex, command.baseVertex);
+    }
+
+    void DirectX11CommandBackend
+      ::updateBuffer(UpdateBufferCommand const&command, const void *data)
+    {
+      ID3D11Buffer *buffer = reinterpret_cast<ID3D11Buffer*>(command.bufferId);
+      if(!buffer || !command.dataSize)
+        return;
+
+      D3D11_MAPPED_SUBRESOURCE mapped ={};
+      HRESULT hres = m_context->Map(buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+      if(FAILED(hres))
+        return;
+
+      memcpy(mapped.pData, data, command.dataSize);
+      m_context->Unmap(buffer, 0);
+    }
+
+  }
+}
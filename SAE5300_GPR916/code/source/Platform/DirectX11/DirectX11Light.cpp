@@ -11,8 +11,6 @@ namespace SAE {
 
     Light::Light(Properties const& props)
       : m_properties(props)
-      , m_viewMatrix()
-      , m_projectionMatrix()
     {
       // F = I  / (sq*d^2 + lin*d + c)
       // F * (sq*d^2 + lin*d + c) = I
@@ -36,56 +34,14 @@ namespace SAE {
       m_properties.specificProperties.point.distance = max(0.0f, ((x1 < 0) ? x2 : x1));
     }
 
-    XMMATRIX const& 
-      Light::viewMatrix(uint64_t faceIndex)
+    uint32_t
+      Light::ShadowViewCount(Type type)
     {
-      createViewMatrices();
-      return m_viewMatrix[faceIndex];
-    }
-
-    XMMATRIX const& 
-      Light::projectionMatrix(uint64_t faceIndex)
-    {
-      createProjectionMatrices();
-      return m_projectionMatrix[faceIndex];
-    }
-
-    XMMATRIX*
-      Light::viewMatrices()
-    {
-      createViewMatrices();
-      return m_viewMatrix;
-    }
-
-    XMMATRIX* 
-      Light::projectionMatrices()
-    {
-      createProjectionMatrices();
-      return m_projectionMatrix;
-    }
-
-    void 
-      Light::createViewMatrices()
-    {
-      transform().worldMatrix(XMMatrixIdentity(), nullptr);
-      m_viewMatrix[0] = XMMatrixLookToLH(transform().getTranslation(), XMVECTOR({  1.0f,  0.0f,  0.0f, 0.0f }), { 0.0f, 1.0f,  0.0f, 0.0f });
-      m_viewMatrix[1] = XMMatrixLookToLH(transform().getTranslation(), XMVECTOR({ -1.0f,  0.0f,  0.0f, 0.0f }), { 0.0f, 1.0f,  0.0f, 0.0f });
-      m_viewMatrix[2] = XMMatrixLookToLH(transform().getTranslation(), XMVECTOR({  0.0f,  1.0f,  0.0f, 0.0f }), { 0.0f, 0.0f, -1.0f, 0.0f });
-      m_viewMatrix[3] = XMMatrixLookToLH(transform().getTranslation(), XMVECTOR({  0.0f, -1.0f,  0.0f, 0.0f }), { 0.0f, 0.0f,  1.0f, 0.0f });
-      m_viewMatrix[4] = XMMatrixLookToLH(transform().getTranslation(), XMVECTOR({  0.0f,  0.0f,  1.0f, 0.0f }), { 0.0f, 1.0f,  0.0f, 0.0f });
-      m_viewMatrix[5] = XMMatrixLookToLH(transform().getTranslation(), XMVECTOR({  0.0f,  0.0f, -1.0f, 0.0f }), { 0.0f, 1.0f,  0.0f, 0.0f });
-    }
-
-    void 
-      Light::createProjectionMatrices()
-    {
-      transform().worldMatrix(XMMatrixIdentity(), nullptr);
-      m_projectionMatrix[0] = XMMatrixPerspectiveFovLH((float)(M_PI / 2.0f), 1.0f, 0.001f, m_properties.specificProperties.point.distance);
-      m_projectionMatrix[1] = XMMatrixPerspectiveFovLH((float)(M_PI / 2.0f), 1.0f, 0.001f, m_properties.specificProperties.point.distance);
-      m_projectionMatrix[2] = XMMatrixPerspectiveFovLH((float)(M_PI / 2.0f), 1.0f, 0.001f, m_properties.specificProperties.point.distance);
-      m_projectionMatrix[3] = XMMatrixPerspectiveFovLH((float)(M_PI / 2.0f), 1.0f, 0.001f, m_properties.specificProperties.point.distance);
-      m_projectionMatrix[4] = XMMatrixPerspectiveFovLH((float)(M_PI / 2.0f), 1.0f, 0.001f, m_properties.specificProperties.point.distance);
-      m_projectionMatrix[5] = XMMatrixPerspectiveFovLH((float)(M_PI / 2.0f), 1.0f, 0.001f, m_properties.specificProperties.point.distance);
+      switch(type) {
+      case Type::Directional: return CascadeCount;
+      case Type::Spot:        return 1;
+      default:                return 6;
+      }
     }
 
   }
@@ -8,6 +8,21 @@ namespace SAE {
   namespace DirectX11 {
     using namespace SAE::Engine;
 
+    void DirectX11Mesh
+      ::computeBounds()
+    {
+      XMVECTOR boundsMin = XMVectorZero();
+      XMVECTOR boundsMax = XMVectorZero();
+      if(!vertexBuffer().empty()) {
+        boundsMin = boundsMax = vertexBuffer().front().position;
+        for(Vertex_t const&vertex : vertexBuffer()) {
+          boundsMin = XMVectorMin(boundsMin, vertex.position);
+          boundsMax = XMVectorMax(boundsMax, vertex.position);
+        }
+      }
+      setBounds(boundsMin, boundsMax);
+    }
+
     std::shared_ptr<DirectX11Mesh>
       DirectX11Mesh::loadTriangle(
         std::shared_ptr<DirectX11ResourceManager>      &resourceManager,
@@ -63,6 +78,8 @@ namespace SAE {
       uint64_t indexBufferHandle
         = resourceManager->create<ID3D11Buffer>(indexBufferDescription, indexBufferSubresourceData);
 
+      pMesh->computeBounds();
+
       underlyingVertexBuffer.clear();
       underlyingVertexBuffer.resize(0);
       underlyingIndexBuffer.clear();
@@ -206,19 +223,35 @@ namespace SAE {
     std::shared_ptr<DirectX11Mesh>
       DirectX11Mesh::loadFromFile(
         std::shared_ptr<DirectX11ResourceManager>      &resourceManager,
-        std::string                               const&filename)
+        std::string                               const&filename,
+        bool                                           buildTriangleBVH)
+    {
+      VertexBuffer_t vertices;
+      IndexBuffer_t  indices;
+      uint64_t       vertexCount = 0;
+      uint64_t       indexCount  = 0;
+
+      if(!SAE::Engine::Mesh<XMVECTOR>::LoadMeshAssimp(filename.c_str(), vertices, vertexCount, indices, indexCount)) {
+        // Ohoh...
+      }
+
+      return createFromData(resourceManager, vertices, indices, buildTriangleBVH);
+    }
+
+    std::shared_ptr<DirectX11Mesh>
+      DirectX11Mesh::createFromData(
+        std::shared_ptr<DirectX11ResourceManager>      &resourceManager,
+        VertexBuffer_t                            const&vertices,
+        IndexBuffer_t                             const&indices,
+        bool                                           buildTriangleBVH)
     {
       // RAII
       std::shared_ptr<DirectX11Mesh> pMesh= std::shared_ptr<DirectX11Mesh>(new DirectX11Mesh());
 
       VertexBuffer_t& underlyingVertexBuffer = pMesh->vertexBuffer();
       IndexBuffer_t&  underlyingIndexBuffer  = pMesh->indexBuffer();
-      uint64_t        vertexCount = 0;
-      uint64_t        indexCount  = 0;
-
-      if(!SAE::Engine::Mesh<XMVECTOR>::LoadMeshAssimp(filename.c_str(), underlyingVertexBuffer, vertexCount, underlyingIndexBuffer, indexCount)) {
-        // Ohoh...
-      }
+      underlyingVertexBuffer = vertices;
+      underlyingIndexBuffer  = indices;
 
       D3D11_BUFFER_DESC vertexBufferDescription ={};
       vertexBufferDescription.ByteWidth           = underlyingVertexBuffer.size() * sizeof(Vertex_t);
@@ -252,6 +285,20 @@ namespace SAE {
       uint64_t indexBufferHandle
         = resourceManager->create<ID3D11Buffer>(indexBufferDescription, indexBufferSubresourceData);
 
+      pMesh->computeBounds();
+
+      // Built before the CPU copies are dropped below; the tree keeps its own triangles.
+      if(buildTriangleBVH && !underlyingIndexBuffer.empty()) {
+        std::shared_ptr<SAE::Rendering::TriangleBVH> bvh = std::make_shared<SAE::Rendering::TriangleBVH>();
+        if(bvh->build(
+          reinterpret_cast<float const*>(&underlyingVertexBuffer.front().position),
+          sizeof(Vertex_t),
+          underlyingVertexBuffer.size(),
+          underlyingIndexBuffer.data(),
+          underlyingIndexBuffer.size()))
+          pMesh->m_triangleBVH = bvh;
+      }
+
       underlyingVertexBuffer.clear();
       underlyingVertexBuffer.resize(0);
       underlyingIndexBuffer.clear();
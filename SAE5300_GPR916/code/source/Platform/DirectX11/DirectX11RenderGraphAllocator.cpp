@@ -0,0 +1,136 @@
+
+#include "Platform/DirectX11/DirectX11RenderGraphAllocator.h"
+
+namespace SAE {
+  namespace DirectX11 {
+    using namespace SAE::Rendering;
+
+    struct FormatSet {
+      DXGI_FORMAT texture;
+      DXGI_FORMAT shaderResource;
+      DXGI_FORMAT view;  // depth stencil or render target
+    };
+
+    static FormatSet SelectFormats(RenderGraphFormat format)
+    {
+      switch(format) {
+      case RenderGraphFormat::D24S8:
+        return { DXGI_FORMAT_R24G8_TYPELESS, DXGI_FORMAT_R24_UNORM_X8_TYPELESS, DXGI_FORMAT_D24_UNORM_S8_UINT };
+      case RenderGraphFormat::D32F:
+        return { DXGI_FORMAT_R32_TYPELESS, DXGI_FORMAT_R32_FLOAT, DXGI_FORMAT_D32_FLOAT };
+      case RenderGraphFormat::RGBA16F:
+        return { DXGI_FORMAT_R16G16B16A16_FLOAT, DXGI_FORMAT_R16G16B16A16_FLOAT, DXGI_FORMAT_R16G16B16A16_FLOAT };
+      case RenderGraphFormat::R32F:
+        return { DXGI_FORMAT_R32_FLOAT, DXGI_FORMAT_R32_FLOAT, DXGI_FORMAT_R32_FLOAT };
+      case RenderGraphFormat::RGBA8:
+      default:
+        return { DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_FORMAT_R8G8B8A8_UNORM };
+      }
+    }
+
+    DirectX11RenderGraphAllocator::DirectX11RenderGraphAllocator(std::shared_ptr<DirectX11ResourceManager> const&resourceManager)
+      : m_resourceManager(resourceManager)
+    {}
+
+    bool DirectX11RenderGraphAllocator
+      ::create(RenderGraphTextureDesc const&desc, uint32_t usage, RenderGraphTexture &outTexture)
+    {
+      FormatSet const formats   = SelectFormats(desc.format);
+      UINT      const arraySize = (desc.arraySize ? desc.arraySize : 1u);
+
+      D3D11_TEXTURE2D_DESC textureDesc ={};
+      textureDesc.Width              = desc.width;
+      textureDesc.Height             = desc.height;
+      textureDesc.ArraySize          = arraySize;
+      textureDesc.MipLevels          = 1;
+      textureDesc.SampleDesc.Count   = 1;
+      textureDesc.SampleDesc.Quality = 0;
+      textureDesc.Usage              = D3D11_USAGE_DEFAULT;
+      textureDesc.CPUAccessFlags     = 0;
+      textureDesc.Format             = formats.texture;
+      textureDesc.MiscFlags          = (desc.cube ? D3D11_RESOURCE_MISC_TEXTURECUBE : 0);
+      if(usage & RenderGraphUsageShaderResource) textureDesc.BindFlags |= D3D11_BIND_SHADER_RESOURCE;
+      if(usage & RenderGraphUsageDepthStencil)   textureDesc.BindFlags |= D3D11_BIND_DEPTH_STENCIL;
+      if(usage & RenderGraphUsageRenderTarget)   textureDesc.BindFlags |= D3D11_BIND_RENDER_TARGET;
+
+      std::vector<D3D11_SUBRESOURCE_DATA> initialData;
+      outTexture = RenderGraphTexture();
+      outTexture.textureId = m_resourceManager->create<ID3D11Texture2D>(textureDesc, initialData);
+
+      ID3D11Texture2D *pTexture = reinterpret_cast<ID3D11Texture2D*>(outTexture.textureId);
+
+      if(usage & RenderGraphUsageShaderResource) {
+        D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc ={};
+        srvDesc.Format = formats.shaderResource;
+        if(desc.cube && arraySize > 6) {
+          srvDesc.ViewDimension                     = D3D11_SRV_DIMENSION_TEXTURECUBEARRAY;
+          srvDesc.TextureCubeArray.MipLevels        = 1;
+          srvDesc.TextureCubeArray.MostDetailedMip  = 0;
+          srvDesc.TextureCubeArray.First2DArrayFace = 0;
+          srvDesc.TextureCubeArray.NumCubes         = arraySize / 6;
+        }
+        else if(desc.cube) {
+          srvDesc.ViewDimension               = D3D11_SRV_DIMENSION_TEXTURECUBE;
+          srvDesc.TextureCube.MipLevels       = 1;
+          srvDesc.TextureCube.MostDetailedMip = 0;
+        }
+        else if(arraySize > 1) {
+          srvDesc.ViewDimension                  = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+          srvDesc.Texture2DArray.MipLevels       = 1;
+          srvDesc.Texture2DArray.MostDetailedMip = 0;
+          srvDesc.Texture2DArray.FirstArraySlice = 0;
+          srvDesc.Texture2DArray.ArraySize       = arraySize;
+        }
+        else {
+          srvDesc.ViewDimension             = D3D11_SRV_DIMENSION_TEXTURE2D;
+          srvDesc.Texture2D.MipLevels       = 1;
+          srvDesc.Texture2D.MostDetailedMip = 0;
+        }
+        outTexture.shaderResourceViewId = m_resourceManager->create<ID3D11ShaderResourceView>(srvDesc, pTexture);
+      }
+
+      for(UINT slice=0; slice < arraySize; ++slice) {
+        if(usage & RenderGraphUsageDepthStencil) {
+          D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc ={};
+          dsvDesc.Format                         = formats.view;
+          dsvDesc.ViewDimension                  = D3D11_DSV_DIMENSION_TEXTURE2DARRAY;
+          dsvDesc.Texture2DArray.MipSlice        = 0;
+          dsvDesc.Texture2DArray.FirstArraySlice = slice;
+          dsvDesc.Texture2DArray.ArraySize       = 1;
+
+          D3D11_SUBRESOURCE_DATA emptyDSVData ={};
+          outTexture.depthStencilViewIds.push_back(m_resourceManager->create<ID3D11DepthStencilView>(dsvDesc, pTexture, emptyDSVData));
+        }
+
+        if(usage & RenderGraphUsageRenderTarget) {
+          D3D11_RENDER_TARGET_VIEW_DESC rtvDesc ={};
+          rtvDesc.Format                         = formats.view;
+          rtvDesc.ViewDimension                  = D3D11_RTV_DIMENSION_TEXTURE2DARRAY;
+          rtvDesc.Texture2DArray.MipSlice        = 0;
+          rtvDesc.Texture2DArray.FirstArraySlice = slice;
+          rtvDesc.Texture2DArray.ArraySize       = 1;
+
+          outTexture.renderTargetViewIds.push_back(m_resourceManager->create<ID3D11RenderTargetView>(rtvDesc, pTexture));
+        }
+      }
+
+      return (outTexture.textureId != 0);
+    }
+
+    void DirectX11RenderGraphAllocator
+      ::release(RenderGraphTexture &texture)
+    {
+      for(uint64_t id : texture.depthStencilViewIds)
+        m_resourceManager->release<ID3D11DepthStencilView>(id);
+      for(uint64_t id : texture.renderTargetViewIds)
+        m_resourceManager->release<ID3D11RenderTargetView>(id);
+      if(texture.shaderResourceViewId)
+        m_resourceManager->release<ID3D11ShaderResourceView>(texture.shaderResourceViewId);
+      if(texture.textureId)
+        m_resourceManager->release<ID3D11Texture2D>(texture.textureId);
+
+      texture = RenderGraphTexture();
+    }
+
+  }
+}
@@ -318,6 +318,44 @@ namespace SAE {
     }
 
 
+    template <>
+    uint64_t
+      DirectX11ResourceManager
+      ::create<ID3D11ShaderResourceView,
+      D3D11_SHADER_RESOURCE_VIEW_DESC,
+      ID3D11Buffer*>
+      (D3D11_SHADER_RESOURCE_VIEW_DESC  const&desc, 
+       ID3D11Buffer                  *const&buffer)
+    {
+
+      // ---------------------------------------------------------------
+      // RCA -> Resource Creation Algorithm 
+      // ---------------------------------------------------------------
+      // 1. Declare unmanaged null initialized pointer of specific type
+      ID3D11ShaderResourceView
+        *pSRVUnmanaged = nullptr;
+
+      // 2. Call ID3D11Device creation function and handle error
+      HRESULT hres = m_device->CreateShaderResourceView(buffer, &desc, &pSRVUnmanaged);
+      HandleWINAPIError(hres, "Failed to create buffer shader resource view.");
+
+      // 3. Create unique id by abusing reinterpret_cast to uint64_t
+      uint64_t id = reinterpret_cast<uint64_t>(pSRVUnmanaged);
+
+      // 4. Create managed directX shared pointer
+      std::shared_ptr<ID3D11ShaderResourceView>
+        pSRVManaged
+        = MakeDirectX11ResourceSharedPointer(pSRVUnmanaged);
+
+      // 5. Push to resource holder
+      this->ResourceHolder<ID3D11ShaderResourceView>
+        ::set(id, pSRVManaged);
+
+      // 6. Return id
+      return id;
+    }
+
+
     template <>
     uint64_t 
       DirectX11ResourceManager
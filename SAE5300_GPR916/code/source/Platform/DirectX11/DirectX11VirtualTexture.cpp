@@ -0,0 +1,134 @@
+#include "Platform/DirectX11/DirectX11VirtualTexture.h"
+
+namespace SAE {
+  namespace DirectX11 {
+    using namespace SAE::Texture;
+
+    DirectX11VirtualTexture::DirectX11VirtualTexture()
+      : m_physicalTextureId(0)
+      , m_physicalTextureSRVId(0)
+      , m_pageTableId(0)
+      , m_pageTableSRVId(0)
+    {}
+
+    bool DirectX11VirtualTexture
+      ::initialize(
+        std::shared_ptr<DirectX11ResourceManager> &resourceManager,
+        VirtualTextureCache                  const&cache)
+    {
+      VirtualTextureLayout        const&layout  = cache.layout();
+      VirtualTextureCache::Options const&options = cache.options();
+
+      try {
+        std::vector<D3D11_SUBRESOURCE_DATA> noInitialData;
+
+        D3D11_TEXTURE2D_DESC physicalDesc ={};
+        physicalDesc.Width              = options.physicalPagesX * layout.tileSize();
+        physicalDesc.Height             = options.physicalPagesY * layout.tileSize();
+        physicalDesc.MipLevels          = 1;
+        physicalDesc.ArraySize          = 1;
+        physicalDesc.Format             = DXGI_FORMAT_R8G8B8A8_UNORM;
+        physicalDesc.SampleDesc.Count   = 1;
+        physicalDesc.SampleDesc.Quality = 0;
+        physicalDesc.Usage              = D3D11_USAGE_DEFAULT;
+        physicalDesc.BindFlags          = D3D11_BIND_SHADER_RESOURCE;
+        physicalDesc.CPUAccessFlags     = 0;
+        physicalDesc.MiscFlags          = 0;
+
+        m_physicalTextureId = resourceManager->create<ID3D11Texture2D>(physicalDesc, noInitialData);
+
+        D3D11_SHADER_RESOURCE_VIEW_DESC physicalSRVDesc ={};
+        physicalSRVDesc.Format                    = physicalDesc.Format;
+        physicalSRVDesc.ViewDimension             = D3D11_SRV_DIMENSION_TEXTURE2D;
+        physicalSRVDesc.Texture2D.MipLevels       = 1;
+        physicalSRVDesc.Texture2D.MostDetailedMip = 0;
+        m_physicalTextureSRVId = resourceManager->create<ID3D11ShaderResourceView>(physicalSRVDesc, reinterpret_cast<ID3D11Texture2D*>(m_physicalTextureId));
+
+        // Rounding up to a power of two makes mip m of the texture at least as large as the
+        // page grid of virtual mip m (which rounds up per level).
+        uint32_t tableWidth  = 1;
+        uint32_t tableHeight = 1;
+        while(tableWidth  < layout.pagesX(0)) tableWidth  <<= 1;
+        while(tableHeight < layout.pagesY(0)) tableHeight <<= 1;
+
+        D3D11_TEXTURE2D_DESC pageTableDesc = physicalDesc;
+        pageTableDesc.Width     = tableWidth;
+        pageTableDesc.Height    = tableHeight;
+        pageTableDesc.MipLevels = layout.mipLevels;
+        pageTableDesc.Format    = DXGI_FORMAT_R8G8B8A8_UINT;
+
+        m_pageTableId = resourceManager->create<ID3D11Texture2D>(pageTableDesc, noInitialData);
+
+        D3D11_SHADER_RESOURCE_VIEW_DESC pageTableSRVDesc = physicalSRVDesc;
+        pageTableSRVDesc.Format              = pageTableDesc.Format;
+        pageTableSRVDesc.Texture2D.MipLevels = pageTableDesc.MipLevels;
+        m_pageTableSRVId = resourceManager->create<ID3D11ShaderResourceView>(pageTableSRVDesc, reinterpret_cast<ID3D11Texture2D*>(m_pageTableId));
+
+        return true;
+      } catch(...) {
+        return false;
+      }
+    }
+
+    size_t DirectX11VirtualTexture
+      ::update(
+        ID3D11DeviceContext *context,
+        VirtualTextureCache &cache)
+    {
+      ID3D11Texture2D *physicalTexture = reinterpret_cast<ID3D11Texture2D*>(m_physicalTextureId);
+      ID3D11Texture2D *pageTable       = reinterpret_cast<ID3D11Texture2D*>(m_pageTableId);
+      if(!context || !physicalTexture || !pageTable)
+        return 0;
+
+      uint32_t tileSize = cache.layout().tileSize();
+
+      size_t uploads = cache.update(
+        [&] (VirtualTextureCache::Upload const&upload) -> void
+      {
+        D3D11_BOX box ={};
+        box.left   = upload.slotX * tileSize;
+        box.top    = upload.slotY * tileSize;
+        box.front  = 0;
+        box.right  = box.left + tileSize;
+        box.bottom = box.top  + tileSize;
+        box.back   = 1;
+        context->UpdateSubresource(physicalTexture, 0, &box, upload.tile, tileSize * 4, 0);
+      });
+
+      if(cache.pageTableDirty()) {
+        VirtualTextureLayout const&layout = cache.layout();
+        for(uint32_t mip=0; mip < layout.mipLevels; ++mip) {
+          D3D11_BOX box ={};
+          box.right  = layout.pagesX(mip);
+          box.bottom = layout.pagesY(mip);
+          box.back   = 1;
+          context->UpdateSubresource(pageTable, mip, &box, cache.pageTable(mip).data(), layout.pagesX(mip) * sizeof(VirtualTextureCache::PageTableEntry), 0);
+        }
+        cache.clearPageTableDirty();
+      }
+
+      return uploads;
+    }
+
+    VirtualTextureBuffer_t DirectX11VirtualTexture
+      ::shaderConstants(VirtualTextureCache const&cache) const
+    {
+      VirtualTextureLayout        const&layout  = cache.layout();
+      VirtualTextureCache::Options const&options = cache.options();
+
+      VirtualTextureBuffer_t constants ={};
+      constants.physical = XMVectorSet(
+        1.0f / (options.physicalPagesX * layout.tileSize()),
+        1.0f / (options.physicalPagesY * layout.tileSize()),
+        static_cast<float>(layout.tileSize()),
+        static_cast<float>(layout.border));
+      constants.virtualSize = XMVectorSet(
+        static_cast<float>(layout.width),
+        static_cast<float>(layout.height),
+        static_cast<float>(layout.pageSize),
+        static_cast<float>(layout.mipLevels));
+      return constants;
+    }
+
+  }
+}
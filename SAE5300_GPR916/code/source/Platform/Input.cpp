@@ -5,6 +5,10 @@
 namespace SAE {
   namespace Input {
 
+    static uint8_t stateValue(const KeyState &state) {
+      return static_cast<std::underlying_type_t<KeyState>>(state);
+    }
+
     InputState
       ::InputState()
       : m_keyStates()
@@ -20,6 +24,15 @@ namespace SAE {
       return true;
     }
 
+    void InputState
+      ::merge(InputState const&other)
+    {
+      for(std::map<KeyCode, KeyState>::value_type const&entry : other.m_keyStates) {
+        if(stateValue(entry.second) & stateValue(KeyState::Pressed))
+          m_keyStates[entry.first] = entry.second;
+      }
+    }
+
     void InputState
       ::setPressed(
         KeyCode const &keyCode,
@@ -45,10 +58,6 @@ namespace SAE {
       setPressed(MapWinApiVKeyToKeyCode(keyCode), pressed, isAlt);
     }
 
-    static uint8_t stateValue(const KeyState &state) {
-      return static_cast<std::underlying_type_t<KeyState>>(state);
-    }
-
     bool InputState
       ::getPressed(KeyCode const &keyCode) const
     {
@@ -0,0 +1,384 @@
+#include <algorithm>
+#include <cstring>
+
+#include "Renderer/CommandBuffer.h"
+
+namespace SAE {
+  namespace Rendering {
+
+    static const size_t PacketAlignment = 16;
+
+    static inline size_t AlignPacket(size_t size)
+    {
+      return (size + (PacketAlignment - 1)) & ~(PacketAlignment - 1);
+    }
+
+    CommandList::CommandList()
+      : m_base(nullptr)
+      , m_capacity(0)
+      , m_size(0)
+      , m_commandCount(0)
+    {}
+
+    CommandList::CommandList(CommandList const&other)
+      : CommandList()
+    {
+      *this = other;
+    }
+
+    CommandList& CommandList
+      ::operator=(CommandList const&other)
+    {
+      if(this == &other)
+        return *this;
+
+      m_size         = 0;
+      m_commandCount = 0;
+
+      reserve(other.m_size);
+      if(other.m_size)
+        memcpy(m_base, other.m_base, other.m_size);
+
+      m_size         = other.m_size;
+      m_commandCount = other.m_commandCount;
+
+      return *this;
+    }
+
+    void CommandList
+      ::reset()
+    {
+      m_size         = 0;
+      m_commandCount = 0;
+    }
+
+    void CommandList
+      ::reserve(size_t size)
+    {
+      if(size <= m_capacity)
+        return;
+
+      size_t capacity = std::max<size_t>(4096, m_capacity * 2);
+      while(capacity < size)
+        capacity *= 2;
+
+      // std::vector only guarantees the alignment of the default allocator, which is 8 on Win32.
+      std::vector<uint8_t> storage(capacity + PacketAlignment);
+      uintptr_t address = reinterpret_cast<uintptr_t>(storage.data());
+      uint8_t  *base    = storage.data() + (AlignPacket(address) - address);
+
+      if(m_size)
+        memcpy(base, m_base, m_size);
+
+      m_storage.swap(storage);
+      m_base     = base;
+      m_capacity = capacity;
+    }
+
+    void* CommandList
+      ::allocate(CommandType type, size_t size)
+    {
+      size_t const packetSize = AlignPacket(size);
+      reserve(m_size + packetSize);
+
+      uint8_t *packet = m_base + m_size;
+      memset(packet, 0, packetSize);
+
+      CommandHeader *header = reinterpret_cast<CommandHeader*>(packet);
+      header->type = type;
+      header->size = static_cast<uint32_t>(packetSize);
+
+      m_size += packetSize;
+      ++m_commandCount;
+
+      return packet;
+    }
+
+    void CommandList
+      ::bindPipeline(uint64_t inputLayoutId, uint64_t vertexShaderId, uint64_t pixelShaderId)
+    {
+      BindPipelineCommand *command
+        = static_cast<BindPipelineCommand*>(allocate(CommandType::BindPipeline, sizeof(BindPipelineCommand)));
+      command->inputLayoutId  = inputLayoutId;
+      command->vertexShaderId = vertexShaderId;
+      command->pixelShaderId  = pixelShaderId;
+    }
+
+    void CommandList
+      ::bindResources(BindResourcesCommand const&resources)
+    {
+      BindResourcesCommand *command
+        = static_cast<BindResourcesCommand*>(allocate(CommandType::BindResources, sizeof(BindResourcesCommand)));
+      CommandHeader header = command->header;
+      *command        = resources;
+      command->header = header;
+    }
+
+    void* CommandList
+      ::updateConstants(uint64_t bufferId, uint32_t slot, uint32_t stages, uint32_t dataSize, uint32_t flags)
+    {
+      UpdateConstantsCommand *command
+        = static_cast<UpdateConstantsCommand*>(allocate(CommandType::UpdateConstants, sizeof(UpdateConstantsCommand) + dataSize));
+      command->bufferId = bufferId;
+      command->slot     = slot;
+      command->stages   = stages;
+      command->dataSize = dataSize;
+      command->flags    = flags;
+
+      return (dataSize ? (command + 1) : nullptr);
+    }
+
+    void CommandList
+      ::drawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex)
+    {
+      DrawIndexedCommand *command
+        = static_cast<DrawIndexedCommand*>(allocate(CommandType::DrawIndexed, sizeof(DrawIndexedCommand)));
+      command->indexCount = indexCount;
+      command->startIndex = startIndex;
+      command->baseVertex = baseVertex;
+    }
+
+    void* CommandList
+      ::updateBuffer(uint64_t bufferId, uint32_t dataSize)
+    {
+      UpdateBufferCommand *command
+        = static_cast<UpdateBufferCommand*>(allocate(CommandType::UpdateBuffer, sizeof(UpdateBufferCommand) + dataSize));
+      command->bufferId = bufferId;
+      command->dataSize = dataSize;
+
+      return (dataSize ? (command + 1) : nullptr);
+    }
+
+    void CommandBuffer
+      ::reset(size_t listCount)
+    {
+      if(m_lists.size() < listCount)
+        m_lists.resize(listCount);
+
+      for(size_t k=0; k < listCount; ++k)
+        m_lists[k].reset();
+
+      m_listCount = listCount;
+    }
+
+    size_t CommandBuffer
+      ::commandCount() const
+    {
+      size_t count = 0;
+      for(size_t k=0; k < m_listCount; ++k)
+        count += m_lists[k].commandCount();
+      return count;
+    }
+
+    size_t CommandBuffer
+      ::byteSize() const
+    {
+      size_t size = 0;
+      for(size_t k=0; k < m_listCount; ++k)
+        size += m_lists[k].byteSize();
+      return size;
+    }
+
+    bool CommandBuffer
+      ::submit(CommandBackend &backend) const
+    {
+      for(size_t k=0; k < m_listCount; ++k) {
+        CommandList const&list   = m_lists[k];
+        const uint8_t    *packet = list.data();
+        const uint8_t    *end    = packet + list.byteSize();
+
+        while(packet < end) {
+          CommandHeader const&header = *reinterpret_cast<const CommandHeader*>(packet);
+          if(!header.size || (header.size % PacketAlignment) || header.size > static_cast<size_t>(end - packet))
+            return false;
+
+          switch(header.type) {
+          case CommandType::BindPipeline:
+            if(header.size < sizeof(BindPipelineCommand))
+              return false;
+            backend.bindPipeline(*reinterpret_cast<const BindPipelineCommand*>(packet));
+            break;
+          case CommandType::BindResources:
+            if(header.size < sizeof(BindResourcesCommand))
+              return false;
+            backend.bindResources(*reinterpret_cast<const BindResourcesCommand*>(packet));
+            break;
+          case CommandType::UpdateConstants:
+          {
+            const UpdateConstantsCommand *command = reinterpret_cast<const UpdateConstantsCommand*>(packet);
+            if(header.size < sizeof(UpdateConstantsCommand)
+               || command->dataSize > header.size - sizeof(UpdateConstantsCommand))
+              return false;
+            backend.updateConstants(*command, (command->dataSize ? (command + 1) : nullptr));
+            break;
+          }
+          case CommandType::DrawIndexed:
+            if(header.size < sizeof(DrawIndexedCommand))
+              return false;
+            backend.drawIndexed(*reinterpret_cast<const DrawIndexedCommand*>(packet));
+            break;
+          case CommandType::UpdateBuffer:
+          {
+            const UpdateBufferCommand *command = reinterpret_cast<const UpdateBufferCommand*>(packet);
+            if(header.size < sizeof(UpdateBufferCommand)
+               || command->dataSize > header.size - sizeof(UpdateBufferCommand))
+              return false;
+            backend.updateBuffer(*command, (command->dataSize ? (command + 1) : nullptr));
+            break;
+          }
+          default:
+            return false;
+          }
+
+          packet += header.size;
+        }
+      }
+
+      return true;
+    }
+
+    void RecordPassConstants(
+      RenderScene const&scene,
+      CommandList      &list)
+    {
+      uint32_t const vertexAndPixel = ShaderStageVertex | ShaderStagePixel;
+
+      for(ShaderBufferUpdate const&update : scene.shaderBufferUpdates) {
+        if(!update.bufferId || !update.dataSize)
+          continue;
+
+        void *data = list.updateBuffer(update.bufferId, update.dataSize);
+        if(update.updateFn)
+          update.updateFn(data);
+      }
+
+      if(scene.cameraBufferId) {
+        void *data = list.updateConstants(scene.cameraBufferId, 0, vertexAndPixel, sizeof(CameraBuffer_t), ConstantFlagCacheable);
+        if(scene.cameraBufferUpdateFn)
+          scene.cameraBufferUpdateFn(static_cast<CameraBuffer_t*>(data));
+      }
+
+      // Lights
+      if(scene.lightBufferId) {
+        void *data = list.updateConstants(scene.lightBufferId, 1, vertexAndPixel, sizeof(LightBuffer_t), ConstantFlagCacheable);
+        uint64_t k=0;
+        for(uint64_t const&lightId : scene.lights) {
+          if(scene.lightingBufferUpdateFn)
+            scene.lightingBufferUpdateFn(static_cast<LightBuffer_t*>(data), lightId, k);
+
+          ++k;
+        }
+      }
+
+      // Other (updated, currently not bound to any stage)
+      if(scene.otherBufferId) {
+        void *data = list.updateConstants(scene.otherBufferId, 2, 0, sizeof(OtherBuffer_t), ConstantFlagCacheable);
+        if(scene.otherBufferUpdateFn)
+          scene.otherBufferUpdateFn(static_cast<OtherBuffer_t*>(data));
+      }
+
+      // Ambient (immutable, bind only)
+      if(scene.ambientBufferId)
+        list.updateConstants(scene.ambientBufferId, 3, ShaderStagePixel, 0);
+
+      // Light clusters
+      if(scene.clusterBufferId) {
+        void *data = list.updateConstants(scene.clusterBufferId, 4, ShaderStagePixel, sizeof(ClusterBuffer_t), ConstantFlagCacheable);
+        if(scene.clusterBufferUpdateFn)
+          scene.clusterBufferUpdateFn(static_cast<ClusterBuffer_t*>(data));
+      }
+    }
+
+    void RecordRenderObjects(
+      RenderScene           const&scene,
+      PassType              const&passType,
+      SceneRecordingOptions const&options,
+      size_t                      first,
+      size_t                      last,
+      CommandList                &list)
+    {
+      bool const bindTextures = !(passType == PassType::ShadowMap);
+
+      RenderObject const  *previous = nullptr;
+      BindResourcesCommand previousResources;
+      BindResourcesCommand resources;
+
+      for(size_t k=first; k < last; ++k) {
+        RenderObject const&object = scene.objects[k];
+
+        if(!previous
+           || previous->inputLayoutId  != object.inputLayoutId
+           || previous->vertexShaderId != object.vertexShaderId
+           || previous->pixelShaderId  != object.pixelShaderId)
+          list.bindPipeline(object.inputLayoutId, object.vertexShaderId, object.pixelShaderId);
+
+        memset(&resources, 0, sizeof(resources));
+        resources.vertexBufferId = object.vertexBufferId;
+        resources.indexBufferId  = object.indexBufferId;
+        resources.vertexStride   = options.vertexStride;
+        if(bindTextures) {
+          resources.pixelShaderResourceCount = 9;
+          resources.pixelShaderResources[0]  = object.diffuseTextureSRVId;
+          resources.pixelShaderResources[1]  = object.specularTextureSRVId;
+          resources.pixelShaderResources[2]  = object.glossTextureSRVId;
+          resources.pixelShaderResources[3]  = object.normalTextureSRVId;
+          resources.pixelShaderResources[4]  = scene.shadowMapTextureSRVId;
+          resources.pixelShaderResources[5]  = scene.environmentMapSRVId;
+          resources.pixelShaderResources[6]  = scene.clusterLightsSRVId;
+          resources.pixelShaderResources[7]  = scene.clusterCellsSRVId;
+          resources.pixelShaderResources[8]  = scene.clusterIndicesSRVId;
+          resources.samplerCount             = 2;
+          resources.samplers[0]              = options.defaultSamplerId;
+          resources.samplers[1]              = options.shadowMapSamplerId;
+        }
+
+        if(!previous || memcmp(&resources, &previousResources, sizeof(resources))) {
+          list.bindResources(resources);
+          previousResources = resources;
+        }
+
+        if(scene.objectBufferId) {
+          void *data = list.updateConstants(scene.objectBufferId, 2, ShaderStageVertex, sizeof(ObjectBuffer_t));
+          if(scene.objectBufferUpdateFn)
+            scene.objectBufferUpdateFn(static_cast<ObjectBuffer_t*>(data), object.objectId);
+        }
+
+        list.drawIndexed(0);
+
+        previous = &object;
+      }
+    }
+
+    void RecordScene(
+      RenderScene                 const&scene,
+      PassType                    const&passType,
+      SceneRecordingOptions       const&options,
+      SAE::Threading::WorkerPool       *pool,
+      CommandBuffer                    &buffer)
+    {
+      size_t const objectCount    = scene.objects.size();
+      size_t const objectsPerList = std::max<size_t>(1, options.objectsPerList);
+      size_t const sliceCount     = (objectCount + objectsPerList - 1) / objectsPerList;
+
+      buffer.reset(1 + sliceCount);
+
+      // The light update moves light transforms that object updates read; record it up front.
+      RecordPassConstants(scene, buffer.list(0));
+
+      auto recordSlices = [&] (size_t begin, size_t end) -> void
+      {
+        for(size_t k=begin; k < end; ++k) {
+          size_t const first = k * objectsPerList;
+          size_t const last  = std::min(objectCount, first + objectsPerList);
+          RecordRenderObjects(scene, passType, options, first, last, buffer.list(1 + k));
+        }
+      };
+
+      if(pool && sliceCount > 1)
+        pool->parallelFor(sliceCount, 1, recordSlices);
+      else
+        recordSlices(0, sliceCount);
+    }
+
+  }
+}
@@ -0,0 +1,265 @@
+#include <cstring>
+
+#include "Renderer/ConstantUploadRing.h"
+
+namespace SAE {
+  namespace Rendering {
+
+    // FNV-1a, 64 bit
+    static uint64_t HashBytes(const void *data, size_t size)
+    {
+      const uint8_t *bytes = static_cast<const uint8_t*>(data);
+
+      uint64_t hash = 14695981039346656037ull;
+      for(size_t k=0; k < size; ++k) {
+        hash ^= bytes[k];
+        hash *= 1099511628211ull;
+      }
+      return hash;
+    }
+
+    ConstantUploadRing::ConstantUploadRing()
+      : m_device(nullptr)
+      , m_capacity(0)
+      , m_head(0)
+      , m_discardPending(true)
+      , m_mapped(nullptr)
+      , m_cacheSize(0)
+      , m_frameStats()
+      , m_lastFrameStats()
+    {}
+
+    bool ConstantUploadRing
+      ::initialize(ConstantUploadDevice *device, uint32_t capacity)
+    {
+      deinitialize();
+
+      if(!device)
+        return false;
+
+      capacity = AlignedSize(capacity ? capacity : Alignment);
+      if(!device->createBuffer(capacity))
+        return false;
+
+      m_device         = device;
+      m_capacity       = capacity;
+      m_head           = 0;
+      m_discardPending = true;
+
+      return true;
+    }
+
+    bool ConstantUploadRing
+      ::deinitialize()
+    {
+      if(m_mapped)
+        end();
+
+      m_device    = nullptr;
+      m_capacity  = 0;
+      m_head      = 0;
+      m_cacheSize = 0;
+      m_cache.clear();
+
+      return true;
+    }
+
+    bool ConstantUploadRing
+      ::begin(uint32_t maxByteSize)
+    {
+      if(!m_device || m_mapped)
+        return false;
+
+      // A frame that does not fit grows the buffer, so frames settle at one discard each.
+      uint32_t required = maxByteSize;
+      if(!m_discardPending && (m_head + maxByteSize) > m_capacity)
+        required = m_head + maxByteSize;
+
+      if(required > m_capacity) {
+        uint32_t capacity = m_capacity;
+        while(capacity < required)
+          capacity *= 2;
+
+        if(!m_device->createBuffer(capacity))
+          return false;
+
+        m_capacity       = capacity;
+        m_discardPending = true;
+      }
+
+      bool const discard = m_discardPending;
+
+      m_mapped = static_cast<uint8_t*>(m_device->map(discard));
+      if(!m_mapped)
+        return false;
+
+      ++m_frameStats.maps;
+      if(discard) {
+        ++m_frameStats.discards;
+        m_head           = 0;
+        m_cacheSize      = 0;
+        m_discardPending = false;
+      }
+
+      return true;
+    }
+
+    bool ConstantUploadRing
+      ::upload(const void *data, uint32_t size, bool cacheable, Allocation &outAllocation)
+    {
+      uint64_t hash = 0;
+      if(cacheable) {
+        hash = HashBytes(data, size);
+
+        for(size_t k=0; k < m_cacheSize; ++k) {
+          CacheEntry const&entry = m_cache[k];
+          if(entry.hash == hash && entry.data.size() == size && !memcmp(entry.data.data(), data, size)) {
+            outAllocation = entry.allocation;
+            m_frameStats.bytesSkipped += size;
+            ++m_frameStats.blocksSkipped;
+            return true;
+          }
+        }
+      }
+
+      uint32_t const alignedSize = AlignedSize(size);
+      if(!m_mapped || (m_head + alignedSize) > m_capacity)
+        return false;
+
+      memcpy(m_mapped + m_head, data, size);
+
+      outAllocation.offset = m_head;
+      outAllocation.size   = alignedSize;
+      m_head += alignedSize;
+
+      m_frameStats.bytesUploaded += size;
+      ++m_frameStats.blocksUploaded;
+
+      if(cacheable) {
+        if(m_cacheSize == m_cache.size())
+          m_cache.push_back(CacheEntry());
+
+        CacheEntry &entry = m_cache[m_cacheSize++];
+        entry.hash       = hash;
+        entry.allocation = outAllocation;
+        entry.data.assign(static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+      }
+
+      return true;
+    }
+
+    void ConstantUploadRing
+      ::end()
+    {
+      if(!m_mapped)
+        return;
+
+      m_device->unmap();
+      m_mapped = nullptr;
+    }
+
+    void ConstantUploadRing
+      ::endFrame()
+    {
+      m_lastFrameStats = m_frameStats;
+      m_frameStats     = Stats();
+      m_discardPending = true;
+    }
+
+    //
+    // Command buffer upload
+    //
+
+    namespace {
+      // Collects the constant packets of a command buffer, in replay order.
+      class ConstantPacketCollector
+        : public CommandBackend
+      {
+      public:
+        struct Packet {
+          UpdateConstantsCommand const*command;
+          const void                  *data;
+        };
+
+        void bindPipeline(BindPipelineCommand const&) override {}
+        void bindResources(BindResourcesCommand const&) override {}
+        void drawIndexed(DrawIndexedCommand const&) override {}
+        void updateBuffer(UpdateBufferCommand const&, const void*) override {}
+
+        void updateConstants(UpdateConstantsCommand const&command, const void *data) override
+        {
+          Packet packet ={ &command, data };
+          packets.push_back(packet);
+        }
+
+        SAE::Memory::FrameVector<Packet> packets;
+      };
+    }
+
+    bool UploadCommandConstants(
+      CommandBuffer                     const&buffer,
+      ConstantUploadRing                     &ring,
+      std::vector<ConstantUploadRing::Allocation> &outAllocations)
+    {
+      ConstantPacketCollector collector;
+      if(!buffer.submit(collector))
+        return false;
+
+      ConstantUploadRing::Allocation const none ={ 0, 0 };
+      outAllocations.assign(collector.packets.size(), none);
+
+      uint64_t maxByteSize = 0;
+      for(ConstantPacketCollector::Packet const&packet : collector.packets)
+        if(packet.command->dataSize && packet.command->stages)
+          maxByteSize += ConstantUploadRing::AlignedSize(packet.command->dataSize);
+
+      if(!maxByteSize)
+        return true;
+      if(maxByteSize > UINT32_MAX || !ring.begin(static_cast<uint32_t>(maxByteSize)))
+        return false;
+
+      bool succeeded = true;
+      for(size_t k=0; k < collector.packets.size(); ++k) {
+        UpdateConstantsCommand const&command = *collector.packets[k].command;
+        if(!command.dataSize || !command.stages)
+          continue;
+
+        succeeded = ring.upload(
+          collector.packets[k].data,
+          command.dataSize,
+          (command.flags & ConstantFlagCacheable) != 0,
+          outAllocations[k]) && succeeded;
+      }
+
+      ring.end();
+
+      return succeeded;
+    }
+
+    //
+    // MemoryConstantUploadDevice
+    //
+
+    bool MemoryConstantUploadDevice
+      ::createBuffer(uint32_t byteSize)
+    {
+      m_data.assign(byteSize, 0);
+      return true;
+    }
+
+    void* MemoryConstantUploadDevice
+      ::map(bool discard)
+    {
+      ++m_mapCount;
+      if(discard)
+        ++m_discardCount;
+
+      return (m_data.empty() ? nullptr : m_data.data());
+    }
+
+    void MemoryConstantUploadDevice
+      ::unmap()
+    {}
+
+  }
+}
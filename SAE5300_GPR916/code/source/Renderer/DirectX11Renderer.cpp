@@ -1,6 +1,7 @@
 #include "Renderer/DirectX11Renderer.h"
 
 #include "Platform/Timer.h"
+#include "Platform/DirectX11/DirectX11CommandBackend.h"
 #include "Engine/Mesh.h"
 
 namespace SAE {
@@ -16,29 +17,6 @@ namespace SAE {
     {}
 
     bool Renderer::initialize() {
-      ID3D11Texture2D *pTextureUnmanaged = nullptr;
-      HRESULT hres = m_dx11Environment->getSwapChain()->GetBuffer(0, __uuidof(ID3D11Texture2D), ((void**)&pTextureUnmanaged));
-      HandleWINAPIError(hres, "Failed to get underlying swapchain backbuffer texture.");
-
-      D3D11_TEXTURE2D_DESC dsvTexDesc ={};
-      pTextureUnmanaged->GetDesc(&dsvTexDesc);
-      dsvTexDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
-      dsvTexDesc.Format    = DXGI_FORMAT_D24_UNORM_S8_UINT;
-
-      std::vector<D3D11_SUBRESOURCE_DATA> emptyRenderTargetData{};
-
-      m_dsvTexHandle = m_resourceManager->create<ID3D11Texture2D>(dsvTexDesc, emptyRenderTargetData);
-      std::shared_ptr<ID3D11Texture2D> pDsvTex = nullptr;
-      pDsvTex = m_resourceManager->get<ID3D11Texture2D>(m_dsvTexHandle);
-
-      D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc ={};
-      dsvDesc.ViewDimension      = D3D11_DSV_DIMENSION_TEXTURE2D;
-      dsvDesc.Texture2D.MipSlice = 0;
-      dsvDesc.Format             = DXGI_FORMAT_D24_UNORM_S8_UINT;
-
-      D3D11_SUBRESOURCE_DATA data{};
-      m_dsvViewHandle = m_resourceManager->create<ID3D11DepthStencilView>(dsvDesc, pDsvTex.get(), data);
-
       D3D11_DEPTH_STENCIL_DESC dssDesc ={};
       dssDesc.DepthEnable                  = true;
       dssDesc.DepthFunc                    = D3D11_COMPARISON_LESS;
@@ -88,11 +66,30 @@ namespace SAE {
       ssCubeDesc.ComparisonFunc = D3D11_COMPARISON_LESS;
       m_shadowMapSamplerStateId = m_resourceManager->create<ID3D11SamplerState>(ssCubeDesc);
 
+      m_recordingPool.initialize();
+
+      // All constants of a pass go into one ring buffer where the runtime supports binding
+      // ranges of it (D3D11.1); otherwise every update maps its own buffer.
+      if(DirectX11ConstantUploadDevice::IsSupported(m_dx11Environment->getDevice())) {
+        m_constantUploadDevice
+          = std::make_shared<DirectX11ConstantUploadDevice>(m_dx11Environment->getDevice(), m_dx11Environment->getImmediateContext());
+        if(!m_constantUploadRing.initialize(m_constantUploadDevice.get()))
+          m_constantUploadDevice = nullptr;
+      }
+
+      m_commandBackend = std::make_shared<DirectX11CommandBackend>(
+        m_dx11Environment->getImmediateContext(),
+        (m_constantUploadDevice ? &m_constantUploadRing : nullptr),
+        m_constantUploadDevice.get());
 
       return true;
     }
 
     bool Renderer::deinitialize() {
+      m_commandBackend = nullptr;
+      m_constantUploadRing.deinitialize();
+      m_constantUploadDevice = nullptr;
+      m_recordingPool.deinitialize();
       return true;
     }
 
@@ -103,18 +100,15 @@ namespace SAE {
     {
       ID3D11DeviceContextPtr context = m_dx11Environment->getImmediateContext();
 
+      // Depth targets belong to the frame graph, see Engine::renderFrame.
       ID3D11RenderTargetView  *renderTarget      = m_dx11Environment->getMainRenderTarget().get();
-      ID3D11DepthStencilView  *depthStencilView  = reinterpret_cast<ID3D11DepthStencilView*>(m_dsvViewHandle);
+      ID3D11DepthStencilView  *depthStencilView  = reinterpret_cast<ID3D11DepthStencilView*>(scene.renderTargetId);
 
-      if(passType == PassType::ShadowMap) {
-        renderTarget     = nullptr;
-        depthStencilView = reinterpret_cast<ID3D11DepthStencilView*>(scene.renderTargetId);
-      }
+      if(passType == PassType::ShadowMap)
+        renderTarget = nullptr;
 
       ID3D11DepthStencilState *depthStencilState = reinterpret_cast<ID3D11DepthStencilState*>(m_dssHandle);
       ID3D11RasterizerState   *rasterizerState   = reinterpret_cast<ID3D11RasterizerState*>(m_rasterizerStateId);
-      ID3D11SamplerState      *defaultSampler    = reinterpret_cast<ID3D11SamplerState*>(m_defaultSamplerStateId);
-      ID3D11SamplerState      *shadowMapSampler  = reinterpret_cast<ID3D11SamplerState*>(m_shadowMapSamplerStateId);
 
       FLOAT color[4] ={ 0.5f, 0.5f, 0.5f, 1.0f };
 
@@ -123,19 +117,20 @@ namespace SAE {
       context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
       context->RSSetState(rasterizerState);
 
-      if(passType == PassType::Main) {
-        m_viewPort.TopLeftX = 0;
-        m_viewPort.TopLeftY = 0;
-        m_viewPort.Width    = m_dx11Environment->getSelectedMode().width;
-        m_viewPort.Height   = m_dx11Environment->getSelectedMode().height;
+      // Shadow passes draw into their tile of the shadow atlas.
+      if(scene.viewport.width > 0.0f) {
+        m_viewPort.TopLeftX = scene.viewport.x;
+        m_viewPort.TopLeftY = scene.viewport.y;
+        m_viewPort.Width    = scene.viewport.width;
+        m_viewPort.Height   = scene.viewport.height;
         m_viewPort.MinDepth = 0.0;
         m_viewPort.MaxDepth = 1.0;
       }
       else {
         m_viewPort.TopLeftX = 0;
         m_viewPort.TopLeftY = 0;
-        m_viewPort.Width    = 1024;
-        m_viewPort.Height   = 1024;
+        m_viewPort.Width    = m_dx11Environment->getSelectedMode().width;
+        m_viewPort.Height   = m_dx11Environment->getSelectedMode().height;
         m_viewPort.MinDepth = 0.0;
         m_viewPort.MaxDepth = 1.0;
       }
@@ -146,122 +141,27 @@ namespace SAE {
       else
         context->OMSetRenderTargets(0, nullptr, depthStencilView);
 
-      context->ClearDepthStencilView(depthStencilView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0xFF);
+      if(!scene.preserveDepth)
+        context->ClearDepthStencilView(depthStencilView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0xFF);
       context->OMSetDepthStencilState(depthStencilState, 0);
 
-      ID3D11Buffer *cameraBuffer    =reinterpret_cast<ID3D11Buffer*>(scene.cameraBufferId);
-      ID3D11Buffer *objectBuffer    =reinterpret_cast<ID3D11Buffer*>(scene.objectBufferId);
-      ID3D11Buffer *lightBuffer     =reinterpret_cast<ID3D11Buffer*>(scene.lightBufferId);
-      ID3D11Buffer *otherBuffer     =reinterpret_cast<ID3D11Buffer*>(scene.otherBufferId);
-
-      D3D11_MAPPED_SUBRESOURCE mapped ={};
+      // Constants and draws are recorded into packets, object slices in parallel, and replayed here.
+      SceneRecordingOptions recordingOptions;
+      recordingOptions.vertexStride       = sizeof(Mesh<XMVECTOR>::Vertex_t);
+      recordingOptions.defaultSamplerId   = m_defaultSamplerStateId;
+      recordingOptions.shadowMapSamplerId = m_shadowMapSamplerStateId;
 
-      if(scene.cameraBufferId) {
-        context->Map(
-          cameraBuffer,
-          0,
-          D3D11_MAP_WRITE_DISCARD,
-          0,
-          &mapped);
-        if(scene.cameraBufferUpdateFn)
-          scene.cameraBufferUpdateFn(static_cast<CameraBuffer_t*>(mapped.pData));
-        context->Unmap(cameraBuffer, 0);
-
-        context->VSSetConstantBuffers(0, 1, &cameraBuffer);
-        context->PSSetConstantBuffers(0, 1, &cameraBuffer);
-      }
+      RecordScene(scene, passType, recordingOptions, &m_recordingPool, m_commandBuffer);
 
-      // Lights
-      if(scene.lightBufferId) {
-        context->Map(
-          lightBuffer,
-          0,
-          D3D11_MAP_WRITE_DISCARD,
-          0,
-          &mapped);
-        uint64_t k=0;
-        for(uint64_t const&lightId : scene.lights) {
-          if(scene.lightingBufferUpdateFn)
-            scene.lightingBufferUpdateFn(static_cast<LightBuffer_t*>(mapped.pData), lightId, k);
+      m_commandBackend->uploadConstants(m_commandBuffer);
+      m_commandBuffer.submit(*m_commandBackend);
 
-          ++k;
-        }
-        context->Unmap(lightBuffer, 0);
-        context->VSSetConstantBuffers(1, 1, &lightBuffer);
-        context->PSSetConstantBuffers(1, 1, &lightBuffer);
-      }
-
-      // Other
-      if(scene.otherBufferId) {
-        mapped ={};
-        context->Map(
-          otherBuffer,
-          0,
-          D3D11_MAP_WRITE_DISCARD,
-          0,
-          &mapped);
-        if(scene.otherBufferUpdateFn)
-          scene.otherBufferUpdateFn(static_cast<OtherBuffer_t*>(mapped.pData));
-        context->Unmap(otherBuffer, 0);
-        // context->PSSetConstantBuffers(2, 1, &otherBuffer);
-      }
-
-      ID3D11ShaderResourceView *shadowMapTexture = reinterpret_cast<ID3D11ShaderResourceView*>(scene.shadowMapTextureSRVId);
-
-      // Objects
-      for(RenderObject const&object : scene.objects) {
-        ID3D11Buffer       *vertexBuffer = reinterpret_cast<ID3D11Buffer*>(object.vertexBufferId);
-        ID3D11Buffer       *indexBuffer  = reinterpret_cast<ID3D11Buffer*>(object.indexBufferId);
-        ID3D11InputLayout  *inputLayout  = reinterpret_cast<ID3D11InputLayout*>(object.inputLayoutId);
-        ID3D11VertexShader *vertexShader = reinterpret_cast<ID3D11VertexShader*>(object.vertexShaderId);
-        ID3D11PixelShader  *pixelShader  = reinterpret_cast<ID3D11PixelShader*>(object.pixelShaderId);
-
-        ID3D11ShaderResourceView *diffuseTexture  = reinterpret_cast<ID3D11ShaderResourceView*>(object.diffuseTextureSRVId);
-        ID3D11ShaderResourceView *specularTexture = reinterpret_cast<ID3D11ShaderResourceView*>(object.specularTextureSRVId);
-        ID3D11ShaderResourceView *glossTexture    = reinterpret_cast<ID3D11ShaderResourceView*>(object.glossTextureSRVId);
-        ID3D11ShaderResourceView *normalTexture   = reinterpret_cast<ID3D11ShaderResourceView*>(object.normalTextureSRVId);
-
-        D3D11_BUFFER_DESC indexBufferDesc ={};
-        indexBuffer->GetDesc(&indexBufferDesc);
-
-        uint64_t indexBufferSize = indexBufferDesc.ByteWidth / sizeof(Mesh<XMVECTOR>::Index_t);
-
-        context->Map(
-          objectBuffer,
-          0,
-          D3D11_MAP_WRITE_DISCARD,
-          0,
-          &mapped);
-        if(scene.objectBufferUpdateFn)
-          scene.objectBufferUpdateFn(static_cast<ObjectBuffer_t*>(mapped.pData), object.objectId);
-        context->Unmap(objectBuffer, 0);
-
-        context->VSSetConstantBuffers(2, 1, &objectBuffer);
-
-        std::size_t vertexSize = sizeof(Mesh<XMVECTOR>::Vertex_t);
-        std::size_t offset     = 0;
-        context->IASetInputLayout(inputLayout);
-        context->IASetVertexBuffers(0, 1, &vertexBuffer, &vertexSize, &offset);
-        context->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
-        context->VSSetShader(vertexShader, nullptr, 0);
-        context->PSSetShader(pixelShader, nullptr, 0);
-
-        if(!(passType == PassType::ShadowMap)) {
-
-          std::vector<ID3D11ShaderResourceView*> psSRV
-            ={ diffuseTexture, specularTexture, glossTexture, normalTexture, shadowMapTexture };
-          context->PSSetShaderResources(0, psSRV.size(), psSRV.data());
-
-          std::vector<ID3D11SamplerState*> psSS
-            ={ defaultSampler, shadowMapSampler };
-          context->PSSetSamplers(0, psSS.size(), psSS.data());
-        }
-
-        context->DrawIndexed(indexBufferSize, 0, 0);
-      }
-
-      if(passType == PassType::Main)
+      // The main pass closes the frame.
+      if(passType == PassType::Main) {
         m_dx11Environment->getSwapChain()->Present(0, 0);
+        m_constantUploadRing.endFrame();
+        m_recordingPool.beginFrame();
+      }
 
       context->ClearState();
 
@@ -0,0 +1,330 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "Renderer/LightClusters.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+  // SSE2 is part of the x64 baseline and the MSVC x86 default: no dispatch needed.
+  #define SAE_LIGHTCLUSTERS_X86 1
+  #include <emmintrin.h>
+#else
+  #define SAE_LIGHTCLUSTERS_X86 0
+#endif
+
+namespace SAE {
+  namespace Rendering {
+
+    typedef std::chrono::high_resolution_clock ClusterClock;
+
+    LightClusters::LightClusters()
+      : m_options()
+      , m_pool(nullptr)
+      , m_useSIMD(false)
+      , m_scaleX(0.0f)
+      , m_scaleY(0.0f)
+      , m_nearPlane(0.0f)
+      , m_farPlane(0.0f)
+      , m_depthScale(0.0f)
+      , m_depthBias(0.0f)
+      , m_sliceStride(0)
+      , m_stats()
+    {}
+
+    bool LightClusters
+      ::initialize(Options const&options, SAE::Threading::WorkerPool *pool)
+    {
+      deinitialize();
+
+      if(!options.gridX || !options.gridY || !options.gridZ || !options.maxLightsPerCluster)
+        return false;
+
+      m_options = options;
+      m_pool    = pool;
+      m_useSIMD = (options.allowSIMD && SAE_LIGHTCLUSTERS_X86);
+
+      uint32_t const sliceSize = options.gridX * options.gridY;
+      size_t   const padded    = size_t(options.gridZ) * ((sliceSize + 3) & ~3u);
+
+      m_sliceStride = ((sliceSize + 3) & ~3u);
+      m_sliceNear.assign(options.gridZ, 0.0f);
+      m_sliceFar.assign(options.gridZ, 0.0f);
+      for(uint32_t k=0; k < 3; ++k) {
+        m_boundsMin[k].assign(padded, 0.0f);
+        m_boundsMax[k].assign(padded, 0.0f);
+      }
+
+      m_clusterLights.assign(padded * options.maxLightsPerCluster, 0);
+      m_clusterCounts.assign(padded, 0);
+      m_sliceMaxLights.assign(options.gridZ, 0);
+
+      Cell const empty ={ 0, 0 };
+      m_cells.assign(clusterCount(), empty);
+      m_indices.reserve(options.maxIndices);
+
+      return true;
+    }
+
+    void LightClusters
+      ::deinitialize()
+    {
+      m_pool        = nullptr;
+      m_scaleX      = 0.0f;
+      m_scaleY      = 0.0f;
+      m_nearPlane   = 0.0f;
+      m_farPlane    = 0.0f;
+      m_depthScale  = 0.0f;
+      m_depthBias   = 0.0f;
+      m_sliceStride = 0;
+
+      m_sliceNear.clear();
+      m_sliceFar.clear();
+      for(uint32_t k=0; k < 3; ++k) {
+        m_boundsMin[k].clear();
+        m_boundsMax[k].clear();
+      }
+      m_clusterLights.clear();
+      m_clusterCounts.clear();
+      m_sliceMaxLights.clear();
+      m_cells.clear();
+      m_indices.clear();
+
+      m_stats = Stats();
+    }
+
+    void LightClusters
+      ::setProjection(float scaleX, float scaleY, float nearPlane, float farPlane)
+    {
+      if(scaleX == m_scaleX && scaleY == m_scaleY && nearPlane == m_nearPlane && farPlane == m_farPlane)
+        return;
+
+      m_scaleX    = scaleX;
+      m_scaleY    = scaleY;
+      m_nearPlane = nearPlane;
+      m_farPlane  = farPlane;
+
+      computeBounds();
+    }
+
+    void LightClusters
+      ::computeBounds()
+    {
+      if(!m_sliceStride)
+        return;
+
+      bool const valid = (m_scaleX > 0.0f && m_scaleY > 0.0f && m_nearPlane > 0.0f && m_farPlane > m_nearPlane);
+
+      m_depthScale = valid ? (m_options.gridZ / std::log(m_farPlane / m_nearPlane)) : 0.0f;
+      m_depthBias  = valid ? (-std::log(m_nearPlane) * m_depthScale) : 0.0f;
+
+      float const highest = std::numeric_limits<float>::max();
+
+      for(uint32_t slice=0; slice < m_options.gridZ; ++slice) {
+        float zNear = m_nearPlane * std::pow(m_farPlane / m_nearPlane, float(slice)     / m_options.gridZ);
+        float zFar  = m_nearPlane * std::pow(m_farPlane / m_nearPlane, float(slice + 1) / m_options.gridZ);
+        if(slice == 0)
+          zNear = 0.0f;
+        if(slice == m_options.gridZ - 1)
+          zFar = m_farPlane;
+
+        m_sliceNear[slice] = zNear;
+        m_sliceFar[slice]  = zFar;
+
+        for(uint32_t c=0; c < m_sliceStride; ++c) {
+          size_t const cluster = size_t(slice) * m_sliceStride + c;
+
+          // Padding and an invalid projection: boxes no finite sphere reaches.
+          if(!valid || c >= m_options.gridX * m_options.gridY) {
+            for(uint32_t k=0; k < 3; ++k) {
+              m_boundsMin[k][cluster] =  highest;
+              m_boundsMax[k][cluster] = -highest;
+            }
+            continue;
+          }
+
+          uint32_t const x = c % m_options.gridX;
+          uint32_t const y = c / m_options.gridX;
+
+          // Tile edges in NDC; rows run top to bottom.
+          float const ndcX[2] ={ -1.0f + (2.0f * x) / m_options.gridX, -1.0f + (2.0f * (x + 1)) / m_options.gridX };
+          float const ndcY[2] ={  1.0f - (2.0f * (y + 1)) / m_options.gridY, 1.0f - (2.0f * y) / m_options.gridY };
+
+          // The tile's side planes pass through the eye: the extremes lie on the near or far face.
+          float minX =  highest, maxX = -highest;
+          float minY =  highest, maxY = -highest;
+          for(uint32_t k=0; k < 2; ++k) {
+            float const depth = (k ? zFar : zNear);
+            for(uint32_t e=0; e < 2; ++e) {
+              float const vx = (ndcX[e] * depth) / m_scaleX;
+              float const vy = (ndcY[e] * depth) / m_scaleY;
+              minX = std::min(minX, vx);
+              maxX = std::max(maxX, vx);
+              minY = std::min(minY, vy);
+              maxY = std::max(maxY, vy);
+            }
+          }
+
+          m_boundsMin[0][cluster] = minX;
+          m_boundsMax[0][cluster] = maxX;
+          m_boundsMin[1][cluster] = minY;
+          m_boundsMax[1][cluster] = maxY;
+          m_boundsMin[2][cluster] = zNear;
+          m_boundsMax[2][cluster] = zFar;
+        }
+      }
+    }
+
+    void LightClusters
+      ::assignSlice(uint32_t slice, std::vector<LightSphere> const&lights)
+    {
+      uint32_t const sliceSize = m_options.gridX * m_options.gridY;
+      uint32_t const maxLights = m_options.maxLightsPerCluster;
+      size_t   const base      = size_t(slice) * m_sliceStride;
+
+      uint32_t *counts = &m_clusterCounts[base];
+      uint32_t *lists  = &m_clusterLights[base * maxLights];
+      memset(counts, 0, sizeof(uint32_t) * m_sliceStride);
+
+      const float *minX = &m_boundsMin[0][base];
+      const float *minY = &m_boundsMin[1][base];
+      const float *minZ = &m_boundsMin[2][base];
+      const float *maxX = &m_boundsMax[0][base];
+      const float *maxY = &m_boundsMax[1][base];
+      const float *maxZ = &m_boundsMax[2][base];
+
+      float const zNear = m_sliceNear[slice];
+      float const zFar  = m_sliceFar[slice];
+
+      for(size_t l=0; l < lights.size(); ++l) {
+        LightSphere const&sphere = lights[l];
+        if(!(sphere.radius > 0.0f))
+          continue;
+        if(sphere.z + sphere.radius < zNear || sphere.z - sphere.radius > zFar)
+          continue;
+
+        uint32_t const light         = static_cast<uint32_t>(l);
+        float    const radiusSquared = sphere.radius * sphere.radius;
+
+        // Squared distance from the sphere's centre to each box, compared to the squared radius.
+#if SAE_LIGHTCLUSTERS_X86
+        if(m_useSIMD) {
+          __m128 const zero = _mm_setzero_ps();
+          __m128 const cx   = _mm_set1_ps(sphere.x);
+          __m128 const cy   = _mm_set1_ps(sphere.y);
+          __m128 const cz   = _mm_set1_ps(sphere.z);
+          __m128 const r2   = _mm_set1_ps(radiusSquared);
+
+          for(uint32_t c=0; c < sliceSize; c += 4) {
+            __m128 const dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(minX + c), cx), _mm_sub_ps(cx, _mm_loadu_ps(maxX + c))), zero);
+            __m128 const dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(minY + c), cy), _mm_sub_ps(cy, _mm_loadu_ps(maxY + c))), zero);
+            __m128 const dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(minZ + c), cz), _mm_sub_ps(cz, _mm_loadu_ps(maxZ + c))), zero);
+            __m128 const d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+            int const mask = _mm_movemask_ps(_mm_cmple_ps(d2, r2));
+            if(!mask)
+              continue;
+
+            for(uint32_t b=0; b < 4; ++b) {
+              uint32_t const cluster = c + b;
+              if(!(mask & (1 << b)) || cluster >= sliceSize)
+                continue;
+
+              uint32_t const n = counts[cluster]++;
+              if(n < maxLights)
+                lists[cluster * maxLights + n] = light;
+            }
+          }
+          continue;
+        }
+#endif
+
+        for(uint32_t cluster=0; cluster < sliceSize; ++cluster) {
+          float const dx = std::max(std::max(minX[cluster] - sphere.x, sphere.x - maxX[cluster]), 0.0f);
+          float const dy = std::max(std::max(minY[cluster] - sphere.y, sphere.y - maxY[cluster]), 0.0f);
+          float const dz = std::max(std::max(minZ[cluster] - sphere.z, sphere.z - maxZ[cluster]), 0.0f);
+          if(((dx * dx) + (dy * dy)) + (dz * dz) > radiusSquared)
+            continue;
+
+          uint32_t const n = counts[cluster]++;
+          if(n < maxLights)
+            lists[cluster * maxLights + n] = light;
+        }
+      }
+
+      uint32_t maxCount = 0;
+      for(uint32_t cluster=0; cluster < sliceSize; ++cluster)
+        maxCount = std::max(maxCount, counts[cluster]);
+      m_sliceMaxLights[slice] = maxCount;
+    }
+
+    void LightClusters
+      ::build(std::vector<LightSphere> const&lights)
+    {
+      ClusterClock::time_point start = ClusterClock::now();
+
+      m_stats        = Stats();
+      m_stats.lights = static_cast<uint32_t>(lights.size());
+      m_indices.clear();
+
+      if(!m_sliceStride)
+        return;
+
+      uint32_t const sliceSize = m_options.gridX * m_options.gridY;
+      uint32_t const maxLights = m_options.maxLightsPerCluster;
+
+      auto assignSlices = [&] (size_t begin, size_t end) -> void
+      {
+        for(size_t slice=begin; slice < end; ++slice)
+          assignSlice(static_cast<uint32_t>(slice), lights);
+      };
+
+      if(m_pool && m_options.gridZ > 1)
+        m_pool->parallelFor(m_options.gridZ, 1, assignSlices);
+      else
+        assignSlices(0, m_options.gridZ);
+
+      // Offsets in cell order; whatever does not fit the index list is dropped.
+      uint32_t offset = 0;
+      for(uint32_t slice=0; slice < m_options.gridZ; ++slice) {
+        m_stats.maxClusterLights = std::max(m_stats.maxClusterLights, m_sliceMaxLights[slice]);
+
+        for(uint32_t c=0; c < sliceSize; ++c) {
+          uint32_t const found = m_clusterCounts[size_t(slice) * m_sliceStride + c];
+          uint32_t       count = std::min(found, maxLights);
+          count = std::min(count, m_options.maxIndices - offset);
+
+          Cell &cell = m_cells[size_t(slice) * sliceSize + c];
+          cell.offset = offset;
+          cell.count  = count;
+
+          offset                   += count;
+          m_stats.indicesDropped   += (found - count);
+          m_stats.occupiedClusters += (count ? 1 : 0);
+        }
+      }
+
+      m_indices.resize(offset);
+      m_stats.indices = offset;
+
+      auto gatherSlices = [&] (size_t begin, size_t end) -> void
+      {
+        for(size_t slice=begin; slice < end; ++slice)
+          for(uint32_t c=0; c < sliceSize; ++c) {
+            Cell const&cell = m_cells[slice * sliceSize + c];
+            if(cell.count)
+              memcpy(&m_indices[cell.offset], &m_clusterLights[(slice * m_sliceStride + c) * maxLights], sizeof(uint32_t) * cell.count);
+          }
+      };
+
+      if(m_pool && m_options.gridZ > 1 && offset)
+        m_pool->parallelFor(m_options.gridZ, 1, gatherSlices);
+      else
+        gatherSlices(0, m_options.gridZ);
+
+      m_stats.buildMs = std::chrono::duration<double, std::milli>(ClusterClock::now() - start).count();
+    }
+
+  }
+}
@@ -0,0 +1,725 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#include "Engine/PixelConversion.h"
+#include "Renderer/MaskedOcclusionCulling.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+  #define SAE_OCCLUSION_X86 1
+  #include <immintrin.h>
+  #if defined(_MSC_VER)
+    // MSVC emits any intrinsic regardless of /arch, dispatch guards the call sites.
+    #define SAE_TARGET_AVX2
+  #else
+    #define SAE_TARGET_AVX2 __attribute__((target("avx2")))
+  #endif
+#else
+  #define SAE_OCCLUSION_X86 0
+#endif
+
+namespace SAE {
+  namespace Rendering {
+
+    typedef std::chrono::high_resolution_clock OcclusionClock;
+
+    static double MillisecondsSince(OcclusionClock::time_point start)
+    {
+      return std::chrono::duration<double, std::milli>(OcclusionClock::now() - start).count();
+    }
+
+    static const uint32_t TileRows = MaskedOcclusionCulling::TileHeight;
+
+    //
+    // Scanline spans and tile masks. Both paths perform the same float operations in the same
+    // order, so they produce identical buffers.
+    //
+
+    // Inclusive pixel span [outLeft, outRight] of each of the TileRows scanlines from y0;
+    // empty rows get outLeft > outRight.
+    static void ComputeSpansScalar(
+      const float  slope[3],
+      const float  offset[3],
+      const bool   left[3],
+      uint32_t     edgeCount,
+      int32_t      firstRow,
+      int32_t      lastRow,
+      int32_t      y0,
+      float        width,
+      int32_t      outLeft[TileRows],
+      int32_t      outRight[TileRows])
+    {
+      for(uint32_t r=0; r < TileRows; ++r) {
+        int32_t y = y0 + static_cast<int32_t>(r);
+        if(y < firstRow || y > lastRow) {
+          outLeft[r]  = static_cast<int32_t>(width);
+          outRight[r] = -1;
+          continue;
+        }
+
+        float yc = static_cast<float>(y) + 0.5f;
+        float l  = 0.0f;
+        float rr = width - 1.0f;
+        for(uint32_t e=0; e < edgeCount; ++e) {
+          float t = (offset[e] + slope[e] * yc) - 0.5f;
+          if(left[e])
+            l = std::max(l, std::ceil(t));
+          else
+            rr = std::min(rr, std::floor(t));
+        }
+        outLeft[r]  = static_cast<int32_t>(std::min(l, width));
+        outRight[r] = static_cast<int32_t>(std::max(rr, -1.0f));
+      }
+    }
+
+    // Bit i of row r is set if pixel (tileX + i, r) lies inside that row's span.
+    static void BuildTileMaskScalar(
+      const int32_t spanLeft[TileRows],
+      const int32_t spanRight[TileRows],
+      int32_t       tileX,
+      uint32_t      outMask[TileRows])
+    {
+      for(uint32_t r=0; r < TileRows; ++r) {
+        int32_t  fromLeft  = spanLeft[r] - tileX;
+        int32_t  fromRight = tileX + 31 - spanRight[r];
+        uint32_t leftMask  = (fromLeft  <= 0) ? ~0u : (fromLeft  >= 32) ? 0u : (~0u << fromLeft);
+        uint32_t rightMask = (fromRight <= 0) ? ~0u : (fromRight >= 32) ? 0u : (~0u >> fromRight);
+        outMask[r] = leftMask & rightMask;
+      }
+    }
+
+#if SAE_OCCLUSION_X86
+    SAE_TARGET_AVX2
+    static void ComputeSpansAVX2(
+      const float  slope[3],
+      const float  offset[3],
+      const bool   left[3],
+      uint32_t     edgeCount,
+      int32_t      firstRow,
+      int32_t      lastRow,
+      int32_t      y0,
+      float        width,
+      int32_t      outLeft[TileRows],
+      int32_t      outRight[TileRows])
+    {
+      __m256i rows = _mm256_add_epi32(_mm256_set1_epi32(y0), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+      __m256  yc   = _mm256_add_ps(_mm256_cvtepi32_ps(rows), _mm256_set1_ps(0.5f));
+      __m256  half = _mm256_set1_ps(0.5f);
+      __m256  l    = _mm256_setzero_ps();
+      __m256  r    = _mm256_set1_ps(width - 1.0f);
+
+      for(uint32_t e=0; e < edgeCount; ++e) {
+        __m256 t = _mm256_sub_ps(_mm256_add_ps(_mm256_set1_ps(offset[e]), _mm256_mul_ps(_mm256_set1_ps(slope[e]), yc)), half);
+        if(left[e])
+          l = _mm256_max_ps(_mm256_round_ps(t, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC), l);
+        else
+          r = _mm256_min_ps(_mm256_round_ps(t, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC), r);
+      }
+      l = _mm256_min_ps(l, _mm256_set1_ps(width));
+      r = _mm256_max_ps(r, _mm256_set1_ps(-1.0f));
+
+      __m256i outside = _mm256_or_si256(
+        _mm256_cmpgt_epi32(_mm256_set1_epi32(firstRow), rows),
+        _mm256_cmpgt_epi32(rows, _mm256_set1_epi32(lastRow)));
+      __m256i li = _mm256_blendv_epi8(_mm256_cvttps_epi32(l), _mm256_set1_epi32(static_cast<int32_t>(width)), outside);
+      __m256i ri = _mm256_blendv_epi8(_mm256_cvttps_epi32(r), _mm256_set1_epi32(-1), outside);
+
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(outLeft),  li);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(outRight), ri);
+    }
+
+    SAE_TARGET_AVX2
+    static void BuildTileMaskAVX2(
+      const int32_t spanLeft[TileRows],
+      const int32_t spanRight[TileRows],
+      int32_t       tileX,
+      uint32_t      outMask[TileRows])
+    {
+      // Variable shifts by 32 or more produce zero, which empties rows outside the tile.
+      __m256i ones      = _mm256_set1_epi32(-1);
+      __m256i zero      = _mm256_setzero_si256();
+      __m256i fromLeft  = _mm256_sub_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(spanLeft)), _mm256_set1_epi32(tileX));
+      __m256i fromRight = _mm256_sub_epi32(_mm256_set1_epi32(tileX + 31), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(spanRight)));
+      __m256i mask      = _mm256_and_si256(
+        _mm256_sllv_epi32(ones, _mm256_max_epi32(fromLeft,  zero)),
+        _mm256_srlv_epi32(ones, _mm256_max_epi32(fromRight, zero)));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(outMask), mask);
+    }
+#endif
+
+    static inline uint32_t PopCount(uint32_t v)
+    {
+      v = v - ((v >> 1) & 0x55555555u);
+      v = (v & 0x33333333u) + ((v >> 2) & 0x33333333u);
+      return (((v + (v >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24;
+    }
+
+    // Merges coverage at conservative depth zTriangle into a tile. Pixels in mask are bounded by
+    // z0, all others by z1; z0 <= z1 always holds.
+    static void UpdateTile(uint32_t mask[TileRows], float &z0, float &z1, uint32_t coverage[TileRows], float zTriangle)
+    {
+      if(!(zTriangle < z1))
+        return;
+
+      uint32_t coverageCount = 0;
+      uint32_t maskCount     = 0;
+      uint32_t maskOnlyCount = 0;
+      for(uint32_t r=0; r < TileRows; ++r) {
+        // Pixels of the working layer already at least as near need no update.
+        if(z0 <= zTriangle)
+          coverage[r] &= ~mask[r];
+        coverageCount += PopCount(coverage[r]);
+        maskCount     += PopCount(mask[r]);
+        maskOnlyCount += PopCount(mask[r] & ~coverage[r]);
+      }
+      if(!coverageCount)
+        return;
+
+      if(!maskCount) {
+        memcpy(mask, coverage, sizeof(uint32_t) * TileRows);
+        z0 = zTriangle;
+      }
+      else {
+        // Depth error summed over the tile: extending the working layer loosens its pixels
+        // to the merged depth, discarding it drops its remaining pixels back to z1.
+        float merged        = std::max(z0, zTriangle);
+        float mergeError    = maskCount * (merged - z0) + coverageCount * (merged - zTriangle);
+        float discardError  = maskOnlyCount * (z1 - z0);
+        if(mergeError <= discardError) {
+          for(uint32_t r=0; r < TileRows; ++r)
+            mask[r] |= coverage[r];
+          z0 = merged;
+        }
+        else {
+          memcpy(mask, coverage, sizeof(uint32_t) * TileRows);
+          z0 = zTriangle;
+        }
+      }
+
+      uint32_t full = ~0u;
+      for(uint32_t r=0; r < TileRows; ++r)
+        full &= mask[r];
+      if(full == ~0u) {
+        z1 = z0;
+        memset(mask, 0, sizeof(uint32_t) * TileRows);
+      }
+    }
+
+    //
+    // MaskedOcclusionCulling
+    //
+
+    MaskedOcclusionCulling::MaskedOcclusionCulling()
+      : m_pool(nullptr)
+      , m_useAVX2(false)
+      , m_tilesX(0)
+      , m_tilesY(0)
+      , m_triangleCount(0)
+      , m_stats()
+      , m_objectsTested(0)
+      , m_objectsOccluded(0)
+      , m_objectsViewCulled(0)
+    {}
+
+    bool MaskedOcclusionCulling
+      ::initialize(Options const&options, SAE::Threading::WorkerPool *pool)
+    {
+      if(!options.width || !options.height)
+        return false;
+
+      m_options = options;
+      m_pool    = pool;
+      m_tilesX  = (options.width  + TileWidth  - 1) / TileWidth;
+      m_tilesY  = (options.height + TileHeight - 1) / TileHeight;
+
+#if SAE_OCCLUSION_X86
+      m_useAVX2 = options.allowAVX2
+                  && SAE::Texture::SupportedPixelKernelLevel() >= SAE::Texture::PixelKernelLevel::AVX2;
+#else
+      m_useAVX2 = false;
+#endif
+
+      m_mask.assign((size_t)m_tilesX * m_tilesY * TileRows, 0);
+      m_z0.assign((size_t)m_tilesX * m_tilesY, 1.0f);
+      m_z1.assign((size_t)m_tilesX * m_tilesY, 1.0f);
+
+      // Setup works on a few ranges per thread so uneven triangle costs even out.
+      m_bins.resize(m_pool ? m_pool->threadCount() * 4 : 1);
+
+      resetStats();
+      clear();
+
+      return true;
+    }
+
+    bool MaskedOcclusionCulling
+      ::deinitialize()
+    {
+      m_mask.clear();
+      m_z0.clear();
+      m_z1.clear();
+      m_vertices.clear();
+      m_indices.clear();
+      m_occluders.clear();
+      m_bins.clear();
+      m_pool = nullptr;
+
+      return true;
+    }
+
+    void MaskedOcclusionCulling
+      ::clear()
+    {
+      std::fill(m_mask.begin(), m_mask.end(), 0u);
+      std::fill(m_z0.begin(), m_z0.end(), 1.0f);
+      std::fill(m_z1.begin(), m_z1.end(), 1.0f);
+
+      m_vertices.clear();
+      m_indices.clear();
+      m_occluders.clear();
+      m_triangleCount = 0;
+    }
+
+    void MaskedOcclusionCulling
+      ::addOccluder(
+        const float    *positions,
+        size_t          stride,
+        size_t          vertexCount,
+        const uint32_t *indices,
+        size_t          indexCount,
+        const float    *modelToClip,
+        bool            cullBackFaces)
+    {
+      if(!positions || !indices || !modelToClip || !vertexCount || indexCount < 3)
+        return;
+
+      for(size_t k=0; k < indexCount; ++k)
+        if(indices[k] >= vertexCount)
+          return;
+
+      const float *m          = modelToClip;
+      size_t       vertexBase = m_vertices.size() / 4;
+      m_vertices.resize(m_vertices.size() + vertexCount * 4);
+
+      float *out = m_vertices.data() + vertexBase * 4;
+      for(size_t k=0; k < vertexCount; ++k, out += 4) {
+        const float *p = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + k * stride);
+        for(int c=0; c < 4; ++c)
+          out[c] = p[0] * m[c] + p[1] * m[4 + c] + p[2] * m[8 + c] + m[12 + c];
+      }
+
+      Occluder occluder;
+      occluder.indexBase     = m_indices.size();
+      occluder.triangleBase  = m_triangleCount;
+      occluder.triangleCount = indexCount / 3;
+      occluder.cullBackFaces = cullBackFaces;
+
+      for(size_t k=0; k < occluder.triangleCount * 3; ++k)
+        m_indices.push_back(static_cast<uint32_t>(vertexBase) + indices[k]);
+
+      m_occluders.push_back(occluder);
+      m_triangleCount += occluder.triangleCount;
+    }
+
+    void MaskedOcclusionCulling
+      ::parallelFor(size_t count, std::function<void(size_t, size_t)> const&fn)
+    {
+      if(m_pool)
+        m_pool->parallelFor(count, 1, fn);
+      else
+        fn(0, count);
+    }
+
+    void MaskedOcclusionCulling
+      ::flush()
+    {
+      if(!m_triangleCount)
+        return;
+
+      OcclusionClock::time_point setupStart = OcclusionClock::now();
+
+      size_t binCount = m_bins.size();
+      parallelFor(binCount, [&] (size_t begin, size_t end)
+      {
+        for(size_t b=begin; b < end; ++b)
+          setupRange((m_triangleCount * b) / binCount, (m_triangleCount * (b + 1)) / binCount, m_bins[b]);
+      });
+
+      m_stats.occluderTriangles += m_triangleCount;
+      for(Bin const&bin : m_bins)
+        m_stats.occluderTrianglesRasterized += bin.rasterized;
+      m_stats.setupMs += MillisecondsSince(setupStart);
+
+      OcclusionClock::time_point rasterStart = OcclusionClock::now();
+
+      // One tile row per task: every tile is owned by a single thread and sees the triangles
+      // in submission order.
+      parallelFor(m_tilesY, [&] (size_t begin, size_t end)
+      {
+        for(size_t tileY=begin; tileY < end; ++tileY)
+          rasterizeTileRow(static_cast<uint32_t>(tileY));
+      });
+
+      m_stats.rasterMs += MillisecondsSince(rasterStart);
+
+      m_vertices.clear();
+      m_indices.clear();
+      m_occluders.clear();
+      m_triangleCount = 0;
+    }
+
+    void MaskedOcclusionCulling
+      ::setupRange(size_t first, size_t last, Bin &bin)
+    {
+      bin.triangles.clear();
+      bin.rows.resize(m_tilesY);
+      for(std::vector<uint32_t> &row : bin.rows)
+        row.clear();
+      bin.rasterized = 0;
+
+      if(first >= last)
+        return;
+
+      size_t occluderIndex = std::upper_bound(m_occluders.begin(), m_occluders.end(), first,
+        [] (size_t triangle, Occluder const&occluder) { return triangle < occluder.triangleBase; }) - m_occluders.begin() - 1;
+
+      for(size_t triangle=first; triangle < last; ++triangle) {
+        while(triangle >= m_occluders[occluderIndex].triangleBase + m_occluders[occluderIndex].triangleCount)
+          ++occluderIndex;
+
+        Occluder const&occluder = m_occluders[occluderIndex];
+        const uint32_t *indices = m_indices.data() + occluder.indexBase + (triangle - occluder.triangleBase) * 3;
+
+        const float *v[3] ={
+          m_vertices.data() + (size_t)indices[0] * 4,
+          m_vertices.data() + (size_t)indices[1] * 4,
+          m_vertices.data() + (size_t)indices[2] * 4
+        };
+        setupTriangle(v, occluder.cullBackFaces, bin);
+      }
+    }
+
+    void MaskedOcclusionCulling
+      ::setupTriangle(const float *v[3], bool cullBackFaces, Bin &bin)
+    {
+      // Trivial reject: all three vertices outside the same frustum plane.
+      for(int axis=0; axis < 2; ++axis) {
+        if(v[0][axis] > v[0][3] && v[1][axis] > v[1][3] && v[2][axis] > v[2][3])
+          return;
+        if(v[0][axis] < -v[0][3] && v[1][axis] < -v[1][3] && v[2][axis] < -v[2][3])
+          return;
+      }
+      if(v[0][2] > v[0][3] && v[1][2] > v[1][3] && v[2][2] > v[2][3])
+        return;
+
+      // Clip against the near plane (z >= 0); leaves a triangle or a quad.
+      float polygon[4][4];
+      int   count = 0;
+      for(int k=0; k < 3; ++k) {
+        const float *a  = v[k];
+        const float *b  = v[(k + 1) % 3];
+        float        da = a[2];
+        float        db = b[2];
+
+        if(da >= 0.0f)
+          memcpy(polygon[count++], a, sizeof(float) * 4);
+        if((da >= 0.0f) != (db >= 0.0f)) {
+          float t = da / (da - db);
+          for(int c=0; c < 4; ++c)
+            polygon[count][c] = a[c] + (b[c] - a[c]) * t;
+          ++count;
+        }
+      }
+      if(count < 3)
+        return;
+
+      float width  = static_cast<float>(this->width());
+      float height = static_cast<float>(this->height());
+
+      float sx[4], sy[4], sz[4];
+      for(int k=0; k < count; ++k) {
+        float invW = 1.0f / polygon[k][3];
+        sx[k] = (polygon[k][0] * invW * 0.5f + 0.5f) * width;
+        sy[k] = (0.5f - polygon[k][1] * invW * 0.5f) * height;
+        sz[k] = polygon[k][2] * invW;
+      }
+
+      for(int fan=1; fan + 1 < count; ++fan) {
+        int   i[3] ={ 0, fan, fan + 1 };
+        float x[3] ={ sx[i[0]], sx[i[1]], sx[i[2]] };
+        float y[3] ={ sy[i[0]], sy[i[1]], sy[i[2]] };
+        float z[3] ={ sz[i[0]], sz[i[1]], sz[i[2]] };
+
+        // Render target space has y down: positive area is clockwise on screen.
+        float area2 = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+        if(!(area2 != 0.0f) || !std::isfinite(area2))
+          continue;
+        if(cullBackFaces) {
+          bool front = m_options.frontCounterClockwise ? (area2 < 0.0f) : (area2 > 0.0f);
+          if(!front)
+            continue;
+        }
+
+        Triangle tri;
+        tri.minX     = std::min(x[0], std::min(x[1], x[2]));
+        tri.maxX     = std::max(x[0], std::max(x[1], x[2]));
+        tri.minY     = std::min(y[0], std::min(y[1], y[2]));
+        tri.maxY     = std::max(y[0], std::max(y[1], y[2]));
+        tri.firstRow = static_cast<int32_t>(std::min(height, std::max(0.0f, std::ceil(tri.minY - 0.5f))));
+        tri.lastRow  = static_cast<int32_t>(std::max(-1.0f, std::min(height - 1.0f, std::floor(tri.maxY - 0.5f))));
+        if(tri.firstRow > tri.lastRow
+           || std::ceil(tri.minX - 0.5f) > width - 1.0f || std::floor(tri.maxX - 0.5f) < 0.0f)
+        {
+          continue;
+        }
+
+        // Horizontal edges only bound the row range, which firstRow / lastRow already do.
+        tri.edgeCount = 0;
+        for(int e=0; e < 3; ++e) {
+          int   a  = e;
+          int   b  = (e + 1) % 3;
+          int   c  = (e + 2) % 3;
+          float dy = y[b] - y[a];
+          if(dy == 0.0f)
+            continue;
+
+          float slope  = (x[b] - x[a]) / dy;
+          float offset = x[a] - slope * y[a];
+          tri.slope[tri.edgeCount]  = slope;
+          tri.offset[tri.edgeCount] = offset;
+          tri.left[tri.edgeCount]   = x[c] > offset + slope * y[c]; // opposite vertex to the right
+          ++tri.edgeCount;
+        }
+
+        float inverseArea = 1.0f / area2;
+        tri.depth[0] = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) * inverseArea;
+        tri.depth[1] = ((x[1] - x[0]) * (z[2] - z[0]) - (x[2] - x[0]) * (z[1] - z[0])) * inverseArea;
+        tri.depth[2] = z[0] - tri.depth[0] * x[0] - tri.depth[1] * y[0];
+        tri.maxDepth = std::max(z[0], std::max(z[1], z[2]));
+
+        uint32_t index = static_cast<uint32_t>(bin.triangles.size());
+        bin.triangles.push_back(tri);
+        for(int32_t tileY=tri.firstRow / (int32_t)TileHeight; tileY <= tri.lastRow / (int32_t)TileHeight; ++tileY)
+          bin.rows[tileY].push_back(index);
+        ++bin.rasterized;
+      }
+    }
+
+    void MaskedOcclusionCulling
+      ::rasterizeTileRow(uint32_t tileY)
+    {
+      for(Bin const&bin : m_bins)
+        for(uint32_t index : bin.rows[tileY])
+          rasterizeTriangle(bin.triangles[index], tileY);
+    }
+
+    void MaskedOcclusionCulling
+      ::rasterizeTriangle(Triangle const&tri, uint32_t tileY)
+    {
+      float   width = static_cast<float>(this->width());
+      int32_t y0    = static_cast<int32_t>(tileY * TileHeight);
+
+      int32_t spanLeft[TileRows];
+      int32_t spanRight[TileRows];
+#if SAE_OCCLUSION_X86
+      if(m_useAVX2)
+        ComputeSpansAVX2(tri.slope, tri.offset, tri.left, tri.edgeCount, tri.firstRow, tri.lastRow, y0, width, spanLeft, spanRight);
+      else
+#endif
+        ComputeSpansScalar(tri.slope, tri.offset, tri.left, tri.edgeCount, tri.firstRow, tri.lastRow, y0, width, spanLeft, spanRight);
+
+      int32_t firstColumn = static_cast<int32_t>(std::max(0.0f, std::ceil(tri.minX - 0.5f)));
+      int32_t lastColumn  = static_cast<int32_t>(std::min(width - 1.0f, std::floor(tri.maxX - 0.5f)));
+
+      // Depth bound over the part of the tile row inside the triangle's bounding box.
+      float rectY0 = std::max(static_cast<float>(y0), tri.minY);
+      float rectY1 = std::min(static_cast<float>(y0 + TileHeight), tri.maxY);
+      float depthY = std::max(tri.depth[1] * rectY0, tri.depth[1] * rectY1) + tri.depth[2];
+
+      for(int32_t tileX=firstColumn / (int32_t)TileWidth; tileX <= lastColumn / (int32_t)TileWidth; ++tileX) {
+        int32_t  x0 = tileX * static_cast<int32_t>(TileWidth);
+        uint32_t coverage[TileRows];
+#if SAE_OCCLUSION_X86
+        if(m_useAVX2)
+          BuildTileMaskAVX2(spanLeft, spanRight, x0, coverage);
+        else
+#endif
+          BuildTileMaskScalar(spanLeft, spanRight, x0, coverage);
+
+        uint32_t any = 0;
+        for(uint32_t r=0; r < TileRows; ++r)
+          any |= coverage[r];
+        if(!any)
+          continue;
+
+        float rectX0    = std::max(static_cast<float>(x0), tri.minX);
+        float rectX1    = std::min(static_cast<float>(x0 + TileWidth), tri.maxX);
+        float zTriangle = std::min(tri.maxDepth, std::max(tri.depth[0] * rectX0, tri.depth[0] * rectX1) + depthY);
+
+        size_t tile = (size_t)tileY * m_tilesX + tileX;
+        UpdateTile(m_mask.data() + tile * TileRows, m_z0[tile], m_z1[tile], coverage, zTriangle);
+      }
+    }
+
+    //
+    // Queries
+    //
+
+    MaskedOcclusionCulling::Result MaskedOcclusionCulling
+      ::countResult(Result result) const
+    {
+      ++m_objectsTested;
+      if(result == Result::Occluded)
+        ++m_objectsOccluded;
+      else if(result == Result::ViewCulled)
+        ++m_objectsViewCulled;
+      return result;
+    }
+
+    MaskedOcclusionCulling::Result MaskedOcclusionCulling
+      ::testAABB(const float boundsMin[3], const float boundsMax[3], const float *modelToClip) const
+    {
+      const float *m = modelToClip;
+
+      float corners[8][4];
+      for(int k=0; k < 8; ++k) {
+        float p[3] ={
+          (k & 1) ? boundsMax[0] : boundsMin[0],
+          (k & 2) ? boundsMax[1] : boundsMin[1],
+          (k & 4) ? boundsMax[2] : boundsMin[2]
+        };
+        for(int c=0; c < 4; ++c)
+          corners[k][c] = p[0] * m[c] + p[1] * m[4 + c] + p[2] * m[8 + c] + m[12 + c];
+      }
+
+      // Outside one frustum plane with all corners: not on screen at all.
+      uint32_t outsideAll = 0x3F;
+      bool     crossesNear = false;
+      for(int k=0; k < 8; ++k) {
+        float const*c = corners[k];
+        uint32_t outside = 0;
+        if(c[0] < -c[3]) outside |= 0x01;
+        if(c[0] >  c[3]) outside |= 0x02;
+        if(c[1] < -c[3]) outside |= 0x04;
+        if(c[1] >  c[3]) outside |= 0x08;
+        if(c[2] <  0.0f) outside |= 0x10;
+        if(c[2] >  c[3]) outside |= 0x20;
+        outsideAll  &= outside;
+        crossesNear |= (c[2] < 0.0f);
+      }
+      if(outsideAll)
+        return countResult(Result::ViewCulled);
+
+      // Boxes reaching behind the near plane have no conservative screen bound.
+      if(crossesNear)
+        return countResult(Result::Visible);
+
+      float width  = static_cast<float>(this->width());
+      float height = static_cast<float>(this->height());
+      float minX   = width,  maxX = 0.0f;
+      float minY   = height, maxY = 0.0f;
+      float nearestDepth = 1.0f;
+      for(int k=0; k < 8; ++k) {
+        float invW = 1.0f / corners[k][3];
+        float x    = (corners[k][0] * invW * 0.5f + 0.5f) * width;
+        float y    = (0.5f - corners[k][1] * invW * 0.5f) * height;
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+        nearestDepth = std::min(nearestDepth, corners[k][2] * invW);
+      }
+
+      return countResult(testScreenRect(minX, minY, maxX, maxY, nearestDepth));
+    }
+
+    MaskedOcclusionCulling::Result MaskedOcclusionCulling
+      ::testRect(float minX, float minY, float maxX, float maxY, float nearestDepth) const
+    {
+      return countResult(testScreenRect(minX, minY, maxX, maxY, nearestDepth));
+    }
+
+    MaskedOcclusionCulling::Result MaskedOcclusionCulling
+      ::testScreenRect(float minX, float minY, float maxX, float maxY, float nearestDepth) const
+    {
+      if(!(nearestDepth >= 0.0f))
+        return Result::Visible;
+
+      // Every pixel the rectangle touches, clamped before converting.
+      float   width  = static_cast<float>(this->width());
+      float   height = static_cast<float>(this->height());
+      if(!(maxX >= 0.0f && maxY >= 0.0f && minX < width && minY < height))
+        return Result::ViewCulled;
+
+      int32_t x0 = static_cast<int32_t>(std::max(0.0f, std::floor(minX)));
+      int32_t y0 = static_cast<int32_t>(std::max(0.0f, std::floor(minY)));
+      int32_t x1 = static_cast<int32_t>(std::min(width  - 1.0f, std::floor(maxX)));
+      int32_t y1 = static_cast<int32_t>(std::min(height - 1.0f, std::floor(maxY)));
+
+      for(int32_t tileY=y0 / (int32_t)TileHeight; tileY <= y1 / (int32_t)TileHeight; ++tileY) {
+        int32_t rowBase  = tileY * static_cast<int32_t>(TileHeight);
+        int32_t firstRow = std::max(y0, rowBase) - rowBase;
+        int32_t lastRow  = std::min(y1, rowBase + (int32_t)TileHeight - 1) - rowBase;
+
+        for(int32_t tileX=x0 / (int32_t)TileWidth; tileX <= x1 / (int32_t)TileWidth; ++tileX) {
+          size_t tile = (size_t)tileY * m_tilesX + tileX;
+
+          // Coarse level: the whole tile is at least as near as the object.
+          if(nearestDepth >= m_z1[tile])
+            continue;
+          if(nearestDepth < m_z0[tile])
+            return Result::Visible;
+
+          // In between: occluded only where the working layer covers the rectangle.
+          int32_t  columnBase = tileX * static_cast<int32_t>(TileWidth);
+          int32_t  fromLeft   = std::max(x0 - columnBase, 0);
+          int32_t  toRight    = std::min(x1 - columnBase, (int32_t)TileWidth - 1);
+          uint32_t rowBits    = (~0u << fromLeft) & (~0u >> (31 - toRight));
+
+          const uint32_t *mask = m_mask.data() + tile * TileRows;
+          for(int32_t r=firstRow; r <= lastRow; ++r)
+            if(rowBits & ~mask[r])
+              return Result::Visible;
+        }
+      }
+
+      return Result::Occluded;
+    }
+
+    void MaskedOcclusionCulling
+      ::resolveDepth(std::vector<float> &outDepth) const
+    {
+      uint32_t width = this->width();
+      outDepth.resize((size_t)width * height());
+
+      for(uint32_t y=0; y < height(); ++y) {
+        for(uint32_t x=0; x < width; ++x) {
+          size_t tile = (size_t)(y / TileHeight) * m_tilesX + (x / TileWidth);
+          bool   set  = (m_mask[tile * TileRows + (y % TileHeight)] >> (x % TileWidth)) & 1u;
+          outDepth[(size_t)y * width + x] = set ? m_z0[tile] : m_z1[tile];
+        }
+      }
+    }
+
+    MaskedOcclusionCulling::Stats MaskedOcclusionCulling
+      ::stats() const
+    {
+      Stats stats = m_stats;
+      stats.objectsTested     = m_objectsTested;
+      stats.objectsOccluded   = m_objectsOccluded;
+      stats.objectsViewCulled = m_objectsViewCulled;
+      return stats;
+    }
+
+    void MaskedOcclusionCulling
+      ::resetStats()
+    {
+      m_stats             = Stats();
+      m_objectsTested     = 0;
+      m_objectsOccluded   = 0;
+      m_objectsViewCulled = 0;
+    }
+
+  }
+}
@@ -0,0 +1,238 @@
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "Renderer/NullCommandBackend.h"
+
+namespace SAE {
+  namespace Rendering {
+
+    NullCommandBackend::NullCommandBackend()
+    {
+      reset();
+    }
+
+    void NullCommandBackend
+      ::reset()
+    {
+      m_stats          = {};
+      m_firstError.clear();
+      m_pipelineBound  = false;
+      m_resourcesBound = false;
+    }
+
+    void NullCommandBackend
+      ::error(const char *message)
+    {
+      if(!m_stats.errors)
+        m_firstError = message;
+      ++m_stats.errors;
+    }
+
+    void NullCommandBackend
+      ::bindPipeline(BindPipelineCommand const&command)
+    {
+      ++m_stats.pipelineBinds;
+
+      // A null pixel shader is legal: depth-only passes.
+      if(!command.inputLayoutId || !command.vertexShaderId)
+        error("BindPipeline: null input layout or vertex shader.");
+
+      m_pipelineBound = true;
+    }
+
+    void NullCommandBackend
+      ::bindResources(BindResourcesCommand const&command)
+    {
+      ++m_stats.resourceBinds;
+
+      if(!command.vertexBufferId || !command.indexBufferId)
+        error("BindResources: null vertex or index buffer.");
+      if(!command.vertexStride)
+        error("BindResources: zero vertex stride.");
+      if(command.pixelShaderResourceCount > MaxPixelShaderResources)
+        error("BindResources: too many pixel shader resources.");
+      if(command.samplerCount > MaxPixelShaderSamplers)
+        error("BindResources: too many samplers.");
+      for(uint32_t k=0; k < std::min(command.samplerCount, MaxPixelShaderSamplers); ++k)
+        if(!command.samplers[k])
+          error("BindResources: null sampler.");
+
+      m_resourcesBound = true;
+    }
+
+    void NullCommandBackend
+      ::updateConstants(UpdateConstantsCommand const&command, const void *data)
+    {
+      ++m_stats.constantUpdates;
+      m_stats.constantBytes += command.dataSize;
+
+      if(!command.bufferId)
+        error("UpdateConstants: null buffer.");
+      if(command.slot >= MaxConstantBufferSlots)
+        error("UpdateConstants: slot out of range.");
+      if(command.stages & ~static_cast<uint32_t>(ShaderStageVertex | ShaderStagePixel))
+        error("UpdateConstants: unknown shader stage.");
+      if(command.dataSize % 16)
+        error("UpdateConstants: size is not a multiple of 16 bytes.");
+      if(command.dataSize && !data)
+        error("UpdateConstants: missing data.");
+    }
+
+    void NullCommandBackend
+      ::drawIndexed(DrawIndexedCommand const&)
+    {
+      ++m_stats.draws;
+
+      if(!m_pipelineBound || !m_resourcesBound)
+        error("DrawIndexed: no pipeline or resources bound.");
+    }
+
+    void NullCommandBackend
+      ::updateBuffer(UpdateBufferCommand const&command, const void *data)
+    {
+      ++m_stats.bufferUpdates;
+      m_stats.bufferBytes += command.dataSize;
+
+      if(!command.bufferId)
+        error("UpdateBuffer: null buffer.");
+      if(!command.dataSize)
+        error("UpdateBuffer: empty update.");
+      if(command.dataSize && !data)
+        error("UpdateBuffer: missing data.");
+    }
+
+    //
+    // Benchmark
+    //
+
+    std::vector<CommandRecordingBenchmarkResult> BenchmarkCommandRecording(
+      size_t       objectCount,
+      unsigned int maxThreads)
+    {
+      typedef std::chrono::high_resolution_clock Clock;
+
+      if(!maxThreads)
+        maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+      // Fake, non-null ids; 8 materials drawn in runs, as a sorted draw list would be.
+      std::vector<XMMATRIX> worlds(objectCount), normals(objectCount);
+      RenderScene scene;
+      scene.cameraBufferId        = 0x1000;
+      scene.objectBufferId        = 0x1010;
+      scene.lightBufferId         = 0x1020;
+      scene.otherBufferId         = 0x1030;
+      scene.ambientBufferId       = 0x1040;
+      scene.shadowMapTextureSRVId = 0x1050;
+      scene.environmentMapSRVId   = 0x1060;
+      scene.renderTargetId        = 0;
+      scene.lights                = { 1, 2, 3, 4 };
+      for(size_t k=0; k < objectCount; ++k) {
+        uint64_t const material = 1 + ((k * 8) / std::max<size_t>(1, objectCount));
+        uint64_t const mesh     = 1 + (k % 32);
+
+        RenderObject object ={};
+        object.objectId             = k + 1;
+        object.vertexBufferId       = 0x2000 + mesh * 16;
+        object.indexBufferId        = 0x3000 + mesh * 16;
+        object.inputLayoutId        = 0x4000;
+        object.vertexShaderId       = 0x5000 + material * 16;
+        object.pixelShaderId        = 0x6000 + material * 16;
+        object.diffuseTextureSRVId  = 0x7000 + material * 16;
+        object.specularTextureSRVId = 0x8000 + material * 16;
+        object.glossTextureSRVId    = 0x9000 + material * 16;
+        object.normalTextureSRVId   = 0xA000 + material * 16;
+        scene.objects.push_back(object);
+
+        worlds[k]  = XMMatrixTranslation(float(k % 100), 0.0f, float(k / 100));
+        normals[k] = XMMatrixIdentity();  // as the engine captures them: translations only
+      }
+
+      scene.cameraBufferUpdateFn =
+        [] (CameraBuffer_t *ptr) -> bool
+      {
+        ptr->view       = XMMatrixIdentity();
+        ptr->projection = XMMatrixIdentity();
+        return true;
+      };
+      scene.lightingBufferUpdateFn =
+        [] (LightBuffer_t *ptr, uint64_t lightId, uint64_t targetIndex) -> bool
+      {
+        ptr->lights[targetIndex].position = XMVectorSet(float(lightId), 1.0f, 0.0f, 1.0f);
+        return true;
+      };
+      scene.objectBufferUpdateFn =
+        [&worlds, &normals] (ObjectBuffer_t *ptr, uint64_t objectId) -> bool
+      {
+        ptr->world             = worlds[objectId - 1];
+        ptr->invTransposeWorld = normals[objectId - 1];
+        return true;
+      };
+      scene.otherBufferUpdateFn =
+        [] (OtherBuffer_t *ptr) -> bool
+      {
+        ptr->displayMode = 0;
+        return true;
+      };
+
+      SceneRecordingOptions options;
+      options.defaultSamplerId   = 0xB000;
+      options.shadowMapSamplerId = 0xB010;
+
+      std::vector<CommandRecordingBenchmarkResult> results;
+      for(unsigned int threads=1; threads <= maxThreads; threads *= 2) {
+        SAE::Threading::WorkerPool pool;
+        pool.initialize(threads);
+
+        CommandBuffer      buffer;
+        NullCommandBackend backend;
+
+        MemoryConstantUploadDevice                  uploadDevice;
+        ConstantUploadRing                          uploadRing;
+        std::vector<ConstantUploadRing::Allocation> allocations;
+        uploadRing.initialize(&uploadDevice);
+
+        // Warm-up: grows the command lists once.
+        RecordScene(scene, PassType::Main, options, &pool, buffer);
+
+        int const repetitions = 10;
+        double recordSeconds = 0.0;
+        double submitSeconds = 0.0;
+        bool   valid         = true;
+        for(int r=0; r < repetitions; ++r) {
+          Clock::time_point start = Clock::now();
+          RecordScene(scene, PassType::Main, options, &pool, buffer);
+          Clock::time_point recorded = Clock::now();
+
+          backend.reset();
+          valid = buffer.submit(backend) && !backend.stats().errors && valid;
+          Clock::time_point submitted = Clock::now();
+
+          valid = UploadCommandConstants(buffer, uploadRing, allocations) && valid;
+          uploadRing.endFrame();
+
+          recordSeconds += std::chrono::duration<double>(recorded  - start).count();
+          submitSeconds += std::chrono::duration<double>(submitted - recorded).count();
+        }
+        valid = valid && (backend.stats().draws == objectCount);
+
+        CommandRecordingBenchmarkResult result;
+        result.threadCount           = threads;
+        result.commands              = buffer.commandCount();
+        result.bytes                 = buffer.byteSize();
+        result.recordMs              = (recordSeconds * 1000.0) / repetitions;
+        result.submitMs              = (submitSeconds * 1000.0) / repetitions;
+        result.commandsPerSecond     = (recordSeconds > 0.0) ? (double(result.commands) * repetitions / recordSeconds) : 0.0;
+        result.megabytesPerSecond    = (recordSeconds > 0.0) ? (double(result.bytes) * repetitions / recordSeconds / (1024.0 * 1024.0)) : 0.0;
+        result.constantBytesPerFrame = uploadRing.lastFrameStats().bytesUploaded;
+        result.valid                 = valid;
+        results.push_back(result);
+
+        pool.deinitialize();
+      }
+
+      return results;
+    }
+
+  }
+}
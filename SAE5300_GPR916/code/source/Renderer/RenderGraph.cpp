@@ -0,0 +1,535 @@
+#include <algorithm>
+#include <functional>
+#include <queue>
+
+#include "Engine/FrameArena.h"
+#include "Renderer/RenderGraph.h"
+
+namespace SAE {
+  namespace Rendering {
+
+    static const char* FormatName(RenderGraphFormat format)
+    {
+      switch(format) {
+      case RenderGraphFormat::D24S8:   return "D24S8";
+      case RenderGraphFormat::D32F:    return "D32F";
+      case RenderGraphFormat::RGBA8:   return "RGBA8";
+      case RenderGraphFormat::RGBA16F: return "RGBA16F";
+      case RenderGraphFormat::R32F:    return "R32F";
+      }
+      return "?";
+    }
+
+    static void WriteUsage(std::ostream &out, uint32_t usage)
+    {
+      const char *separator = "";
+      if(usage & RenderGraphUsageShaderResource) { out << separator << "SRV"; separator = "|"; }
+      if(usage & RenderGraphUsageDepthStencil)   { out << separator << "DSV"; separator = "|"; }
+      if(usage & RenderGraphUsageRenderTarget)   { out << separator << "RTV"; separator = "|"; }
+    }
+
+    bool RenderGraphTextureDesc
+      ::operator==(RenderGraphTextureDesc const&other) const
+    {
+      return width     == other.width
+          && height    == other.height
+          && arraySize == other.arraySize
+          && format    == other.format
+          && cube      == other.cube;
+    }
+
+    uint64_t RenderGraphTextureDesc
+      ::byteSize() const
+    {
+      uint64_t texelSize = 4;
+      if(format == RenderGraphFormat::RGBA16F)
+        texelSize = 8;
+
+      return uint64_t(width) * height * std::max(1u, arraySize) * texelSize;
+    }
+
+    //
+    // Builder / Context
+    //
+
+    RenderGraph::Builder::Builder(RenderGraph &graph, uint32_t pass)
+      : m_graph(graph)
+      , m_pass(pass)
+    {}
+
+    void RenderGraph::Builder
+      ::read(ResourceHandle resource)
+    {
+      m_graph.access(m_pass, resource, RenderGraphUsageShaderResource, false);
+    }
+
+    void RenderGraph::Builder
+      ::writeDepthStencil(ResourceHandle resource)
+    {
+      m_graph.access(m_pass, resource, RenderGraphUsageDepthStencil, true);
+    }
+
+    void RenderGraph::Builder
+      ::writeRenderTarget(ResourceHandle resource)
+    {
+      m_graph.access(m_pass, resource, RenderGraphUsageRenderTarget, true);
+    }
+
+    void RenderGraph::Builder
+      ::sideEffect()
+    {
+      m_graph.m_passes[m_pass].sideEffect = true;
+    }
+
+    RenderGraph::Context::Context(RenderGraph const&graph)
+      : m_graph(graph)
+    {}
+
+    RenderGraphTexture const& RenderGraph::Context
+      ::texture(ResourceHandle resource) const
+    {
+      static const RenderGraphTexture none ={};
+
+      if(resource >= m_graph.m_resources.size())
+        return none;
+
+      Resource const&entry = m_graph.m_resources[resource];
+      if(entry.imported)
+        return entry.importedTexture;
+      if(entry.physical < 0)
+        return none;
+
+      return m_graph.m_pool[entry.physical].texture;
+    }
+
+    //
+    // RenderGraph
+    //
+
+    RenderGraph::RenderGraph()
+      : m_allocator(nullptr)
+      , m_releaseAfterFrames(8)
+      , m_frame(0)
+      , m_compiled(false)
+      , m_stats()
+    {}
+
+    RenderGraph::~RenderGraph()
+    {
+      deinitialize();
+    }
+
+    bool RenderGraph
+      ::initialize(RenderGraphAllocator *allocator, uint32_t releaseAfterFrames)
+    {
+      deinitialize();
+
+      m_allocator          = allocator;
+      m_releaseAfterFrames = releaseAfterFrames;
+
+      return (m_allocator != nullptr);
+    }
+
+    bool RenderGraph
+      ::deinitialize()
+    {
+      reset();
+      m_spares.clear();
+
+      if(m_allocator)
+        for(PhysicalTexture &physical : m_pool)
+          m_allocator->release(physical.texture);
+      m_pool.clear();
+
+      m_allocator = nullptr;
+
+      return true;
+    }
+
+    void RenderGraph
+      ::reset()
+    {
+      for(Pass &pass : m_passes) {
+        pass.execute = nullptr;
+        m_spares.push_back(std::move(pass));
+      }
+      m_passes.clear();
+      m_resources.clear();
+      m_schedule.clear();
+      m_error.clear();
+      m_compiled = false;
+      m_stats    = Stats();
+
+      for(PhysicalTexture &physical : m_pool) {
+        physical.usedThisFrame = false;
+        physical.busyUntil     = 0;
+      }
+
+      ++m_frame;
+    }
+
+    RenderGraph::ResourceHandle RenderGraph
+      ::createTexture(std::string const&name, RenderGraphTextureDesc const&desc)
+    {
+      Resource resource ={};
+      resource.name     = name;
+      resource.desc     = desc;
+      resource.imported = false;
+      resource.physical = -1;
+
+      m_resources.push_back(resource);
+      return static_cast<ResourceHandle>(m_resources.size() - 1);
+    }
+
+    RenderGraph::ResourceHandle RenderGraph
+      ::importTexture(std::string const&name, RenderGraphTextureDesc const&desc, RenderGraphTexture const&texture)
+    {
+      ResourceHandle handle = createTexture(name, desc);
+      m_resources[handle].imported        = true;
+      m_resources[handle].importedTexture = texture;
+
+      return handle;
+    }
+
+    void RenderGraph
+      ::addPass(char const *name, SetupFn const&setup, ExecuteFn const&execute)
+    {
+      Pass pass;
+      if(!m_spares.empty()) {
+        pass = std::move(m_spares.back());
+        m_spares.pop_back();
+      }
+
+      pass.name.assign(name ? name : "");
+      pass.accesses.clear();
+      pass.execute    = execute;
+      pass.sideEffect = false;
+      pass.culled     = false;
+      pass.order      = 0;
+      m_passes.push_back(std::move(pass));
+
+      Builder builder(*this, static_cast<uint32_t>(m_passes.size() - 1));
+      if(setup)
+        setup(builder);
+    }
+
+    void RenderGraph
+      ::access(uint32_t pass, ResourceHandle resource, uint32_t usage, bool write)
+    {
+      if(resource >= m_resources.size())
+        return;
+
+      if(write && m_resources[resource].imported)
+        m_passes[pass].sideEffect = true;
+      m_resources[resource].usage |= usage;
+
+      for(Access &existing : m_passes[pass].accesses)
+        if(existing.resource == resource) {
+          existing.usage |= usage;
+          existing.write  = existing.write || write;
+          return;
+        }
+
+      Access entry ={ resource, usage, write };
+      m_passes[pass].accesses.push_back(entry);
+    }
+
+    bool RenderGraph
+      ::compile()
+    {
+      m_compiled = false;
+      m_error.clear();
+
+      cull();
+
+      m_stats              = Stats();
+      m_stats.passes       = static_cast<uint32_t>(m_passes.size());
+      m_stats.passesCulled = static_cast<uint32_t>(std::count_if(m_passes.begin(), m_passes.end(),
+        [] (Pass const&pass) -> bool { return pass.culled; }));
+
+      if(!schedule() || !assignPhysical())
+        return false;
+
+      m_compiled = true;
+      return true;
+    }
+
+    void RenderGraph
+      ::cull()
+    {
+      // Reference counts: a pass is referenced by the resources it writes, a resource by the
+      // passes reading it (without also writing it). Unreferenced resources release their
+      // writers, culled passes release what they read.
+      SAE::Memory::FrameVector<uint32_t> passReferences(m_passes.size(), 0);
+      SAE::Memory::FrameVector<uint32_t> resourceReferences(m_resources.size(), 0);
+
+      for(size_t p=0; p < m_passes.size(); ++p)
+        for(Access const&access : m_passes[p].accesses) {
+          if(access.write)
+            ++passReferences[p];
+          else
+            ++resourceReferences[access.resource];
+        }
+
+      SAE::Memory::FrameVector<ResourceHandle> unreferenced;
+      std::function<void(size_t)>              cullPass
+        = [&] (size_t p) -> void
+      {
+        m_passes[p].culled = true;
+        for(Access const&access : m_passes[p].accesses)
+          if(!access.write && !--resourceReferences[access.resource])
+            unreferenced.push_back(access.resource);
+      };
+
+      for(size_t p=0; p < m_passes.size(); ++p) {
+        m_passes[p].culled = false;
+        if(!m_passes[p].sideEffect && !passReferences[p])
+          cullPass(p);
+      }
+
+      for(size_t r=0; r < m_resources.size(); ++r)
+        if(!resourceReferences[r])
+          unreferenced.push_back(static_cast<ResourceHandle>(r));
+
+      while(!unreferenced.empty()) {
+        ResourceHandle resource = unreferenced.back();
+        unreferenced.pop_back();
+
+        for(size_t p=0; p < m_passes.size(); ++p) {
+          Pass &pass = m_passes[p];
+          if(pass.culled || pass.sideEffect)
+            continue;
+
+          for(Access const&access : pass.accesses)
+            if(access.write && access.resource == resource) {
+              if(!--passReferences[p])
+                cullPass(p);
+              break;
+            }
+        }
+      }
+
+      // Usage, and with it the views a texture needs, only counts passes that survived.
+      for(Resource &resource : m_resources) {
+        resource.culled = true;
+        resource.usage  = 0;
+      }
+      for(Pass const&pass : m_passes)
+        if(!pass.culled)
+          for(Access const&access : pass.accesses) {
+            m_resources[access.resource].culled  = false;
+            m_resources[access.resource].usage  |= access.usage;
+          }
+    }
+
+    bool RenderGraph
+      ::schedule()
+    {
+      size_t const passCount = m_passes.size();
+
+      // Edges: writers of a resource in declaration order, then all of its readers.
+      SAE::Memory::FrameVector<SAE::Memory::FrameVector<uint32_t>> successors(passCount);
+      SAE::Memory::FrameVector<uint32_t>                           predecessorCount(passCount, 0);
+
+      SAE::Memory::FrameVector<uint32_t> writers;
+      SAE::Memory::FrameVector<uint32_t> readers;
+      for(size_t r=0; r < m_resources.size(); ++r) {
+        writers.clear();
+        readers.clear();
+        for(size_t p=0; p < passCount; ++p) {
+          if(m_passes[p].culled)
+            continue;
+          for(Access const&access : m_passes[p].accesses)
+            if(access.resource == r) {
+              (access.write ? writers : readers).push_back(static_cast<uint32_t>(p));
+              break;
+            }
+        }
+
+        for(size_t k=1; k < writers.size(); ++k)
+          successors[writers[k - 1]].push_back(writers[k]);
+        for(uint32_t writer : writers)
+          for(uint32_t reader : readers)
+            successors[writer].push_back(reader);
+      }
+
+      for(SAE::Memory::FrameVector<uint32_t> const&edges : successors)
+        for(uint32_t successor : edges)
+          ++predecessorCount[successor];
+
+      // Kahn's algorithm, ready passes in declaration order.
+      std::priority_queue<uint32_t, SAE::Memory::FrameVector<uint32_t>, std::greater<uint32_t>> ready;
+      size_t alive = 0;
+      for(size_t p=0; p < passCount; ++p)
+        if(!m_passes[p].culled) {
+          ++alive;
+          if(!predecessorCount[p])
+            ready.push(static_cast<uint32_t>(p));
+        }
+
+      m_schedule.clear();
+      while(!ready.empty()) {
+        uint32_t p = ready.top();
+        ready.pop();
+
+        m_passes[p].order = static_cast<uint32_t>(m_schedule.size());
+        m_schedule.push_back(p);
+
+        for(uint32_t successor : successors[p])
+          if(!--predecessorCount[successor])
+            ready.push(successor);
+      }
+
+      if(m_schedule.size() != alive) {
+        m_error = "Dependency cycle between passes.";
+        return false;
+      }
+
+      return true;
+    }
+
+    bool RenderGraph
+      ::assignPhysical()
+    {
+      // Textures unused for a while go back to the backend.
+      for(size_t k=0; k < m_pool.size(); ) {
+        if((m_frame - m_pool[k].lastUsedFrame) > m_releaseAfterFrames) {
+          m_allocator->release(m_pool[k].texture);
+          m_pool.erase(m_pool.begin() + k);
+        }
+        else
+          ++k;
+      }
+
+      SAE::Memory::FrameVector<ResourceHandle> transients;
+      for(size_t r=0; r < m_resources.size(); ++r) {
+        Resource &resource = m_resources[r];
+        resource.firstPass = 0xFFFFFFFF;
+        resource.lastPass  = 0;
+        resource.physical  = -1;
+        if(!resource.culled && !resource.imported)
+          transients.push_back(static_cast<ResourceHandle>(r));
+      }
+
+      for(uint32_t position=0; position < m_schedule.size(); ++position)
+        for(Access const&access : m_passes[m_schedule[position]].accesses) {
+          Resource &resource = m_resources[access.resource];
+          resource.firstPass = std::min(resource.firstPass, position);
+          resource.lastPass  = std::max(resource.lastPass,  position);
+        }
+
+      // Ties by handle, as a stable sort would order them, without its heap buffer.
+      std::sort(transients.begin(), transients.end(),
+        [this] (ResourceHandle a, ResourceHandle b) -> bool
+      {
+        if(m_resources[a].firstPass != m_resources[b].firstPass)
+          return m_resources[a].firstPass < m_resources[b].firstPass;
+        return a < b;
+      });
+
+      for(ResourceHandle handle : transients) {
+        Resource &resource = m_resources[handle];
+
+        int32_t physical = -1;
+        for(size_t k=0; k < m_pool.size(); ++k) {
+          PhysicalTexture const&candidate = m_pool[k];
+          if(candidate.desc == resource.desc
+             && candidate.usage == resource.usage
+             && (!candidate.usedThisFrame || candidate.busyUntil < resource.firstPass)) {
+            physical = static_cast<int32_t>(k);
+            break;
+          }
+        }
+
+        if(physical < 0) {
+          PhysicalTexture created ={};
+          created.desc  = resource.desc;
+          created.usage = resource.usage;
+          if(!m_allocator || !m_allocator->create(resource.desc, resource.usage, created.texture)) {
+            m_error = "Failed to create the physical texture for '" + resource.name + "'.";
+            return false;
+          }
+
+          m_pool.push_back(created);
+          physical = static_cast<int32_t>(m_pool.size() - 1);
+          ++m_stats.physicalTexturesCreated;
+        }
+
+        PhysicalTexture &texture = m_pool[physical];
+        texture.usedThisFrame = true;
+        texture.busyUntil     = resource.lastPass;
+        texture.lastUsedFrame = m_frame;
+        resource.physical     = physical;
+
+        m_stats.transientBytes += resource.desc.byteSize();
+      }
+
+      m_stats.transientResources = static_cast<uint32_t>(transients.size());
+      for(PhysicalTexture const&texture : m_pool)
+        if(texture.usedThisFrame) {
+          ++m_stats.physicalTextures;
+          m_stats.physicalBytes += texture.desc.byteSize();
+        }
+
+      return true;
+    }
+
+    void RenderGraph
+      ::execute()
+    {
+      if(!m_compiled)
+        return;
+
+      Context context(*this);
+      for(uint32_t p : m_schedule)
+        if(m_passes[p].execute)
+          m_passes[p].execute(context);
+    }
+
+    void RenderGraph
+      ::describe(std::ostream &out) const
+    {
+      out << "Render graph, frame " << m_frame << ": "
+          << m_stats.passes << " passes (" << m_stats.passesCulled << " culled), "
+          << m_stats.transientResources << " transient textures on " << m_stats.physicalTextures << " physical, "
+          << (m_stats.transientBytes / 1024) << " KiB -> " << (m_stats.physicalBytes / 1024) << " KiB\n";
+
+      if(!m_error.empty())
+        out << "  error: " << m_error << "\n";
+
+      out << "Schedule:\n";
+      for(uint32_t position=0; position < m_schedule.size(); ++position) {
+        Pass const&pass = m_passes[m_schedule[position]];
+        out << "  " << position << ": " << pass.name << (pass.sideEffect ? " [side effect]" : "");
+        for(Access const&access : pass.accesses) {
+          out << (access.write ? "  w:" : "  r:") << m_resources[access.resource].name << "(";
+          WriteUsage(out, access.usage);
+          out << ")";
+        }
+        out << "\n";
+      }
+
+      for(Pass const&pass : m_passes)
+        if(pass.culled)
+          out << "  culled: " << pass.name << "\n";
+
+      out << "Resources:\n";
+      for(Resource const&resource : m_resources) {
+        out << "  " << resource.name << ": "
+            << resource.desc.width << "x" << resource.desc.height << "x" << resource.desc.arraySize << " "
+            << FormatName(resource.desc.format) << (resource.desc.cube ? " cube " : " ");
+        WriteUsage(out, resource.usage);
+
+        if(!m_compiled)
+          out << "\n";
+        else if(resource.culled)
+          out << ", culled\n";
+        else if(resource.imported)
+          out << ", imported, passes " << resource.firstPass << "-" << resource.lastPass << "\n";
+        else
+          out << ", passes " << resource.firstPass << "-" << resource.lastPass << " -> physical #" << resource.physical << "\n";
+      }
+    }
+
+  }
+}
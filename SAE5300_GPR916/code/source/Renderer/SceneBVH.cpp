@@ -0,0 +1,983 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#include "Renderer/SceneBVH.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+  // SSE2 is part of the x64 baseline and the MSVC x86 default: no dispatch needed.
+  #define SAE_SCENEBVH_X86 1
+  #include <emmintrin.h>
+#else
+  #define SAE_SCENEBVH_X86 0
+#endif
+
+namespace SAE {
+  namespace Rendering {
+
+    namespace {
+
+      typedef SceneBVH::Box   Box;
+      typedef SceneBVH::Plane Plane;
+
+      static const uint32_t MaxBins = 32;
+
+      // Also true for NaN bounds, which no query could report sensibly.
+      static bool IsEmpty(Box const&box)
+      {
+        return !(box.minimum[0] <= box.maximum[0]
+              && box.minimum[1] <= box.maximum[1]
+              && box.minimum[2] <= box.maximum[2]);
+      }
+
+      static Box EmptyBox()
+      {
+        Box const box ={ { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+        return box;
+      }
+
+      static void Grow(Box &box, Box const&other)
+      {
+        for(uint32_t k=0; k < 3; ++k) {
+          box.minimum[k] = std::min(box.minimum[k], other.minimum[k]);
+          box.maximum[k] = std::max(box.maximum[k], other.maximum[k]);
+        }
+      }
+
+      static float Area(Box const&box)
+      {
+        if(IsEmpty(box))
+          return 0.0f;
+
+        float const dx = box.maximum[0] - box.minimum[0];
+        float const dy = box.maximum[1] - box.minimum[1];
+        float const dz = box.maximum[2] - box.minimum[2];
+        return 2.0f * (dx * dy + dy * dz + dz * dx);
+      }
+
+      static bool OutsideFrustum(Box const&box, Plane const*planes, uint32_t planeCount)
+      {
+        for(uint32_t p=0; p < planeCount; ++p) {
+          Plane const&plane = planes[p];
+          float const x = (plane.x >= 0.0f) ? box.maximum[0] : box.minimum[0];
+          float const y = (plane.y >= 0.0f) ? box.maximum[1] : box.minimum[1];
+          float const z = (plane.z >= 0.0f) ? box.maximum[2] : box.minimum[2];
+          if((plane.x * x + plane.y * y + plane.z * z + plane.w) < 0.0f)
+            return true;
+        }
+        return false;
+      }
+
+      static float SquaredDistance(Box const&box, float const center[3])
+      {
+        float distance = 0.0f;
+        for(uint32_t k=0; k < 3; ++k) {
+          float const d = std::max(std::max(box.minimum[k] - center[k], center[k] - box.maximum[k]), 0.0f);
+          distance += d * d;
+        }
+        return distance;
+      }
+
+      static bool EntersBox(Box const&box, float const origin[3], float const inverse[3], float maxDistance, float &outDistance)
+      {
+        float tNear = 0.0f;
+        float tFar  = maxDistance;
+        for(uint32_t k=0; k < 3; ++k) {
+          float const t1 = (box.minimum[k] - origin[k]) * inverse[k];
+          float const t2 = (box.maximum[k] - origin[k]) * inverse[k];
+          tNear = std::max(tNear, std::min(t1, t2));
+          tFar  = std::min(tFar,  std::max(t1, t2));
+        }
+        outDistance = tNear;
+        return (tNear <= tFar);
+      }
+
+      // Large instead of infinite for axis-parallel rays: a slab the origin lies in then spans
+      // [-large, large] and no 0 * infinity makes a NaN.
+      static float InverseDirection(float d)
+      {
+        return (std::fabs(d) > 1e-30f) ? (1.0f / d) : 1e30f;
+      }
+
+    }
+
+    // Four child boxes at a time; bit k of a mask stands for child k. Empty slots have
+    // inverted boxes but are masked by the caller.
+    struct SceneBVHLanes {
+      template <typename TNode>
+      static uint32_t frustum(TNode const&node, Plane const*planes, uint32_t planeCount, uint32_t &outInside)
+      {
+#if SAE_SCENEBVH_X86
+        __m128 const minX = _mm_loadu_ps(node.minX);
+        __m128 const minY = _mm_loadu_ps(node.minY);
+        __m128 const minZ = _mm_loadu_ps(node.minZ);
+        __m128 const maxX = _mm_loadu_ps(node.maxX);
+        __m128 const maxY = _mm_loadu_ps(node.maxY);
+        __m128 const maxZ = _mm_loadu_ps(node.maxZ);
+        __m128 const zero = _mm_setzero_ps();
+
+        uint32_t outside = 0;
+        uint32_t inside  = 0xF;
+        for(uint32_t p=0; p < planeCount; ++p) {
+          Plane const&plane = planes[p];
+          __m128 const nx = _mm_set1_ps(plane.x);
+          __m128 const ny = _mm_set1_ps(plane.y);
+          __m128 const nz = _mm_set1_ps(plane.z);
+          __m128 const nw = _mm_set1_ps(plane.w);
+
+          // The corner furthest along the normal decides outside, the nearest one inside.
+          __m128 const farthest =
+            _mm_add_ps(
+              _mm_add_ps(_mm_mul_ps(nx, (plane.x >= 0.0f) ? maxX : minX), _mm_mul_ps(ny, (plane.y >= 0.0f) ? maxY : minY)),
+              _mm_add_ps(_mm_mul_ps(nz, (plane.z >= 0.0f) ? maxZ : minZ), nw));
+          __m128 const nearest =
+            _mm_add_ps(
+              _mm_add_ps(_mm_mul_ps(nx, (plane.x >= 0.0f) ? minX : maxX), _mm_mul_ps(ny, (plane.y >= 0.0f) ? minY : maxY)),
+              _mm_add_ps(_mm_mul_ps(nz, (plane.z >= 0.0f) ? minZ : maxZ), nw));
+
+          outside |= static_cast<uint32_t>(_mm_movemask_ps(_mm_cmplt_ps(farthest, zero)));
+          inside  &= static_cast<uint32_t>(_mm_movemask_ps(_mm_cmpge_ps(nearest, zero)));
+        }
+#else
+        uint32_t outside = 0;
+        uint32_t inside  = 0xF;
+        for(uint32_t p=0; p < planeCount; ++p) {
+          Plane const&plane = planes[p];
+          for(uint32_t k=0; k < 4; ++k) {
+            float const farthest =
+                plane.x * ((plane.x >= 0.0f) ? node.maxX[k] : node.minX[k])
+              + plane.y * ((plane.y >= 0.0f) ? node.maxY[k] : node.minY[k])
+              + plane.z * ((plane.z >= 0.0f) ? node.maxZ[k] : node.minZ[k])
+              + plane.w;
+            float const nearest =
+                plane.x * ((plane.x >= 0.0f) ? node.minX[k] : node.maxX[k])
+              + plane.y * ((plane.y >= 0.0f) ? node.minY[k] : node.maxY[k])
+              + plane.z * ((plane.z >= 0.0f) ? node.minZ[k] : node.maxZ[k])
+              + plane.w;
+
+            outside |= (farthest < 0.0f)  ? (1u << k) : 0;
+            inside  &= (nearest >= 0.0f) ? ~0u : ~(1u << k);
+          }
+        }
+#endif
+        outInside = inside & ~outside;
+        return (~outside & 0xF);
+      }
+
+      template <typename TNode>
+      static uint32_t sphere(TNode const&node, float const center[3], float radius)
+      {
+#if SAE_SCENEBVH_X86
+        __m128 const zero = _mm_setzero_ps();
+        __m128 const cx   = _mm_set1_ps(center[0]);
+        __m128 const cy   = _mm_set1_ps(center[1]);
+        __m128 const cz   = _mm_set1_ps(center[2]);
+
+        __m128 const dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(node.minX), cx), _mm_sub_ps(cx, _mm_loadu_ps(node.maxX))), zero);
+        __m128 const dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(node.minY), cy), _mm_sub_ps(cy, _mm_loadu_ps(node.maxY))), zero);
+        __m128 const dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(node.minZ), cz), _mm_sub_ps(cz, _mm_loadu_ps(node.maxZ))), zero);
+
+        __m128 const distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(distance, _mm_set1_ps(radius * radius))));
+#else
+        uint32_t mask = 0;
+        for(uint32_t k=0; k < 4; ++k) {
+          Box const box ={ { node.minX[k], node.minY[k], node.minZ[k] }, { node.maxX[k], node.maxY[k], node.maxZ[k] } };
+          mask |= (SquaredDistance(box, center) <= (radius * radius)) ? (1u << k) : 0;
+        }
+        return mask;
+#endif
+      }
+
+      template <typename TNode>
+      static uint32_t ray(TNode const&node, float const origin[3], float const inverse[3], float maxDistance)
+      {
+#if SAE_SCENEBVH_X86
+        __m128 const ox = _mm_set1_ps(origin[0]);
+        __m128 const oy = _mm_set1_ps(origin[1]);
+        __m128 const oz = _mm_set1_ps(origin[2]);
+        __m128 const ix = _mm_set1_ps(inverse[0]);
+        __m128 const iy = _mm_set1_ps(inverse[1]);
+        __m128 const iz = _mm_set1_ps(inverse[2]);
+
+        __m128 const x1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minX), ox), ix);
+        __m128 const x2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maxX), ox), ix);
+        __m128 const y1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minY), oy), iy);
+        __m128 const y2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maxY), oy), iy);
+        __m128 const z1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minZ), oz), iz);
+        __m128 const z2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maxZ), oz), iz);
+
+        __m128 const tNear = _mm_max_ps(_mm_max_ps(_mm_min_ps(x1, x2), _mm_min_ps(y1, y2)), _mm_max_ps(_mm_min_ps(z1, z2), _mm_setzero_ps()));
+        __m128 const tFar  = _mm_min_ps(_mm_min_ps(_mm_max_ps(x1, x2), _mm_max_ps(y1, y2)), _mm_min_ps(_mm_max_ps(z1, z2), _mm_set1_ps(maxDistance)));
+        return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(tNear, tFar)));
+#else
+        uint32_t mask = 0;
+        for(uint32_t k=0; k < 4; ++k) {
+          Box const box ={ { node.minX[k], node.minY[k], node.minZ[k] }, { node.maxX[k], node.maxY[k], node.maxZ[k] } };
+          float distance = 0.0f;
+          mask |= EntersBox(box, origin, inverse, maxDistance, distance) ? (1u << k) : 0;
+        }
+        return mask;
+#endif
+      }
+    };
+
+    SceneBVH::SceneBVH()
+      : m_options()
+      , m_root(InvalidNode)
+      , m_refitPass(0)
+      , m_movedItems(0)
+      , m_buildPending(false)
+      , m_stats()
+    {}
+
+    void SceneBVH
+      ::setOptions(Options const&options)
+    {
+      m_options = options;
+      m_options.maxLeafItems = std::min(std::max(options.maxLeafItems, 1u), 4u);
+      m_options.binCount     = std::min(std::max(options.binCount, 2u), MaxBins);
+    }
+
+    void SceneBVH
+      ::build(Box const*boxes, size_t itemCount)
+    {
+      clear();
+
+      m_itemBoxes.assign(boxes, boxes + itemCount);
+      m_itemSlots.assign(itemCount, uint32_t(InvalidSlot));
+      buildAll();
+    }
+
+    void SceneBVH
+      ::clear()
+    {
+      m_nodes.clear();
+      m_freeNodes.clear();
+      m_root = InvalidNode;
+
+      m_itemBoxes.clear();
+      m_itemSlots.clear();
+      m_leafItems.clear();
+
+      m_dirtyNodes.clear();
+      m_dirtyFlags.clear();
+      m_rebuildNodes.clear();
+      m_movedItems   = 0;
+      m_buildPending = false;
+
+      m_stats = Stats();
+    }
+
+    void SceneBVH
+      ::update(uint32_t item, Box const&box)
+    {
+      if(item >= m_itemBoxes.size())
+        return;
+
+      m_itemBoxes[item] = box;
+      ++m_movedItems;
+
+      // Items entering the tree need a place in it: refit() builds anew.
+      uint32_t const slot = m_itemSlots[item];
+      if(slot == InvalidSlot) {
+        m_buildPending |= !IsEmpty(box);
+        return;
+      }
+
+      uint32_t const node = slot / 4;
+      if(!m_dirtyFlags[node]) {
+        m_dirtyFlags[node] = 1;
+        m_dirtyNodes.push_back(node);
+      }
+    }
+
+    void SceneBVH
+      ::refit()
+    {
+      m_stats.refitItems = m_movedItems;
+      m_stats.rebuilds   = 0;
+      m_movedItems       = 0;
+
+      if(m_buildPending) {
+        buildAll();
+        ++m_stats.fullRebuilds;
+        return;
+      }
+
+      if(m_root == InvalidNode || m_dirtyNodes.empty())
+        return;
+
+      ++m_refitPass;
+      m_rebuildNodes.clear();
+
+      if((m_dirtyNodes.size() * 4) > m_nodes.size()) {
+        // Most of the tree moved: one pass over all of it is cheaper than a path per node.
+        refitNode(m_root);
+        for(uint32_t node : m_dirtyNodes)
+          m_dirtyFlags[node] = 0;
+      }
+      else {
+        for(uint32_t node : m_dirtyNodes) {
+          m_dirtyFlags[node] = 0;
+
+          for(uint32_t slot=0; slot < 4; ++slot) {
+            uint32_t const child = m_nodes[node].child[slot];
+            if(child != InvalidNode && (child & LeafBit))
+              setSlot(node, slot, leafBox(child & ~LeafBit, m_nodes[node].count[slot]));
+          }
+
+          // Up to the first ancestor whose box stays as it was.
+          uint32_t current = node;
+          for(;;) {
+            Box const box = nodeBox(current);
+            checkDegraded(current, box);
+
+            Node     const&entry  = m_nodes[current];
+            uint32_t const parent = entry.parent;
+            if(parent == InvalidNode)
+              break;
+
+            Node     const&up   = m_nodes[parent];
+            uint32_t const slot = entry.parentSlot;
+            if(up.minX[slot] == box.minimum[0] && up.minY[slot] == box.minimum[1] && up.minZ[slot] == box.minimum[2]
+            && up.maxX[slot] == box.maximum[0] && up.maxY[slot] == box.maximum[1] && up.maxZ[slot] == box.maximum[2])
+              break;
+
+            setSlot(parent, slot, box);
+            current = parent;
+          }
+        }
+      }
+      m_dirtyNodes.clear();
+
+      // Only the topmost degraded node of a path is rebuilt, which covers those below it; the
+      // remaining subtrees are disjoint, so rebuilding one leaves the others' nodes alone.
+      size_t roots = 0;
+      for(uint32_t node : m_rebuildNodes) {
+        bool covered = false;
+        for(uint32_t parent = m_nodes[node].parent; parent != InvalidNode && !covered; parent = m_nodes[parent].parent)
+          covered = (m_nodes[parent].rebuildMark == m_refitPass);
+
+        if(!covered)
+          m_rebuildNodes[roots++] = node;
+      }
+      m_rebuildNodes.resize(roots);
+
+      for(uint32_t node : m_rebuildNodes) {
+        if(node == m_root)
+          ++m_stats.fullRebuilds;
+        rebuildSubtree(node);
+        ++m_stats.rebuilds;
+      }
+      m_rebuildNodes.clear();
+    }
+
+    size_t SceneBVH
+      ::queryFrustum(Plane const*planes, uint32_t planeCount, uint32_t *outItems) const
+    {
+      if(m_root == InvalidNode)
+        return 0;
+
+      planeCount = std::min(planeCount, 6u);
+
+      size_t   found = 0;
+      uint32_t stack[StackSize];
+      uint32_t top = 0;
+      stack[top++] = m_root;
+
+      while(top) {
+        Node const&node = m_nodes[stack[--top]];
+
+        uint32_t inside = 0;
+        uint32_t hit    = SceneBVHLanes::frustum(node, planes, planeCount, inside);
+        for(uint32_t slot=0; slot < 4; ++slot) {
+          uint32_t const child = node.child[slot];
+          if(child == InvalidNode || !(hit & (1u << slot)))
+            continue;
+
+          // Entirely inside: everything below is reported without further tests.
+          if(inside & (1u << slot)) {
+            if(child & LeafBit)
+              found += emitItems(child & ~LeafBit, (child & ~LeafBit) + node.count[slot], outItems + found);
+            else
+              found += emitItems(m_nodes[child].begin, m_nodes[child].end, outItems + found);
+            continue;
+          }
+
+          if(child & LeafBit) {
+            uint32_t const first = child & ~LeafBit;
+            for(uint32_t k=first; k < (first + node.count[slot]); ++k) {
+              uint32_t const item = m_leafItems[k];
+              if(!IsEmpty(m_itemBoxes[item]) && !OutsideFrustum(m_itemBoxes[item], planes, planeCount))
+                outItems[found++] = item;
+            }
+          }
+          else {
+            stack[top++] = child;
+          }
+        }
+      }
+
+      return found;
+    }
+
+    size_t SceneBVH
+      ::querySphere(float const center[3], float radius, uint32_t *outItems) const
+    {
+      if(m_root == InvalidNode)
+        return 0;
+
+      size_t   found = 0;
+      uint32_t stack[StackSize];
+      uint32_t top = 0;
+      stack[top++] = m_root;
+
+      while(top) {
+        Node const&node = m_nodes[stack[--top]];
+
+        uint32_t const hit = SceneBVHLanes::sphere(node, center, radius);
+        for(uint32_t slot=0; slot < 4; ++slot) {
+          uint32_t const child = node.child[slot];
+          if(child == InvalidNode || !(hit & (1u << slot)))
+            continue;
+
+          if(child & LeafBit) {
+            uint32_t const first = child & ~LeafBit;
+            for(uint32_t k=first; k < (first + node.count[slot]); ++k) {
+              uint32_t const item = m_leafItems[k];
+              if(!IsEmpty(m_itemBoxes[item]) && SquaredDistance(m_itemBoxes[item], center) <= (radius * radius))
+                outItems[found++] = item;
+            }
+          }
+          else {
+            stack[top++] = child;
+          }
+        }
+      }
+
+      return found;
+    }
+
+    size_t SceneBVH
+      ::queryRay(
+        float const  origin[3],
+        float const  direction[3],
+        float        maxDistance,
+        uint32_t    *outItems,
+        float       *outDistances) const
+    {
+      if(m_root == InvalidNode)
+        return 0;
+
+      float const inverse[3] ={ InverseDirection(direction[0]), InverseDirection(direction[1]), InverseDirection(direction[2]) };
+
+      size_t   found = 0;
+      uint32_t stack[StackSize];
+      uint32_t top = 0;
+      stack[top++] = m_root;
+
+      while(top) {
+        Node const&node = m_nodes[stack[--top]];
+
+        uint32_t const hit = SceneBVHLanes::ray(node, origin, inverse, maxDistance);
+        for(uint32_t slot=0; slot < 4; ++slot) {
+          uint32_t const child = node.child[slot];
+          if(child == InvalidNode || !(hit & (1u << slot)))
+            continue;
+
+          if(child & LeafBit) {
+            uint32_t const first = child & ~LeafBit;
+            for(uint32_t k=first; k < (first + node.count[slot]); ++k) {
+              uint32_t const item     = m_leafItems[k];
+              float          distance = 0.0f;
+              if(IsEmpty(m_itemBoxes[item]) || !EntersBox(m_itemBoxes[item], origin, inverse, maxDistance, distance))
+                continue;
+
+              if(outDistances)
+                outDistances[found] = distance;
+              outItems[found++] = item;
+            }
+          }
+          else {
+            stack[top++] = child;
+          }
+        }
+      }
+
+      return found;
+    }
+
+    bool SceneBVH
+      ::overlapsSphere(float const center[3], float radius) const
+    {
+      if(m_root == InvalidNode)
+        return false;
+
+      uint32_t stack[StackSize];
+      uint32_t top = 0;
+      stack[top++] = m_root;
+
+      while(top) {
+        Node const&node = m_nodes[stack[--top]];
+
+        uint32_t const hit = SceneBVHLanes::sphere(node, center, radius);
+        for(uint32_t slot=0; slot < 4; ++slot) {
+          uint32_t const child = node.child[slot];
+          if(child == InvalidNode || !(hit & (1u << slot)))
+            continue;
+
+          if(child & LeafBit) {
+            uint32_t const first = child & ~LeafBit;
+            for(uint32_t k=first; k < (first + node.count[slot]); ++k) {
+              Box const&box = m_itemBoxes[m_leafItems[k]];
+              if(!IsEmpty(box) && SquaredDistance(box, center) <= (radius * radius))
+                return true;
+            }
+          }
+          else {
+            stack[top++] = child;
+          }
+        }
+      }
+
+      return false;
+    }
+
+    uint32_t SceneBVH
+      ::FrustumPlanes(float const *viewProjection, bool clipNear, Plane outPlanes[6])
+    {
+      // Column c of the matrix maps a point to clip coordinate c.
+      auto column = [viewProjection] (uint32_t c, float sign, Plane const&base) -> Plane
+      {
+        Plane const plane ={
+          base.x + sign * viewProjection[c],
+          base.y + sign * viewProjection[4 + c],
+          base.z + sign * viewProjection[8 + c],
+          base.w + sign * viewProjection[12 + c]
+        };
+        return plane;
+      };
+
+      Plane const zero ={ 0.0f, 0.0f, 0.0f, 0.0f };
+      Plane const w    = column(3, 1.0f, zero);
+
+      uint32_t count = 0;
+      outPlanes[count++] = column(0,  1.0f, w);  // -w <= x
+      outPlanes[count++] = column(0, -1.0f, w);  //  x <= w
+      outPlanes[count++] = column(1,  1.0f, w);  // -w <= y
+      outPlanes[count++] = column(1, -1.0f, w);  //  y <= w
+      outPlanes[count++] = column(2, -1.0f, w);  //  z <= w
+      if(clipNear)
+        outPlanes[count++] = column(2, 1.0f, zero);  // 0 <= z
+
+      for(uint32_t p=0; p < count; ++p) {
+        Plane &plane = outPlanes[p];
+        float const length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+        if(length > 0.0f) {
+          plane.x /= length;
+          plane.y /= length;
+          plane.z /= length;
+          plane.w /= length;
+        }
+      }
+
+      return count;
+    }
+
+    uint32_t SceneBVH
+      ::allocateNode()
+    {
+      uint32_t node = 0;
+      if(!m_freeNodes.empty()) {
+        node = m_freeNodes.back();
+        m_freeNodes.pop_back();
+      }
+      else {
+        node = static_cast<uint32_t>(m_nodes.size());
+        m_nodes.push_back(Node());
+        m_dirtyFlags.push_back(0);
+      }
+
+      Node &entry = m_nodes[node];
+      for(uint32_t slot=0; slot < 4; ++slot) {
+        entry.child[slot] = InvalidNode;
+        entry.count[slot] = 0;
+      }
+      entry.begin       = 0;
+      entry.end         = 0;
+      entry.parent      = InvalidNode;
+      entry.parentSlot  = 0;
+      entry.builtArea   = 0.0f;
+      entry.rebuildMark = 0;
+
+      Box const empty = EmptyBox();
+      for(uint32_t slot=0; slot < 4; ++slot)
+        setSlot(node, slot, empty);
+
+      return node;
+    }
+
+    void SceneBVH
+      ::releaseSubtree(uint32_t node)
+    {
+      for(uint32_t slot=0; slot < 4; ++slot) {
+        uint32_t const child = m_nodes[node].child[slot];
+        if(child != InvalidNode && !(child & LeafBit))
+          releaseSubtree(child);
+      }
+
+      m_dirtyFlags[node] = 0;
+      m_freeNodes.push_back(node);
+    }
+
+    void SceneBVH
+      ::buildAll()
+    {
+      m_nodes.clear();
+      m_freeNodes.clear();
+      m_dirtyNodes.clear();
+      m_dirtyFlags.clear();
+      m_root = InvalidNode;
+
+      m_leafItems.clear();
+      m_itemSlots.assign(m_itemSlots.size(), uint32_t(InvalidSlot));
+
+      m_centroids.resize(3 * m_itemBoxes.size());
+      for(uint32_t item=0; item < m_itemBoxes.size(); ++item) {
+        Box const&box = m_itemBoxes[item];
+        if(IsEmpty(box))
+          continue;
+
+        for(uint32_t k=0; k < 3; ++k)
+          m_centroids[3 * item + k] = 0.5f * (box.minimum[k] + box.maximum[k]);
+        m_leafItems.push_back(item);
+      }
+
+      m_stats.items = static_cast<uint32_t>(m_leafItems.size());
+      m_stats.depth = 0;
+      if(!m_leafItems.empty())
+        m_root = buildNode(0, static_cast<uint32_t>(m_leafItems.size()), InvalidNode, 0, 1);
+
+      m_stats.nodes  = static_cast<uint32_t>(m_nodes.size());
+      m_buildPending = false;
+    }
+
+    /**********************************************************************************************//**
+     * \fn  uint32_t SceneBVH ::buildNode(uint32_t begin, uint32_t end, uint32_t parent, uint32_t parentSlot, uint32_t depth)
+     *
+     * \brief Builds the subtree over the items m_leafItems[begin, end), reordering them.
+     *
+     * The range is split in two, then the largest part that does not fit a leaf again, until
+     * the node has four children or every part fits a leaf. Parts that do not fit become
+     * nodes of their own. Centroids of the items must be current.
+     *
+     * \return  The node.
+     **************************************************************************************************/
+    uint32_t SceneBVH
+      ::buildNode(
+        uint32_t begin,
+        uint32_t end,
+        uint32_t parent,
+        uint32_t parentSlot,
+        uint32_t depth)
+    {
+      uint32_t const node = allocateNode();
+      m_nodes[node].begin      = begin;
+      m_nodes[node].end        = end;
+      m_nodes[node].parent     = parent;
+      m_nodes[node].parentSlot = parentSlot;
+      m_stats.depth = std::max(m_stats.depth, depth);
+
+      uint32_t ranges[4][2] ={ { begin, end } };
+      float    areas[4]     ={ Area(leafBox(begin, end - begin)) };
+      uint32_t rangeCount   = 1;
+      while(rangeCount < 4) {
+        int32_t split = -1;
+        for(uint32_t r=0; r < rangeCount; ++r)
+          if((ranges[r][1] - ranges[r][0]) > m_options.maxLeafItems && (split < 0 || areas[r] > areas[split]))
+            split = static_cast<int32_t>(r);
+        if(split < 0)
+          break;
+
+        uint32_t const mid = splitRange(ranges[split][0], ranges[split][1], depth > MaxSAHDepth);
+        ranges[rangeCount][0] = mid;
+        ranges[rangeCount][1] = ranges[split][1];
+        ranges[split][1]      = mid;
+        areas[split]          = Area(leafBox(ranges[split][0], mid - ranges[split][0]));
+        areas[rangeCount]     = Area(leafBox(mid, ranges[rangeCount][1] - mid));
+        ++rangeCount;
+      }
+
+      for(uint32_t r=0; r < rangeCount; ++r) {
+        uint32_t const first = ranges[r][0];
+        uint32_t const count = ranges[r][1] - first;
+
+        if(count <= m_options.maxLeafItems) {
+          m_nodes[node].child[r] = (LeafBit | first);
+          m_nodes[node].count[r] = count;
+          for(uint32_t k=first; k < (first + count); ++k)
+            m_itemSlots[m_leafItems[k]] = (node * 4 + r);
+
+          setSlot(node, r, leafBox(first, count));
+        }
+        else {
+          uint32_t const child = buildNode(first, first + count, node, r, depth + 1);
+          m_nodes[node].child[r] = child;
+          m_nodes[node].count[r] = 0;
+
+          setSlot(node, r, nodeBox(child));
+        }
+      }
+
+      m_nodes[node].builtArea = Area(nodeBox(node));
+      return node;
+    }
+
+    /**********************************************************************************************//**
+     * \fn  uint32_t SceneBVH ::splitRange(uint32_t begin, uint32_t end, bool median)
+     *
+     * \brief Partitions m_leafItems[begin, end) in two, at the cheapest bin boundary by SAH.
+     *
+     * Centroids are binned along every axis; the boundary minimising left area * left count +
+     * right area * right count wins. Without a boundary leaving items on both sides, or when
+     * median is set, the items are split in halves along the axis of largest centroid extent.
+     *
+     * \return  The first item of the right part, in (begin, end).
+     **************************************************************************************************/
+    uint32_t SceneBVH
+      ::splitRange(uint32_t begin, uint32_t end, bool median)
+    {
+      float centroidMin[3] ={ FLT_MAX, FLT_MAX, FLT_MAX };
+      float centroidMax[3] ={ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+      for(uint32_t k=begin; k < end; ++k)
+        for(uint32_t a=0; a < 3; ++a) {
+          float const c = m_centroids[3 * m_leafItems[k] + a];
+          centroidMin[a] = std::min(centroidMin[a], c);
+          centroidMax[a] = std::max(centroidMax[a], c);
+        }
+
+      uint32_t const bins = m_options.binCount;
+      auto binOf = [&] (uint32_t item, uint32_t axis, float scale) -> uint32_t
+      {
+        uint32_t const bin = static_cast<uint32_t>((m_centroids[3 * item + axis] - centroidMin[axis]) * scale);
+        return (bin < bins) ? bin : (bins - 1);
+      };
+
+      if(!median) {
+        float    bestCost  = FLT_MAX;
+        int32_t  bestAxis  = -1;
+        uint32_t bestBin   = 0;
+        float    bestScale = 0.0f;
+
+        for(uint32_t axis=0; axis < 3; ++axis) {
+          float const extent = centroidMax[axis] - centroidMin[axis];
+          if(!(extent > 0.0f))
+            continue;
+
+          float const scale = bins / extent;
+
+          Box      binBoxes[MaxBins];
+          uint32_t binCounts[MaxBins];
+          for(uint32_t b=0; b < bins; ++b) {
+            binBoxes[b]  = EmptyBox();
+            binCounts[b] = 0;
+          }
+
+          for(uint32_t k=begin; k < end; ++k) {
+            uint32_t const item = m_leafItems[k];
+            uint32_t const bin  = binOf(item, axis, scale);
+            Grow(binBoxes[bin], m_itemBoxes[item]);
+            ++binCounts[bin];
+          }
+
+          // Right of boundary b: bins b to bins - 1.
+          float    rightAreas[MaxBins];
+          uint32_t rightCounts[MaxBins];
+          Box      accumulated = EmptyBox();
+          uint32_t count       = 0;
+          for(uint32_t b=(bins - 1); b > 0; --b) {
+            Grow(accumulated, binBoxes[b]);
+            count += binCounts[b];
+            rightAreas[b]  = Area(accumulated);
+            rightCounts[b] = count;
+          }
+
+          accumulated = EmptyBox();
+          count       = 0;
+          for(uint32_t b=0; (b + 1) < bins; ++b) {
+            Grow(accumulated, binBoxes[b]);
+            count += binCounts[b];
+            if(!count || !rightCounts[b + 1])
+              continue;
+
+            float const cost = Area(accumulated) * count + rightAreas[b + 1] * rightCounts[b + 1];
+            if(cost < bestCost) {
+              bestCost  = cost;
+              bestAxis  = static_cast<int32_t>(axis);
+              bestBin   = b;
+              bestScale = scale;
+            }
+          }
+        }
+
+        if(bestAxis >= 0) {
+          uint32_t const axis = static_cast<uint32_t>(bestAxis);
+          uint32_t *const middle = std::partition(
+            m_leafItems.data() + begin,
+            m_leafItems.data() + end,
+            [&] (uint32_t item) -> bool { return binOf(item, axis, bestScale) <= bestBin; });
+
+          uint32_t const mid = static_cast<uint32_t>(middle - m_leafItems.data());
+          if(mid > begin && mid < end)
+            return mid;
+        }
+      }
+
+      uint32_t axis = 0;
+      for(uint32_t a=1; a < 3; ++a)
+        if((centroidMax[a] - centroidMin[a]) > (centroidMax[axis] - centroidMin[axis]))
+          axis = a;
+
+      uint32_t const mid = begin + (end - begin) / 2;
+      std::nth_element(
+        m_leafItems.data() + begin,
+        m_leafItems.data() + mid,
+        m_leafItems.data() + end,
+        [&] (uint32_t lhs, uint32_t rhs) -> bool
+      {
+        float const l = m_centroids[3 * lhs + axis];
+        float const r = m_centroids[3 * rhs + axis];
+        return (l != r) ? (l < r) : (lhs < rhs);
+      });
+
+      return mid;
+    }
+
+    void SceneBVH
+      ::rebuildSubtree(uint32_t node)
+    {
+      uint32_t const begin      = m_nodes[node].begin;
+      uint32_t const end        = m_nodes[node].end;
+      uint32_t const parent     = m_nodes[node].parent;
+      uint32_t const parentSlot = m_nodes[node].parentSlot;
+      uint32_t const depth      = nodeDepth(node);
+
+      for(uint32_t k=begin; k < end; ++k) {
+        uint32_t const item = m_leafItems[k];
+        Box      const&box  = m_itemBoxes[item];
+        for(uint32_t a=0; a < 3; ++a)
+          m_centroids[3 * item + a] = 0.5f * (box.minimum[a] + box.maximum[a]);
+      }
+
+      releaseSubtree(node);
+      uint32_t const rebuilt = buildNode(begin, end, parent, parentSlot, depth);
+
+      if(parent == InvalidNode) {
+        m_root = rebuilt;
+      }
+      else {
+        m_nodes[parent].child[parentSlot] = rebuilt;
+        setSlot(parent, parentSlot, nodeBox(rebuilt));
+      }
+
+      m_stats.nodes = static_cast<uint32_t>(m_nodes.size() - m_freeNodes.size());
+    }
+
+    SceneBVH::Box SceneBVH
+      ::nodeBox(uint32_t node) const
+    {
+      Node const&entry = m_nodes[node];
+
+      Box box = EmptyBox();
+      for(uint32_t slot=0; slot < 4; ++slot) {
+        if(entry.child[slot] == InvalidNode)
+          continue;
+
+        Box const child ={
+          { entry.minX[slot], entry.minY[slot], entry.minZ[slot] },
+          { entry.maxX[slot], entry.maxY[slot], entry.maxZ[slot] }
+        };
+        Grow(box, child);
+      }
+      return box;
+    }
+
+    // Items whose box became empty while in the tree do not widen it.
+    SceneBVH::Box SceneBVH
+      ::leafBox(uint32_t first, uint32_t count) const
+    {
+      Box box = EmptyBox();
+      for(uint32_t k=first; k < (first + count); ++k)
+        if(!IsEmpty(m_itemBoxes[m_leafItems[k]]))
+          Grow(box, m_itemBoxes[m_leafItems[k]]);
+      return box;
+    }
+
+    void SceneBVH
+      ::setSlot(uint32_t node, uint32_t slot, Box const&box)
+    {
+      Node &entry = m_nodes[node];
+      entry.minX[slot] = box.minimum[0];
+      entry.minY[slot] = box.minimum[1];
+      entry.minZ[slot] = box.minimum[2];
+      entry.maxX[slot] = box.maximum[0];
+      entry.maxY[slot] = box.maximum[1];
+      entry.maxZ[slot] = box.maximum[2];
+    }
+
+    SceneBVH::Box SceneBVH
+      ::refitNode(uint32_t node)
+    {
+      for(uint32_t slot=0; slot < 4; ++slot) {
+        uint32_t const child = m_nodes[node].child[slot];
+        if(child == InvalidNode)
+          continue;
+
+        if(child & LeafBit)
+          setSlot(node, slot, leafBox(child & ~LeafBit, m_nodes[node].count[slot]));
+        else
+          setSlot(node, slot, refitNode(child));
+      }
+
+      Box const box = nodeBox(node);
+      checkDegraded(node, box);
+      return box;
+    }
+
+    void SceneBVH
+      ::checkDegraded(uint32_t node, Box const&box)
+    {
+      Node &entry = m_nodes[node];
+      if(entry.rebuildMark == m_refitPass)
+        return;
+
+      // Points and segments have no area; a minimum keeps them from rebuilding on every move.
+      if(Area(box) > m_options.rebuildAreaRatio * std::max(entry.builtArea, 1e-6f)) {
+        entry.rebuildMark = m_refitPass;
+        m_rebuildNodes.push_back(node);
+      }
+    }
+
+    uint32_t SceneBVH
+      ::nodeDepth(uint32_t node) const
+    {
+      uint32_t depth = 0;
+      for(; node != InvalidNode; node = m_nodes[node].parent)
+        ++depth;
+      return depth;
+    }
+
+    size_t SceneBVH
+      ::emitItems(uint32_t begin, uint32_t end, uint32_t *outItems) const
+    {
+      size_t found = 0;
+      for(uint32_t k=begin; k < end; ++k)
+        if(!IsEmpty(m_itemBoxes[m_leafItems[k]]))
+          outItems[found++] = m_leafItems[k];
+      return found;
+    }
+
+  }
+}
@@ -0,0 +1,334 @@
+#include <algorithm>
+
+#include "Renderer/ShadowAtlas.h"
+
+namespace SAE {
+  namespace Rendering {
+
+    static bool IsPowerOfTwo(uint32_t value)
+    {
+      return value && !(value & (value - 1));
+    }
+
+    ShadowAtlas::ShadowAtlas()
+      : m_atlasSize(0)
+      , m_minTileSize(0)
+      , m_maxTileSize(0)
+      , m_shrinkDelayFrames(0)
+      , m_stats()
+    {}
+
+    bool ShadowAtlas
+      ::initialize(
+        uint32_t atlasSize,
+        uint32_t minTileSize,
+        uint32_t maxTileSize,
+        uint32_t shrinkDelayFrames)
+    {
+      deinitialize();
+
+      if(!IsPowerOfTwo(atlasSize) || !IsPowerOfTwo(minTileSize) || !IsPowerOfTwo(maxTileSize)
+         || minTileSize > maxTileSize || maxTileSize > atlasSize)
+        return false;
+
+      m_atlasSize         = atlasSize;
+      m_minTileSize       = minTileSize;
+      m_maxTileSize       = maxTileSize;
+      m_shrinkDelayFrames = shrinkDelayFrames;
+
+      clearCells();
+
+      return true;
+    }
+
+    void ShadowAtlas
+      ::deinitialize()
+    {
+      m_atlasSize = 0;
+      m_freeCells.clear();
+      m_entries.clear();
+      m_stats = Stats();
+    }
+
+    uint32_t ShadowAtlas
+      ::tileSize(float importance) const
+    {
+      if(!(importance > 0.0f) || !m_atlasSize)
+        return 0;
+
+      float const texels = std::min(importance, 1.0f) * m_maxTileSize;
+
+      uint32_t size = m_maxTileSize;
+      while(size > m_minTileSize && size > texels)
+        size /= 2;
+
+      return size;
+    }
+
+    ShadowAtlasTile ShadowAtlas
+      ::tile(uint64_t key) const
+    {
+      std::map<uint64_t, Entry>::const_iterator it = m_entries.find(key);
+      if(it == m_entries.end())
+        return ShadowAtlasTile();
+
+      return it->second.tile;
+    }
+
+    void ShadowAtlas
+      ::update(SAE::Memory::FrameVector<Request> const&requests)
+    {
+      if(!m_atlasSize)
+        return;
+
+      uint32_t const repacks = m_stats.repacks;
+      m_stats         = Stats();
+      m_stats.repacks = repacks;
+
+      for(std::pair<uint64_t const, Entry> &entry : m_entries)
+        entry.second.requested = false;
+
+      for(Request const&request : requests) {
+        uint32_t size = tileSize(request.importance);
+        if(!size)
+          continue;
+
+        std::map<uint64_t, Entry>::iterator it = m_entries.find(request.key);
+        if(it == m_entries.end()) {
+          Entry entry ={};
+          entry.key = request.key;
+          it = m_entries.insert(std::make_pair(request.key, entry)).first;
+        }
+
+        Entry &entry = it->second;
+        entry.requested  = true;
+        entry.importance = request.importance;
+
+        // Shrink late: importance hovering around a size boundary must not move the tile each frame.
+        if(entry.tile.size && size < entry.tile.size) {
+          if(++entry.shrinkFrames < m_shrinkDelayFrames)
+            size = entry.tile.size;
+          else
+            entry.shrinkFrames = 0;
+        }
+        else {
+          entry.shrinkFrames = 0;
+        }
+
+        entry.targetSize = size;
+      }
+
+      SAE::Memory::FrameVector<Entry*>          order;
+      SAE::Memory::FrameVector<ShadowAtlasTile> previous;
+      for(std::map<uint64_t, Entry>::iterator it = m_entries.begin(); it != m_entries.end(); ) {
+        if(!it->second.requested) {
+          if(it->second.tile.size)
+            freeCell({ it->second.tile.x, it->second.tile.y }, it->second.tile.size);
+          it = m_entries.erase(it);
+          continue;
+        }
+
+        order.push_back(&it->second);
+        ++it;
+      }
+
+      // Fit the budget: halve the least important tiles first, then drop them. Ties in key order;
+      // unlike std::stable_sort, std::sort needs no temporary buffer from the heap.
+      std::sort(order.begin(), order.end(), [] (Entry const*lhs, Entry const*rhs) -> bool
+      {
+        if(lhs->importance != rhs->importance)
+          return lhs->importance < rhs->importance;
+        return lhs->key < rhs->key;
+      });
+
+      uint64_t const atlasArea = uint64_t(m_atlasSize) * m_atlasSize;
+      uint64_t       area      = 0;
+      for(Entry const*entry : order)
+        area += uint64_t(entry->targetSize) * entry->targetSize;
+
+      while(area > atlasArea) {
+        bool halved = false;
+        for(Entry *entry : order) {
+          if(area <= atlasArea)
+            break;
+          if(entry->targetSize <= m_minTileSize)
+            continue;
+
+          area -= (uint64_t(entry->targetSize) * entry->targetSize * 3) / 4;
+          entry->targetSize /= 2;
+          halved = true;
+        }
+
+        if(halved)
+          continue;
+
+        for(Entry *entry : order)
+          if(entry->targetSize) {
+            area -= uint64_t(entry->targetSize) * entry->targetSize;
+            entry->targetSize = 0;
+            ++m_stats.tilesDropped;
+            break;
+          }
+      }
+
+      previous.reserve(order.size());
+      for(Entry *entry : order) {
+        previous.push_back(entry->tile);
+
+        if(entry->tile.size && entry->tile.size != entry->targetSize) {
+          freeCell({ entry->tile.x, entry->tile.y }, entry->tile.size);
+          entry->tile = ShadowAtlasTile();
+        }
+      }
+
+      // Largest first; identical sizes by importance, so ties place deterministically.
+      SAE::Memory::FrameVector<size_t> placement(order.size());
+      for(size_t k=0; k < placement.size(); ++k)
+        placement[k] = k;
+      std::sort(placement.begin(), placement.end(), [&] (size_t lhs, size_t rhs) -> bool
+      {
+        if(order[lhs]->targetSize != order[rhs]->targetSize)
+          return order[lhs]->targetSize > order[rhs]->targetSize;
+        if(order[lhs]->importance != order[rhs]->importance)
+          return order[lhs]->importance > order[rhs]->importance;
+        return lhs < rhs;
+      });
+
+      bool fragmented = false;
+      for(size_t k : placement) {
+        Entry &entry = *order[k];
+        if(!entry.targetSize || entry.tile.size)
+          continue;
+
+        Cell cell;
+        if(!allocateCell(entry.targetSize, cell)) {
+          fragmented = true;
+          break;
+        }
+
+        entry.tile.x    = cell.x;
+        entry.tile.y    = cell.y;
+        entry.tile.size = entry.targetSize;
+      }
+
+      if(fragmented) {
+        ++m_stats.repacks;
+        clearCells();
+
+        for(size_t k : placement) {
+          Entry &entry = *order[k];
+          entry.tile = ShadowAtlasTile();
+          if(!entry.targetSize)
+            continue;
+
+          Cell cell;
+          if(!allocateCell(entry.targetSize, cell))
+            continue; // Cannot happen: the sizes sum up to at most the atlas area.
+
+          entry.tile.x    = cell.x;
+          entry.tile.y    = cell.y;
+          entry.tile.size = entry.targetSize;
+        }
+      }
+
+      for(size_t k=0; k < order.size(); ++k) {
+        ShadowAtlasTile const&tile = order[k]->tile;
+        if(!tile.size)
+          continue;
+
+        ++m_stats.tiles;
+        m_stats.texelsUsed += uint64_t(tile.size) * tile.size;
+
+        if(tile.x == previous[k].x && tile.y == previous[k].y && tile.size == previous[k].size)
+          ++m_stats.tilesReused;
+        else
+          ++m_stats.tilesAllocated;
+      }
+    }
+
+    //
+    // Quadtree cells
+    //
+
+    uint32_t ShadowAtlas
+      ::levelOf(uint32_t size) const
+    {
+      uint32_t level = 0;
+      for(uint32_t cellSize = m_atlasSize; cellSize > size; cellSize /= 2)
+        ++level;
+
+      return level;
+    }
+
+    void ShadowAtlas
+      ::clearCells()
+    {
+      m_freeCells.assign(levelOf(m_minTileSize) + 1, std::vector<Cell>());
+      m_freeCells[0].push_back({ 0, 0 });
+    }
+
+    bool ShadowAtlas
+      ::allocateCell(uint32_t size, Cell &outCell)
+    {
+      uint32_t const level = levelOf(size);
+
+      // Smallest free cell that is large enough.
+      int32_t source = static_cast<int32_t>(level);
+      while(source >= 0 && m_freeCells[source].empty())
+        --source;
+      if(source < 0)
+        return false;
+
+      Cell cell = m_freeCells[source].back();
+      m_freeCells[source].pop_back();
+
+      // Split down to the requested size, keeping the top left quadrant.
+      for(uint32_t split = static_cast<uint32_t>(source) + 1; split <= level; ++split) {
+        uint32_t const half = (m_atlasSize >> split);
+
+        m_freeCells[split].push_back({ cell.x + half, cell.y        });
+        m_freeCells[split].push_back({ cell.x,        cell.y + half });
+        m_freeCells[split].push_back({ cell.x + half, cell.y + half });
+      }
+
+      outCell = cell;
+      return true;
+    }
+
+    void ShadowAtlas
+      ::freeCell(Cell cell, uint32_t size)
+    {
+      uint32_t level = levelOf(size);
+
+      // Merge with the three siblings while they are all free.
+      while(level > 0) {
+        uint32_t const cellSize   = (m_atlasSize >> level);
+        uint32_t const parentMask = ~((cellSize * 2) - 1);
+        Cell     const parent     ={ cell.x & parentMask, cell.y & parentMask };
+
+        std::vector<Cell> &cells = m_freeCells[level];
+
+        size_t siblings[3];
+        size_t found = 0;
+        for(size_t k=0; k < cells.size() && found < 3; ++k)
+          if((cells[k].x & parentMask) == parent.x && (cells[k].y & parentMask) == parent.y)
+            siblings[found++] = k;
+
+        if(found < 3)
+          break;
+
+        // Descending, so the indices stay valid.
+        for(size_t k=3; k > 0; --k) {
+          cells[siblings[k - 1]] = cells.back();
+          cells.pop_back();
+        }
+
+        cell = parent;
+        --level;
+      }
+
+      m_freeCells[level].push_back(cell);
+    }
+
+  }
+}
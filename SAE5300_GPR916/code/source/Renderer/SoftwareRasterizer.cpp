@@ -0,0 +1,496 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+  #define SAE_RASTERIZER_SSE2 1
+  #include <emmintrin.h>
+#else
+  #define SAE_RASTERIZER_SSE2 0
+#endif
+
+#include "Renderer/SoftwareRasterizer.h"
+
+namespace SAE {
+  namespace Rendering {
+
+    typedef std::chrono::high_resolution_clock RasterClock;
+
+    static double MillisecondsSince(RasterClock::time_point start)
+    {
+      return std::chrono::duration<double, std::milli>(RasterClock::now() - start).count();
+    }
+
+    SoftwareRasterizer::SoftwareRasterizer()
+      : m_target()
+      , m_tilesX(0)
+      , m_tilesY(0)
+      , m_triangleCount(0)
+      , m_stats()
+    {}
+
+    SoftwareRasterizer::~SoftwareRasterizer()
+    {
+      deinitialize();
+    }
+
+    bool SoftwareRasterizer
+      ::initialize(Options const&options)
+    {
+      deinitialize();
+
+      if(!options.tileSize || (options.tileSize % 4) != 0)
+        return false;
+
+      m_options = options;
+
+      unsigned int threads = options.threadCount;
+      if(!threads)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+      // Setup works on a few ranges per thread so uneven triangle costs even out.
+      m_bins.resize(threads * 4);
+
+      return m_pool.initialize(threads);
+    }
+
+    bool SoftwareRasterizer
+      ::deinitialize()
+    {
+      m_pool.deinitialize();
+      m_bins.clear();
+
+      return true;
+    }
+
+    void SoftwareRasterizer
+      ::begin(Target const&target)
+    {
+      m_target = target;
+      m_tilesX = (target.width  + m_options.tileSize - 1) / m_options.tileSize;
+      m_tilesY = (target.height + m_options.tileSize - 1) / m_options.tileSize;
+
+      m_vertices.clear();
+      m_indices.clear();
+      m_draws.clear();
+      m_triangleCount = 0;
+    }
+
+    void SoftwareRasterizer
+      ::submit(
+        const Vertex          *vertices,
+        size_t                 vertexCount,
+        const uint32_t        *indices,
+        size_t                 indexCount,
+        uint32_t               attributeCount,
+        RasterizerState const &state,
+        PixelShaderFn          shader,
+        const void            *shaderContext)
+    {
+      if(!vertices || !indices || indexCount < 3 || attributeCount > MaxAttributes)
+        return;
+
+      for(size_t k=0; k < indexCount; ++k)
+        if(indices[k] >= vertexCount)
+          return;
+
+      Draw draw;
+      draw.vertexBase     = m_vertices.size();
+      draw.indexBase      = m_indices.size();
+      draw.triangleBase   = m_triangleCount;
+      draw.triangleCount  = indexCount / 3;
+      draw.attributeCount = attributeCount;
+      draw.state          = state;
+      draw.shader         = shader;
+      draw.shaderContext  = shaderContext;
+
+      m_vertices.insert(m_vertices.end(), vertices, vertices + vertexCount);
+      m_indices.insert(m_indices.end(), indices, indices + draw.triangleCount * 3);
+      m_draws.push_back(draw);
+
+      m_triangleCount += draw.triangleCount;
+    }
+
+    void SoftwareRasterizer
+      ::flush()
+    {
+      if(!m_triangleCount || !m_target.depth || !m_target.width || !m_target.height) {
+        m_draws.clear();
+        return;
+      }
+
+      m_stats.trianglesSubmitted += m_triangleCount;
+
+      // 1. Setup and binning, one bin per contiguous triangle range.
+      RasterClock::time_point setupStart = RasterClock::now();
+
+      size_t binCount = m_bins.size();
+      parallelFor(binCount, 1, [&] (size_t begin, size_t end)
+      {
+        for(size_t b=begin; b < end; ++b)
+          setupRange((m_triangleCount * b) / binCount, (m_triangleCount * (b + 1)) / binCount, m_bins[b]);
+      });
+
+      for(Bin const&bin : m_bins) {
+        m_stats.trianglesCulled  += bin.culled;
+        m_stats.trianglesClipped += bin.clipped;
+        m_stats.trianglesBinned  += bin.triangles.size();
+        for(std::vector<uint32_t> const&tile : bin.tiles)
+          m_stats.binEntries += tile.size();
+      }
+      m_stats.setupMs += MillisecondsSince(setupStart);
+
+      // 2. Rasterization, one tile at a time per thread.
+      RasterClock::time_point rasterStart = RasterClock::now();
+
+      std::atomic<uint64_t> pixelsWritten(0);
+      parallelFor(m_tilesX * m_tilesY, 1, [&] (size_t begin, size_t end)
+      {
+        uint64_t pixels = 0;
+        for(size_t tile=begin; tile < end; ++tile)
+          rasterizeTile(static_cast<uint32_t>(tile), pixels);
+        pixelsWritten += pixels;
+      });
+
+      m_stats.pixelsWritten += pixelsWritten;
+      m_stats.rasterMs      += MillisecondsSince(rasterStart);
+
+      m_vertices.clear();
+      m_indices.clear();
+      m_draws.clear();
+      m_triangleCount = 0;
+    }
+
+    void SoftwareRasterizer
+      ::Clear(Target const&target, float depth, uint32_t color)
+    {
+      for(uint32_t y=0; y < target.height; ++y) {
+        if(target.depth)
+          std::fill(target.depth + (size_t)y * target.stride, target.depth + (size_t)y * target.stride + target.width, depth);
+        if(target.color)
+          std::fill(target.color + (size_t)y * target.stride, target.color + (size_t)y * target.stride + target.width, color);
+      }
+    }
+
+    //
+    // Setup
+    //
+
+    void SoftwareRasterizer
+      ::setupRange(size_t first, size_t last, Bin &bin)
+    {
+      bin.triangles.clear();
+      bin.attributes.clear();
+      bin.tiles.resize(m_tilesX * m_tilesY);
+      for(std::vector<uint32_t> &tile : bin.tiles)
+        tile.clear();
+      bin.culled  = 0;
+      bin.clipped = 0;
+
+      if(first >= last)
+        return;
+
+      // Draw containing the first triangle; draws are sorted by triangleBase.
+      size_t drawIndex = std::upper_bound(m_draws.begin(), m_draws.end(), first,
+                                          [] (size_t t, Draw const&d) { return t < d.triangleBase; }) - m_draws.begin() - 1;
+
+      for(size_t t=first; t < last; ++t) {
+        while(t >= m_draws[drawIndex].triangleBase + m_draws[drawIndex].triangleCount)
+          ++drawIndex;
+
+        Draw const&draw  = m_draws[drawIndex];
+        size_t     index = draw.indexBase + (t - draw.triangleBase) * 3;
+
+        Vertex const*v[3] ={
+          &m_vertices[draw.vertexBase + m_indices[index + 0]],
+          &m_vertices[draw.vertexBase + m_indices[index + 1]],
+          &m_vertices[draw.vertexBase + m_indices[index + 2]]
+        };
+        setupTriangle(v, draw, static_cast<uint32_t>(drawIndex), bin);
+      }
+    }
+
+    static float ClipDistance(SoftwareRasterizer::Vertex const&v, bool depthClip)
+    {
+      // With depth clipping off, only w must stay positive; keep a small margin so 1/w is sane.
+      return depthClip ? v.position[2] : (v.position[3] - 1.0e-5f);
+    }
+
+    void SoftwareRasterizer
+      ::setupTriangle(Vertex const*v[3], Draw const&draw, uint32_t drawIndex, Bin &bin)
+    {
+      // Trivial reject against the sides of the view volume.
+      for(int axis=0; axis < 2; ++axis) {
+        if(v[0]->position[axis] >  v[0]->position[3] && v[1]->position[axis] >  v[1]->position[3] && v[2]->position[axis] >  v[2]->position[3]) { ++bin.culled; return; }
+        if(v[0]->position[axis] < -v[0]->position[3] && v[1]->position[axis] < -v[1]->position[3] && v[2]->position[axis] < -v[2]->position[3]) { ++bin.culled; return; }
+      }
+      if(draw.state.depthClip
+         && v[0]->position[2] > v[0]->position[3] && v[1]->position[2] > v[1]->position[3] && v[2]->position[2] > v[2]->position[3])
+      {
+        ++bin.culled;
+        return;
+      }
+
+      float d[3] ={ ClipDistance(*v[0], draw.state.depthClip), ClipDistance(*v[1], draw.state.depthClip), ClipDistance(*v[2], draw.state.depthClip) };
+
+      Vertex       clipped[4];
+      Vertex const*polygon[4] ={ v[0], v[1], v[2], nullptr };
+      int          polygonSize = 3;
+
+      if(d[0] < 0.0f || d[1] < 0.0f || d[2] < 0.0f) {
+        if(d[0] < 0.0f && d[1] < 0.0f && d[2] < 0.0f) {
+          ++bin.culled;
+          return;
+        }
+
+        // Sutherland-Hodgman against a single plane: a triangle becomes at most a quad.
+        ++bin.clipped;
+        polygonSize = 0;
+        for(int k=0; k < 3; ++k) {
+          int           n  = (k + 1) % 3;
+          Vertex const &a  = *v[k];
+          Vertex const &b  = *v[n];
+
+          if(d[k] >= 0.0f)
+            clipped[polygonSize++] = a;
+
+          if((d[k] >= 0.0f) != (d[n] >= 0.0f)) {
+            float   s = d[k] / (d[k] - d[n]);
+            Vertex &i = clipped[polygonSize++];
+            for(int c=0; c < 4; ++c)
+              i.position[c] = a.position[c] + (b.position[c] - a.position[c]) * s;
+            for(uint32_t c=0; c < draw.attributeCount; ++c)
+              i.attributes[c] = a.attributes[c] + (b.attributes[c] - a.attributes[c]) * s;
+          }
+        }
+        for(int k=0; k < polygonSize; ++k)
+          polygon[k] = &clipped[k];
+      }
+
+      for(int fan=1; fan + 1 < polygonSize; ++fan) {
+        Vertex const*p[3] ={ polygon[0], polygon[fan], polygon[fan + 1] };
+
+        float sx[3], sy[3], z[3], invW[3];
+        for(int k=0; k < 3; ++k) {
+          invW[k] = 1.0f / p[k]->position[3];
+          sx[k]   = (p[k]->position[0] * invW[k] * 0.5f + 0.5f) * m_target.width;
+          sy[k]   = (0.5f - p[k]->position[1] * invW[k] * 0.5f) * m_target.height;
+          z[k]    = p[k]->position[2] * invW[k];
+        }
+
+        float area2 = (sx[1] - sx[0]) * (sy[2] - sy[0]) - (sx[2] - sx[0]) * (sy[1] - sy[0]);
+        if(!(area2 != 0.0f) || !std::isfinite(area2)) {
+          ++bin.culled;
+          continue;
+        }
+
+        // Positive area is clockwise on screen (y points down).
+        bool front = draw.state.frontCounterClockwise ? (area2 < 0.0f) : (area2 > 0.0f);
+        if((draw.state.cullMode == CullMode::Back && !front) || (draw.state.cullMode == CullMode::Front && front)) {
+          ++bin.culled;
+          continue;
+        }
+
+        SetupTriangle tri;
+        tri.minX = std::max(0, static_cast<int32_t>(std::floor(std::min(sx[0], std::min(sx[1], sx[2])))));
+        tri.minY = std::max(0, static_cast<int32_t>(std::floor(std::min(sy[0], std::min(sy[1], sy[2])))));
+        tri.maxX = std::min(static_cast<int32_t>(m_target.width)  - 1, static_cast<int32_t>(std::ceil(std::max(sx[0], std::max(sx[1], sx[2])))));
+        tri.maxY = std::min(static_cast<int32_t>(m_target.height) - 1, static_cast<int32_t>(std::ceil(std::max(sy[0], std::max(sy[1], sy[2])))));
+        if(tri.minX > tri.maxX || tri.minY > tri.maxY) {
+          ++bin.culled;
+          continue;
+        }
+
+        // Edge k is opposite vertex k and evaluates to area2 there; flip so inside is positive.
+        float sign = (area2 > 0.0f) ? 1.0f : -1.0f;
+        for(int k=0; k < 3; ++k) {
+          int a = (k + 1) % 3;
+          int b = (k + 2) % 3;
+          tri.edge[k][0] = sign * (sy[a] - sy[b]);
+          tri.edge[k][1] = sign * (sx[b] - sx[a]);
+          tri.edge[k][2] = sign * (sx[a] * sy[b] - sx[b] * sy[a]);
+          tri.topLeft[k] = (tri.edge[k][0] > 0.0f) || (tri.edge[k][0] == 0.0f && tri.edge[k][1] > 0.0f);
+        }
+
+        // Barycentrics are edge / area, so any per-vertex quantity q becomes the plane
+        // sum(q_k * edge_k) / area.
+        float inverseArea = 1.0f / std::fabs(area2);
+        auto  plane = [&] (const float q[3], float out[3])
+        {
+          for(int c=0; c < 3; ++c)
+            out[c] = (q[0] * tri.edge[0][c] + q[1] * tri.edge[1][c] + q[2] * tri.edge[2][c]) * inverseArea;
+        };
+
+        plane(z,    tri.depth);
+        plane(invW, tri.invW);
+
+        tri.draw            = drawIndex;
+        tri.attributeOffset = static_cast<uint32_t>(bin.attributes.size());
+        for(uint32_t c=0; c < draw.attributeCount; ++c) {
+          float q[3] ={ p[0]->attributes[c] * invW[0], p[1]->attributes[c] * invW[1], p[2]->attributes[c] * invW[2] };
+          float out[3];
+          plane(q, out);
+          bin.attributes.insert(bin.attributes.end(), out, out + 3);
+        }
+
+        uint32_t index = static_cast<uint32_t>(bin.triangles.size());
+        bin.triangles.push_back(tri);
+
+        uint32_t tileSize = m_options.tileSize;
+        for(uint32_t ty=tri.minY / tileSize; ty <= tri.maxY / tileSize; ++ty)
+          for(uint32_t tx=tri.minX / tileSize; tx <= tri.maxX / tileSize; ++tx)
+            bin.tiles[ty * m_tilesX + tx].push_back(index);
+      }
+    }
+
+    //
+    // Rasterization
+    //
+
+    void SoftwareRasterizer
+      ::rasterizeTile(uint32_t tile, uint64_t &pixelsWritten)
+    {
+      int32_t tileX0 = static_cast<int32_t>((tile % m_tilesX) * m_options.tileSize);
+      int32_t tileY0 = static_cast<int32_t>((tile / m_tilesX) * m_options.tileSize);
+      int32_t tileX1 = std::min(tileX0 + static_cast<int32_t>(m_options.tileSize), static_cast<int32_t>(m_target.width))  - 1;
+      int32_t tileY1 = std::min(tileY0 + static_cast<int32_t>(m_options.tileSize), static_cast<int32_t>(m_target.height)) - 1;
+
+      // Bins are in submission order, and so are their tile lists.
+      for(Bin const&bin : m_bins) {
+        for(uint32_t index : bin.tiles[tile]) {
+          SetupTriangle const&tri = bin.triangles[index];
+
+          int32_t x0 = std::max(tri.minX, tileX0) & ~3; // tile origins are multiples of 4
+          int32_t y0 = std::max(tri.minY, tileY0);
+          int32_t x1 = std::min(tri.maxX, tileX1);
+          int32_t y1 = std::min(tri.maxY, tileY1);
+
+          rasterizeTriangle(tri, bin.attributes.data() + tri.attributeOffset, x0, y0, x1, y1, pixelsWritten);
+        }
+      }
+    }
+
+    static inline uint32_t ShadePixel(
+      SoftwareRasterizer::PixelShaderFn  shader,
+      const void                        *context,
+      const float                       *planes,
+      uint32_t                           attributeCount,
+      const float                        invWPlane[3],
+      float                              px,
+      float                              py)
+    {
+      float attributes[SoftwareRasterizer::MaxAttributes];
+      float w = 1.0f / (invWPlane[0] * px + (invWPlane[1] * py + invWPlane[2]));
+      for(uint32_t c=0; c < attributeCount; ++c)
+        attributes[c] = (planes[c * 3 + 0] * px + (planes[c * 3 + 1] * py + planes[c * 3 + 2])) * w;
+      return shader(context, attributes);
+    }
+
+    void SoftwareRasterizer
+      ::rasterizeTriangle(
+        SetupTriangle const&tri,
+        const float        *attributePlanes,
+        int32_t             x0,
+        int32_t             y0,
+        int32_t             x1,
+        int32_t             y1,
+        uint64_t           &pixelsWritten)
+    {
+      Draw const&draw   = m_draws[tri.draw];
+      bool       shade  = draw.shader && m_target.color;
+      uint64_t   pixels = 0;
+
+      // Every value is evaluated as a * px + (b * py + c) on both paths, which keeps them bit-identical.
+      for(int32_t y=y0; y <= y1; ++y) {
+        float     py    = y + 0.5f;
+        float     row0  = tri.edge[0][1] * py + tri.edge[0][2];
+        float     row1  = tri.edge[1][1] * py + tri.edge[1][2];
+        float     row2  = tri.edge[2][1] * py + tri.edge[2][2];
+        float     rowZ  = tri.depth[1] * py + tri.depth[2];
+        float    *depth = m_target.depth + (size_t)y * m_target.stride;
+        uint32_t *color = m_target.color ? (m_target.color + (size_t)y * m_target.stride) : nullptr;
+
+        int32_t x = x0;
+#if SAE_RASTERIZER_SSE2
+        const __m128 laneOffset = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+        const __m128 a0 = _mm_set1_ps(tri.edge[0][0]), r0 = _mm_set1_ps(row0);
+        const __m128 a1 = _mm_set1_ps(tri.edge[1][0]), r1 = _mm_set1_ps(row1);
+        const __m128 a2 = _mm_set1_ps(tri.edge[2][0]), r2 = _mm_set1_ps(row2);
+        const __m128 tl0 = _mm_castsi128_ps(_mm_set1_epi32(tri.topLeft[0] ? -1 : 0));
+        const __m128 tl1 = _mm_castsi128_ps(_mm_set1_epi32(tri.topLeft[1] ? -1 : 0));
+        const __m128 tl2 = _mm_castsi128_ps(_mm_set1_epi32(tri.topLeft[2] ? -1 : 0));
+        const __m128 za  = _mm_set1_ps(tri.depth[0]), zr = _mm_set1_ps(rowZ);
+        const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+        const __m128i lastLane = _mm_set1_epi32(x1);
+
+        for(; x <= x1; x += 4) {
+          __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), laneOffset);
+
+          __m128 e0 = _mm_add_ps(_mm_mul_ps(a0, px), r0);
+          __m128 e1 = _mm_add_ps(_mm_mul_ps(a1, px), r1);
+          __m128 e2 = _mm_add_ps(_mm_mul_ps(a2, px), r2);
+
+          __m128 in0 = _mm_or_ps(_mm_cmpgt_ps(e0, zero), _mm_and_ps(_mm_cmpeq_ps(e0, zero), tl0));
+          __m128 in1 = _mm_or_ps(_mm_cmpgt_ps(e1, zero), _mm_and_ps(_mm_cmpeq_ps(e1, zero), tl1));
+          __m128 in2 = _mm_or_ps(_mm_cmpgt_ps(e2, zero), _mm_and_ps(_mm_cmpeq_ps(e2, zero), tl2));
+
+          __m128i lanes = _mm_add_epi32(_mm_set1_epi32(x), _mm_setr_epi32(0, 1, 2, 3));
+          __m128  valid = _mm_castsi128_ps(_mm_cmpgt_epi32(_mm_add_epi32(lastLane, _mm_set1_epi32(1)), lanes));
+
+          __m128 inside = _mm_and_ps(_mm_and_ps(in0, in1), _mm_and_ps(in2, valid));
+          if(!_mm_movemask_ps(inside))
+            continue;
+
+          __m128 z    = _mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_mul_ps(za, px), zr), zero), one);
+          __m128 dst  = _mm_loadu_ps(depth + x);
+          __m128 pass = _mm_and_ps(inside, _mm_cmplt_ps(z, dst));
+          int    mask = _mm_movemask_ps(pass);
+          if(!mask)
+            continue;
+
+          _mm_storeu_ps(depth + x, _mm_or_ps(_mm_and_ps(pass, z), _mm_andnot_ps(pass, dst)));
+
+          for(int lane=0; lane < 4; ++lane) {
+            if(!(mask & (1 << lane)))
+              continue;
+            ++pixels;
+            if(shade)
+              color[x + lane] = ShadePixel(draw.shader, draw.shaderContext, attributePlanes, draw.attributeCount, tri.invW, x + lane + 0.5f, py);
+          }
+        }
+#endif
+        for(; x <= x1; ++x) {
+          float px = x + 0.5f;
+          float e0 = tri.edge[0][0] * px + row0;
+          float e1 = tri.edge[1][0] * px + row1;
+          float e2 = tri.edge[2][0] * px + row2;
+
+          bool inside = (e0 > 0.0f || (e0 == 0.0f && tri.topLeft[0]))
+                     && (e1 > 0.0f || (e1 == 0.0f && tri.topLeft[1]))
+                     && (e2 > 0.0f || (e2 == 0.0f && tri.topLeft[2]));
+          if(!inside)
+            continue;
+
+          float z = std::min(std::max(tri.depth[0] * px + rowZ, 0.0f), 1.0f);
+          if(!(z < depth[x]))
+            continue;
+
+          depth[x] = z;
+          ++pixels;
+          if(shade)
+            color[x] = ShadePixel(draw.shader, draw.shaderContext, attributePlanes, draw.attributeCount, tri.invW, px, py);
+        }
+      }
+
+      pixelsWritten += pixels;
+    }
+
+    void SoftwareRasterizer
+      ::parallelFor(size_t count, size_t grain, std::function<void(size_t, size_t)> const&fn)
+    {
+      m_pool.parallelFor(count, grain, fn);
+    }
+
+  }
+}
@@ -0,0 +1,373 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "Renderer/SoftwareRenderer.h"
+
+namespace SAE {
+  namespace Rendering {
+
+    typedef float Matrix4[4][4];
+
+    // DirectXMath convention: row vectors, v' = v * M.
+    static void LoadMatrix(XMMATRIX const&in, Matrix4 &out)
+    {
+      XMFLOAT4X4 stored;
+      XMStoreFloat4x4(&stored, in);
+      for(int r=0; r < 4; ++r)
+        for(int c=0; c < 4; ++c)
+          out[r][c] = stored.m[r][c];
+    }
+
+    static void MultiplyMatrix(Matrix4 const&a, Matrix4 const&b, Matrix4 &out)
+    {
+      for(int r=0; r < 4; ++r)
+        for(int c=0; c < 4; ++c)
+          out[r][c] = a[r][0] * b[0][c] + a[r][1] * b[1][c] + a[r][2] * b[2][c] + a[r][3] * b[3][c];
+    }
+
+    static void TransformPoint(const float p[3], float w, Matrix4 const&m, float out[4])
+    {
+      for(int c=0; c < 4; ++c)
+        out[c] = p[0] * m[0][c] + p[1] * m[1][c] + p[2] * m[2][c] + w * m[3][c];
+    }
+
+    //
+    // Main pass shading
+    //
+    enum LitAttribute {
+      LitWorldPosition = 0,
+      LitNormal        = 3,
+      LitColor         = 6,
+      LitAttributeCount = 10
+    };
+
+    struct LitContext {
+      uint32_t lightCount;
+      uint32_t type[4];
+      float    position[4][3];
+      float    direction[4][3];
+      float    color[4][3];
+      float    intensity[4];
+    };
+
+    static inline uint32_t PackUnorm(float v)
+    {
+      return static_cast<uint32_t>(std::min(std::max(v, 0.0f), 1.0f) * 255.0f + 0.5f);
+    }
+
+    // Lambert term of standard_fragment_shader: same falloff, no specular, shadows or textures.
+    static uint32_t LitPixelShader(const void *context, const float *attributes)
+    {
+      LitContext const&lit = *static_cast<const LitContext*>(context);
+
+      const float *p = attributes + LitWorldPosition;
+      float        n[3] ={ attributes[LitNormal + 0], attributes[LitNormal + 1], attributes[LitNormal + 2] };
+      float        nl = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+      if(nl > 0.0f) { n[0] /= nl; n[1] /= nl; n[2] /= nl; }
+
+      // Meshes without vertex colours leave them zeroed; treat those as white.
+      const float *c        = attributes + LitColor;
+      bool         hasColor = c[3] > 0.0f;
+      float        albedo[3] ={ hasColor ? c[0] : 1.0f, hasColor ? c[1] : 1.0f, hasColor ? c[2] : 1.0f };
+
+      float rgb[3] ={ 0.0f, 0.0f, 0.0f };
+      for(uint32_t k=0; k < lit.lightCount; ++k) {
+        if(lit.intensity[k] == 0.0f)
+          continue;
+
+        float L[3];
+        float distance = 0.0f;
+        if(lit.type[k] == 0) {
+          L[0] = -lit.direction[k][0]; L[1] = -lit.direction[k][1]; L[2] = -lit.direction[k][2];
+        }
+        else {
+          L[0] = lit.position[k][0] - p[0]; L[1] = lit.position[k][1] - p[1]; L[2] = lit.position[k][2] - p[2];
+        }
+        distance = std::sqrt(L[0] * L[0] + L[1] * L[1] + L[2] * L[2]);
+        if(distance <= 0.0f)
+          continue;
+
+        float lambert = (n[0] * L[0] + n[1] * L[1] + n[2] * L[2]) / distance;
+        if(lambert <= 0.0f)
+          continue;
+
+        float falloff = lit.intensity[k] / (0.5f * distance * distance + 0.3f * distance + 0.01f);
+        for(int i=0; i < 3; ++i)
+          rgb[i] += falloff * lit.color[k][i] * albedo[i] * lambert;
+      }
+
+      return PackUnorm(rgb[0]) | (PackUnorm(rgb[1]) << 8) | (PackUnorm(rgb[2]) << 16) | (255u << 24);
+    }
+
+    //
+    // Renderer
+    //
+
+    SoftwareRenderer::SoftwareRenderer()
+      : m_stride(0)
+      , m_nextId(1)
+    {}
+
+    bool SoftwareRenderer
+      ::initialize(Options const&options)
+    {
+      if(!options.width || !options.height
+         || options.vertexLayout.stride < options.vertexLayout.positionOffset + 3 * sizeof(float))
+      {
+        return false;
+      }
+
+      m_options = options;
+      if(!m_rasterizer.initialize(options.rasterizer))
+        return false;
+
+      m_stride = (options.width + 3) & ~3u;
+      m_color.assign((size_t)m_stride * options.height, 0);
+      m_depth.assign((size_t)m_stride * options.height, 1.0f);
+
+      return true;
+    }
+
+    bool SoftwareRenderer
+      ::deinitialize()
+    {
+      m_rasterizer.deinitialize();
+
+      m_vertexBuffers.clear();
+      m_indexBuffers.clear();
+      m_depthTargets.clear();
+      m_transformed.clear();
+      m_color.clear();
+      m_depth.clear();
+
+      return true;
+    }
+
+    uint64_t SoftwareRenderer
+      ::createVertexBuffer(const void *data, size_t byteSize)
+    {
+      if(!data || !byteSize)
+        return 0;
+
+      uint64_t id = m_nextId++;
+      m_vertexBuffers[id].assign(static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + byteSize);
+      return id;
+    }
+
+    uint64_t SoftwareRenderer
+      ::createIndexBuffer(std::vector<uint32_t> const&indices)
+    {
+      if(indices.empty())
+        return 0;
+
+      uint64_t id = m_nextId++;
+      m_indexBuffers[id] = indices;
+      return id;
+    }
+
+    uint64_t SoftwareRenderer
+      ::createDepthTarget(uint32_t width, uint32_t height)
+    {
+      if(!width || !height)
+        return 0;
+
+      uint64_t id = m_nextId++;
+      DepthTarget &target = m_depthTargets[id];
+      target.width  = width;
+      target.height = height;
+      target.stride = (width + 3) & ~3u;
+      target.depth.assign((size_t)target.stride * height, 1.0f);
+      return id;
+    }
+
+    void SoftwareRenderer
+      ::release(uint64_t id)
+    {
+      m_vertexBuffers.erase(id);
+      m_indexBuffers.erase(id);
+      m_depthTargets.erase(id);
+    }
+
+    SoftwareRenderer::DepthTarget const* SoftwareRenderer
+      ::depthTarget(uint64_t id) const
+    {
+      std::map<uint64_t, DepthTarget>::const_iterator it = m_depthTargets.find(id);
+      return (it != m_depthTargets.end()) ? &it->second : nullptr;
+    }
+
+    bool SoftwareRenderer
+      ::transformObject(
+        RenderObject                     const&object,
+        XMMATRIX                         const&world,
+        XMMATRIX                         const&viewProjection,
+        bool                                   lit,
+        std::vector<SoftwareRasterizer::Vertex> &outVertices)
+    {
+      std::map<uint64_t, std::vector<uint8_t>>::const_iterator vb = m_vertexBuffers.find(object.vertexBufferId);
+      if(vb == m_vertexBuffers.end())
+        return false;
+
+      VertexLayout const&layout = m_options.vertexLayout;
+      size_t             count  = vb->second.size() / layout.stride;
+      const uint8_t     *data   = vb->second.data();
+
+      Matrix4 worldMatrix, normalMatrix, viewProjectionMatrix, worldViewProjection;
+      LoadMatrix(world, worldMatrix);
+      LoadMatrix(viewProjection, viewProjectionMatrix);
+      MultiplyMatrix(worldMatrix, viewProjectionMatrix, worldViewProjection);
+
+      if(lit) {
+        // Same as ObjectBuffer_t::invTransposeWorld, which update functions may leave unset.
+        XMMATRIX inverseTranspose = XMMatrixTranspose(XMMatrixInverse(nullptr, world));
+        LoadMatrix(inverseTranspose, normalMatrix);
+      }
+
+      outVertices.resize(count);
+      m_rasterizer.parallelFor(count, 4096, [&] (size_t begin, size_t end)
+      {
+        for(size_t k=begin; k < end; ++k) {
+          const uint8_t              *vertex = data + k * layout.stride;
+          SoftwareRasterizer::Vertex &out    = outVertices[k];
+
+          float position[3];
+          memcpy(position, vertex + layout.positionOffset, sizeof(position));
+          TransformPoint(position, 1.0f, worldViewProjection, out.position);
+
+          if(!lit)
+            continue;
+
+          float worldPosition[4], normal[3], normalWorld[4], color[4];
+          TransformPoint(position, 1.0f, worldMatrix, worldPosition);
+          memcpy(normal, vertex + layout.normalOffset, sizeof(normal));
+          TransformPoint(normal, 0.0f, normalMatrix, normalWorld);
+          memcpy(color, vertex + layout.colorOffset, sizeof(color));
+
+          memcpy(out.attributes + LitWorldPosition, worldPosition, 3 * sizeof(float));
+          memcpy(out.attributes + LitNormal,        normalWorld,   3 * sizeof(float));
+          memcpy(out.attributes + LitColor,         color,         4 * sizeof(float));
+        }
+      });
+
+      return true;
+    }
+
+    void SoftwareRenderer
+      ::renderPass(
+        RenderScene const&scene,
+        PassType    const&passType)
+    {
+      SoftwareRasterizer::Target target ={};
+
+      if(passType == PassType::ShadowMap) {
+        std::map<uint64_t, DepthTarget>::iterator it = m_depthTargets.find(scene.renderTargetId);
+        if(it == m_depthTargets.end())
+          return;
+
+        target.width  = it->second.width;
+        target.height = it->second.height;
+        target.stride = it->second.stride;
+        target.depth  = it->second.depth.data();
+        target.color  = nullptr;
+
+        // A viewport narrows the target to its rectangle, e.g. a shadow atlas tile.
+        if(scene.viewport.width > 0.0f) {
+          uint32_t const x = std::min(static_cast<uint32_t>(scene.viewport.x), target.width);
+          uint32_t const y = std::min(static_cast<uint32_t>(scene.viewport.y), target.height);
+
+          target.width  = std::min(static_cast<uint32_t>(scene.viewport.width),  target.width  - x);
+          target.height = std::min(static_cast<uint32_t>(scene.viewport.height), target.height - y);
+          target.depth += (size_t)y * target.stride + x;
+        }
+      }
+      else {
+        target.width  = m_options.width;
+        target.height = m_options.height;
+        target.stride = m_stride;
+        target.depth  = m_depth.data();
+        target.color  = m_color.data();
+      }
+
+      // Same clear values as Renderer.
+      if(!scene.preserveDepth)
+        SoftwareRasterizer::Clear(target, 1.0f, 0xFF808080);
+
+      LightBuffer_t lightBuffer;
+      memset(&lightBuffer, 0, sizeof(lightBuffer));
+      if(scene.lightBufferId && scene.lightingBufferUpdateFn) {
+        uint64_t k=0;
+        for(uint64_t const&lightId : scene.lights) {
+          if(k >= 4)
+            break;
+          scene.lightingBufferUpdateFn(&lightBuffer, lightId, k);
+          ++k;
+        }
+      }
+
+      // Shadow passes bind the light's view-projection as the camera, see Engine::render().
+      bool     lit = (passType == PassType::Main);
+      CameraBuffer_t camera;
+      memset(&camera, 0, sizeof(camera));
+      if(!scene.cameraBufferId || !scene.cameraBufferUpdateFn || !scene.cameraBufferUpdateFn(&camera))
+        return;
+      XMMATRIX const viewProjection = XMMatrixMultiply(camera.view, camera.projection);
+
+      LitContext litContext;
+      memset(&litContext, 0, sizeof(litContext));
+      litContext.lightCount = static_cast<uint32_t>(std::min<size_t>(scene.lights.size(), 4));
+      for(uint32_t k=0; k < litContext.lightCount; ++k) {
+        LightInfo_t const&light = lightBuffer.lights[k];
+        litContext.type[k]      = light.type;
+        litContext.intensity[k] = light.intensity;
+        XMFLOAT4 position, direction, color;
+        XMStoreFloat4(&position,  light.position);
+        XMStoreFloat4(&direction, light.direction);
+        XMStoreFloat4(&color,     light.color);
+        for(int c=0; c < 3; ++c) {
+          litContext.position[k][c]  = (&position.x)[c];
+          litContext.direction[k][c] = (&direction.x)[c];
+          litContext.color[k][c]     = (&color.x)[c];
+        }
+      }
+
+      // Front faces are counter-clockwise, back faces culled, no depth clip: as Renderer::initialize.
+      SoftwareRasterizer::RasterizerState state;
+      state.cullMode              = SoftwareRasterizer::CullMode::Back;
+      state.frontCounterClockwise = true;
+      state.depthClip             = false;
+
+      m_rasterizer.begin(target);
+
+      m_transformed.resize(scene.objects.size());
+      for(size_t k=0; k < scene.objects.size(); ++k) {
+        RenderObject const&object = scene.objects[k];
+
+        std::map<uint64_t, std::vector<uint32_t>>::const_iterator ib = m_indexBuffers.find(object.indexBufferId);
+        if(ib == m_indexBuffers.end())
+          continue;
+
+        ObjectBuffer_t objectBuffer;
+        objectBuffer.world             = XMMatrixIdentity();
+        objectBuffer.invTransposeWorld = XMMatrixIdentity();
+        if(scene.objectBufferUpdateFn)
+          scene.objectBufferUpdateFn(&objectBuffer, object.objectId);
+
+        if(!transformObject(object, objectBuffer.world, viewProjection, lit, m_transformed[k]))
+          continue;
+
+        m_rasterizer.submit(
+          m_transformed[k].data(),
+          m_transformed[k].size(),
+          ib->second.data(),
+          ib->second.size(),
+          lit ? LitAttributeCount : 0,
+          state,
+          lit ? LitPixelShader : nullptr,
+          &litContext);
+      }
+
+      m_rasterizer.flush();
+    }
+
+  }
+}
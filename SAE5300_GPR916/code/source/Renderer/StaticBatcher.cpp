@@ -0,0 +1,187 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#include "Renderer/StaticBatcher.h"
+
+namespace SAE {
+  namespace Rendering {
+
+    typedef std::chrono::high_resolution_clock BatchClock;
+
+    // Direction d = (x, y, z, w) times the upper 3x3 of the row vector matrix m; w is kept.
+    static inline void TransformDirection(float const *d, float const *m, float *out)
+    {
+      float const x = d[0];
+      float const y = d[1];
+      float const z = d[2];
+
+      out[0] = x * m[0] + y * m[4] + z * m[8];
+      out[1] = x * m[1] + y * m[5] + z * m[9];
+      out[2] = x * m[2] + y * m[6] + z * m[10];
+      out[3] = d[3];
+    }
+
+    static inline void Normalize3(float *v)
+    {
+      float const length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+      if(length > 0.0f) {
+        v[0] /= length;
+        v[1] /= length;
+        v[2] /= length;
+      }
+    }
+
+    bool StaticBatcher::Key
+      ::operator<(Key const&other) const
+    {
+      if(materialId != other.materialId)
+        return materialId < other.materialId;
+      for(uint32_t k=0; k < 3; ++k)
+        if(cell[k] != other.cell[k])
+          return cell[k] < other.cell[k];
+      return false;
+    }
+
+    StaticBatcher::StaticBatcher()
+      : m_options()
+      , m_stats()
+    {}
+
+    bool StaticBatcher
+      ::initialize(Options const&options)
+    {
+      deinitialize();
+
+      if(!(options.cellSize > 0.0f) || !options.maxVerticesPerBatch)
+        return false;
+
+      m_options = options;
+      return true;
+    }
+
+    void StaticBatcher
+      ::deinitialize()
+    {
+      m_open.clear();
+      m_batches.clear();
+      m_transformed.clear();
+      m_transformed.shrink_to_fit();
+      m_stats = Stats();
+    }
+
+    bool StaticBatcher
+      ::add(
+        uint64_t        materialId,
+        Vertex   const *vertices,
+        size_t          vertexCount,
+        uint32_t const *indices,
+        size_t          indexCount,
+        float    const  world[16])
+    {
+      if(!vertices || !indices || !vertexCount || indexCount < 3)
+        return true;
+
+      BatchClock::time_point const start = BatchClock::now();
+
+      // Rebased indices past the instance would silently point into other instances' vertices.
+      for(size_t k=0; k < indexCount; ++k)
+        if(indices[k] >= vertexCount)
+          return false;
+
+      // Normals transform with the inverse transpose of the upper 3x3, i.e. its cofactor matrix
+      // divided by the determinant; rows of the cofactor matrix are cross products of the rows.
+      float const *r0 = world;
+      float const *r1 = world + 4;
+      float const *r2 = world + 8;
+      float cofactor[12] ={
+        r1[1] * r2[2] - r1[2] * r2[1], r1[2] * r2[0] - r1[0] * r2[2], r1[0] * r2[1] - r1[1] * r2[0], 0.0f,
+        r2[1] * r0[2] - r2[2] * r0[1], r2[2] * r0[0] - r2[0] * r0[2], r2[0] * r0[1] - r2[1] * r0[0], 0.0f,
+        r0[1] * r1[2] - r0[2] * r1[1], r0[2] * r1[0] - r0[0] * r1[2], r0[0] * r1[1] - r0[1] * r1[0], 0.0f
+      };
+      float const determinant = r0[0] * cofactor[0] + r0[1] * cofactor[1] + r0[2] * cofactor[2];
+      bool  const mirrored    = (determinant < 0.0f);
+      if(mirrored)
+        for(uint32_t k=0; k < 12; ++k)
+          cofactor[k] = -cofactor[k];
+
+      float boundsMin[3] ={ std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+      float boundsMax[3] ={ -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() };
+
+      m_transformed.resize(vertexCount);
+      for(size_t k=0; k < vertexCount; ++k) {
+        Vertex const&source = vertices[k];
+        Vertex      &target = m_transformed[k];
+
+        float const x = source.position[0];
+        float const y = source.position[1];
+        float const z = source.position[2];
+        for(uint32_t c=0; c < 3; ++c) {
+          target.position[c] = x * world[c] + y * world[4 + c] + z * world[8 + c] + world[12 + c];
+          boundsMin[c]       = std::min(boundsMin[c], target.position[c]);
+          boundsMax[c]       = std::max(boundsMax[c], target.position[c]);
+        }
+        target.position[3] = 1.0f;
+
+        TransformDirection(source.normal,  cofactor, target.normal);
+        TransformDirection(source.tangent, world,    target.tangent);
+        Normalize3(target.normal);
+        Normalize3(target.tangent);
+
+        std::copy(source.uv,    source.uv    + 4, target.uv);
+        std::copy(source.color, source.color + 4, target.color);
+      }
+
+      Key key ={ materialId, { 0, 0, 0 } };
+      for(uint32_t c=0; c < 3; ++c)
+        key.cell[c] = static_cast<int32_t>(std::floor((0.5f * (boundsMin[c] + boundsMax[c])) / m_options.cellSize));
+
+      std::map<Key, size_t>::iterator open = m_open.find(key);
+      if(open == m_open.end()
+         || (m_batches[open->second].vertices.size() + vertexCount) > m_options.maxVerticesPerBatch)
+      {
+        Batch batch;
+        batch.materialId    = materialId;
+        batch.instanceCount = 0;
+        for(uint32_t c=0; c < 3; ++c) {
+          batch.cell[c]      = key.cell[c];
+          batch.boundsMin[c] = boundsMin[c];
+          batch.boundsMax[c] = boundsMax[c];
+        }
+
+        m_open[key] = m_batches.size();
+        m_batches.push_back(batch);
+        ++m_stats.batches;
+        open = m_open.find(key);
+      }
+
+      Batch &batch = m_batches[open->second];
+      for(uint32_t c=0; c < 3; ++c) {
+        batch.boundsMin[c] = std::min(batch.boundsMin[c], boundsMin[c]);
+        batch.boundsMax[c] = std::max(batch.boundsMax[c], boundsMax[c]);
+      }
+
+      uint32_t const base      = static_cast<uint32_t>(batch.vertices.size());
+      size_t   const triangles = indexCount / 3;
+
+      batch.vertices.insert(batch.vertices.end(), m_transformed.begin(), m_transformed.end());
+      batch.indices.reserve(batch.indices.size() + 3 * triangles);
+      for(size_t t=0; t < triangles; ++t) {
+        uint32_t const *triangle = indices + 3 * t;
+        batch.indices.push_back(base + triangle[0]);
+        batch.indices.push_back(base + (mirrored ? triangle[2] : triangle[1]));
+        batch.indices.push_back(base + (mirrored ? triangle[1] : triangle[2]));
+      }
+      ++batch.instanceCount;
+
+      m_stats.instances += 1;
+      m_stats.vertices  += vertexCount;
+      m_stats.indices   += 3 * triangles;
+      m_stats.buildMs   += std::chrono::duration<double, std::milli>(BatchClock::now() - start).count();
+
+      return true;
+    }
+
+  }
+}
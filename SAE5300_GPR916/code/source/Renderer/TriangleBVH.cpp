@@ -0,0 +1,788 @@
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#include "Renderer/TriangleBVH.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+  // SSE2 is part of the x64 baseline and the MSVC x86 default: no dispatch needed.
+  #define SAE_TRIANGLEBVH_X86 1
+  #include <emmintrin.h>
+#else
+  #define SAE_TRIANGLEBVH_X86 0
+#endif
+
+namespace SAE {
+  namespace Rendering {
+
+    typedef std::chrono::high_resolution_clock TriangleBVHClock;
+
+    namespace {
+
+      static const uint32_t MaxBins          = 32;
+      static const uint32_t MaxLeafTriangles = 16;       // largest leaf the SAH may prefer to a split
+      static const float    MinDeterminant   = 1e-12f;   // below: ray parallel to the triangle
+
+      static float Area(float const minimum[3], float const maximum[3])
+      {
+        float const dx = maximum[0] - minimum[0];
+        float const dy = maximum[1] - minimum[1];
+        float const dz = maximum[2] - minimum[2];
+        return (dx >= 0.0f && dy >= 0.0f && dz >= 0.0f) ? 2.0f * (dx * dy + dy * dz + dz * dx) : 0.0f;
+      }
+
+      // Large instead of infinite for axis-parallel rays: a slab the origin lies in then spans
+      // [-large, large] and no 0 * infinity makes a NaN.
+      static float InverseDirection(float d)
+      {
+        return (std::fabs(d) > 1e-30f) ? (1.0f / d) : 1e30f;
+      }
+
+      static bool EntersBox(
+        float const minimum[3],
+        float const maximum[3],
+        float const origin[3],
+        float const inverse[3],
+        float       maxDistance,
+        float      &outDistance)
+      {
+        float tNear = 0.0f;
+        float tFar  = maxDistance;
+        for(uint32_t k=0; k < 3; ++k) {
+          float const t1 = (minimum[k] - origin[k]) * inverse[k];
+          float const t2 = (maximum[k] - origin[k]) * inverse[k];
+          tNear = std::max(tNear, std::min(t1, t2));
+          tFar  = std::min(tFar,  std::max(t1, t2));
+        }
+        outDistance = tNear;
+        return (tNear <= tFar);
+      }
+
+      // Moeller-Trumbore, two-sided. The operations are those of the four lane version in
+      // intersect4(), in the same order, so both find bit identical distances.
+      static bool IntersectTriangle(
+        float const v0[3],
+        float const e1[3],
+        float const e2[3],
+        float const origin[3],
+        float const direction[3],
+        float       maxDistance,
+        float      &outT,
+        float      &outU,
+        float      &outV)
+      {
+        float const px = direction[1] * e2[2] - direction[2] * e2[1];
+        float const py = direction[2] * e2[0] - direction[0] * e2[2];
+        float const pz = direction[0] * e2[1] - direction[1] * e2[0];
+
+        float const det = e1[0] * px + e1[1] * py + e1[2] * pz;
+        if(!(std::fabs(det) > MinDeterminant))
+          return false;
+
+        float const invDet = 1.0f / det;
+
+        float const tx = origin[0] - v0[0];
+        float const ty = origin[1] - v0[1];
+        float const tz = origin[2] - v0[2];
+
+        float const u = (tx * px + ty * py + tz * pz) * invDet;
+        if(u < 0.0f || u > 1.0f)
+          return false;
+
+        float const qx = ty * e1[2] - tz * e1[1];
+        float const qy = tz * e1[0] - tx * e1[2];
+        float const qz = tx * e1[1] - ty * e1[0];
+
+        float const v = (direction[0] * qx + direction[1] * qy + direction[2] * qz) * invDet;
+        if(v < 0.0f || (u + v) > 1.0f)
+          return false;
+
+        float const t = (e2[0] * qx + e2[1] * qy + e2[2] * qz) * invDet;
+        if(t < 0.0f || !(t < maxDistance))
+          return false;
+
+        outT = t;
+        outU = u;
+        outV = v;
+        return true;
+      }
+
+    }
+
+    TriangleBVH::TriangleBVH()
+      : m_options()
+      , m_nodes(nullptr)
+      , m_nodeCount(0)
+      , m_stats()
+    {}
+
+    bool TriangleBVH
+      ::build(
+        float    const*positions,
+        size_t         stride,
+        size_t         vertexCount,
+        uint32_t const*indices,
+        size_t         indexCount,
+        Options  const&options)
+    {
+      clear();
+
+      TriangleBVHClock::time_point const start = TriangleBVHClock::now();
+
+      m_options = options;
+      m_options.maxLeafTriangles = std::min(std::max(options.maxLeafTriangles, 1u), MaxLeafTriangles);
+      m_options.binCount         = std::min(std::max(options.binCount, 2u), MaxBins);
+
+      auto vertex = [positions, stride] (uint32_t index) -> float const*
+      {
+        return reinterpret_cast<float const*>(reinterpret_cast<uint8_t const*>(positions) + size_t(index) * stride);
+      };
+
+      size_t const triangleCount = indexCount / 3;
+      m_buildBounds.resize(6 * triangleCount);
+      m_buildCentroids.resize(3 * triangleCount);
+      m_triangleIndices.reserve(triangleCount);
+
+      for(uint32_t t=0; t < triangleCount; ++t) {
+        uint32_t const*triangle = indices + 3 * t;
+        if(triangle[0] >= vertexCount || triangle[1] >= vertexCount || triangle[2] >= vertexCount)
+          continue;
+
+        float *bounds = &m_buildBounds[6 * t];
+        for(uint32_t a=0; a < 3; ++a) {
+          float const p0 = vertex(triangle[0])[a];
+          float const p1 = vertex(triangle[1])[a];
+          float const p2 = vertex(triangle[2])[a];
+          bounds[a]     = std::min(p0, std::min(p1, p2));
+          bounds[3 + a] = std::max(p0, std::max(p1, p2));
+          m_buildCentroids[3 * t + a] = 0.5f * (bounds[a] + bounds[3 + a]);
+        }
+        m_triangleIndices.push_back(t);
+      }
+
+      if(m_triangleIndices.empty()) {
+        clear();
+        return false;
+      }
+
+      // Node 0 is padding, so that the pairs of children start at even indices.
+      std::vector<Node> nodes(2);
+      nodes.reserve(2 * (m_triangleIndices.size() / m_options.maxLeafTriangles + 1) + 2);
+      buildNode(nodes, 1, 0, static_cast<uint32_t>(m_triangleIndices.size()), 1);
+
+      m_nodeCount = static_cast<uint32_t>(nodes.size());
+      m_nodeStorage.reset(new uint8_t[nodes.size() * sizeof(Node) + 64]);
+      m_nodes = reinterpret_cast<Node*>((reinterpret_cast<uintptr_t>(m_nodeStorage.get()) + 63) & ~uintptr_t(63));
+      memcpy(m_nodes, nodes.data(), nodes.size() * sizeof(Node));
+
+      m_triangles.resize(m_triangleIndices.size());
+      for(size_t k=0; k < m_triangleIndices.size(); ++k) {
+        uint32_t const*triangle = indices + 3 * m_triangleIndices[k];
+        float    const*p0       = vertex(triangle[0]);
+        float    const*p1       = vertex(triangle[1]);
+        float    const*p2       = vertex(triangle[2]);
+
+        Triangle &entry = m_triangles[k];
+        for(uint32_t a=0; a < 3; ++a) {
+          entry.v0[a] = p0[a];
+          entry.e1[a] = p1[a] - p0[a];
+          entry.e2[a] = p2[a] - p0[a];
+        }
+      }
+
+      std::vector<float>().swap(m_buildBounds);
+      std::vector<float>().swap(m_buildCentroids);
+
+      m_stats.triangles = static_cast<uint32_t>(m_triangles.size());
+      m_stats.nodes     = m_nodeCount - 1;
+      m_stats.buildMs   = std::chrono::duration<double, std::milli>(TriangleBVHClock::now() - start).count();
+      return true;
+    }
+
+    void TriangleBVH
+      ::clear()
+    {
+      m_nodeStorage.reset();
+      m_nodes     = nullptr;
+      m_nodeCount = 0;
+
+      m_triangles.clear();
+      m_triangleIndices.clear();
+      m_buildBounds.clear();
+      m_buildCentroids.clear();
+
+      m_stats = Stats();
+    }
+
+    void TriangleBVH
+      ::buildNode(
+        std::vector<Node> &nodes,
+        uint32_t           node,
+        uint32_t           begin,
+        uint32_t           end,
+        uint32_t           depth)
+    {
+      Node bounds ={ { FLT_MAX, FLT_MAX, FLT_MAX }, 0, { -FLT_MAX, -FLT_MAX, -FLT_MAX }, 0 };
+      for(uint32_t k=begin; k < end; ++k) {
+        float const*triangle = &m_buildBounds[6 * m_triangleIndices[k]];
+        for(uint32_t a=0; a < 3; ++a) {
+          bounds.minimum[a] = std::min(bounds.minimum[a], triangle[a]);
+          bounds.maximum[a] = std::max(bounds.maximum[a], triangle[3 + a]);
+        }
+      }
+      nodes[node] = bounds;
+      m_stats.depth = std::max(m_stats.depth, depth);
+
+      bool     leaf = ((end - begin) <= m_options.maxLeafTriangles);
+      uint32_t mid  = 0;
+      if(!leaf)
+        mid = splitRange(begin, end, Area(bounds.minimum, bounds.maximum), depth > MaxSAHDepth, leaf);
+
+      if(leaf) {
+        nodes[node].first = begin;
+        nodes[node].count = end - begin;
+        ++m_stats.leaves;
+        return;
+      }
+
+      uint32_t const left = static_cast<uint32_t>(nodes.size());
+      nodes.resize(left + 2);
+      nodes[node].first = left;
+      nodes[node].count = 0;
+
+      buildNode(nodes, left,     begin, mid, depth + 1);
+      buildNode(nodes, left + 1, mid,   end, depth + 1);
+    }
+
+    /**********************************************************************************************//**
+     * \fn  uint32_t TriangleBVH ::splitRange(uint32_t begin, uint32_t end, float const parentArea, bool median, bool &outLeaf)
+     *
+     * \brief Partitions m_triangleIndices[begin, end) in two, at the cheapest bin boundary by SAH.
+     *
+     * The cost of a split is one box test plus the triangles of either side weighted by the
+     * share of the parent's surface area the side covers; a leaf costs all of its triangles.
+     * outLeaf is set instead of splitting when a leaf of at most MaxLeafTriangles is cheaper.
+     * Without a boundary leaving triangles on both sides, or when median is set, the triangles
+     * are split in halves along the axis of largest centroid extent.
+     *
+     * \return  The first triangle of the right part, in (begin, end).
+     **************************************************************************************************/
+    uint32_t TriangleBVH
+      ::splitRange(
+        uint32_t    begin,
+        uint32_t    end,
+        float const parentArea,
+        bool        median,
+        bool       &outLeaf)
+    {
+      outLeaf = false;
+
+      float centroidMin[3] ={ FLT_MAX, FLT_MAX, FLT_MAX };
+      float centroidMax[3] ={ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+      for(uint32_t k=begin; k < end; ++k)
+        for(uint32_t a=0; a < 3; ++a) {
+          float const c = m_buildCentroids[3 * m_triangleIndices[k] + a];
+          centroidMin[a] = std::min(centroidMin[a], c);
+          centroidMax[a] = std::max(centroidMax[a], c);
+        }
+
+      uint32_t const bins  = m_options.binCount;
+      uint32_t const count = end - begin;
+      auto binOf = [&] (uint32_t triangle, uint32_t axis, float scale) -> uint32_t
+      {
+        uint32_t const bin = static_cast<uint32_t>((m_buildCentroids[3 * triangle + axis] - centroidMin[axis]) * scale);
+        return (bin < bins) ? bin : (bins - 1);
+      };
+
+      if(!median) {
+        float    bestCost  = FLT_MAX;
+        int32_t  bestAxis  = -1;
+        uint32_t bestBin   = 0;
+        float    bestScale = 0.0f;
+
+        for(uint32_t axis=0; axis < 3; ++axis) {
+          float const extent = centroidMax[axis] - centroidMin[axis];
+          if(!(extent > 0.0f))
+            continue;
+
+          float const scale = bins / extent;
+
+          float    binMin[MaxBins][3];
+          float    binMax[MaxBins][3];
+          uint32_t binCounts[MaxBins];
+          for(uint32_t b=0; b < bins; ++b) {
+            binMin[b][0] = binMin[b][1] = binMin[b][2] = FLT_MAX;
+            binMax[b][0] = binMax[b][1] = binMax[b][2] = -FLT_MAX;
+            binCounts[b] = 0;
+          }
+
+          for(uint32_t k=begin; k < end; ++k) {
+            uint32_t const triangle = m_triangleIndices[k];
+            uint32_t const bin      = binOf(triangle, axis, scale);
+            float    const*bounds   = &m_buildBounds[6 * triangle];
+            for(uint32_t a=0; a < 3; ++a) {
+              binMin[bin][a] = std::min(binMin[bin][a], bounds[a]);
+              binMax[bin][a] = std::max(binMax[bin][a], bounds[3 + a]);
+            }
+            ++binCounts[bin];
+          }
+
+          // Right of boundary b: bins b to bins - 1.
+          float    rightAreas[MaxBins];
+          uint32_t rightCounts[MaxBins];
+          float    accumulatedMin[3] ={ FLT_MAX, FLT_MAX, FLT_MAX };
+          float    accumulatedMax[3] ={ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+          uint32_t accumulated       = 0;
+          for(uint32_t b=(bins - 1); b > 0; --b) {
+            for(uint32_t a=0; a < 3; ++a) {
+              accumulatedMin[a] = std::min(accumulatedMin[a], binMin[b][a]);
+              accumulatedMax[a] = std::max(accumulatedMax[a], binMax[b][a]);
+            }
+            accumulated   += binCounts[b];
+            rightAreas[b]  = Area(accumulatedMin, accumulatedMax);
+            rightCounts[b] = accumulated;
+          }
+
+          accumulatedMin[0] = accumulatedMin[1] = accumulatedMin[2] = FLT_MAX;
+          accumulatedMax[0] = accumulatedMax[1] = accumulatedMax[2] = -FLT_MAX;
+          accumulated       = 0;
+          for(uint32_t b=0; (b + 1) < bins; ++b) {
+            for(uint32_t a=0; a < 3; ++a) {
+              accumulatedMin[a] = std::min(accumulatedMin[a], binMin[b][a]);
+              accumulatedMax[a] = std::max(accumulatedMax[a], binMax[b][a]);
+            }
+            accumulated += binCounts[b];
+            if(!accumulated || !rightCounts[b + 1])
+              continue;
+
+            float const cost = Area(accumulatedMin, accumulatedMax) * accumulated + rightAreas[b + 1] * rightCounts[b + 1];
+            if(cost < bestCost) {
+              bestCost  = cost;
+              bestAxis  = static_cast<int32_t>(axis);
+              bestBin   = b;
+              bestScale = scale;
+            }
+          }
+        }
+
+        if(bestAxis >= 0) {
+          float const splitCost = 1.0f + bestCost / (parentArea > 0.0f ? parentArea : 1.0f);
+          if(count <= MaxLeafTriangles && splitCost >= float(count)) {
+            outLeaf = true;
+            return begin;
+          }
+
+          uint32_t const axis = static_cast<uint32_t>(bestAxis);
+          uint32_t *const middle = std::partition(
+            m_triangleIndices.data() + begin,
+            m_triangleIndices.data() + end,
+            [&] (uint32_t triangle) -> bool { return binOf(triangle, axis, bestScale) <= bestBin; });
+
+          uint32_t const mid = static_cast<uint32_t>(middle - m_triangleIndices.data());
+          if(mid > begin && mid < end)
+            return mid;
+        }
+      }
+
+      uint32_t axis = 0;
+      for(uint32_t a=1; a < 3; ++a)
+        if((centroidMax[a] - centroidMin[a]) > (centroidMax[axis] - centroidMin[axis]))
+          axis = a;
+
+      uint32_t const mid = begin + count / 2;
+      std::nth_element(
+        m_triangleIndices.data() + begin,
+        m_triangleIndices.data() + mid,
+        m_triangleIndices.data() + end,
+        [&] (uint32_t lhs, uint32_t rhs) -> bool
+      {
+        float const l = m_buildCentroids[3 * lhs + axis];
+        float const r = m_buildCentroids[3 * rhs + axis];
+        return (l != r) ? (l < r) : (lhs < rhs);
+      });
+
+      return mid;
+    }
+
+    bool TriangleBVH
+      ::intersect(Ray const&ray, Hit &outHit) const
+    {
+      return traverse(ray, false, outHit);
+    }
+
+    bool TriangleBVH
+      ::occluded(Ray const&ray) const
+    {
+      Hit hit;
+      return traverse(ray, true, hit);
+    }
+
+    bool TriangleBVH
+      ::traverse(Ray const&ray, bool anyHit, Hit &outHit) const
+    {
+      if(!m_nodes)
+        return false;
+
+      float const inverse[3] ={ InverseDirection(ray.direction[0]), InverseDirection(ray.direction[1]), InverseDirection(ray.direction[2]) };
+
+      float closest = ray.maxDistance;
+      bool  found   = false;
+
+      struct Entry {
+        uint32_t node;
+        float    distance;  // where the ray enters the node's box
+      };
+
+      Entry stack[StackSize];
+      uint32_t top = 0;
+
+      float distance = 0.0f;
+      if(!EntersBox(m_nodes[1].minimum, m_nodes[1].maximum, ray.origin, inverse, closest, distance))
+        return false;
+      stack[top++] ={ 1, distance };
+
+      while(top) {
+        Entry const entry = stack[--top];
+        if(entry.distance > closest)
+          continue;
+
+        Node const&node = m_nodes[entry.node];
+        if(node.count) {
+          for(uint32_t k=node.first; k < (node.first + node.count); ++k) {
+            Triangle const&triangle = m_triangles[k];
+
+            float t, u, v;
+            if(!IntersectTriangle(triangle.v0, triangle.e1, triangle.e2, ray.origin, ray.direction, closest, t, u, v))
+              continue;
+
+            closest = t;
+            found   = true;
+            outHit.distance = t;
+            outHit.u        = u;
+            outHit.v        = v;
+            outHit.triangle = m_triangleIndices[k];
+            if(anyHit)
+              return true;
+          }
+          continue;
+        }
+
+        // Both children share a cache line; the nearer one is visited first.
+        Node const&left  = m_nodes[node.first];
+        Node const&right = m_nodes[node.first + 1];
+
+        float leftDistance  = 0.0f;
+        float rightDistance = 0.0f;
+        bool const hitLeft  = EntersBox(left.minimum,  left.maximum,  ray.origin, inverse, closest, leftDistance);
+        bool const hitRight = EntersBox(right.minimum, right.maximum, ray.origin, inverse, closest, rightDistance);
+
+        if(hitLeft && hitRight) {
+          bool const leftFirst = (leftDistance <= rightDistance);
+          stack[top++] = leftFirst ? Entry{ node.first + 1, rightDistance } : Entry{ node.first, leftDistance };
+          stack[top++] = leftFirst ? Entry{ node.first, leftDistance } : Entry{ node.first + 1, rightDistance };
+        }
+        else if(hitLeft) {
+          stack[top++] ={ node.first, leftDistance };
+        }
+        else if(hitRight) {
+          stack[top++] ={ node.first + 1, rightDistance };
+        }
+      }
+
+      return found;
+    }
+
+    uint32_t TriangleBVH
+      ::intersect4(Ray const rays[4], Hit outHits[4]) const
+    {
+#if SAE_TRIANGLEBVH_X86
+      if(!m_nodes)
+        return 0;
+
+      __m128 const ox = _mm_setr_ps(rays[0].origin[0], rays[1].origin[0], rays[2].origin[0], rays[3].origin[0]);
+      __m128 const oy = _mm_setr_ps(rays[0].origin[1], rays[1].origin[1], rays[2].origin[1], rays[3].origin[1]);
+      __m128 const oz = _mm_setr_ps(rays[0].origin[2], rays[1].origin[2], rays[2].origin[2], rays[3].origin[2]);
+      __m128 const dx = _mm_setr_ps(rays[0].direction[0], rays[1].direction[0], rays[2].direction[0], rays[3].direction[0]);
+      __m128 const dy = _mm_setr_ps(rays[0].direction[1], rays[1].direction[1], rays[2].direction[1], rays[3].direction[1]);
+      __m128 const dz = _mm_setr_ps(rays[0].direction[2], rays[1].direction[2], rays[2].direction[2], rays[3].direction[2]);
+
+      __m128 const ix = _mm_setr_ps(InverseDirection(rays[0].direction[0]), InverseDirection(rays[1].direction[0]), InverseDirection(rays[2].direction[0]), InverseDirection(rays[3].direction[0]));
+      __m128 const iy = _mm_setr_ps(InverseDirection(rays[0].direction[1]), InverseDirection(rays[1].direction[1]), InverseDirection(rays[2].direction[1]), InverseDirection(rays[3].direction[1]));
+      __m128 const iz = _mm_setr_ps(InverseDirection(rays[0].direction[2]), InverseDirection(rays[1].direction[2]), InverseDirection(rays[2].direction[2]), InverseDirection(rays[3].direction[2]));
+
+      __m128 const zero      = _mm_setzero_ps();
+      __m128 const one       = _mm_set1_ps(1.0f);
+      __m128 const signMask  = _mm_set1_ps(-0.0f);
+      __m128 const threshold = _mm_set1_ps(MinDeterminant);
+
+      __m128  closest = _mm_setr_ps(rays[0].maxDistance, rays[1].maxDistance, rays[2].maxDistance, rays[3].maxDistance);
+      __m128  hitU    = zero;
+      __m128  hitV    = zero;
+      __m128i hitId   = _mm_setzero_si128();
+      int     hits    = 0;
+
+      // Lanes entering the box within their closest hit so far; outNear receives the distances.
+      auto enters = [&] (Node const&node, __m128 &outNear) -> int
+      {
+        __m128 const x1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.minimum[0]), ox), ix);
+        __m128 const x2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.maximum[0]), ox), ix);
+        __m128 const y1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.minimum[1]), oy), iy);
+        __m128 const y2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.maximum[1]), oy), iy);
+        __m128 const z1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.minimum[2]), oz), iz);
+        __m128 const z2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.maximum[2]), oz), iz);
+
+        outNear = _mm_max_ps(_mm_max_ps(_mm_min_ps(x1, x2), _mm_min_ps(y1, y2)), _mm_max_ps(_mm_min_ps(z1, z2), zero));
+        __m128 const tFar = _mm_min_ps(_mm_min_ps(_mm_max_ps(x1, x2), _mm_max_ps(y1, y2)), _mm_min_ps(_mm_max_ps(z1, z2), closest));
+        return _mm_movemask_ps(_mm_cmple_ps(outNear, tFar));
+      };
+
+      // Nearest entry among the lanes of mask.
+      auto nearest = [] (__m128 const&distances, int mask) -> float
+      {
+        float values[4];
+        _mm_storeu_ps(values, distances);
+
+        float result = FLT_MAX;
+        for(uint32_t k=0; k < 4; ++k)
+          if(mask & (1 << k))
+            result = std::min(result, values[k]);
+        return result;
+      };
+
+      uint32_t stack[StackSize];
+      uint32_t top = 0;
+
+      __m128 distances;
+      if(enters(m_nodes[1], distances))
+        stack[top++] = 1;
+
+      while(top) {
+        Node const&node = m_nodes[stack[--top]];
+
+        // Lanes may have found closer hits since the node was pushed.
+        if(!enters(node, distances))
+          continue;
+
+        if(node.count) {
+          for(uint32_t k=node.first; k < (node.first + node.count); ++k) {
+            Triangle const&triangle = m_triangles[k];
+
+            __m128 const e1x = _mm_set1_ps(triangle.e1[0]);
+            __m128 const e1y = _mm_set1_ps(triangle.e1[1]);
+            __m128 const e1z = _mm_set1_ps(triangle.e1[2]);
+            __m128 const e2x = _mm_set1_ps(triangle.e2[0]);
+            __m128 const e2y = _mm_set1_ps(triangle.e2[1]);
+            __m128 const e2z = _mm_set1_ps(triangle.e2[2]);
+
+            __m128 const px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+            __m128 const py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+            __m128 const pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+
+            __m128 const det    = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+            __m128 const invDet = _mm_div_ps(one, det);
+
+            __m128 const tx = _mm_sub_ps(ox, _mm_set1_ps(triangle.v0[0]));
+            __m128 const ty = _mm_sub_ps(oy, _mm_set1_ps(triangle.v0[1]));
+            __m128 const tz = _mm_sub_ps(oz, _mm_set1_ps(triangle.v0[2]));
+
+            __m128 const u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, px), _mm_mul_ps(ty, py)), _mm_mul_ps(tz, pz)), invDet);
+
+            __m128 const qx = _mm_sub_ps(_mm_mul_ps(ty, e1z), _mm_mul_ps(tz, e1y));
+            __m128 const qy = _mm_sub_ps(_mm_mul_ps(tz, e1x), _mm_mul_ps(tx, e1z));
+            __m128 const qz = _mm_sub_ps(_mm_mul_ps(tx, e1y), _mm_mul_ps(ty, e1x));
+
+            __m128 const v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), invDet);
+            __m128 const t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invDet);
+
+            __m128 hit = _mm_cmpgt_ps(_mm_andnot_ps(signMask, det), threshold);
+            hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmple_ps(u, one)));
+            hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpge_ps(v, zero), _mm_cmple_ps(_mm_add_ps(u, v), one)));
+            hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpge_ps(t, zero), _mm_cmplt_ps(t, closest)));
+
+            int const mask = _mm_movemask_ps(hit);
+            if(!mask)
+              continue;
+
+            __m128i const hitMask = _mm_castps_si128(hit);
+            closest = _mm_or_ps(_mm_and_ps(hit, t), _mm_andnot_ps(hit, closest));
+            hitU    = _mm_or_ps(_mm_and_ps(hit, u), _mm_andnot_ps(hit, hitU));
+            hitV    = _mm_or_ps(_mm_and_ps(hit, v), _mm_andnot_ps(hit, hitV));
+            hitId   = _mm_or_si128(_mm_and_si128(hitMask, _mm_set1_epi32(static_cast<int>(m_triangleIndices[k]))), _mm_andnot_si128(hitMask, hitId));
+            hits   |= mask;
+          }
+          continue;
+        }
+
+        __m128 leftDistances, rightDistances;
+        int const hitLeft  = enters(m_nodes[node.first],     leftDistances);
+        int const hitRight = enters(m_nodes[node.first + 1], rightDistances);
+
+        if(hitLeft && hitRight) {
+          bool const leftFirst = (nearest(leftDistances, hitLeft) <= nearest(rightDistances, hitRight));
+          stack[top++] = leftFirst ? (node.first + 1) : node.first;
+          stack[top++] = leftFirst ? node.first : (node.first + 1);
+        }
+        else if(hitLeft) {
+          stack[top++] = node.first;
+        }
+        else if(hitRight) {
+          stack[top++] = node.first + 1;
+        }
+      }
+
+      float    distance[4], u[4], v[4];
+      uint32_t triangle[4];
+      _mm_storeu_ps(distance, closest);
+      _mm_storeu_ps(u, hitU);
+      _mm_storeu_ps(v, hitV);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(triangle), hitId);
+
+      for(uint32_t k=0; k < 4; ++k)
+        if(hits & (1 << k))
+          outHits[k] ={ distance[k], u[k], v[k], triangle[k] };
+
+      return static_cast<uint32_t>(hits);
+#else
+      uint32_t hits = 0;
+      for(uint32_t k=0; k < 4; ++k)
+        hits |= intersect(rays[k], outHits[k]) ? (1u << k) : 0;
+      return hits;
+#endif
+    }
+
+    TriangleBVH::Ray TriangleBVH
+      ::TransformRay(Ray const&ray, float const *matrix)
+    {
+      Ray result;
+      for(uint32_t a=0; a < 3; ++a) {
+        result.origin[a]
+          = ray.origin[0] * matrix[a] + ray.origin[1] * matrix[4 + a] + ray.origin[2] * matrix[8 + a] + matrix[12 + a];
+        result.direction[a]
+          = ray.direction[0] * matrix[a] + ray.direction[1] * matrix[4 + a] + ray.direction[2] * matrix[8 + a];
+      }
+      result.maxDistance = ray.maxDistance;
+      return result;
+    }
+
+    TriangleBVHBenchmarkResult BenchmarkTriangleBVH(
+      float    const*positions,
+      size_t         stride,
+      size_t         vertexCount,
+      uint32_t const*indices,
+      size_t         indexCount,
+      uint32_t       rayCount)
+    {
+      typedef TriangleBVH::Ray Ray;
+      typedef TriangleBVH::Hit Hit;
+
+      TriangleBVHBenchmarkResult result ={};
+
+      TriangleBVH bvh;
+      if(!bvh.build(positions, stride, vertexCount, indices, indexCount))
+        return result;
+
+      result.triangles = bvh.stats().triangles;
+      result.nodes     = bvh.stats().nodes;
+      result.buildMs   = bvh.stats().buildMs;
+
+      uint32_t seed = 0x2545F491u;
+      auto random = [&seed] () -> float
+      {
+        seed = seed * 1664525u + 1013904223u;
+        return float(seed >> 8) / float(1u << 24);
+      };
+
+      float center[3], extent[3];
+      for(uint32_t a=0; a < 3; ++a) {
+        center[a] = 0.5f * (bvh.boundsMin()[a] + bvh.boundsMax()[a]);
+        extent[a] = 0.5f * (bvh.boundsMax()[a] - bvh.boundsMin()[a]);
+      }
+      float const radius = std::sqrt(extent[0] * extent[0] + extent[1] * extent[1] + extent[2] * extent[2]);
+
+      // Packets of four: one origin outside the bounds, targets close to each other inside.
+      rayCount = (rayCount + 3) & ~3u;
+      std::vector<Ray> rays(rayCount);
+      for(uint32_t p=0; p < rayCount; p += 4) {
+        float direction[3] ={ random() - 0.5f, random() - 0.5f, random() - 0.5f };
+        float const length = std::sqrt(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]) + 1e-6f;
+
+        float origin[3], target[3];
+        for(uint32_t a=0; a < 3; ++a) {
+          origin[a] = center[a] + 1.5f * radius * direction[a] / length;
+          target[a] = center[a] + (random() - 0.5f) * extent[a];
+        }
+
+        for(uint32_t k=0; k < 4; ++k) {
+          Ray &ray = rays[p + k];
+          for(uint32_t a=0; a < 3; ++a) {
+            ray.origin[a]    = origin[a];
+            ray.direction[a] = (target[a] + 0.01f * radius * (random() - 0.5f)) - origin[a];
+          }
+          ray.maxDistance = 4.0f;
+        }
+      }
+
+      std::vector<Hit>     singleHits(rayCount);
+      std::vector<uint8_t> singleFound(rayCount);
+      TriangleBVHClock::time_point start = TriangleBVHClock::now();
+      for(uint32_t r=0; r < rayCount; ++r)
+        singleFound[r] = bvh.intersect(rays[r], singleHits[r]) ? 1 : 0;
+      double const singleMs = std::chrono::duration<double, std::milli>(TriangleBVHClock::now() - start).count();
+
+      std::vector<Hit>     packetHits(rayCount);
+      std::vector<uint32_t> packetFound(rayCount / 4);
+      start = TriangleBVHClock::now();
+      for(uint32_t p=0; p < rayCount; p += 4)
+        packetFound[p / 4] = bvh.intersect4(&rays[p], &packetHits[p]);
+      double const packetMs = std::chrono::duration<double, std::milli>(TriangleBVHClock::now() - start).count();
+
+      // Every triangle for a sample of the rays.
+      uint32_t const sample = std::min(rayCount, 1024u);
+      uint32_t       found  = 0;
+      bool           valid  = true;
+      start = TriangleBVHClock::now();
+      for(uint32_t r=0; r < sample; ++r) {
+        Ray const&ray     = rays[r];
+        float     closest = ray.maxDistance;
+        bool      hit     = false;
+        for(size_t t=0; (t + 2) < indexCount; t += 3) {
+          if(indices[t] >= vertexCount || indices[t + 1] >= vertexCount || indices[t + 2] >= vertexCount)
+            continue;
+
+          float const*p0 = reinterpret_cast<float const*>(reinterpret_cast<uint8_t const*>(positions) + size_t(indices[t])     * stride);
+          float const*p1 = reinterpret_cast<float const*>(reinterpret_cast<uint8_t const*>(positions) + size_t(indices[t + 1]) * stride);
+          float const*p2 = reinterpret_cast<float const*>(reinterpret_cast<uint8_t const*>(positions) + size_t(indices[t + 2]) * stride);
+
+          float const e1[3] ={ p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+          float const e2[3] ={ p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+
+          float d, u, v;
+          if(IntersectTriangle(p0, e1, e2, ray.origin, ray.direction, closest, d, u, v)) {
+            closest = d;
+            hit     = true;
+          }
+        }
+
+        valid &= (hit == (singleFound[r] != 0)) && (!hit || closest == singleHits[r].distance);
+      }
+      double const bruteMs = std::chrono::duration<double, std::milli>(TriangleBVHClock::now() - start).count();
+
+      for(uint32_t r=0; r < rayCount; ++r) {
+        bool const packetHit = (packetFound[r / 4] & (1u << (r % 4))) != 0;
+        valid &= (packetHit == (singleFound[r] != 0)) && (!packetHit || packetHits[r].distance == singleHits[r].distance);
+        found += singleFound[r];
+      }
+
+      result.rays                = rayCount;
+      result.hitRatio            = double(found) / rayCount;
+      result.raysPerSecond       = (singleMs > 0.0) ? (rayCount / (singleMs * 0.001)) : 0.0;
+      result.packetRaysPerSecond = (packetMs > 0.0) ? (rayCount / (packetMs * 0.001)) : 0.0;
+      result.speedup             = (singleMs > 0.0) ? ((bruteMs / sample) / (singleMs / rayCount)) : 0.0;
+      result.valid               = valid;
+      return result;
+    }
+
+  }
+}
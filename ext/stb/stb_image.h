@@ -437,6 +437,18 @@ STBIDEF void stbi_convert_iphone_png_to_rgb(int flag_true_if_should_convert);
 // flip the image vertically, so the first pixel in the output array is the bottom left
 STBIDEF void stbi_set_flip_vertically_on_load(int flag_true_if_should_flip);
 
+// decode a JPEG at 1/2, 1/4 or 1/8 size straight from its DCT coefficients,
+// which is much cheaper than a full decode followed by a resize. scale_denom
+// must be 1, 2, 4 or 8; the result is ceil(w/scale_denom) x ceil(h/scale_denom).
+// fails with "not JPEG" for any other image type.
+STBIDEF stbi_uc *stbi_load_jpeg_scaled_from_memory   (stbi_uc           const *buffer, int len   , int *x, int *y, int *channels_in_file, int desired_channels, int scale_denom);
+STBIDEF stbi_uc *stbi_load_jpeg_scaled_from_callbacks(stbi_io_callbacks const *clbk  , void *user, int *x, int *y, int *channels_in_file, int desired_channels, int scale_denom);
+
+#ifndef STBI_NO_STDIO
+STBIDEF stbi_uc *stbi_load_jpeg_scaled          (char const *filename, int *x, int *y, int *channels_in_file, int desired_channels, int scale_denom);
+STBIDEF stbi_uc *stbi_load_jpeg_scaled_from_file(FILE *f, int *x, int *y, int *channels_in_file, int desired_channels, int scale_denom);
+#endif
+
 // ZLIB client - used by PNG, available for other purposes
 
 STBIDEF char *stbi_zlib_decode_malloc_guesssize(const char *buffer, int len, int initial_size, int *outlen);
@@ -1696,6 +1708,7 @@ typedef struct
 
    int scan_n, order[4];
    int restart_interval, todo;
+   int scale_log2; // reconstruct at 1/(1<<scale_log2) size, 0..3
 
 // kernels
    void (*idct_block_kernel)(stbi_uc *out, int out_stride, short data[64]);
@@ -2211,6 +2224,82 @@ static void stbi__idct_block(stbi_uc *out, int out_stride, short data[64])
    }
 }
 
+// reduced-size IDCTs for scaled decoding (cf. jidctred). averaging an 8-point
+// basis function over a group of 2 (4, 8) pixels gives the same cosine
+// sampled at the group centre, attenuated by a per-frequency factor, so the
+// box-filtered 4x4 (2x2, 1x1) result only needs the top-left coefficients:
+// each 1D pass is a small even/odd butterfly with the 8-point normalisation
+// and the box attenuation folded into its constants. constants are 1<<12
+// scaled like above; the first pass keeps 2 extra bits, the second removes
+// 1<<14.
+#define STBI__IDCT_4_E0  stbi__f2f(0.353553391f) // 1/(2*sqrt(2))
+#define STBI__IDCT_4_E2  stbi__f2f(0.326640741f) // cos(pi/8)cos(pi/4)/2
+#define STBI__IDCT_4_O1a stbi__f2f(0.453063723f) // cos(pi/16)cos(pi/8)/2
+#define STBI__IDCT_4_O3a stbi__f2f(0.159094823f) // cos(3pi/16)cos(3pi/8)/2
+#define STBI__IDCT_4_O1b stbi__f2f(0.187665139f) // cos(pi/16)cos(3pi/8)/2
+#define STBI__IDCT_4_O3b stbi__f2f(0.384088878f) // -cos(3pi/16)cos(9pi/8)/2
+#define STBI__IDCT_2_O1  stbi__f2f(0.320364431f) // mean of cos((2x+1)pi/16), x<4, over 2
+
+#define STBI__IDCT_1D_4(s0,s1,s2,s3)                       \
+   int e0,e1,o0,o1;                                        \
+   e0 = (s0)*STBI__IDCT_4_E0  + (s2)*STBI__IDCT_4_E2;      \
+   e1 = (s0)*STBI__IDCT_4_E0  - (s2)*STBI__IDCT_4_E2;      \
+   o0 = (s1)*STBI__IDCT_4_O1a + (s3)*STBI__IDCT_4_O3a;     \
+   o1 = (s1)*STBI__IDCT_4_O1b - (s3)*STBI__IDCT_4_O3b;
+
+static void stbi__idct_block_4x4(stbi_uc *out, int out_stride, short data[64])
+{
+   int i,val[16],*v=val;
+   stbi_uc *o;
+   short *d = data;
+
+   // columns
+   for (i=0; i < 4; ++i,++d,++v) {
+      STBI__IDCT_1D_4(d[0],d[8],d[16],d[24])
+      e0 += 512; e1 += 512;
+      v[ 0] = (e0+o0) >> 10;
+      v[12] = (e0-o0) >> 10;
+      v[ 4] = (e1+o1) >> 10;
+      v[ 8] = (e1-o1) >> 10;
+   }
+
+   for (i=0, v=val, o=out; i < 4; ++i,v+=4,o+=out_stride) {
+      STBI__IDCT_1D_4(v[0],v[1],v[2],v[3])
+      e0 += 8192 + (128<<14);
+      e1 += 8192 + (128<<14);
+      o[0] = stbi__clamp((e0+o0) >> 14);
+      o[3] = stbi__clamp((e0-o0) >> 14);
+      o[1] = stbi__clamp((e1+o1) >> 14);
+      o[2] = stbi__clamp((e1-o1) >> 14);
+   }
+}
+
+static void stbi__idct_block_2x2(stbi_uc *out, int out_stride, short data[64])
+{
+   int c0,c1,c2,c3,r0,r1,r2,r3;
+   // columns
+   c0 = (data[0]*STBI__IDCT_4_E0 + data[8]*STBI__IDCT_2_O1 + 512) >> 10;
+   c1 = (data[1]*STBI__IDCT_4_E0 + data[9]*STBI__IDCT_2_O1 + 512) >> 10;
+   c2 = (data[0]*STBI__IDCT_4_E0 - data[8]*STBI__IDCT_2_O1 + 512) >> 10;
+   c3 = (data[1]*STBI__IDCT_4_E0 - data[9]*STBI__IDCT_2_O1 + 512) >> 10;
+   // rows
+   r0 = c0*STBI__IDCT_4_E0 + c1*STBI__IDCT_2_O1;
+   r1 = c0*STBI__IDCT_4_E0 - c1*STBI__IDCT_2_O1;
+   r2 = c2*STBI__IDCT_4_E0 + c3*STBI__IDCT_2_O1;
+   r3 = c2*STBI__IDCT_4_E0 - c3*STBI__IDCT_2_O1;
+   out[0]            = stbi__clamp((r0 + 8192 + (128<<14)) >> 14);
+   out[1]            = stbi__clamp((r1 + 8192 + (128<<14)) >> 14);
+   out[out_stride]   = stbi__clamp((r2 + 8192 + (128<<14)) >> 14);
+   out[out_stride+1] = stbi__clamp((r3 + 8192 + (128<<14)) >> 14);
+}
+
+static void stbi__idct_block_1x1(stbi_uc *out, int out_stride, short data[64])
+{
+   STBI_NOTUSED(out_stride);
+   // the block average is just the DC term over 8
+   out[0] = stbi__clamp(((data[0] + 4) >> 3) + 128);
+}
+
 #ifdef STBI_SSE2
 // sse2 integer IDCT. not the fastest possible implementation but it
 // produces bit-identical results to the generic C version so it's
@@ -2390,6 +2479,75 @@ static void stbi__idct_simd(stbi_uc *out, int out_stride, short data[64])
 #undef dct_pass
 }
 
+// sse2 version of stbi__idct_block_4x4: the four columns (rows) go through
+// each pass at once via the same interleave+madd trick as above, so it is
+// bit-identical to the C version for all in-range input.
+static void stbi__idct_simd_4x4(stbi_uc *out, int out_stride, short data[64])
+{
+   __m128i r0, r1, r2, r3, i02, i13, e0, e1, o0, o1, p0, p1, t0, t1, u0, u1;
+   int k;
+
+   #define dct4_const(x,y)  _mm_setr_epi16((x),(y),(x),(y),(x),(y),(x),(y))
+   __m128i rot_ee = dct4_const(STBI__IDCT_4_E0,   STBI__IDCT_4_E2);
+   __m128i rot_en = dct4_const(STBI__IDCT_4_E0,  -STBI__IDCT_4_E2);
+   __m128i rot_o0 = dct4_const(STBI__IDCT_4_O1a,  STBI__IDCT_4_O3a);
+   __m128i rot_o1 = dct4_const(STBI__IDCT_4_O1b, -STBI__IDCT_4_O3b);
+   __m128i bias_0 = _mm_set1_epi32(512);
+   __m128i bias_1 = _mm_set1_epi32(8192 + (128<<14));
+
+   // butterfly over 4 lanes; out_k are 32-bit, in output order 0,1,2,3
+   #define dct4_pass(bias, shift) \
+      e0 = _mm_madd_epi16(i02, rot_ee); \
+      e1 = _mm_madd_epi16(i02, rot_en); \
+      o0 = _mm_madd_epi16(i13, rot_o0); \
+      o1 = _mm_madd_epi16(i13, rot_o1); \
+      e0 = _mm_add_epi32(e0, bias); \
+      e1 = _mm_add_epi32(e1, bias); \
+      r0 = _mm_srai_epi32(_mm_add_epi32(e0, o0), shift); \
+      r3 = _mm_srai_epi32(_mm_sub_epi32(e0, o0), shift); \
+      r1 = _mm_srai_epi32(_mm_add_epi32(e1, o1), shift); \
+      r2 = _mm_srai_epi32(_mm_sub_epi32(e1, o1), shift)
+
+   // 4x4 16-bit transpose of (a0..a3 b0..b3), (c0..c3 d0..d3)
+   #define dct4_transpose(x, y) \
+      t0 = _mm_unpacklo_epi16(x, y); \
+      t1 = _mm_unpackhi_epi16(x, y); \
+      u0 = _mm_unpacklo_epi16(t0, t1); \
+      u1 = _mm_unpackhi_epi16(t0, t1)
+
+   // columns: lanes are the four columns of each coefficient row
+   r0 = _mm_loadl_epi64((const __m128i *) (data + 0*8));
+   r1 = _mm_loadl_epi64((const __m128i *) (data + 1*8));
+   r2 = _mm_loadl_epi64((const __m128i *) (data + 2*8));
+   r3 = _mm_loadl_epi64((const __m128i *) (data + 3*8));
+   i02 = _mm_unpacklo_epi16(r0, r2);
+   i13 = _mm_unpacklo_epi16(r1, r3);
+   dct4_pass(bias_0, 10);
+
+   // transpose so lanes become rows, then pair up inputs 0/2 and 1/3
+   p0 = _mm_packs_epi32(r0, r1);
+   p1 = _mm_packs_epi32(r2, r3);
+   dct4_transpose(p0, p1);
+   i02 = _mm_unpacklo_epi16(u0, u1);
+   i13 = _mm_unpackhi_epi16(u0, u1);
+   dct4_pass(bias_1, 14);
+
+   // back to row-major, then saturate to 0..255
+   p0 = _mm_packs_epi32(r0, r1);
+   p1 = _mm_packs_epi32(r2, r3);
+   dct4_transpose(p0, p1);
+   p0 = _mm_packus_epi16(u0, u1);
+   for (k=0; k < 4; ++k, out += out_stride) {
+      int row = _mm_cvtsi128_si32(p0);
+      memcpy(out, &row, 4);
+      p0 = _mm_srli_si128(p0, 4);
+   }
+
+   #undef dct4_const
+   #undef dct4_pass
+   #undef dct4_transpose
+}
+
 #endif // STBI_SSE2
 
 #ifdef STBI_NEON
@@ -2652,7 +2810,7 @@ static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
             for (i=0; i < w; ++i) {
                int ha = z->img_comp[n].ha;
                if (!stbi__jpeg_decode_block(z, data, z->huff_dc+z->img_comp[n].hd, z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
-               z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*j*8+i*8, z->img_comp[n].w2, data);
+               z->idct_block_kernel(z->img_comp[n].data+((z->img_comp[n].w2*j+i)<<(3-z->scale_log2)), z->img_comp[n].w2, data);
                // every data block is an MCU, so countdown the restart interval
                if (--z->todo <= 0) {
                   if (z->code_bits < 24) stbi__grow_buffer_unsafe(z);
@@ -2676,8 +2834,8 @@ static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
                   // by the basic H and V specified for the component
                   for (y=0; y < z->img_comp[n].v; ++y) {
                      for (x=0; x < z->img_comp[n].h; ++x) {
-                        int x2 = (i*z->img_comp[n].h + x)*8;
-                        int y2 = (j*z->img_comp[n].v + y)*8;
+                        int x2 = (i*z->img_comp[n].h + x) << (3-z->scale_log2);
+                        int y2 = (j*z->img_comp[n].v + y) << (3-z->scale_log2);
                         int ha = z->img_comp[n].ha;
                         if (!stbi__jpeg_decode_block(z, data, z->huff_dc+z->img_comp[n].hd, z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
                         z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*y2+x2, z->img_comp[n].w2, data);
@@ -2758,6 +2916,26 @@ static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
    }
 }
 
+// skip a scan's entropy-coded data by searching for the next real marker.
+// a 1/8 scaled decode only needs DC, so it can drop every progressive AC
+// scan this way. (bigger scales can't: an AC refinement scan reads one
+// correction bit per already-nonzero coefficient across its whole band,
+// so it needs the skipped high-frequency history to stay in sync.)
+static void stbi__jpeg_skip_scan(stbi__jpeg *z)
+{
+   while (!stbi__at_eof(z->s)) {
+      int x = stbi__get8(z->s);
+      if (x == 255) {
+         while (x == 255)
+            x = stbi__get8(z->s); // consume repeated 0xff fill bytes
+         if (x != 0 && !STBI__RESTART(x)) {
+            z->marker = (unsigned char) x;
+            return;
+         }
+      }
+   }
+}
+
 static void stbi__jpeg_dequantize(short *data, stbi__uint16 *dequant)
 {
    int i;
@@ -2777,7 +2955,7 @@ static void stbi__jpeg_finish(stbi__jpeg *z)
             for (i=0; i < w; ++i) {
                short *data = z->img_comp[n].coeff + 64 * (i + j * z->img_comp[n].coeff_w);
                stbi__jpeg_dequantize(data, z->dequant[z->img_comp[n].tq]);
-               z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*j*8+i*8, z->img_comp[n].w2, data);
+               z->idct_block_kernel(z->img_comp[n].data+((z->img_comp[n].w2*j+i)<<(3-z->scale_log2)), z->img_comp[n].w2, data);
             }
          }
       }
@@ -3007,8 +3185,11 @@ static int stbi__process_frame_header(stbi__jpeg *z, int scan)
       //
       // img_mcu_x, img_mcu_y: <=17 bits; comp[i].h and .v are <=4 (checked earlier)
       // so these muls can't overflow with 32-bit ints (which we require)
-      z->img_comp[i].w2 = z->img_mcu_x * z->img_comp[i].h * 8;
-      z->img_comp[i].h2 = z->img_mcu_y * z->img_comp[i].v * 8;
+      //
+      // with a scaled decode every 8x8 block reconstructs to only
+      // (8>>scale_log2)^2 pixels, so the planes shrink accordingly
+      z->img_comp[i].w2 = (z->img_mcu_x * z->img_comp[i].h * 8) >> z->scale_log2;
+      z->img_comp[i].h2 = (z->img_mcu_y * z->img_comp[i].v * 8) >> z->scale_log2;
       z->img_comp[i].coeff = 0;
       z->img_comp[i].raw_coeff = 0;
       z->img_comp[i].linebuf = NULL;
@@ -3018,10 +3199,10 @@ static int stbi__process_frame_header(stbi__jpeg *z, int scan)
       // align blocks for idct using mmx/sse
       z->img_comp[i].data = (stbi_uc*) (((size_t) z->img_comp[i].raw_data + 15) & ~15);
       if (z->progressive) {
-         // w2, h2 are multiples of 8 (see above)
-         z->img_comp[i].coeff_w = z->img_comp[i].w2 / 8;
-         z->img_comp[i].coeff_h = z->img_comp[i].h2 / 8;
-         z->img_comp[i].raw_coeff = stbi__malloc_mad3(z->img_comp[i].w2, z->img_comp[i].h2, sizeof(short), 15);
+         // coefficients are always kept for the full 8x8 blocks
+         z->img_comp[i].coeff_w = z->img_mcu_x * z->img_comp[i].h;
+         z->img_comp[i].coeff_h = z->img_mcu_y * z->img_comp[i].v;
+         z->img_comp[i].raw_coeff = stbi__malloc_mad3(z->img_comp[i].coeff_w * 8, z->img_comp[i].coeff_h * 8, sizeof(short), 15);
          if (z->img_comp[i].raw_coeff == NULL)
             return stbi__free_jpeg_components(z, i+1, stbi__err("outofmem", "Out of memory"));
          z->img_comp[i].coeff = (short*) (((size_t) z->img_comp[i].raw_coeff + 15) & ~15);
@@ -3078,7 +3259,9 @@ static int stbi__decode_jpeg_image(stbi__jpeg *j)
    while (!stbi__EOI(m)) {
       if (stbi__SOS(m)) {
          if (!stbi__process_scan_header(j)) return 0;
-         if (!stbi__parse_entropy_coded_data(j)) return 0;
+         if (j->progressive && j->scale_log2 == 3 && j->spec_start != 0)
+            stbi__jpeg_skip_scan(j);
+         else if (!stbi__parse_entropy_coded_data(j)) return 0;
          if (j->marker == STBI__MARKER_none ) {
             // handle 0s at the end of image data from IP Kamera 9060
             while (!stbi__at_eof(j->s)) {
@@ -3479,6 +3662,7 @@ static void stbi__YCbCr_to_RGB_simd(stbi_uc *out, stbi_uc const *y, stbi_uc cons
 // set up the kernels
 static void stbi__setup_jpeg(stbi__jpeg *j)
 {
+   j->scale_log2 = 0;
    j->idct_block_kernel = stbi__idct_block;
    j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_row;
    j->resample_row_hv_2_kernel = stbi__resample_row_hv_2;
@@ -3498,6 +3682,25 @@ static void stbi__setup_jpeg(stbi__jpeg *j)
 #endif
 }
 
+// switch to one of the reduced-size IDCTs; colorspace conversion and
+// upsampling keep using whatever kernels stbi__setup_jpeg picked
+static void stbi__setup_jpeg_scale(stbi__jpeg *j, int scale_log2)
+{
+   j->scale_log2 = scale_log2;
+   switch (scale_log2) {
+      case 1:
+         j->idct_block_kernel = stbi__idct_block_4x4;
+#ifdef STBI_SSE2
+         if (stbi__sse2_available())
+            j->idct_block_kernel = stbi__idct_simd_4x4;
+#endif
+         break;
+      case 2: j->idct_block_kernel = stbi__idct_block_2x2; break;
+      case 3: j->idct_block_kernel = stbi__idct_block_1x1; break;
+      default: break;
+   }
+}
+
 // clean up the temporary component buffers
 static void stbi__cleanup_jpeg(stbi__jpeg *j)
 {
@@ -3532,6 +3735,18 @@ static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp
    // load a jpeg image from whichever source, but leave in YCbCr format
    if (!stbi__decode_jpeg_image(z)) { stbi__cleanup_jpeg(z); return NULL; }
 
+   // a scaled decode reconstructed every plane at reduced size, so shrink
+   // the logical dimensions to match before resampling
+   if (z->scale_log2) {
+      int k, round = (1 << z->scale_log2) - 1;
+      z->s->img_x = (z->s->img_x + round) >> z->scale_log2;
+      z->s->img_y = (z->s->img_y + round) >> z->scale_log2;
+      for (k=0; k < z->s->img_n; ++k) {
+         z->img_comp[k].x = (z->img_comp[k].x + round) >> z->scale_log2;
+         z->img_comp[k].y = (z->img_comp[k].y + round) >> z->scale_log2;
+      }
+   }
+
    // determine actual number of components to generate
    n = req_comp ? req_comp : z->s->img_n >= 3 ? 3 : 1;
 
@@ -3727,6 +3942,81 @@ static int stbi__jpeg_info(stbi__context *s, int *x, int *y, int *comp)
 }
 #endif
 
+#ifndef STBI_NO_JPEG
+static stbi_uc *stbi__jpeg_load_scaled(stbi__context *s, int *x, int *y, int *comp, int req_comp, int scale_denom)
+{
+   unsigned char* result;
+   stbi__jpeg* j;
+   int scale_log2;
+   switch (scale_denom) {
+      case 1: scale_log2 = 0; break;
+      case 2: scale_log2 = 1; break;
+      case 4: scale_log2 = 2; break;
+      case 8: scale_log2 = 3; break;
+      default: return stbi__errpuc("bad scale", "JPEG scale must be 1, 2, 4 or 8");
+   }
+   if (!stbi__jpeg_test(s)) return stbi__errpuc("not JPEG", "Image is not a JPEG");
+   j = (stbi__jpeg*) stbi__malloc(sizeof(stbi__jpeg));
+   if (!j) return stbi__errpuc("outofmem", "Out of memory");
+   j->s = s;
+   stbi__setup_jpeg(j);
+   stbi__setup_jpeg_scale(j, scale_log2);
+   result = load_jpeg_image(j, x,y,comp,req_comp);
+   STBI_FREE(j);
+
+   if (result && stbi__vertically_flip_on_load) {
+      int channels = req_comp ? req_comp : *comp;
+      stbi__vertical_flip(result, *x, *y, channels * sizeof(stbi_uc));
+   }
+   return result;
+}
+#else
+static stbi_uc *stbi__jpeg_load_scaled(stbi__context *s, int *x, int *y, int *comp, int req_comp, int scale_denom)
+{
+   STBI_NOTUSED(s); STBI_NOTUSED(x); STBI_NOTUSED(y); STBI_NOTUSED(comp); STBI_NOTUSED(req_comp); STBI_NOTUSED(scale_denom);
+   return stbi__errpuc("not JPEG", "JPEG support disabled");
+}
+#endif
+
+STBIDEF stbi_uc *stbi_load_jpeg_scaled_from_memory(stbi_uc const *buffer, int len, int *x, int *y, int *comp, int req_comp, int scale_denom)
+{
+   stbi__context s;
+   stbi__start_mem(&s,buffer,len);
+   return stbi__jpeg_load_scaled(&s,x,y,comp,req_comp,scale_denom);
+}
+
+STBIDEF stbi_uc *stbi_load_jpeg_scaled_from_callbacks(stbi_io_callbacks const *clbk, void *user, int *x, int *y, int *comp, int req_comp, int scale_denom)
+{
+   stbi__context s;
+   stbi__start_callbacks(&s, (stbi_io_callbacks *) clbk, user);
+   return stbi__jpeg_load_scaled(&s,x,y,comp,req_comp,scale_denom);
+}
+
+#ifndef STBI_NO_STDIO
+STBIDEF stbi_uc *stbi_load_jpeg_scaled(char const *filename, int *x, int *y, int *comp, int req_comp, int scale_denom)
+{
+   FILE *f = stbi__fopen(filename, "rb");
+   unsigned char *result;
+   if (!f) return stbi__errpuc("can't fopen", "Unable to open file");
+   result = stbi_load_jpeg_scaled_from_file(f,x,y,comp,req_comp,scale_denom);
+   fclose(f);
+   return result;
+}
+
+STBIDEF stbi_uc *stbi_load_jpeg_scaled_from_file(FILE *f, int *x, int *y, int *comp, int req_comp, int scale_denom)
+{
+   unsigned char *result;
+   stbi__context s;
+   stbi__start_file(&s,f);
+   result = stbi__jpeg_load_scaled(&s,x,y,comp,req_comp,scale_denom);
+   if (result) {
+      // need to 'unget' all the characters in the IO buffer
+      fseek(f, - (int) (s.img_buffer_end - s.img_buffer), SEEK_CUR);
+   }
+   return result;
+}
+#endif //!STBI_NO_STDIO
+
 // public domain zlib decode    v0.2  Sean Barrett 2006-11-18
 //    simple implementation
 //      - all input must be provided in an upfront buffer